@@ -0,0 +1,96 @@
+#include "VBackBuffer.h"
+
+uint32_t VBackBuffer::m_numObjects = 0;
+uint32_t VBackBuffer::m_numPaints = 0;
+LARGE_INTEGER VBackBuffer::m_lastCount = { 0 };
+
+VBackBuffer::VBackBuffer() :
+  m_dc(nullptr),
+  m_bitmap(nullptr),
+  m_oldBitmap(nullptr),
+  m_width(0),
+  m_height(0)
+{
+}
+
+VBackBuffer::~VBackBuffer()
+{
+  destroy();
+}
+
+bool VBackBuffer::resize(HDC hdc, uint32_t width, uint32_t height)
+{
+  if (m_dc && width == m_width && height == m_height) {
+    return false;
+  }
+  destroy();
+  if (!width || !height) {
+    return false;
+  }
+  m_dc = CreateCompatibleDC(hdc);
+  if (!m_dc) {
+    return false;
+  }
+  m_bitmap = CreateCompatibleBitmap(hdc, width, height);
+  if (!m_bitmap) {
+    DeleteDC(m_dc);
+    m_dc = nullptr;
+    return false;
+  }
+  m_oldBitmap = (HBITMAP)SelectObject(m_dc, m_bitmap);
+  m_width = width;
+  m_height = height;
+  m_numObjects += 2;
+  return true;
+}
+
+void VBackBuffer::destroy()
+{
+  if (!m_dc) {
+    return;
+  }
+  // the bitmap can't be deleted while it's still selected
+  SelectObject(m_dc, m_oldBitmap);
+  DeleteObject(m_bitmap);
+  DeleteDC(m_dc);
+  m_dc = nullptr;
+  m_bitmap = nullptr;
+  m_oldBitmap = nullptr;
+  m_width = 0;
+  m_height = 0;
+  m_numObjects -= 2;
+}
+
+void VBackBuffer::present(HDC hdc)
+{
+  if (!m_dc) {
+    return;
+  }
+  BitBlt(hdc, 0, 0, m_width, m_height, m_dc, 0, 0, SRCCOPY);
+  if (!m_lastCount.QuadPart) {
+    // the rate is counted from the first paint
+    QueryPerformanceCounter(&m_lastCount);
+  }
+  m_numPaints++;
+}
+
+double VBackBuffer::paintsPerSec()
+{
+  if (!m_lastCount.QuadPart) {
+    return 0;
+  }
+  LARGE_INTEGER freq;
+  LARGE_INTEGER now;
+  QueryPerformanceFrequency(&freq);
+  QueryPerformanceCounter(&now);
+  double elapsedSec = (double)(now.QuadPart - m_lastCount.QuadPart) / (double)freq.QuadPart;
+  double rate = (elapsedSec > 0) ? m_numPaints / elapsedSec : 0;
+  m_lastCount = now;
+  m_numPaints = 0;
+  return rate;
+}
+
+uint32_t VBackBuffer::processObjects()
+{
+  return GetGuiResources(GetCurrentProcess(), GR_GDIOBJECTS);
+}
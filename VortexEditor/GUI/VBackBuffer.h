@@ -0,0 +1,55 @@
+#pragma once
+
+// windows includes
+#include <windows.h>
+
+#include <stdint.h>
+
+// An offscreen bitmap for a widget to draw into before it's copied to the
+// window, kept for the life of the widget instead of being made on every
+// paint. It's only created again when the widget changes size, so a widget
+// that is repainted on every move of a drag doesn't create or delete any
+// gdi objects at all.
+//
+// Every buffer counts the gdi objects it holds and the times it was copied
+// to a window, which is all a custom drawn widget does on a paint.
+class VBackBuffer
+{
+public:
+  VBackBuffer();
+  ~VBackBuffer();
+
+  // make sure the buffer fits a window of this size, returns true if it
+  // was created and whatever was drawn into it before is gone
+  bool resize(HDC hdc, uint32_t width, uint32_t height);
+  void destroy();
+
+  // copy the whole buffer to the window
+  void present(HDC hdc);
+
+  HDC dc() const { return m_dc; }
+  uint32_t width() const { return m_width; }
+  uint32_t height() const { return m_height; }
+
+  // the paints per second of every buffer since the last call
+  static double paintsPerSec();
+  // the gdi objects held by every buffer, and by the whole process
+  static uint32_t numObjects() { return m_numObjects; }
+  static uint32_t processObjects();
+
+private:
+  // the buffers belong to the window they were made for
+  VBackBuffer(const VBackBuffer &) = delete;
+  VBackBuffer &operator=(const VBackBuffer &) = delete;
+
+  HDC m_dc;
+  HBITMAP m_bitmap;
+  HBITMAP m_oldBitmap;
+  uint32_t m_width;
+  uint32_t m_height;
+
+  // only touched on the ui thread
+  static uint32_t m_numObjects;
+  static uint32_t m_numPaints;
+  static LARGE_INTEGER m_lastCount;
+};
@@ -23,7 +23,10 @@ VColorSelect::VColorSelect() :
   m_color(0),
   m_active(false),
   m_selected(false),
-  m_selectable(true)
+  m_selectable(true),
+  m_backbuffer(),
+  m_drawnBorder(0),
+  m_drawnFront(0)
 {
 }
 
@@ -78,23 +81,18 @@ void VColorSelect::init(HINSTANCE hInstance, VWindow &parent, const string &titl
 
 void VColorSelect::cleanup()
 {
+  m_backbuffer.destroy();
 }
 
 void VColorSelect::create()
 {
 }
 
-static HBRUSH getBrushCol(DWORD rgbcol)
+// fill with the stock dc brush so no brush is created per color
+static void fillRectCol(HDC hdc, const RECT *rect, DWORD rgbcol)
 {
-  static std::map<COLORREF, HBRUSH> m_brushmap;
-  HBRUSH br;
-  COLORREF col = RGB((rgbcol >> 16) & 0xFF, (rgbcol >> 8) & 0xFF, rgbcol & 0xFF);
-  if (m_brushmap.find(col) == m_brushmap.end()) {
-    br = CreateSolidBrush(col);
-    m_brushmap[col] = br;
-  }
-  br = m_brushmap[col];
-  return br;
+  SetDCBrushColor(hdc, RGB((rgbcol >> 16) & 0xFF, (rgbcol >> 8) & 0xFF, rgbcol & 0xFF));
+  FillRect(hdc, rect, (HBRUSH)GetStockObject(DC_BRUSH));
 }
 
 void VColorSelect::paint()
@@ -109,11 +107,6 @@ void VColorSelect::paint()
   uint32_t width = rect.right - rect.left;
   uint32_t height = rect.bottom - rect.top;
 
-  // create a backbuffer and select it
-  HDC backbuffDC = CreateCompatibleDC(hdc);
-  HBITMAP backbuffer = CreateCompatibleBitmap(hdc, width, height);
-  SelectObject(backbuffDC, backbuffer);
-
   COLORREF frontCol = getColor();
   COLORREF borderCol;
 
@@ -129,19 +122,25 @@ void VColorSelect::paint()
       frontCol = 0;
     }
   }
-  FillRect(backbuffDC, &rect, getBrushCol(borderCol));
-
-#define BORDER_WIDTH 1
-  rect.left += BORDER_WIDTH;
-  rect.top += BORDER_WIDTH;
-  rect.right -= BORDER_WIDTH;
-  rect.bottom -= BORDER_WIDTH;
-  FillRect(backbuffDC, &rect, getBrushCol(frontCol));
 
-  BitBlt(hdc, 0, 0, width, height, backbuffDC, 0, 0, SRCCOPY);
+  // the backbuffer is only made again on a resize and only drawn into
+  // again when the colors change, otherwise a paint is just the copy
+  bool created = m_backbuffer.resize(hdc, width, height);
+  HDC backbuffDC = m_backbuffer.dc();
+  if (backbuffDC && (created || borderCol != m_drawnBorder || frontCol != m_drawnFront)) {
+    fillRectCol(backbuffDC, &rect, borderCol);
 
-  DeleteObject(backbuffer);
-  DeleteDC(backbuffDC);
+#define BORDER_WIDTH 1
+    rect.left += BORDER_WIDTH;
+    rect.top += BORDER_WIDTH;
+    rect.right -= BORDER_WIDTH;
+    rect.bottom -= BORDER_WIDTH;
+    fillRectCol(backbuffDC, &rect, frontCol);
+
+    m_drawnBorder = borderCol;
+    m_drawnFront = frontCol;
+  }
+  m_backbuffer.present(hdc);
 
   EndPaint(m_hwnd, &paintStruct);
 }
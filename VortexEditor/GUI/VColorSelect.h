@@ -2,6 +2,7 @@
 
 #include "VWindow.h"
 
+#include "VBackBuffer.h"
 #include "VLabel.h"
 
 class VColorSelect : public VWindow
@@ -71,4 +72,9 @@ private:
   bool m_selected;
   // whether this control is selectable
   bool m_selectable;
+
+  // kept between paints and only drawn into again when the colors change
+  VBackBuffer m_backbuffer;
+  COLORREF m_drawnBorder;
+  COLORREF m_drawnFront;
 };
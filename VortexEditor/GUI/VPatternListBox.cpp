@@ -1,102 +1,666 @@
 #include "VPatternListBox.h"
+
+// Windows includes
 #include <CommCtrl.h>
 #include <Windowsx.h>
 
+// Vortex Engine includes
+#include "EditorConfig.h"
+
+// Editor includes
+#include "VortexModeHash.h"
+#include "VPatternScheduler.h"
+#include "VPixels.h"
+
+#include <algorithm>
+
+using namespace std;
+
 #define WC_PATTERN_LIST_BOX "VPatternListBox"
 
-// Constructor with initialization list
-VPatternListBox::VPatternListBox() 
-    : VWindow(), m_scrollPos(0), m_callback(nullptr) {}
+// each line of the list is a strip of the pattern with the name beside it
+#define LIST_ROW_HEIGHT 38
+#define LIST_STRIP_HEIGHT 32
+#define LIST_STRIP_WIDTH 240
+#define LIST_LINE_SIZE 2
+#define LIST_NAME_MARGIN 8
+// how fast the previews play
+#define LIST_TICKRATE 40
+
+// how long a paint can spend recording timelines, at least one is recorded
+#define LIST_RECORD_BUDGET_MS 4.0
+// how many timelines are kept after their rows scroll away
+#define LIST_CACHED_TIMELINES 64
+
+// a row that isn't showing any item
+#define LIST_NO_ITEM UINT32_MAX
+// rows that are waiting on their timeline or have no mode
+#define LIST_PLACEHOLDER_COLOR 0x282828
+
+// lines scrolled by a notch of the mouse wheel
+#define LIST_WHEEL_LINES 3
+
+WNDCLASS VPatternListBox::m_wc = { 0 };
 
-// Delegate constructor
-VPatternListBox::VPatternListBox(HINSTANCE hInstance, VWindow &parent, uint32_t width, uint32_t height, 
-                                 uint32_t x, uint32_t y, uintptr_t menuID, VWindowCallback callback) 
-    : VPatternListBox() {
-    init(hInstance, parent, width, height, x, y, menuID, callback);
+// a COLORREF is 0x00BBGGRR and the pixels are 0x00RRGGBB
+static uint32_t toPixel(COLORREF col)
+{
+  return ((uint32_t)GetRValue(col) << 16) | ((uint32_t)GetGValue(col) << 8) | GetBValue(col);
 }
 
-// Destructor
-VPatternListBox::~VPatternListBox() {
-    cleanup();
+VPatternListBox::VPatternListBox() :
+  VWindow(),
+  m_vortex(),
+  m_items(),
+  m_rows(),
+  m_rowLock(),
+  m_timelines(),
+  m_useCount(0),
+  m_active(false),
+  m_scrollPos(0),
+  m_drawColors(),
+  m_backbufferDC(nullptr),
+  m_backbuffer(nullptr),
+  m_oldBitmap(nullptr),
+  m_oldFont(nullptr),
+  m_pixels(nullptr),
+  m_backbufferWidth(0),
+  m_backbufferHeight(0),
+  m_numRecorded(0),
+  m_numFrames(0),
+  m_frameSec(0)
+{
+  InitializeSRWLock(&m_rowLock);
 }
 
-// Initialize the VPatternListBox
-void VPatternListBox::init(HINSTANCE hInstance, VWindow &parent, uint32_t width, uint32_t height, 
-                           uint32_t x, uint32_t y, uintptr_t menuID, VWindowCallback callback) {
-    m_callback = callback;
+VPatternListBox::VPatternListBox(HINSTANCE hInstance, VWindow &parent, COLORREF backcol,
+  uint32_t width, uint32_t height, uint32_t x, uint32_t y, uintptr_t menuID) :
+  VPatternListBox()
+{
+  init(hInstance, parent, backcol, width, height, x, y, menuID);
+}
 
-    m_hwnd = CreateWindow(WC_PATTERN_LIST_BOX, "", WS_CHILD | WS_VISIBLE | WS_VSCROLL,
-                          x, y, width, height, parent.hwnd(), (HMENU)menuID, hInstance, nullptr);
-    if (!m_hwnd) {
-        MessageBox(nullptr, "Failed to create pattern list box", "Error", MB_OK);
-        return;
-    }
+VPatternListBox::~VPatternListBox()
+{
+  cleanup();
+}
+
+void VPatternListBox::init(HINSTANCE hInstance, VWindow &parent, COLORREF backcol,
+  uint32_t width, uint32_t height, uint32_t x, uint32_t y, uintptr_t menuID)
+{
+  m_backColor = backcol;
+  m_foreColor = RGB(0xD0, 0xD0, 0xD0);
+
+  // register window class if it hasn't been registered yet
+  registerWindowClass(hInstance, backcol);
+
+  if (!menuID) {
+    menuID = nextMenuID++;
+  }
+
+  if (!parent.addChild(menuID, this)) {
+    return;
+  }
+
+  // create the window
+  m_hwnd = CreateWindow(WC_PATTERN_LIST_BOX, "",
+    WS_CHILD | WS_VISIBLE | WS_VSCROLL | WS_TABSTOP,
+    x, y, width, height, parent.hwnd(), (HMENU)menuID, nullptr, nullptr);
+  if (!m_hwnd) {
+    MessageBox(nullptr, "Failed to open window", "Error", 0);
+    throw exception("idk");
+  }
 
-    SetWindowLongPtr(m_hwnd, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(this));
+  // set 'this' in the user data area of the class so that the static callback
+  // routine can access the object
+  SetWindowLongPtr(m_hwnd, GWLP_USERDATA, (LONG_PTR)this);
+
+  // the engine only ever records, the scheduler paces the playback
+  m_vortex.init();
+  m_vortex.setLedCount(1);
+  m_vortex.setTickrate(LIST_TICKRATE);
+  m_vortex.setInstantTimestep(true);
+
+  // the first WM_SIZE came before the window knew about this object
+  RECT rect;
+  GetClientRect(m_hwnd, &rect);
+  resize(rect.right, rect.bottom);
+}
+
+void VPatternListBox::cleanup()
+{
+  if (m_active) {
+    setActive(false);
+  }
+  m_rows.clear();
+  destroyBackBuffer();
+}
+
+void VPatternListBox::create()
+{
+}
+
+void VPatternListBox::paint()
+{
+  PAINTSTRUCT ps;
+  HDC hdc = BeginPaint(m_hwnd, &ps);
+  // rows that just scrolled in are bound before the frame is drawn
+  bool pending = bindRows();
+  LARGE_INTEGER freq;
+  LARGE_INTEGER startTime;
+  LARGE_INTEGER endTime;
+  QueryPerformanceFrequency(&freq);
+  QueryPerformanceCounter(&startTime);
+  drawToBackBuffer();
+  BitBlt(hdc, 0, 0, m_backbufferWidth, m_backbufferHeight, m_backbufferDC, 0, 0, SRCCOPY);
+  QueryPerformanceCounter(&endTime);
+  EndPaint(m_hwnd, &ps);
+  m_frameSec += (double)(endTime.QuadPart - startTime.QuadPart) / (double)freq.QuadPart;
+  m_numFrames++;
+  if (pending) {
+    // the rest of the timelines are recorded over the next paints
+    InvalidateRect(m_hwnd, nullptr, FALSE);
+  }
 }
 
-// Clean up resources
-void VPatternListBox::cleanup() {
-    // Cleanup logic here
+void VPatternListBox::command(WPARAM wParam, LPARAM lParam)
+{
 }
 
-// Handle creation logic
-void VPatternListBox::create() {
-    // Additional setup on creation
+void VPatternListBox::pressButton(WPARAM wParam, LPARAM lParam)
+{
+  // take focus so the wheel scrolls the list
+  SetFocus(m_hwnd);
 }
 
-// Handle painting of the list box
-void VPatternListBox::paint() {
-    PAINTSTRUCT ps;
-    HDC hdc = BeginPaint(m_hwnd, &ps);
+void VPatternListBox::releaseButton(WPARAM wParam, LPARAM lParam)
+{
+}
+
+void VPatternListBox::addItem(const string &name, const ByteStream &mode)
+{
+  Item item;
+  item.name = name;
+  item.mode = mode;
+  item.hash = mode.rawSize() ? VortexModeHash::hashMode(mode) : 0;
+  m_items.push_back(move(item));
+  updateScrollBar();
+  InvalidateRect(m_hwnd, nullptr, FALSE);
+}
+
+void VPatternListBox::removeItem(uint32_t index)
+{
+  if (index >= m_items.size()) {
+    return;
+  }
+  m_items.erase(m_items.begin() + index);
+  // everything after the item moved up a line, the rows find their
+  // timelines again in the cache
+  AcquireSRWLockExclusive(&m_rowLock);
+  for (Row &row : m_rows) {
+    row.item = LIST_NO_ITEM;
+    row.pending = false;
+    startRow(row, nullptr);
+  }
+  ReleaseSRWLockExclusive(&m_rowLock);
+  scroll(m_scrollPos);
+  updateScrollBar();
+  InvalidateRect(m_hwnd, nullptr, FALSE);
+}
+
+void VPatternListBox::clearItems()
+{
+  // the cached timelines stay, the same modes are often shown again
+  m_items.clear();
+  AcquireSRWLockExclusive(&m_rowLock);
+  for (Row &row : m_rows) {
+    row.item = LIST_NO_ITEM;
+    row.pending = false;
+    startRow(row, nullptr);
+  }
+  ReleaseSRWLockExclusive(&m_rowLock);
+  m_scrollPos = 0;
+  updateScrollBar();
+  InvalidateRect(m_hwnd, nullptr, FALSE);
+}
 
-    drawPatternStrips(hdc);
+string VPatternListBox::itemName(uint32_t index) const
+{
+  if (index >= m_items.size()) {
+    return "";
+  }
+  return m_items[index].name;
+}
 
-    EndPaint(m_hwnd, &ps);
+const ByteStream *VPatternListBox::itemMode(uint32_t index) const
+{
+  if (index >= m_items.size()) {
+    return nullptr;
+  }
+  return &m_items[index].mode;
 }
 
-// Add a new pattern strip to the list
-void VPatternListBox::addPatternStrip(std::shared_ptr<VPatternStrip> patternStrip) {
-    m_patternStrips.push_back(patternStrip);
-    // Update view
+void VPatternListBox::scrollTo(uint32_t index)
+{
+  scroll((int64_t)index * LIST_ROW_HEIGHT);
 }
 
-// Remove a pattern strip from the list
-void VPatternListBox::removePatternStrip(size_t index) {
-    if (index < m_patternStrips.size()) {
-        m_patternStrips.erase(m_patternStrips.begin() + index);
-        // Update view
+void VPatternListBox::setActive(bool active)
+{
+  if (m_active == active) {
+    return;
+  }
+  m_active = active;
+  if (!m_active) {
+    VPatternScheduler::remove(this);
+    return;
+  }
+  VPatternScheduler::add(m_hwnd, LIST_TICKRATE, playRows, this);
+}
+
+double VPatternListBox::averageFrameMs() const
+{
+  if (!m_numFrames) {
+    return 0;
+  }
+  return (m_frameSec * 1000.0) / m_numFrames;
+}
+
+void VPatternListBox::playRows(void *arg, uint32_t numTicks)
+{
+  VPatternListBox *list = (VPatternListBox *)arg;
+  AcquireSRWLockExclusive(&list->m_rowLock);
+  for (Row &row : list->m_rows) {
+    if (row.timeline) {
+      advanceRow(row, numTicks);
+    }
+  }
+  ReleaseSRWLockExclusive(&list->m_rowLock);
+}
+
+bool VPatternListBox::bindRows()
+{
+  if (!m_rows.size() || !m_items.size()) {
+    return false;
+  }
+  uint32_t first = m_scrollPos / LIST_ROW_HEIGHT;
+  uint32_t last = (m_scrollPos + m_backbufferHeight + LIST_ROW_HEIGHT - 1) / LIST_ROW_HEIGHT;
+  if (last > m_items.size()) {
+    last = (uint32_t)m_items.size();
+  }
+  // there's a row for every line that can be on screen at once so the
+  // visible items never share one
+  AcquireSRWLockExclusive(&m_rowLock);
+  for (uint32_t i = first; i < last; ++i) {
+    Row &row = m_rows[i % m_rows.size()];
+    if (row.item == i) {
+      continue;
+    }
+    const Item &item = m_items[i];
+    row.item = i;
+    startRow(row, item.mode.rawSize() ? findTimeline(item.hash) : nullptr);
+    row.pending = item.mode.rawSize() && !row.timeline;
+  }
+  ReleaseSRWLockExclusive(&m_rowLock);
+  LARGE_INTEGER freq;
+  LARGE_INTEGER startTime;
+  LARGE_INTEGER now;
+  QueryPerformanceFrequency(&freq);
+  QueryPerformanceCounter(&startTime);
+  bool recorded = false;
+  for (uint32_t i = first; i < last; ++i) {
+    Row &row = m_rows[i % m_rows.size()];
+    if (!row.pending) {
+      continue;
+    }
+    if (recorded) {
+      QueryPerformanceCounter(&now);
+      double ms = (double)(now.QuadPart - startTime.QuadPart) * 1000.0 / (double)freq.QuadPart;
+      if (ms >= LIST_RECORD_BUDGET_MS) {
+        return true;
+      }
+    }
+    // a mode that can't be recorded is left as a placeholder, the rows
+    // keep playing while it records
+    shared_ptr<const VortexTimeline> timeline = recordTimeline(m_items[i]);
+    AcquireSRWLockExclusive(&m_rowLock);
+    startRow(row, timeline);
+    ReleaseSRWLockExclusive(&m_rowLock);
+    row.pending = false;
+    recorded = true;
+  }
+  return false;
+}
+
+void VPatternListBox::startRow(Row &row, shared_ptr<const VortexTimeline> timeline)
+{
+  row.timeline = move(timeline);
+  row.samples->clear();
+  if (!row.timeline) {
+    return;
+  }
+  row.cursor = row.timeline->seek(0);
+  advanceRow(row, row.samples->capacity());
+}
+
+void VPatternListBox::advanceRow(Row &row, uint64_t numTicks)
+{
+  uint32_t capacity = row.samples->capacity();
+  if (numTicks > capacity) {
+    // only the last ticks fit in the ring, the rest are skipped over
+    row.cursor = row.timeline->seek((uint64_t)row.cursor.tick + numTicks - capacity);
+    numTicks = capacity;
+  }
+  for (uint64_t i = 0; i < numTicks; ++i) {
+    row.samples->push(row.timeline->next(row.cursor));
+  }
+}
+
+shared_ptr<const VortexTimeline> VPatternListBox::findTimeline(uint64_t hash)
+{
+  for (CachedTimeline &cached : m_timelines) {
+    if (cached.hash == hash) {
+      cached.lastUsed = ++m_useCount;
+      return cached.timeline;
     }
+  }
+  return nullptr;
 }
 
-// Clear all pattern strips
-void VPatternListBox::clearPatternStrips() {
-    m_patternStrips.clear();
-    // Update view
+shared_ptr<const VortexTimeline> VPatternListBox::recordTimeline(const Item &item)
+{
+  m_vortex.engine().modes().clearModes();
+  // the engine takes apart the stream it's given
+  ByteStream copy = item.mode;
+  m_vortex.matchLedCount(copy, true);
+  if (!m_vortex.addNewMode(copy, false) || !m_vortex.setCurMode(0, false)) {
+    return nullptr;
+  }
+  shared_ptr<const VortexTimeline> timeline = VortexTimeline::get(m_vortex, LIST_TICKRATE);
+  if (!timeline) {
+    return nullptr;
+  }
+  m_numRecorded++;
+  CachedTimeline cached = { item.hash, ++m_useCount, timeline };
+  if (m_timelines.size() < LIST_CACHED_TIMELINES) {
+    m_timelines.push_back(cached);
+    return timeline;
+  }
+  // replace the timeline that was used the longest ago
+  auto oldest = min_element(m_timelines.begin(), m_timelines.end(),
+    [](const CachedTimeline &a, const CachedTimeline &b) { return a.lastUsed < b.lastUsed; });
+  *oldest = cached;
+  return timeline;
 }
 
-// Draw all pattern strips within the list box
-void VPatternListBox::drawPatternStrips(HDC hdc) {
-    int yOffset = 0;
-    for (auto &strip : m_patternStrips) {
-        if (yOffset - m_scrollPos >= -40 && yOffset - m_scrollPos < m_height) {
-            strip->draw(hdc, 0, yOffset - m_scrollPos, 200, 32);
-        }
-        yOffset += 40;
+void VPatternListBox::scroll(int64_t pos)
+{
+  if (pos < 0) {
+    pos = 0;
+  }
+  if (pos > maxScroll()) {
+    pos = maxScroll();
+  }
+  if (pos == m_scrollPos) {
+    return;
+  }
+  m_scrollPos = (uint32_t)pos;
+  SetScrollPos(m_hwnd, SB_VERT, m_scrollPos, TRUE);
+  InvalidateRect(m_hwnd, nullptr, FALSE);
+}
+
+void VPatternListBox::vscroll(WPARAM wParam)
+{
+  int64_t pos = m_scrollPos;
+  switch (LOWORD(wParam)) {
+  case SB_LINEUP:
+    pos -= LIST_ROW_HEIGHT;
+    break;
+  case SB_LINEDOWN:
+    pos += LIST_ROW_HEIGHT;
+    break;
+  case SB_PAGEUP:
+    pos -= m_backbufferHeight;
+    break;
+  case SB_PAGEDOWN:
+    pos += m_backbufferHeight;
+    break;
+  case SB_TOP:
+    pos = 0;
+    break;
+  case SB_BOTTOM:
+    pos = maxScroll();
+    break;
+  case SB_THUMBTRACK:
+  case SB_THUMBPOSITION:
+  {
+    // the position in the message is only 16 bits
+    SCROLLINFO info;
+    memset(&info, 0, sizeof(info));
+    info.cbSize = sizeof(info);
+    info.fMask = SIF_TRACKPOS;
+    GetScrollInfo(m_hwnd, SB_VERT, &info);
+    pos = info.nTrackPos;
+    break;
+  }
+  default:
+    return;
+  }
+  scroll(pos);
+}
+
+void VPatternListBox::updateScrollBar()
+{
+  SCROLLINFO info;
+  memset(&info, 0, sizeof(info));
+  info.cbSize = sizeof(info);
+  info.fMask = SIF_RANGE | SIF_PAGE | SIF_POS;
+  info.nMin = 0;
+  info.nMax = m_items.size() ? (int)(m_items.size() * LIST_ROW_HEIGHT) - 1 : 0;
+  info.nPage = m_backbufferHeight;
+  info.nPos = m_scrollPos;
+  SetScrollInfo(m_hwnd, SB_VERT, &info, TRUE);
+}
+
+uint32_t VPatternListBox::maxScroll() const
+{
+  uint32_t contentHeight = (uint32_t)m_items.size() * LIST_ROW_HEIGHT;
+  if (contentHeight <= m_backbufferHeight) {
+    return 0;
+  }
+  return contentHeight - m_backbufferHeight;
+}
+
+void VPatternListBox::resize(uint32_t width, uint32_t height)
+{
+  // the backbuffer and the rows only change with the size of the window
+  if (width != m_backbufferWidth || height != m_backbufferHeight) {
+    createBackBuffer(width, height);
+  }
+  // enough rows for a line cut off at the top and another at the bottom
+  uint32_t numRows = height ? ((height - 1) / LIST_ROW_HEIGHT) + 2 : 0;
+  if (numRows != m_rows.size()) {
+    AcquireSRWLockExclusive(&m_rowLock);
+    m_rows.clear();
+    m_rows.resize(numRows);
+    for (Row &row : m_rows) {
+      row.item = LIST_NO_ITEM;
+      // enough samples to fill the widest strip
+      row.samples.reset(new VSampleRing);
+      row.samples->init(LIST_STRIP_WIDTH / LIST_LINE_SIZE);
+      row.pending = false;
     }
+    ReleaseSRWLockExclusive(&m_rowLock);
+  }
+  if (m_scrollPos > maxScroll()) {
+    m_scrollPos = maxScroll();
+  }
+  updateScrollBar();
+  InvalidateRect(m_hwnd, nullptr, FALSE);
+}
+
+void VPatternListBox::drawToBackBuffer()
+{
+  if (!m_pixels) {
+    return;
+  }
+  // gdi may still be drawing text into the pixels from the last frame
+  GdiFlush();
+  VPixels::fillRect(m_pixels, m_backbufferWidth, m_backbufferHeight,
+    0, 0, m_backbufferWidth, m_backbufferHeight, toPixel(m_backColor));
+  if (!m_rows.size()) {
+    return;
+  }
+  uint32_t first = m_scrollPos / LIST_ROW_HEIGHT;
+  uint32_t last = (m_scrollPos + m_backbufferHeight + LIST_ROW_HEIGHT - 1) / LIST_ROW_HEIGHT;
+  if (last > m_items.size()) {
+    last = (uint32_t)m_items.size();
+  }
+  for (uint32_t i = first; i < last; ++i) {
+    drawRow(m_rows[i % m_rows.size()], (int32_t)(i * LIST_ROW_HEIGHT) - (int32_t)m_scrollPos);
+  }
+  // then the names over the top of the pixels
+  int32_t nameX = min<int32_t>(LIST_STRIP_WIDTH, m_backbufferWidth) + LIST_NAME_MARGIN;
+  TEXTMETRIC metrics;
+  GetTextMetrics(m_backbufferDC, &metrics);
+  for (uint32_t i = first; i < last; ++i) {
+    const string &name = m_items[i].name;
+    int32_t y = (int32_t)(i * LIST_ROW_HEIGHT) - (int32_t)m_scrollPos;
+    TextOut(m_backbufferDC, nameX, y + (LIST_STRIP_HEIGHT - metrics.tmHeight) / 2,
+      name.c_str(), (int)name.length());
+  }
+}
+
+void VPatternListBox::drawRow(const Row &row, int32_t y)
+{
+  uint32_t stripWidth = min<uint32_t>(LIST_STRIP_WIDTH, m_backbufferWidth);
+  int32_t top = max<int32_t>(y, 0);
+  int32_t bottom = min<int32_t>(y + LIST_STRIP_HEIGHT, m_backbufferHeight);
+  if (top >= bottom || !stripWidth) {
+    return;
+  }
+  if (!row.timeline) {
+    VPixels::fillRect(m_pixels, m_backbufferWidth, m_backbufferHeight,
+      0, top, stripWidth, bottom, LIST_PLACEHOLDER_COLOR);
+    return;
+  }
+  // the colors of the last ticks played, the newest at the right edge of
+  // the strip and a short snapshot leaves the left of it as placeholder
+  uint32_t numColumns = stripWidth / LIST_LINE_SIZE;
+  uint32_t numSamples = row.samples->snapshot(m_drawColors);
+  uint32_t skip = (numSamples > numColumns) ? numSamples - numColumns : 0;
+  uint32_t startX = (numColumns - (numSamples - skip)) * LIST_LINE_SIZE;
+  // every line of the strip is the same so only the visible part is drawn
+  VPixels::fillColumns(m_pixels + (size_t)top * m_backbufferWidth, stripWidth, bottom - top,
+    m_backbufferWidth, m_drawColors.data() + skip, numSamples - skip, LIST_LINE_SIZE, startX,
+    LIST_PLACEHOLDER_COLOR);
+}
+
+void VPatternListBox::createBackBuffer(uint32_t width, uint32_t height)
+{
+  destroyBackBuffer();
+  if (!width || !height) {
+    return;
+  }
+
+  // a top down 32 bit dib so the rows can be drawn straight into the pixels
+  BITMAPINFO bmi;
+  memset(&bmi, 0, sizeof(bmi));
+  bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+  bmi.bmiHeader.biWidth = width;
+  bmi.bmiHeader.biHeight = -(LONG)height;
+  bmi.bmiHeader.biPlanes = 1;
+  bmi.bmiHeader.biBitCount = 32;
+  bmi.bmiHeader.biCompression = BI_RGB;
+
+  HDC hdc = GetDC(m_hwnd);
+  m_backbufferDC = CreateCompatibleDC(hdc);
+  ReleaseDC(m_hwnd, hdc);
+  m_backbuffer = CreateDIBSection(m_backbufferDC, &bmi, DIB_RGB_COLORS, (void **)&m_pixels, nullptr, 0);
+  if (!m_backbuffer) {
+    DeleteDC(m_backbufferDC);
+    m_backbufferDC = nullptr;
+    m_pixels = nullptr;
+    return;
+  }
+  m_oldBitmap = (HBITMAP)SelectObject(m_backbufferDC, m_backbuffer);
+  m_oldFont = (HFONT)SelectObject(m_backbufferDC, GetStockObject(DEFAULT_GUI_FONT));
+  SetBkMode(m_backbufferDC, TRANSPARENT);
+  SetTextColor(m_backbufferDC, m_foreColor);
+  m_backbufferWidth = width;
+  m_backbufferHeight = height;
 }
 
-// Command handling (placeholder for future logic)
-void VPatternListBox::command(WPARAM wParam, LPARAM lParam) {
-    // Implement as needed
+void VPatternListBox::destroyBackBuffer()
+{
+  if (m_backbufferDC) {
+    SelectObject(m_backbufferDC, m_oldFont);
+    SelectObject(m_backbufferDC, m_oldBitmap);
+    DeleteDC(m_backbufferDC);
+    DeleteObject(m_backbuffer);
+    m_backbufferDC = nullptr;
+    m_backbuffer = nullptr;
+    m_pixels = nullptr;
+  }
+  m_backbufferWidth = 0;
+  m_backbufferHeight = 0;
 }
 
-// Handle button press events (placeholder for future logic)
-void VPatternListBox::pressButton(WPARAM wParam, LPARAM lParam) {
-    // Implement as needed
+LRESULT CALLBACK VPatternListBox::window_proc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
+{
+  VPatternListBox *pListBox = (VPatternListBox *)GetWindowLongPtr(hwnd, GWLP_USERDATA);
+  if (!pListBox) {
+    return DefWindowProc(hwnd, uMsg, wParam, lParam);
+  }
+  switch (uMsg) {
+  case WM_VSCROLL:
+    pListBox->vscroll(wParam);
+    return 0;
+  case WM_MOUSEWHEEL:
+    pListBox->scroll((int64_t)pListBox->m_scrollPos -
+      (GET_WHEEL_DELTA_WPARAM(wParam) * LIST_WHEEL_LINES * LIST_ROW_HEIGHT) / WHEEL_DELTA);
+    return 0;
+  case WM_SIZE:
+    pListBox->resize(LOWORD(lParam), HIWORD(lParam));
+    break;
+  case WM_LBUTTONDOWN:
+    pListBox->pressButton(wParam, lParam);
+    break;
+  case WM_LBUTTONUP:
+    pListBox->releaseButton(wParam, lParam);
+    break;
+  case WM_CREATE:
+    pListBox->create();
+    break;
+  case WM_PAINT:
+    pListBox->paint();
+    return 0;
+  case WM_ERASEBKGND:
+    return 1;
+  case WM_COMMAND:
+    pListBox->command(wParam, lParam);
+    break;
+  case WM_DESTROY:
+    pListBox->cleanup();
+    break;
+  default:
+    break;
+  }
+  return DefWindowProc(hwnd, uMsg, wParam, lParam);
 }
 
-// Handle button release events (placeholder for future logic)
-void VPatternListBox::releaseButton(WPARAM wParam, LPARAM lParam) {
-    // Implement as needed
+void VPatternListBox::registerWindowClass(HINSTANCE hInstance, COLORREF backcol)
+{
+  if (m_wc.lpfnWndProc == VPatternListBox::window_proc) {
+    // already registered
+    return;
+  }
+  // class registration
+  m_wc.lpfnWndProc = VPatternListBox::window_proc;
+  m_wc.hInstance = hInstance;
+  m_wc.hbrBackground = CreateSolidBrush(backcol);
+  m_wc.style = CS_GLOBALCLASS | CS_HREDRAW | CS_VREDRAW;
+  m_wc.hCursor = LoadCursor(NULL, IDC_ARROW);
+  m_wc.lpszClassName = WC_PATTERN_LIST_BOX;
+  RegisterClass(&m_wc);
 }
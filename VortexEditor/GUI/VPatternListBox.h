@@ -1,37 +1,156 @@
 #pragma once
 
 #include "VWindow.h"
-#include "VPatternStrip.h" // Ensure this includes the definition of VPatternStrip
-#include <vector>
+#include "VortexLib.h"
+#include "VortexTimeline.h"
+#include "VSampleRing.h"
+#include "Serial/ByteStream.h"
 #include <memory>
+#include <string>
+#include <vector>
 
+// A scrolling list of mode previews that can hold any number of modes.
+//
+// Only the rows on screen have any live state. There is one row for every
+// line that fits in the window plus one for a line that is partly scrolled
+// in, and when the list scrolls the rows that leave one side are given to
+// the modes coming in on the other. A row is a timeline being played into a
+// ring of the colors it played last, each frame the visible rows are
+// snapshotted out of their rings straight into a single DIB, so there's one
+// window and one engine no matter how long the list is.
+//
+// The rows are played on the pattern scheduler thread while the ui thread
+// only ever snapshots their rings, the rows are locked just while the ui
+// gives them to other items.
+//
+// Timelines are recorded when a mode scrolls into view, only as many per
+// frame as fit in a few milliseconds so a fast scroll never stalls the
+// window, rows show a placeholder until theirs is ready. The timelines that
+// were used last are kept so scrolling back never records them again.
 class VPatternListBox : public VWindow {
 public:
     VPatternListBox();
-    VPatternListBox(HINSTANCE hInstance, VWindow& parent, uint32_t width, uint32_t height, uint32_t x, uint32_t y, uintptr_t menuID, VWindowCallback callback);
+    VPatternListBox(HINSTANCE hInstance, VWindow &parent, COLORREF backcol, uint32_t width, uint32_t height,
+        uint32_t x, uint32_t y, uintptr_t menuID);
     virtual ~VPatternListBox();
 
-    void init(HINSTANCE hInstance, VWindow& parent, uint32_t width, uint32_t height, uint32_t x, uint32_t y, uintptr_t menuID, VWindowCallback callback);
+    void init(HINSTANCE hInstance, VWindow &parent, COLORREF backcol, uint32_t width, uint32_t height,
+        uint32_t x, uint32_t y, uintptr_t menuID);
     virtual void cleanup() override;
 
-    // Override these methods for custom behavior
     virtual void create() override;
     virtual void paint() override;
     virtual void command(WPARAM wParam, LPARAM lParam) override;
     virtual void pressButton(WPARAM wParam, LPARAM lParam) override;
     virtual void releaseButton(WPARAM wParam, LPARAM lParam) override;
 
-    // Methods to manage pattern strips
-    void addPatternStrip(std::shared_ptr<VPatternStrip> patternStrip);
-    void removePatternStrip(size_t index);
-    void clearPatternStrips();
+    // the modes in the list, an empty mode is shown as an empty row
+    void addItem(const std::string &name, const ByteStream &mode);
+    void removeItem(uint32_t index);
+    void clearItems();
+    uint32_t numItems() const { return (uint32_t)m_items.size(); }
+    std::string itemName(uint32_t index) const;
+    const ByteStream *itemMode(uint32_t index) const;
 
-protected:
-    std::vector<std::shared_ptr<VPatternStrip>> m_patternStrips; // Container for pattern strips
-    uint32_t m_scrollPos;
-    uint32_t m_height;
+    // scroll so the item is at the top, or as close as the list goes
+    void scrollTo(uint32_t index);
+
+    // start or stop the previews playing
+    bool isActive() const { return m_active; }
+    void setActive(bool active);
+
+    // the average time to draw a frame and the timelines that were recorded
+    double averageFrameMs() const;
+    uint32_t numRecorded() const { return m_numRecorded; }
 
 private:
-    VWindowCallback m_callback;
-    void drawPatternStrips(HDC hdc); // Helper function to draw pattern strips
+    static LRESULT CALLBACK window_proc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
+    static void registerWindowClass(HINSTANCE hInstance, COLORREF backcol);
+    static WNDCLASS m_wc;
+
+    struct Item
+    {
+        std::string name;
+        ByteStream mode;
+        // identifies the timeline of the mode, modes that are the same share one
+        uint64_t hash;
+    };
+
+    // the live state of a line of the list
+    struct Row
+    {
+        // the item shown in the row, or none
+        uint32_t item;
+        // null until the timeline is recorded
+        std::shared_ptr<const VortexTimeline> timeline;
+        // where the timeline plays from next
+        VortexTimeline::Cursor cursor;
+        // the colors played so far, the newest last
+        std::unique_ptr<VSampleRing> samples;
+        // whether the timeline still has to be recorded
+        bool pending;
+    };
+
+    // a recently used timeline
+    struct CachedTimeline
+    {
+        uint64_t hash;
+        uint64_t lastUsed;
+        std::shared_ptr<const VortexTimeline> timeline;
+    };
+
+    // advance the rows on the scheduler thread
+    static void playRows(void *arg, uint32_t numTicks);
+    // show a timeline in the row, or none, as if the strip had already
+    // filled up, only with the rows locked
+    void startRow(Row &row, std::shared_ptr<const VortexTimeline> timeline);
+    // play the row forward into it's samples
+    static void advanceRow(Row &row, uint64_t numTicks);
+    // give the visible items their rows and record a few of the timelines
+    // they are missing, returns true if some are still missing
+    bool bindRows();
+    std::shared_ptr<const VortexTimeline> findTimeline(uint64_t hash);
+    std::shared_ptr<const VortexTimeline> recordTimeline(const Item &item);
+
+    void scroll(int64_t pos);
+    void vscroll(WPARAM wParam);
+    void updateScrollBar();
+    uint32_t maxScroll() const;
+    void resize(uint32_t width, uint32_t height);
+
+    void createBackBuffer(uint32_t width, uint32_t height);
+    void destroyBackBuffer();
+    void drawToBackBuffer();
+    void drawRow(const Row &row, int32_t y);
+
+    // engine for recording the timelines of the items
+    Vortex m_vortex;
+    std::vector<Item> m_items;
+    // recycled as the list scrolls, the row of an item is always the same
+    // one while it's on screen
+    std::vector<Row> m_rows;
+    // held by the scheduler while it plays the rows, and by the ui while it
+    // changes which timeline a row plays
+    SRWLOCK m_rowLock;
+    std::vector<CachedTimeline> m_timelines;
+    uint64_t m_useCount;
+
+    bool m_active;
+    // in pixels from the top of the first item
+    uint32_t m_scrollPos;
+
+    // colors of a single row snapshotted out of it's samples
+    std::vector<uint32_t> m_drawColors;
+
+    HDC m_backbufferDC;
+    HBITMAP m_backbuffer;
+    HBITMAP m_oldBitmap;
+    HFONT m_oldFont;
+    uint32_t *m_pixels;
+    uint32_t m_backbufferWidth;
+    uint32_t m_backbufferHeight;
+
+    uint32_t m_numRecorded;
+    uint32_t m_numFrames;
+    double m_frameSec;
 };
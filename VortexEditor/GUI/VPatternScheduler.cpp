@@ -0,0 +1,123 @@
+#include "VPatternScheduler.h"
+
+// the scheduler wakes up this often, about 60fps
+#define SCHEDULER_FRAME_MS 16
+// after a long stall the previews don't try to catch up more than this
+#define SCHEDULER_MAX_CATCHUP_SEC 0.25
+
+using namespace std;
+
+vector<VPatternScheduler::Entry> VPatternScheduler::m_entries;
+SRWLOCK VPatternScheduler::m_lock = SRWLOCK_INIT;
+bool VPatternScheduler::m_running = false;
+double VPatternScheduler::m_busySec = 0;
+double VPatternScheduler::m_wallSec = 0;
+
+void VPatternScheduler::add(HWND hwnd, uint32_t tickrate, VSchedulerCallback callback, void *arg)
+{
+  AcquireSRWLockExclusive(&m_lock);
+  for (const Entry &ent : m_entries) {
+    if (ent.arg == arg) {
+      ReleaseSRWLockExclusive(&m_lock);
+      return;
+    }
+  }
+  m_entries.push_back({ hwnd, tickrate, callback, arg, 0 });
+  if (!m_running) {
+    // the thread is never joined, it closes down by itself when it runs
+    // out of previews and a new one is started with the next preview
+    HANDLE hThread = CreateThread(NULL, 0, schedulerThread, nullptr, 0, NULL);
+    if (hThread) {
+      CloseHandle(hThread);
+      m_running = true;
+    }
+  }
+  ReleaseSRWLockExclusive(&m_lock);
+}
+
+void VPatternScheduler::remove(void *arg)
+{
+  // the scheduler holds the lock for the whole frame so once this has the
+  // lock the callback is not running
+  AcquireSRWLockExclusive(&m_lock);
+  for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+    if (it->arg == arg) {
+      m_entries.erase(it);
+      break;
+    }
+  }
+  ReleaseSRWLockExclusive(&m_lock);
+}
+
+double VPatternScheduler::load()
+{
+  AcquireSRWLockExclusive(&m_lock);
+  double pct = (m_wallSec > 0) ? (m_busySec * 100.0) / m_wallSec : 0;
+  m_busySec = 0;
+  m_wallSec = 0;
+  ReleaseSRWLockExclusive(&m_lock);
+  return pct;
+}
+
+DWORD __stdcall VPatternScheduler::schedulerThread(void *arg)
+{
+  // a periodic timer keeps the frames evenly spaced no matter how long
+  // each frame took to play
+  HANDLE hTimer = CreateWaitableTimer(NULL, FALSE, NULL);
+  LARGE_INTEGER dueTime;
+  dueTime.QuadPart = -10000LL * SCHEDULER_FRAME_MS;
+  SetWaitableTimer(hTimer, &dueTime, SCHEDULER_FRAME_MS, NULL, NULL, FALSE);
+  LARGE_INTEGER freq;
+  LARGE_INTEGER lastTime;
+  LARGE_INTEGER curTime;
+  QueryPerformanceFrequency(&freq);
+  QueryPerformanceCounter(&lastTime);
+  double elapsedSec = 0;
+  do {
+    WaitForSingleObject(hTimer, INFINITE);
+    QueryPerformanceCounter(&curTime);
+    elapsedSec = (double)(curTime.QuadPart - lastTime.QuadPart) / (double)freq.QuadPart;
+    lastTime = curTime;
+  } while (frame(elapsedSec));
+  CancelWaitableTimer(hTimer);
+  CloseHandle(hTimer);
+  return 0;
+}
+
+bool VPatternScheduler::frame(double elapsedSec)
+{
+  LARGE_INTEGER freq;
+  LARGE_INTEGER startTime;
+  LARGE_INTEGER endTime;
+  QueryPerformanceFrequency(&freq);
+  QueryPerformanceCounter(&startTime);
+  AcquireSRWLockExclusive(&m_lock);
+  if (!m_entries.size()) {
+    m_running = false;
+    ReleaseSRWLockExclusive(&m_lock);
+    return false;
+  }
+  // a long stall like dragging the window shouldn't make the previews race
+  if (elapsedSec > SCHEDULER_MAX_CATCHUP_SEC) {
+    elapsedSec = SCHEDULER_MAX_CATCHUP_SEC;
+  }
+  for (Entry &ent : m_entries) {
+    if (!IsWindowVisible(ent.hwnd)) {
+      continue;
+    }
+    ent.pendingTicks += elapsedSec * ent.tickrate;
+    uint32_t numTicks = (uint32_t)ent.pendingTicks;
+    if (!numTicks) {
+      continue;
+    }
+    ent.pendingTicks -= numTicks;
+    ent.callback(ent.arg, numTicks);
+    // this only marks the window to be painted, it doesn't wait on the ui
+    InvalidateRect(ent.hwnd, nullptr, FALSE);
+  }
+  QueryPerformanceCounter(&endTime);
+  m_busySec += (double)(endTime.QuadPart - startTime.QuadPart) / (double)freq.QuadPart;
+  m_wallSec += elapsedSec;
+  ReleaseSRWLockExclusive(&m_lock);
+  return true;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+// windows includes
+#include <windows.h>
+
+#include <stdint.h>
+#include <vector>
+
+// called with the number of ticks a preview has to play since the last call
+typedef void (*VSchedulerCallback)(void *arg, uint32_t numTicks);
+
+// A single thread that plays every active pattern preview, instead of each
+// preview spinning on a thread of it's own.
+//
+// Each frame every visible preview is advanced by however many ticks are
+// due at it's tickrate, then all of the windows that changed are
+// invalidated together. Previews in hidden windows are skipped until they
+// are shown again, and the thread exits once there are none left.
+class VPatternScheduler
+{
+public:
+  // start and stop playing a preview, the callback is run on the scheduler
+  // thread and once remove() returns it will never be called for arg again
+  static void add(HWND hwnd, uint32_t tickrate, VSchedulerCallback callback, void *arg);
+  static void remove(void *arg);
+
+  // the percent of a single core spent playing since the last call
+  static double load();
+
+private:
+  static DWORD __stdcall schedulerThread(void *arg);
+  // play a single frame, returns false once there's nothing to play
+  static bool frame(double elapsedSec);
+
+  struct Entry
+  {
+    HWND hwnd;
+    uint32_t tickrate;
+    VSchedulerCallback callback;
+    void *arg;
+    // ticks that are due but less than a whole tick
+    double pendingTicks;
+  };
+  static std::vector<Entry> m_entries;
+  static SRWLOCK m_lock;
+  static bool m_running;
+
+  // time spent playing and the time that passed for load()
+  static double m_busySec;
+  static double m_wallSec;
+};
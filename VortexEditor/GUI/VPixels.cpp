@@ -0,0 +1,69 @@
+#include "VPixels.h"
+
+#include <string.h>
+
+void VPixels::fillColumns(uint32_t *pixels, uint32_t width, uint32_t height,
+  const uint32_t *colors, uint32_t numColors, uint32_t columnWidth,
+  uint32_t startX, uint32_t backColor)
+{
+  fillColumns(pixels, width, height, width, colors, numColors, columnWidth, startX, backColor);
+}
+
+void VPixels::fillColumns(uint32_t *pixels, uint32_t width, uint32_t height,
+  uint32_t pitch, const uint32_t *colors, uint32_t numColors,
+  uint32_t columnWidth, uint32_t startX, uint32_t backColor)
+{
+  if (!pixels || !width || !height) {
+    return;
+  }
+  // every row is the same so only the first one is actually drawn
+  uint32_t *row = pixels;
+  fillSpan(row, width, backColor);
+  for (uint32_t i = 0; i < numColors; ++i) {
+    uint32_t x = (uint32_t)((startX + (uint64_t)i * columnWidth) % width);
+    uint32_t count = columnWidth;
+    if (count > width - x) {
+      count = width - x;
+    }
+    fillSpan(row + x, count, colors[i]);
+  }
+  // then copied down the rest of the buffer
+  for (uint32_t y = 1; y < height; ++y) {
+    memcpy(pixels + (size_t)y * pitch, row, width * sizeof(uint32_t));
+  }
+}
+
+void VPixels::fillRect(uint32_t *pixels, uint32_t width, uint32_t height,
+  int32_t left, int32_t top, int32_t right, int32_t bottom, uint32_t color)
+{
+  if (!pixels) {
+    return;
+  }
+  if (left < 0) {
+    left = 0;
+  }
+  if (top < 0) {
+    top = 0;
+  }
+  if (right > (int32_t)width) {
+    right = (int32_t)width;
+  }
+  if (bottom > (int32_t)height) {
+    bottom = (int32_t)height;
+  }
+  if (left >= right || top >= bottom) {
+    return;
+  }
+  for (int32_t y = top; y < bottom; ++y) {
+    fillSpan(pixels + (size_t)y * width + left, right - left, color);
+  }
+}
+
+void VPixels::fillSpan(uint32_t *dest, uint32_t count, uint32_t color)
+{
+  // a plain loop over a contiguous span, the optimizer vectorizes this into
+  // 128 or 256 bit stores on every target
+  for (uint32_t i = 0; i < count; ++i) {
+    dest[i] = color;
+  }
+}
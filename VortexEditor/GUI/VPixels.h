@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdint.h>
+
+// Drawing straight into the pixels of a 32 bit top-down DIB section, where
+// each pixel is 0x00RRGGBB, the same layout as a raw engine color. There is
+// no GDI in here so none of it depends on windows.
+class VPixels
+{
+public:
+  // fill every row of the buffer with columns of color, each color is
+  // columnWidth pixels wide and the first starts at startX, a column that
+  // starts past the right edge wraps around to the left but one that
+  // straddles the edge is cut off there, anything not covered by a column
+  // is the back color
+  static void fillColumns(uint32_t *pixels, uint32_t width, uint32_t height,
+    const uint32_t *colors, uint32_t numColors, uint32_t columnWidth,
+    uint32_t startX, uint32_t backColor);
+  // the same for a buffer that is part of a bigger one, where each row is
+  // pitch pixels from the start of the last
+  static void fillColumns(uint32_t *pixels, uint32_t width, uint32_t height,
+    uint32_t pitch, const uint32_t *colors, uint32_t numColors,
+    uint32_t columnWidth, uint32_t startX, uint32_t backColor);
+
+  // fill a rectangle of the buffer with a single color, clipped to the buffer
+  static void fillRect(uint32_t *pixels, uint32_t width, uint32_t height,
+    int32_t left, int32_t top, int32_t right, int32_t bottom, uint32_t color);
+
+private:
+  // fill a span of a row, written so the compiler turns it into wide stores
+  static void fillSpan(uint32_t *dest, uint32_t count, uint32_t color);
+};
@@ -0,0 +1,58 @@
+#include "VSampleRing.h"
+
+using namespace std;
+
+VSampleRing::VSampleRing() :
+  m_slots(),
+  m_capacity(0),
+  m_head(0)
+{
+}
+
+void VSampleRing::init(uint32_t capacity)
+{
+  m_slots.reset(capacity ? new atomic<uint64_t>[capacity] : nullptr);
+  m_capacity = capacity;
+  for (uint32_t i = 0; i < m_capacity; ++i) {
+    m_slots[i].store(0, memory_order_relaxed);
+  }
+  m_head.store(0, memory_order_release);
+}
+
+void VSampleRing::clear()
+{
+  m_head.store(0, memory_order_release);
+}
+
+void VSampleRing::push(uint32_t sample)
+{
+  if (!m_capacity) {
+    return;
+  }
+  uint64_t head = m_head.load(memory_order_relaxed);
+  m_slots[head % m_capacity].store((head << 32) | sample, memory_order_relaxed);
+  // publishing the head releases the sample to any reader that sees it
+  m_head.store(head + 1, memory_order_release);
+}
+
+uint32_t VSampleRing::snapshot(vector<uint32_t> &outSamples) const
+{
+  outSamples.clear();
+  if (!m_capacity) {
+    return 0;
+  }
+  uint64_t head = m_head.load(memory_order_acquire);
+  uint64_t first = (head > m_capacity) ? head - m_capacity : 0;
+  outSamples.reserve((size_t)(head - first));
+  for (uint64_t i = first; i < head; ++i) {
+    uint64_t slot = m_slots[i % m_capacity].load(memory_order_relaxed);
+    if ((uint32_t)(slot >> 32) != (uint32_t)i) {
+      // the writer lapped this slot during the copy, and so every slot
+      // before it too, only the samples after it are still consecutive
+      outSamples.clear();
+      continue;
+    }
+    outSamples.push_back((uint32_t)slot);
+  }
+  return (uint32_t)outSamples.size();
+}
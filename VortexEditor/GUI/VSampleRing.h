@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// A fixed size ring of packed 0x00RRGGBB color samples that one thread
+// writes while another takes snapshots of it without any locking.
+//
+// The writer never waits, each push overwrites the oldest sample once the
+// ring is full. Every slot packs the sample together with the low bits of
+// it's sequence number into one 64 bit word, so a snapshot can tell exactly
+// which slots the writer lapped while they were copied. Those are dropped
+// from the front so a snapshot is always a run of consecutive samples.
+//
+// There must only ever be one writer at a time, and init() and clear() can
+// only be called while nothing is pushing.
+class VSampleRing
+{
+public:
+  VSampleRing();
+
+  void init(uint32_t capacity);
+  void clear();
+
+  // publish a sample, only from the writer
+  void push(uint32_t sample);
+
+  // copy out the samples oldest first, returns the number copied
+  uint32_t snapshot(std::vector<uint32_t> &outSamples) const;
+
+  uint32_t capacity() const { return m_capacity; }
+  // the total number of samples ever pushed
+  uint64_t numPushed() const { return m_head.load(std::memory_order_acquire); }
+
+private:
+  // the sequence number in the high half and the sample in the low half
+  std::unique_ptr<std::atomic<uint64_t>[]> m_slots;
+  uint32_t m_capacity;
+  // the index of the next sample to be written, it only ever grows
+  std::atomic<uint64_t> m_head;
+};
@@ -40,7 +40,11 @@ VSelectBox::VSelectBox() :
   m_ySelect(0),
   m_callback(nullptr),
   m_bitmap(nullptr),
-  m_hoverBitmap(nullptr)
+  m_hoverBitmap(nullptr),
+  m_background(),
+  m_composedBitmap(nullptr),
+  m_backgroundDirty(true),
+  m_backbuffer()
 {
 }
 
@@ -109,58 +113,85 @@ void VSelectBox::init(HINSTANCE hInstance, VWindow &parent, const string &title,
 
 void VSelectBox::cleanup()
 {
+  m_backbuffer.destroy();
+  m_background.destroy();
 }
 
 void VSelectBox::create()
 {
 }
 
-static HBRUSH getBrushCol(DWORD rgbcol)
-{
-  static std::map<COLORREF, HBRUSH> m_brushmap;
-  HBRUSH br;
-  COLORREF col = RGB((rgbcol >> 16) & 0xFF, (rgbcol >> 8) & 0xFF, rgbcol & 0xFF);
-  if (m_brushmap.find(col) == m_brushmap.end()) {
-    br = CreateSolidBrush(col);
-    m_brushmap[col] = br;
-  }
-  br = m_brushmap[col];
-  return br;
-}
-
 void VSelectBox::paint()
 {
   PAINTSTRUCT paintStruct;
   memset(&paintStruct, 0, sizeof(paintStruct));
   HDC hdc = BeginPaint(m_hwnd, &paintStruct);
 
-  HDC backbuffDC = CreateCompatibleDC(hdc);
-  HBITMAP backbuffer = CreateCompatibleBitmap(hdc, m_width, m_height);
-  HBITMAP hbmOldBackbuffer = (HBITMAP)SelectObject(backbuffDC, backbuffer);
+  // the buffers are kept between paints and only made again on a resize
+  if (m_background.resize(hdc, m_width, m_height)) {
+    m_backgroundDirty = true;
+  }
+  if (!m_background.dc()) {
+    EndPaint(m_hwnd, &paintStruct);
+    return;
+  }
 
-  HDC bmpDC = CreateCompatibleDC(hdc);
   HBITMAP back = m_bitmap;
   if (m_mouseInside && m_hoverBitmap) {
     back = m_hoverBitmap;
   }
-  HBITMAP hbmpOld = (HBITMAP)SelectObject(bmpDC, back);
+  if (m_backgroundDirty || back != m_composedBitmap) {
+    composeBackground(back);
+  }
 
-  if (m_useTransparency) {
-    // Fill the background with a color that will be made transparent
-    HBRUSH hBrush = CreateSolidBrush(RGB(45, 45, 45)); // Magenta, assuming this is the transparent color
-    FillRect(backbuffDC, &paintStruct.rcPaint, hBrush);
-    DeleteObject(hBrush);
+  if (!m_drawHLine && !m_drawVLine && !m_drawCircle) {
+    // nothing goes over the background so it's copied straight out
+    m_background.present(hdc);
+    EndPaint(m_hwnd, &paintStruct);
+    return;
+  }
+
+  // start from the background so only the selector is drawn
+  m_backbuffer.resize(hdc, m_width, m_height);
+  BitBlt(m_backbuffer.dc(), 0, 0, m_width, m_height, m_background.dc(), 0, 0, SRCCOPY);
+  drawSelector(m_backbuffer.dc());
+  m_backbuffer.present(hdc);
+
+  EndPaint(m_hwnd, &paintStruct);
+}
 
-    // Use TransparentBlt to copy the bitmap with transparency
-    TransparentBlt(backbuffDC, m_innerLeft, m_innerTop, m_innerWidth, m_innerHeight, bmpDC, 0, 0, m_innerWidth, m_innerHeight, RGB(255, 0, 255));
+void VSelectBox::composeBackground(HBITMAP back)
+{
+  HDC backDC = m_background.dc();
+  RECT rect = { 0, 0, (LONG)m_width, (LONG)m_height };
+  if (m_useTransparency) {
+    // the magenta parts of the bitmap show this color instead
+    SetDCBrushColor(backDC, RGB(45, 45, 45));
+    FillRect(backDC, &rect, (HBRUSH)GetStockObject(DC_BRUSH));
   } else {
-    // Use BitBlt to copy the bitmap without transparency
-    BitBlt(backbuffDC, m_innerLeft, m_innerTop, m_innerWidth, m_innerHeight, bmpDC, 0, 0, SRCCOPY);
+    FillRect(backDC, &rect, (HBRUSH)GetStockObject(BLACK_BRUSH));
+  }
+
+  if (back) {
+    HDC bmpDC = CreateCompatibleDC(backDC);
+    HBITMAP hbmpOld = (HBITMAP)SelectObject(bmpDC, back);
+    if (m_useTransparency) {
+      // Use TransparentBlt to copy the bitmap with transparency
+      TransparentBlt(backDC, m_innerLeft, m_innerTop, m_innerWidth, m_innerHeight, bmpDC, 0, 0, m_innerWidth, m_innerHeight, RGB(255, 0, 255));
+    } else {
+      // Use BitBlt to copy the bitmap without transparency
+      BitBlt(backDC, m_innerLeft, m_innerTop, m_innerWidth, m_innerHeight, bmpDC, 0, 0, SRCCOPY);
+    }
+    SelectObject(bmpDC, hbmpOld);
+    DeleteDC(bmpDC);
   }
 
-  SelectObject(bmpDC, hbmpOld);
-  DeleteDC(bmpDC);
+  m_composedBitmap = back;
+  m_backgroundDirty = false;
+}
 
+void VSelectBox::drawSelector(HDC backbuffDC)
+{
   // draw the lines and circle
   uint32_t selectorSize = 5;
   if (m_drawHLine) {
@@ -209,15 +240,6 @@ void VSelectBox::paint()
       m_innerLeft + (m_xSelect + selectorSize) - 1,
       m_innerTop + (m_ySelect + selectorSize) - 1);
   }
-
-
-  BitBlt(hdc, 0, 0, m_width, m_height, backbuffDC, 0, 0, SRCCOPY);
-
-  SelectObject(backbuffDC, hbmOldBackbuffer); // Restore the original bitmap
-  DeleteObject(backbuffer);
-  DeleteDC(backbuffDC);
-
-  EndPaint(m_hwnd, &paintStruct);
 }
 
 
@@ -301,21 +323,25 @@ void VSelectBox::doCallback(SelectEvent sevent)
 void VSelectBox::setBackground(HBITMAP hBitmap)
 {
   m_bitmap = hBitmap;
+  m_backgroundDirty = true;
 }
 
 void VSelectBox::setHoverBackground(HBITMAP hBitmap)
 {
   m_hoverBitmap = hBitmap;
+  m_backgroundDirty = true;
 }
 
 void VSelectBox::setBackgroundTransparency(bool transparent)
 {
   m_useTransparency = transparent;
+  m_backgroundDirty = true;
 }
 
 void VSelectBox::setBorderSize(uint32_t borderSize)
 {
   m_borderSize = borderSize;
+  m_backgroundDirty = true;
 
   uint32_t borders = m_borderSize * 2;
   m_width = m_innerWidth + borders;
@@ -2,6 +2,7 @@
 
 #include "VWindow.h"
 
+#include "VBackBuffer.h"
 #include "VLabel.h"
 
 class RGBColor;
@@ -46,6 +47,9 @@ public:
   void setBackgroundTransparency(bool transparent);
   void setBorderSize(uint32_t borderSize);
   void setSelection(uint32_t x, uint32_t y);
+  // the pixels of the background bitmap were changed, it's composited
+  // again on the next paint
+  void invalidateBackground() { m_backgroundDirty = true; }
 
   // whether to draw specific components
   void setDrawHLine(bool draw) { m_drawHLine = draw; }
@@ -58,6 +62,8 @@ private:
   static WNDCLASS m_wc;
 
   void doCallback(SelectEvent sevent);
+  void composeBackground(HBITMAP back);
+  void drawSelector(HDC backbuffDC);
 
   uint32_t m_borderSize;
 
@@ -91,4 +97,14 @@ private:
   VSelectBoxCallback m_callback;
   HBITMAP m_bitmap;
   HBITMAP m_hoverBitmap;
+
+  // the background with the border and transparency worked out, copied
+  // under the selector on every paint
+  VBackBuffer m_background;
+  // which bitmap is in the background and whether it's out of date
+  HBITMAP m_composedBitmap;
+  bool m_backgroundDirty;
+  // the background and selector together, drawn here then copied to the
+  // window in one go so the selector doesn't flicker
+  VBackBuffer m_backbuffer;
 };
@@ -0,0 +1,629 @@
+#include "HttpCache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#include <dirent.h>
+#endif
+
+// marks the start of every cache file
+#define CACHE_MAGIC 0x31434856 // "VHC1"
+// the extension of cache files, a file being written has .tmp after it
+#define CACHE_EXTENSION ".http"
+// the length of the hash every file of the cache is named with
+#define CACHE_NAME_LENGTH 16
+// the most that is read for a key or a header, and for a body, of a cache
+// file so a corrupt file can't ask for all of memory
+#define CACHE_MAX_STRING 65536
+#define CACHE_MAX_BODY (1ull << 30)
+
+using namespace std;
+
+// the name every file of a key starts with, a hash of the key
+static string NameOf(const string &key)
+{
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for (unsigned char c : key) {
+    hash = (hash ^ c) * 0x100000001b3ull;
+  }
+  char name[32];
+  snprintf(name, sizeof(name), "%016llx", (unsigned long long)hash);
+  return name;
+}
+
+// the cache file of a key, the key itself is stored inside the file so a
+// clash of the hash only costs a miss
+static string FileOf(const string &key)
+{
+  return NameOf(key) + CACHE_EXTENSION;
+}
+
+static bool SizeOf(const string &path, uint64_t &outSize)
+{
+  FILE *file = fopen(path.c_str(), "rb");
+  if (!file) {
+    return false;
+  }
+  fseek(file, 0, SEEK_END);
+  outSize = (uint64_t)ftell(file);
+  fclose(file);
+  return true;
+}
+
+static vector<string> ListFiles(const string &directory)
+{
+  vector<string> files;
+#ifdef _WIN32
+  WIN32_FIND_DATAA data;
+  HANDLE hFind = FindFirstFileA((directory + "\\*").c_str(), &data);
+  if (hFind == INVALID_HANDLE_VALUE) {
+    return files;
+  }
+  do {
+    if (!(data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+      files.push_back(data.cFileName);
+    }
+  } while (FindNextFileA(hFind, &data));
+  FindClose(hFind);
+#else
+  DIR *dir = opendir(directory.c_str());
+  if (!dir) {
+    return files;
+  }
+  while (dirent *ent = readdir(dir)) {
+    if (ent->d_name[0] != '.') {
+      files.push_back(ent->d_name);
+    }
+  }
+  closedir(dir);
+#endif
+  return files;
+}
+
+// headers about the connection a response came over, or about the body as
+// it was sent rather than as it was decoded, none of them hold for a cached
+// response. Anything the connection header names is one of them as well
+static const char *hopByHopHeaders[] = {
+  "connection", "keep-alive", "proxy-authenticate", "proxy-authorization", "te", "trailer",
+  "transfer-encoding", "upgrade", "content-length", "content-encoding",
+};
+
+static void StripHopByHop(map<string, string> &headers)
+{
+  auto connection = headers.find("connection");
+  if (connection != headers.end()) {
+    string value = connection->second;
+    for (char &c : value) {
+      c = (char)tolower((unsigned char)c);
+    }
+    size_t start = 0;
+    while (start < value.size()) {
+      size_t end = value.find(',', start);
+      if (end == string::npos) {
+        end = value.size();
+      }
+      size_t first = value.find_first_not_of(" \t", start);
+      size_t last = value.find_last_not_of(" \t", end - 1);
+      if (first < end && last != string::npos && last >= first) {
+        headers.erase(value.substr(first, last - first + 1));
+      }
+      start = end + 1;
+    }
+  }
+  for (const char *name : hopByHopHeaders) {
+    headers.erase(name);
+  }
+}
+
+static bool EndsWith(const string &str, const string &end)
+{
+  return str.size() >= end.size() && str.compare(str.size() - end.size(), end.size(), end) == 0;
+}
+
+// cache files are the magic, the key, when the response was stored and
+// goes stale, the status, the headers then the body. Every number is
+// written as it is in memory
+static bool WriteString(FILE *file, const string &str)
+{
+  uint32_t len = (uint32_t)str.size();
+  return fwrite(&len, sizeof(len), 1, file) == 1 && fwrite(str.data(), 1, len, file) == len;
+}
+
+static bool ReadString(FILE *file, string &str, uint32_t maxLen)
+{
+  uint32_t len = 0;
+  if (fread(&len, sizeof(len), 1, file) != 1 || len > maxLen) {
+    return false;
+  }
+  str.resize(len);
+  return fread(&str[0], 1, len, file) == len;
+}
+
+static bool WriteEntry(const string &path, const string &key, int64_t storedAt, int64_t freshUntil,
+  const HttpResponse &response, uint64_t &outSize)
+{
+  FILE *file = fopen(path.c_str(), "wb");
+  if (!file) {
+    return false;
+  }
+  uint32_t magic = CACHE_MAGIC;
+  uint32_t numHeaders = (uint32_t)response.headers.size();
+  bool ok = fwrite(&magic, sizeof(magic), 1, file) == 1 &&
+    WriteString(file, key) &&
+    fwrite(&storedAt, sizeof(storedAt), 1, file) == 1 &&
+    fwrite(&freshUntil, sizeof(freshUntil), 1, file) == 1 &&
+    fwrite(&response.status, sizeof(response.status), 1, file) == 1 &&
+    fwrite(&numHeaders, sizeof(numHeaders), 1, file) == 1;
+  for (auto it = response.headers.begin(); ok && it != response.headers.end(); ++it) {
+    ok = WriteString(file, it->first) && WriteString(file, it->second);
+  }
+  uint64_t bodySize = response.body.size();
+  ok = ok && fwrite(&bodySize, sizeof(bodySize), 1, file) == 1 &&
+    fwrite(response.body.data(), 1, response.body.size(), file) == response.body.size();
+  outSize = (uint64_t)ftell(file);
+  if (fclose(file) != 0) {
+    ok = false;
+  }
+  return ok;
+}
+
+// read the file back, without a response only the key and times are read
+static bool ReadEntry(const string &path, string &outKey, int64_t &outStoredAt, int64_t &outFreshUntil,
+  HttpResponse *outResponse, uint64_t *outSize = nullptr)
+{
+  FILE *file = fopen(path.c_str(), "rb");
+  if (!file) {
+    return false;
+  }
+  uint32_t magic = 0;
+  bool ok = fread(&magic, sizeof(magic), 1, file) == 1 && magic == CACHE_MAGIC &&
+    ReadString(file, outKey, CACHE_MAX_STRING) &&
+    fread(&outStoredAt, sizeof(outStoredAt), 1, file) == 1 &&
+    fread(&outFreshUntil, sizeof(outFreshUntil), 1, file) == 1;
+  if (ok && outResponse) {
+    uint32_t numHeaders = 0;
+    ok = fread(&outResponse->status, sizeof(outResponse->status), 1, file) == 1 &&
+      fread(&numHeaders, sizeof(numHeaders), 1, file) == 1;
+    outResponse->headers.clear();
+    for (uint32_t i = 0; ok && i < numHeaders; ++i) {
+      string name;
+      string value;
+      ok = ReadString(file, name, CACHE_MAX_STRING) && ReadString(file, value, CACHE_MAX_STRING);
+      outResponse->headers[name] = value;
+    }
+    uint64_t bodySize = 0;
+    ok = ok && fread(&bodySize, sizeof(bodySize), 1, file) == 1 && bodySize <= CACHE_MAX_BODY;
+    if (ok) {
+      outResponse->body.resize((size_t)bodySize);
+      ok = fread(&outResponse->body[0], 1, (size_t)bodySize, file) == bodySize;
+    }
+  }
+  if (ok && outSize) {
+    fseek(file, 0, SEEK_END);
+    *outSize = (uint64_t)ftell(file);
+  }
+  fclose(file);
+  return ok;
+}
+
+static bool ReplaceEntry(const string &from, const string &to)
+{
+#ifdef _WIN32
+  return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+  return rename(from.c_str(), to.c_str()) == 0;
+#endif
+}
+
+HttpCache::HttpCache(HttpClient &client, const string &directory, uint64_t maxBytes,
+  uint32_t freshSecs, uint32_t maxAgeSecs)
+  : client(client), directory(directory), maxBytes(maxBytes), freshSecs(freshSecs),
+  maxAgeSecs(maxAgeSecs), lock(), entries(), numBytes(0), useCount(0), refreshThread(), refreshWake(),
+  refreshIdle(), refreshQueue(), refreshKeys(), refreshBusy(false), quit(false), numFresh(0),
+  numStale(0), numMisses(0), numNotModified(0)
+{
+#ifdef _WIN32
+  CreateDirectoryA(directory.c_str(), NULL);
+#else
+  mkdir(directory.c_str(), 0755);
+#endif
+  lock_guard<mutex> guard(lock);
+  Scan();
+}
+
+HttpCache::~HttpCache()
+{
+  // a revalidation that is under way finishes but the rest are dropped
+  {
+    lock_guard<mutex> guard(lock);
+    quit = true;
+  }
+  refreshWake.notify_all();
+  if (refreshThread.joinable()) {
+    refreshThread.join();
+  }
+}
+
+HttpCache::Source HttpCache::Get(const HttpRequest &request, HttpResponse &response)
+{
+  if (request.method != "GET") {
+    client.Send(request, response);
+    return SOURCE_NETWORK;
+  }
+  string key = KeyOf(request);
+  HttpResponse cached;
+  bool fresh = false;
+  bool found = false;
+  {
+    lock_guard<mutex> guard(lock);
+    auto it = entries.find(key);
+    if (it != entries.end()) {
+      int64_t now = (int64_t)time(nullptr);
+      int64_t freshUntil = it->second.freshUntil ? it->second.freshUntil : it->second.storedAt + freshSecs;
+      fresh = now < freshUntil;
+      it->second.lastUse = ++useCount;
+      found = (now - it->second.storedAt <= maxAgeSecs) && Load(key, cached);
+      if (!found) {
+        Remove(key);
+      }
+    }
+    if (found && fresh) {
+      numFresh++;
+    } else if (found) {
+      numStale++;
+    }
+  }
+  if (found) {
+    if (!fresh) {
+      Refresh(request);
+    }
+    response = move(cached);
+    return fresh ? SOURCE_FRESH : SOURCE_STALE;
+  }
+  Fetch(request, nullptr, response);
+  lock_guard<mutex> guard(lock);
+  numMisses++;
+  return SOURCE_NETWORK;
+}
+
+void HttpCache::WaitForRefreshes()
+{
+  unique_lock<mutex> guard(lock);
+  refreshIdle.wait(guard, [this]() { return quit || (refreshQueue.empty() && !refreshBusy); });
+}
+
+void HttpCache::Clear()
+{
+  lock_guard<mutex> guard(lock);
+  while (!entries.empty()) {
+    Remove(entries.begin()->first);
+  }
+}
+
+uint32_t HttpCache::NumEntries() const
+{
+  lock_guard<mutex> guard(lock);
+  return (uint32_t)entries.size();
+}
+
+uint64_t HttpCache::NumBytes() const
+{
+  lock_guard<mutex> guard(lock);
+  return numBytes;
+}
+
+uint32_t HttpCache::NumFresh() const
+{
+  lock_guard<mutex> guard(lock);
+  return numFresh;
+}
+
+uint32_t HttpCache::NumStale() const
+{
+  lock_guard<mutex> guard(lock);
+  return numStale;
+}
+
+uint32_t HttpCache::NumMisses() const
+{
+  lock_guard<mutex> guard(lock);
+  return numMisses;
+}
+
+uint32_t HttpCache::NumNotModified() const
+{
+  lock_guard<mutex> guard(lock);
+  return numNotModified;
+}
+
+string HttpCache::KeyOf(const HttpRequest &request)
+{
+  return (request.secure ? "https://" : "http://") + request.host + ":" +
+    to_string(request.port) + request.path;
+}
+
+string HttpCache::DerivedPath(const HttpRequest &request, const string &extension) const
+{
+  return PathOf(NameOf(KeyOf(request)) + extension);
+}
+
+void HttpCache::AddDerived(const HttpRequest &request, const string &extension)
+{
+  string key = KeyOf(request);
+  string file = NameOf(key) + extension;
+  string path = PathOf(file);
+  lock_guard<mutex> guard(lock);
+  auto it = entries.find(key);
+  uint64_t size = 0;
+  if (it == entries.end() || !SizeOf(path, size)) {
+    // the response was removed while the file was being made
+    remove(path.c_str());
+    return;
+  }
+  Entry &entry = it->second;
+  uint64_t &derivedSize = entry.derived[file];
+  entry.size += size - derivedSize;
+  numBytes += size - derivedSize;
+  derivedSize = size;
+  Trim();
+}
+
+void HttpCache::Fetch(const HttpRequest &request, const HttpResponse *cached, HttpResponse &response)
+{
+  HttpRequest conditional = request;
+  if (cached) {
+    auto etag = cached->headers.find("etag");
+    if (etag != cached->headers.end()) {
+      conditional.headers["If-None-Match"] = etag->second;
+    }
+    auto modified = cached->headers.find("last-modified");
+    if (modified != cached->headers.end()) {
+      conditional.headers["If-Modified-Since"] = modified->second;
+    }
+  }
+  client.Send(conditional, response);
+
+  string key = KeyOf(request);
+  lock_guard<mutex> guard(lock);
+  if (cached && response.status == 304) {
+    // nothing changed, the headers of the 304 replace the cached ones except
+    // for the ones about the connection and the body
+    numNotModified++;
+    HttpResponse updated = *cached;
+    StripHopByHop(response.headers);
+    for (const auto &header : response.headers) {
+      updated.headers[header.first] = header.second;
+    }
+    response = move(updated);
+  } else if (response.status != 200) {
+    // errors are never cached and don't replace what is
+    return;
+  }
+  // the body is stored decoded and whole, so what the headers said about
+  // how it was sent, like being chunked, isn't kept with it
+  StripHopByHop(response.headers);
+  // how long the response can be served without asking again, unless the
+  // server says it goes by the fresh time of the cache
+  int64_t now = (int64_t)time(nullptr);
+  int64_t freshUntil = 0;
+  auto control = response.headers.find("cache-control");
+  if (control != response.headers.end()) {
+    string value = control->second;
+    for (char &c : value) {
+      c = (char)tolower((unsigned char)c);
+    }
+    if (value.find("no-store") != string::npos) {
+      Remove(key);
+      return;
+    }
+    size_t maxAge = value.find("max-age=");
+    if (value.find("no-cache") != string::npos) {
+      freshUntil = now;
+    } else if (maxAge != string::npos) {
+      freshUntil = now + strtoll(value.c_str() + maxAge + 8, nullptr, 10);
+    }
+  }
+  Store(key, response, freshUntil);
+}
+
+void HttpCache::Scan()
+{
+  int64_t now = (int64_t)time(nullptr);
+  vector<string> derivedFiles;
+  for (const string &file : ListFiles(directory)) {
+    string path = PathOf(file);
+    if (!EndsWith(file, CACHE_EXTENSION)) {
+      // left behind by a write that never finished
+      if (EndsWith(file, ".tmp")) {
+        remove(path.c_str());
+      } else {
+        derivedFiles.push_back(file);
+      }
+      continue;
+    }
+    Entry entry;
+    string key;
+    entry.file = file;
+    if (!ReadEntry(path, key, entry.storedAt, entry.freshUntil, nullptr, &entry.size) ||
+        FileOf(key) != file || now - entry.storedAt > maxAgeSecs) {
+      remove(path.c_str());
+      continue;
+    }
+    entries[key] = entry;
+    numBytes += entry.size;
+  }
+  // derived files go with the entry they're named after, the ones that
+  // outlived their response are removed
+  map<string, Entry *> byName;
+  for (auto &it : entries) {
+    byName[NameOf(it.first)] = &it.second;
+  }
+  for (const string &file : derivedFiles) {
+    string name = file.substr(0, file.find('.'));
+    auto owner = byName.find(name);
+    uint64_t size = 0;
+    if (owner == byName.end() || !SizeOf(PathOf(file), size)) {
+      if (name.size() == CACHE_NAME_LENGTH) {
+        remove(PathOf(file).c_str());
+      }
+      continue;
+    }
+    owner->second->derived[file] = size;
+    owner->second->size += size;
+    numBytes += size;
+  }
+  // until they're used again the entries stored last count as used last
+  vector<Entry *> byAge;
+  for (auto &it : entries) {
+    byAge.push_back(&it.second);
+  }
+  sort(byAge.begin(), byAge.end(), [](const Entry *a, const Entry *b) { return a->storedAt < b->storedAt; });
+  for (Entry *entry : byAge) {
+    entry->lastUse = ++useCount;
+  }
+  Trim();
+}
+
+bool HttpCache::Load(const string &key, HttpResponse &response)
+{
+  auto it = entries.find(key);
+  if (it == entries.end()) {
+    return false;
+  }
+  string fileKey;
+  int64_t storedAt = 0;
+  int64_t freshUntil = 0;
+  return ReadEntry(PathOf(it->second.file), fileKey, storedAt, freshUntil, &response) && fileKey == key;
+}
+
+void HttpCache::Store(const string &key, const HttpResponse &response, int64_t freshUntil)
+{
+  Entry entry;
+  entry.file = FileOf(key);
+  entry.size = 0;
+  entry.storedAt = (int64_t)time(nullptr);
+  entry.freshUntil = freshUntil;
+  entry.lastUse = ++useCount;
+  // written beside the old file first so a failed write leaves whatever
+  // was cached before as it was
+  string path = PathOf(entry.file);
+  string tempPath = path + ".tmp";
+  if (!WriteEntry(tempPath, key, entry.storedAt, entry.freshUntil, response, entry.size) ||
+      !ReplaceEntry(tempPath, path)) {
+    remove(tempPath.c_str());
+    return;
+  }
+  auto it = entries.find(key);
+  if (it != entries.end()) {
+    // the derived files stay, whatever made them checks they still match
+    // the response before using them
+    entry.derived = move(it->second.derived);
+    for (const auto &derived : entry.derived) {
+      entry.size += derived.second;
+    }
+    numBytes -= it->second.size;
+  }
+  entries[key] = entry;
+  numBytes += entry.size;
+  Trim();
+}
+
+void HttpCache::Remove(const string &key)
+{
+  auto it = entries.find(key);
+  if (it == entries.end()) {
+    return;
+  }
+  remove(PathOf(it->second.file).c_str());
+  for (const auto &derived : it->second.derived) {
+    remove(PathOf(derived.first).c_str());
+  }
+  numBytes -= it->second.size;
+  entries.erase(it);
+}
+
+void HttpCache::Trim()
+{
+  int64_t now = (int64_t)time(nullptr);
+  for (auto it = entries.begin(); it != entries.end();) {
+    auto next = it;
+    ++next;
+    if (now - it->second.storedAt > maxAgeSecs) {
+      Remove(it->first);
+    }
+    it = next;
+  }
+  while (numBytes > maxBytes && !entries.empty()) {
+    auto oldest = entries.begin();
+    for (auto it = entries.begin(); it != entries.end(); ++it) {
+      if (it->second.lastUse < oldest->second.lastUse) {
+        oldest = it;
+      }
+    }
+    Remove(oldest->first);
+  }
+}
+
+void HttpCache::Refresh(const HttpRequest &request)
+{
+  string key = KeyOf(request);
+  lock_guard<mutex> guard(lock);
+  // a page that's asked for again before it's been revalidated is only
+  // revalidated once
+  if (quit || refreshKeys.count(key)) {
+    return;
+  }
+  refreshKeys.insert(key);
+  refreshQueue.push_back(request);
+  if (!refreshThread.joinable()) {
+    refreshThread = thread(&HttpCache::RefreshThread, this);
+  }
+  refreshWake.notify_one();
+}
+
+void HttpCache::RefreshThread()
+{
+  unique_lock<mutex> guard(lock);
+  while (true) {
+    refreshWake.wait(guard, [this]() { return quit || !refreshQueue.empty(); });
+    if (quit) {
+      break;
+    }
+    HttpRequest request = move(refreshQueue.front());
+    refreshQueue.pop_front();
+    refreshBusy = true;
+    string key = KeyOf(request);
+    HttpResponse cached;
+    bool found = Load(key, cached);
+    guard.unlock();
+    try {
+      HttpResponse response;
+      Fetch(request, found ? &cached : nullptr, response);
+    } catch (...) {
+      // most likely offline, the stale response stays as it is
+    }
+    guard.lock();
+    refreshKeys.erase(key);
+    refreshBusy = false;
+    if (refreshQueue.empty()) {
+      refreshIdle.notify_all();
+    }
+  }
+  refreshIdle.notify_all();
+}
+
+string HttpCache::PathOf(const string &file) const
+{
+#ifdef _WIN32
+  return directory + "\\" + file;
+#else
+  return directory + "/" + file;
+#endif
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+#include "HttpClient.h"
+
+#include <stdint.h>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+
+// A cache of responses on disk so that anything fetched before shows up
+// straight away in the next session, even without a connection.
+//
+// Each response is kept in a file of it's own in the cache directory, keyed
+// by the host and the full path including the query. The status and headers
+// are kept with the body so that the ETag and Last-Modified of the response
+// can be handed back to the server to revalidate it, if nothing changed the
+// server only answers with a 304 and no body.
+//
+// A response is fresh for a while after it was fetched, or for the max-age
+// the server gave it, and is served without asking the server at all. After
+// that it's stale, a stale response is still served right away but it's also
+// revalidated on a background thread so it's fresh again for next time.
+// Responses older than the age limit are never served and are removed, and
+// the least recently used responses are removed whenever the cache grows
+// over the size limit.
+//
+// Files made from a cached response, like the body converted into some
+// other form, can be kept in the cache directory with it. They're named
+// after the response, count towards the size limit with it and are removed
+// along with it.
+class HttpCache
+{
+public:
+  HttpCache(HttpClient &client, const std::string &directory, uint64_t maxBytes = 32 * 1024 * 1024,
+    uint32_t freshSecs = 10 * 60, uint32_t maxAgeSecs = 30 * 24 * 60 * 60);
+  ~HttpCache();
+
+  // where a response came from
+  enum Source
+  {
+    // nothing usable was cached so it came from the server
+    SOURCE_NETWORK,
+    // a fresh response from the cache, the server wasn't asked
+    SOURCE_FRESH,
+    // a stale response from the cache, it's being revalidated
+    SOURCE_STALE,
+  };
+
+  // send a request through the cache, only GET requests are cached and
+  // anything else goes straight to the client. Throws runtime_error if
+  // nothing was cached and the request failed
+  Source Get(const HttpRequest &request, HttpResponse &response);
+
+  // block until the background revalidations are all done
+  void WaitForRefreshes();
+
+  // remove every cached response
+  void Clear();
+
+  uint32_t NumEntries() const;
+  uint64_t NumBytes() const;
+
+  // how requests have been answered since the cache was opened
+  uint32_t NumFresh() const;
+  uint32_t NumStale() const;
+  uint32_t NumMisses() const;
+  // revalidations the server answered with 304 Not Modified
+  uint32_t NumNotModified() const;
+
+  // the key a request is cached under
+  static std::string KeyOf(const HttpRequest &request);
+
+  // where to write a file made from the cached response of a request, the
+  // extension tells apart the files made from the same response
+  std::string DerivedPath(const HttpRequest &request, const std::string &extension) const;
+  // count a file that was just written to the derived path, if the response
+  // is no longer cached the file is removed instead
+  void AddDerived(const HttpRequest &request, const std::string &extension);
+
+private:
+  struct Entry
+  {
+    // name of the file in the cache directory
+    std::string file;
+    // the size of the file and the derived files together
+    uint64_t size;
+    // the derived files and their sizes
+    std::map<std::string, uint64_t> derived;
+    // when the response was fetched or last revalidated
+    int64_t storedAt;
+    // when the response goes stale if the server said, otherwise zero and
+    // it goes stale the configured time after it was stored
+    int64_t freshUntil;
+    // the use count when the entry was last used
+    uint64_t lastUse;
+  };
+
+  // send the request, with the validators of the cached response if there
+  // is one, and store what comes back. A 304 fills the response out with
+  // the cached one
+  void Fetch(const HttpRequest &request, const HttpResponse *cached, HttpResponse &response);
+
+  // read in the entries that are on disk, removing any that are too old
+  void Scan();
+  // these all need the lock held, storing a response also brings the
+  // cache back under it's limits
+  bool Load(const std::string &key, HttpResponse &response);
+  void Store(const std::string &key, const HttpResponse &response, int64_t freshUntil);
+  void Remove(const std::string &key);
+  void Trim();
+
+  // start a revalidation on the background thread
+  void Refresh(const HttpRequest &request);
+  void RefreshThread();
+
+  std::string PathOf(const std::string &file) const;
+
+  HttpClient &client;
+  std::string directory;
+  uint64_t maxBytes;
+  uint32_t freshSecs;
+  uint32_t maxAgeSecs;
+
+  // guards everything below and all access to the files
+  mutable std::mutex lock;
+  std::map<std::string, Entry> entries;
+  uint64_t numBytes;
+  uint64_t useCount;
+
+  // revalidations waiting for the background thread
+  std::thread refreshThread;
+  std::condition_variable refreshWake;
+  std::condition_variable refreshIdle;
+  std::deque<HttpRequest> refreshQueue;
+  std::set<std::string> refreshKeys;
+  bool refreshBusy;
+  bool quit;
+
+  uint32_t numFresh;
+  uint32_t numStale;
+  uint32_t numMisses;
+  uint32_t numNotModified;
+};
@@ -1,106 +1,161 @@
 #include "HttpClient.h"
+#include "HttpDecoder.h"
+
+#include <chrono>
+
+#ifdef _WIN32
+#pragma comment(lib, "winhttp.lib")
+#endif
 
 using namespace std;
 
-HttpClient::HttpClient(const string &userAgent)
-  : userAgent(ConvertToWideString(userAgent))
+HttpClient::HttpClient(const string &userAgent, shared_ptr<HttpBackend> backend)
+  : userAgent(userAgent), backend(backend), compression(true), statsLock(), numRequests(0),
+  lastLatencyMs(0), totalLatencyMs(0), totalWireBytes(0), totalBodyBytes(0)
 {
+#ifdef _WIN32
+  if (!this->backend) {
+    this->backend = make_shared<WinHttpBackend>();
+  }
+#endif
+  if (!this->backend) {
+    throw runtime_error("No HTTP backend");
+  }
 }
 
 string HttpClient::SendRequest(const string &host, const string &path, const string &method,
   const map<string, string> &headers, const string &requestData, const map<string, string> &queryParams)
 {
-  wstring responseW;
-  string result;
-  wstring hostW = ConvertToWideString(host);
-  wstring pathW = BuildFullPath(ConvertToWideString(path), ConvertMapToWideString(queryParams));
-  wstring methodW = ConvertToWideString(method);
-
-  HINTERNET hSession = nullptr;
-  HINTERNET hConnect = nullptr;
-  HINTERNET hRequest = nullptr;
-
-  hSession = WinHttpOpen(userAgent.c_str(), WINHTTP_ACCESS_TYPE_DEFAULT_PROXY,
-    WINHTTP_NO_PROXY_NAME, WINHTTP_NO_PROXY_BYPASS, 0);
-  if (!hSession) {
-    throw runtime_error("Failed to open HTTP session");
-  }
-
-  hConnect = WinHttpConnect(hSession, hostW.c_str(), INTERNET_DEFAULT_HTTPS_PORT, 0);
-  if (!hConnect) {
-    throw runtime_error("Failed to connect");
-  }
-
-  hRequest = WinHttpOpenRequest(hConnect, methodW.c_str(), pathW.c_str(),
-    NULL, WINHTTP_NO_REFERER, WINHTTP_DEFAULT_ACCEPT_TYPES, WINHTTP_FLAG_SECURE);
-  if (!hRequest) {
-    throw runtime_error("Failed to open HTTP request");
-  }
+  HttpRequest request;
+  request.host = host;
+  request.path = BuildFullPath(path, queryParams);
+  request.method = method;
+  request.headers = headers;
+  request.body = requestData;
+  HttpResponse response;
+  Send(request, response);
+  return response.body;
+}
 
-  for (const auto &pair : headers) {
-    wstring fullHeader = ConvertToWideString(pair.first + ": " + pair.second);
-    if (!WinHttpAddRequestHeaders(hRequest, fullHeader.c_str(), -1, WINHTTP_ADDREQ_FLAG_ADD)) {
-      throw runtime_error("Failed to add request header");
+void HttpClient::Send(const HttpRequest &request, HttpResponse &response, const HttpSink &sink)
+{
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  const HttpRequest *sent = &request;
+  HttpRequest withEncoding;
+  if (compression) {
+    bool hasEncoding = false;
+    for (auto &header : request.headers) {
+      string name = header.first;
+      for (char &c : name) {
+        c = (char)tolower((unsigned char)c);
+      }
+      hasEncoding |= (name == "accept-encoding");
+    }
+    if (!hasEncoding) {
+      withEncoding = request;
+      withEncoding.headers["Accept-Encoding"] = HttpDecoder::AcceptEncoding();
+      sent = &withEncoding;
     }
   }
-
-  vector<wchar_t> requestDataW(requestData.begin(), requestData.end());
-  BOOL bResults = WinHttpSendRequest(hRequest, WINHTTP_NO_ADDITIONAL_HEADERS, 0, requestDataW.data(), 
-    requestDataW.size() * sizeof(wchar_t), requestDataW.size() * sizeof(wchar_t), 0);
-  if (!bResults) {
-    throw runtime_error("Failed to send request");
+  response.wireSize = 0;
+  response.bodySize = 0;
+  // the body is decoded between reads off the connection, so a compressed
+  // body is mostly decoded by the time the last of it arrives
+  HttpDecoder decoder;
+  bool started = false;
+  bool stopped = false;
+  HttpSink output = [&](const char *data, size_t size) {
+    response.bodySize += size;
+    if (sink) {
+      return sink(data, size);
+    }
+    response.body.append(data, size);
+    return true;
+  };
+  backend->Send(userAgent, *sent, response, [&](const char *data, size_t size) {
+    if (!started) {
+      started = true;
+      auto encoding = response.headers.find("content-encoding");
+      if (!decoder.Start(encoding != response.headers.end() ? encoding->second : "")) {
+        throw runtime_error("Unsupported content encoding: " + encoding->second);
+      }
+      auto length = response.headers.find("content-length");
+      if (!sink && length != response.headers.end()) {
+        // a compressed body decodes to at least as much as was sent
+        response.body.reserve((size_t)strtoull(length->second.c_str(), nullptr, 10));
+      }
+    }
+    response.wireSize += size;
+    stopped = !decoder.Write(data, size, output);
+    return !stopped;
+  });
+  if (started && !stopped) {
+    decoder.Finish(output);
   }
-  bResults = WinHttpReceiveResponse(hRequest, NULL);
-  if (!bResults) {
-    throw runtime_error("Failed to receive response");
+  if (decoder.IsEncoded()) {
+    // the headers describe the body the caller got, not what was sent
+    response.headers.erase("content-encoding");
+    response.headers.erase("content-length");
   }
+  double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+  lock_guard<mutex> guard(statsLock);
+  numRequests++;
+  lastLatencyMs = ms;
+  totalLatencyMs += ms;
+  totalWireBytes += response.wireSize;
+  totalBodyBytes += response.bodySize;
+}
 
-  DWORD dwSize = 0;
-  DWORD dwDownloaded = 0;
-  do {
-    if (!WinHttpQueryDataAvailable(hRequest, &dwSize)) {
-      throw runtime_error("Failed to query data available");
-    }
-
-    vector<char> buffer(dwSize + 1);
-    if (!WinHttpReadData(hRequest, buffer.data(), dwSize, &dwDownloaded)) {
-      throw runtime_error("Failed to read data");
-    }
+uint32_t HttpClient::NumRequests() const
+{
+  lock_guard<mutex> guard(statsLock);
+  return numRequests;
+}
 
-    responseW.append(buffer.begin(), buffer.begin() + dwDownloaded);
-  } while (dwSize > 0);
+double HttpClient::LastLatencyMs() const
+{
+  lock_guard<mutex> guard(statsLock);
+  return lastLatencyMs;
+}
 
-  // Convert wide string to UTF-8
-  result = ConvertToNarrowString(responseW);
+double HttpClient::AverageLatencyMs() const
+{
+  lock_guard<mutex> guard(statsLock);
+  return numRequests ? (totalLatencyMs / numRequests) : 0;
+}
 
-  WinHttpCloseHandle(hRequest);
-  WinHttpCloseHandle(hConnect);
-  WinHttpCloseHandle(hSession);
+uint64_t HttpClient::TotalWireBytes() const
+{
+  lock_guard<mutex> guard(statsLock);
+  return totalWireBytes;
+}
 
-  return result;
+uint64_t HttpClient::TotalBodyBytes() const
+{
+  lock_guard<mutex> guard(statsLock);
+  return totalBodyBytes;
 }
 
-wstring HttpClient::BuildFullPath(const wstring &path, const map<wstring, wstring> &queryParams)
+string HttpClient::BuildFullPath(const string &path, const map<string, string> &queryParams)
 {
   if (queryParams.empty()) {
     return path;
   }
 
-  wstringstream fullUrlStream;
+  stringstream fullUrlStream;
   fullUrlStream << path;
-  if (!queryParams.empty()) {
-    fullUrlStream << L"?";
-    for (auto iter = queryParams.begin(); iter != queryParams.end(); ++iter) {
-      if (iter != queryParams.begin()) {
-        fullUrlStream << L"&";
-      }
-      fullUrlStream << iter->first << L"=" << iter->second;
+  fullUrlStream << "?";
+  for (auto iter = queryParams.begin(); iter != queryParams.end(); ++iter) {
+    if (iter != queryParams.begin()) {
+      fullUrlStream << "&";
     }
+    fullUrlStream << iter->first << "=" << iter->second;
   }
   return fullUrlStream.str();
 }
 
-wstring HttpClient::ConvertToWideString(const string &input)
+#ifdef _WIN32
+static wstring ConvertToWideString(const string &input)
 {
   if (input.empty()) {
     return L"";
@@ -111,7 +166,7 @@ wstring HttpClient::ConvertToWideString(const string &input)
   return wstrTo;
 }
 
-string HttpClient::ConvertToNarrowString(const wstring &input)
+static string ConvertToNarrowString(const wstring &input)
 {
   if (input.empty()) {
     return "";
@@ -122,11 +177,141 @@ string HttpClient::ConvertToNarrowString(const wstring &input)
   return strTo;
 }
 
-map<wstring, wstring> HttpClient::ConvertMapToWideString(const map<string, string> &inputMap)
+WinHttpBackend::WinHttpBackend()
+  : lock(), session(), connections()
 {
-  map<wstring, wstring> outputMap;
-  for (const auto &kv : inputMap) {
-    outputMap[ConvertToWideString(kv.first)] = ConvertToWideString(kv.second);
+  InitializeSRWLock(&lock);
+}
+
+WinHttpBackend::~WinHttpBackend()
+{
+  // the connections have to be closed before the session they belong to
+  connections.clear();
+  session.reset();
+}
+
+HINTERNET WinHttpBackend::Connect(const string &userAgent, const HttpRequest &request)
+{
+  string key = request.host + ":" + to_string(request.port);
+  AcquireSRWLockExclusive(&lock);
+  if (!session) {
+    session.reset(WinHttpOpen(ConvertToWideString(userAgent).c_str(), WINHTTP_ACCESS_TYPE_DEFAULT_PROXY,
+      WINHTTP_NO_PROXY_NAME, WINHTTP_NO_PROXY_BYPASS, 0));
+  }
+  HINTERNET hConnect = nullptr;
+  if (session) {
+    auto it = connections.find(key);
+    if (it == connections.end()) {
+      unique_ptr<WinHttpHandle> connection = make_unique<WinHttpHandle>(WinHttpConnect(session.get(),
+        ConvertToWideString(request.host).c_str(), request.port, 0));
+      if (*connection) {
+        it = connections.emplace(key, move(connection)).first;
+      }
+    }
+    if (it != connections.end()) {
+      hConnect = it->second->get();
+    }
+  }
+  bool hasSession = session;
+  ReleaseSRWLockExclusive(&lock);
+  if (!hasSession) {
+    throw runtime_error("Failed to open HTTP session");
+  }
+  if (!hConnect) {
+    throw runtime_error("Failed to connect");
+  }
+  return hConnect;
+}
+
+void WinHttpBackend::Send(const string &userAgent, const HttpRequest &request, HttpResponse &response,
+  const HttpSink &sink)
+{
+  // the connection stays open, only the request is closed once it's done
+  // which hands the socket back to winhttp for the next request
+  HINTERNET hConnect = Connect(userAgent, request);
+  wstring pathW = ConvertToWideString(request.path);
+  wstring methodW = ConvertToWideString(request.method);
+  WinHttpHandle hRequest(WinHttpOpenRequest(hConnect, methodW.c_str(), pathW.c_str(),
+    NULL, WINHTTP_NO_REFERER, WINHTTP_DEFAULT_ACCEPT_TYPES, request.secure ? WINHTTP_FLAG_SECURE : 0));
+  if (!hRequest) {
+    throw runtime_error("Failed to open HTTP request");
+  }
+
+  for (const auto &pair : request.headers) {
+    wstring fullHeader = ConvertToWideString(pair.first + ": " + pair.second);
+    if (!WinHttpAddRequestHeaders(hRequest.get(), fullHeader.c_str(), -1, WINHTTP_ADDREQ_FLAG_ADD)) {
+      throw runtime_error("Failed to add request header");
+    }
+  }
+
+  // the request body goes out as the bytes it was given
+  LPVOID requestData = request.body.empty() ? WINHTTP_NO_REQUEST_DATA : (LPVOID)request.body.data();
+  BOOL bResults = WinHttpSendRequest(hRequest.get(), WINHTTP_NO_ADDITIONAL_HEADERS, 0, requestData,
+    (DWORD)request.body.size(), (DWORD)request.body.size(), 0);
+  if (!bResults) {
+    throw runtime_error("Failed to send request");
+  }
+  bResults = WinHttpReceiveResponse(hRequest.get(), NULL);
+  if (!bResults) {
+    throw runtime_error("Failed to receive response");
+  }
+
+  DWORD status = 0;
+  DWORD statusSize = sizeof(status);
+  WinHttpQueryHeaders(hRequest.get(), WINHTTP_QUERY_STATUS_CODE | WINHTTP_QUERY_FLAG_NUMBER,
+    WINHTTP_HEADER_NAME_BY_INDEX, &status, &statusSize, WINHTTP_NO_HEADER_INDEX);
+  response.status = status;
+  response.headers.clear();
+  DWORD headersSize = 0;
+  WinHttpQueryHeaders(hRequest.get(), WINHTTP_QUERY_RAW_HEADERS_CRLF, WINHTTP_HEADER_NAME_BY_INDEX,
+    WINHTTP_NO_OUTPUT_BUFFER, &headersSize, WINHTTP_NO_HEADER_INDEX);
+  if (headersSize) {
+    wstring rawHeaders(headersSize / sizeof(wchar_t), 0);
+    if (WinHttpQueryHeaders(hRequest.get(), WINHTTP_QUERY_RAW_HEADERS_CRLF, WINHTTP_HEADER_NAME_BY_INDEX,
+        &rawHeaders[0], &headersSize, WINHTTP_NO_HEADER_INDEX)) {
+      stringstream lines(ConvertToNarrowString(rawHeaders));
+      string line;
+      // the first line is the status line
+      getline(lines, line);
+      while (getline(lines, line)) {
+        size_t colon = line.find(':');
+        if (colon == string::npos) {
+          continue;
+        }
+        string name = line.substr(0, colon);
+        for (char &c : name) {
+          c = (char)tolower((unsigned char)c);
+        }
+        size_t start = line.find_first_not_of(" \t", colon + 1);
+        size_t end = line.find_last_not_of(" \t\r");
+        response.headers[name] = (start == string::npos || end < start) ? "" : line.substr(start, end - start + 1);
+      }
+    }
+  }
+
+  // the body is read into one block that is reused for every read
+  response.body.clear();
+  vector<char> block;
+  DWORD dwSize = 0;
+  while (true) {
+    if (!WinHttpQueryDataAvailable(hRequest.get(), &dwSize)) {
+      throw runtime_error("Failed to query data available");
+    }
+    if (!dwSize) {
+      break;
+    }
+    if (block.size() < dwSize) {
+      block.resize(dwSize);
+    }
+    DWORD dwDownloaded = 0;
+    if (!WinHttpReadData(hRequest.get(), block.data(), dwSize, &dwDownloaded)) {
+      throw runtime_error("Failed to read data");
+    }
+    // the rest is left unread, closing the request part way through
+    // drops it's connection instead of handing it to the next request
+    if (!sink(block.data(), dwDownloaded)) {
+      break;
+    }
   }
-  return outputMap;
 }
+#endif
@@ -1,27 +1,153 @@
-#include <windows.h>
-#include <winhttp.h>
+#pragma once
+
+#include <stdint.h>
+#include <functional>
 #include <string>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <vector>
 #include <sstream>
 #include <stdexcept>
 
+#ifdef _WIN32
+#include <windows.h>
+#include <winhttp.h>
+#endif
+
+// a single request, the path already has it's query string on it
+struct HttpRequest
+{
+  std::string host;
+  uint16_t port = 443;
+  bool secure = true;
+  std::string method = "GET";
+  std::string path = "/";
+  std::map<std::string, std::string> headers;
+  std::string body;
+};
+
+struct HttpResponse
+{
+  uint32_t status = 0;
+  // the header names are all lowercase
+  std::map<std::string, std::string> headers;
+  std::string body;
+  // the size of the body as it came over the connection and once decoded,
+  // these only differ when the server compressed the body
+  uint64_t wireSize = 0;
+  uint64_t bodySize = 0;
+};
+
+// Takes the body of a response a block at a time as it arrives instead of
+// collecting it in the response, return false to stop reading. The status and
+// headers are filled in before the first block and the block is only valid
+// during the call. Backends pass the bytes through untouched, the client
+// decodes compressed bodies before they reach the caller's sink.
+typedef std::function<bool(const char *data, size_t size)> HttpSink;
+
+// The part of the client that actually talks to the server. A backend
+// keeps connections open between requests so that a run of requests to the
+// same host only pays for connecting once, and it must be safe to send on
+// from more than one thread at a time. Failures are thrown as runtime_error.
+//
+// The body is handed to the sink as raw bytes while it arrives and the body
+// of the response is left empty, the client always passes a sink.
+class HttpBackend
+{
+public:
+  virtual ~HttpBackend() {}
+  virtual void Send(const std::string &userAgent, const HttpRequest &request, HttpResponse &response,
+    const HttpSink &sink) = 0;
+};
+
+#ifdef _WIN32
+// closes a winhttp handle when it goes out of scope
+class WinHttpHandle
+{
+public:
+  WinHttpHandle(HINTERNET handle = nullptr) : handle(handle) {}
+  ~WinHttpHandle() { reset(); }
+  WinHttpHandle(const WinHttpHandle &) = delete;
+  WinHttpHandle &operator=(const WinHttpHandle &) = delete;
+
+  void reset(HINTERNET newHandle = nullptr)
+  {
+    if (handle) {
+      WinHttpCloseHandle(handle);
+    }
+    handle = newHandle;
+  }
+  HINTERNET get() const { return handle; }
+  operator bool() const { return handle != nullptr; }
+
+private:
+  HINTERNET handle;
+};
+
+// The default backend, one winhttp session for the life of the backend and
+// one connection handle per host. Winhttp keeps the sockets of a session
+// alive and hands them back out to the next request on the same host, so
+// after the first request there is no new tcp or tls handshake.
+class WinHttpBackend : public HttpBackend
+{
+public:
+  WinHttpBackend();
+  ~WinHttpBackend();
+
+  void Send(const std::string &userAgent, const HttpRequest &request, HttpResponse &response,
+    const HttpSink &sink) override;
+
+private:
+  // get the connection for a host, opening the session the first time
+  HINTERNET Connect(const std::string &userAgent, const HttpRequest &request);
+
+  SRWLOCK lock;
+  WinHttpHandle session;
+  std::map<std::string, std::unique_ptr<WinHttpHandle>> connections;
+};
+#endif
+
 class HttpClient
 {
 public:
-  HttpClient(const std::string &userAgent);
+  // without a backend the client uses winhttp
+  HttpClient(const std::string &userAgent, std::shared_ptr<HttpBackend> backend = nullptr);
+
+  // send a request and return the body, throws runtime_error on failure
   std::string SendRequest(const std::string &host, const std::string &path,
     const std::string &method = "GET",
     const std::map<std::string, std::string> &headers = {},
     const std::string &requestData = "",
     const std::map<std::string, std::string> &queryParams = {});
 
+  // send a request and get the whole response back, or with a sink get the
+  // status and headers back and stream the body to the sink
+  void Send(const HttpRequest &request, HttpResponse &response, const HttpSink &sink = nullptr);
+
+  // whether to ask for compressed bodies, on by default. Set this before
+  // sending, bodies are decoded either way if the server compresses them
+  void SetCompression(bool enabled) { compression = enabled; }
+
+  // how long requests have taken, to see what keeping connections is worth
+  uint32_t NumRequests() const;
+  double LastLatencyMs() const;
+  double AverageLatencyMs() const;
+  // bytes received over the connection versus the bodies they decoded to
+  uint64_t TotalWireBytes() const;
+  uint64_t TotalBodyBytes() const;
+
+  static std::string BuildFullPath(const std::string &path, const std::map<std::string, std::string> &queryParams);
+
 private:
-  std::wstring userAgent;
-  bool useHttps;
+  std::string userAgent;
+  std::shared_ptr<HttpBackend> backend;
+  bool compression;
 
-  std::wstring BuildFullPath(const std::wstring &path, const std::map<std::wstring, std::wstring> &queryParams);
-  static std::wstring ConvertToWideString(const std::string &input);
-  static std::string ConvertToNarrowString(const std::wstring &input);
-  static std::map<std::wstring, std::wstring> ConvertMapToWideString(const std::map<std::string, std::string> &inputMap);
+  mutable std::mutex statsLock;
+  uint32_t numRequests;
+  double lastLatencyMs;
+  double totalLatencyMs;
+  uint64_t totalWireBytes;
+  uint64_t totalBodyBytes;
 };
@@ -0,0 +1,609 @@
+#include "HttpDecoder.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+// the furthest back a deflate stream can refer to
+#define DEFLATE_WINDOW_SIZE 32768
+// the most bits a length and distance pair can take with their extra bits
+#define DEFLATE_MAX_CODE_BITS 48
+// the most bits a block header can take including dynamic code lengths
+#define DEFLATE_MAX_HEADER_BITS 4600
+// decoded bytes are only dropped once this many are held
+#define DECODER_MAX_OUTPUT (DEFLATE_WINDOW_SIZE * 2)
+
+using namespace std;
+
+static const uint16_t lengthBase[29] = {
+  3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+  35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t lengthExtra[29] = {
+  0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+  3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const uint16_t distanceBase[30] = {
+  1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+  257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+static const uint8_t distanceExtra[30] = {
+  0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+  7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+// the order code length code lengths are stored in
+static const uint8_t codeLengthOrder[19] = {
+  16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+static uint32_t Crc32(uint32_t crc, const char *data, size_t size)
+{
+  // four tables so four bytes are folded in at a time instead of one
+  static uint32_t table[4][256];
+  static bool tableReady = []() {
+    for (uint32_t i = 0; i < 256; ++i) {
+      uint32_t c = i;
+      for (uint32_t k = 0; k < 8; ++k) {
+        c = (c & 1) ? (0xEDB88320 ^ (c >> 1)) : (c >> 1);
+      }
+      table[0][i] = c;
+    }
+    for (uint32_t i = 0; i < 256; ++i) {
+      for (uint32_t t = 1; t < 4; ++t) {
+        table[t][i] = table[0][table[t - 1][i] & 0xFF] ^ (table[t - 1][i] >> 8);
+      }
+    }
+    return true;
+  }();
+  (void)tableReady;
+  const uint8_t *bytes = (const uint8_t *)data;
+  crc = ~crc;
+  for (; size >= 4; size -= 4, bytes += 4) {
+    crc ^= bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+    crc = table[3][crc & 0xFF] ^ table[2][(crc >> 8) & 0xFF] ^ table[1][(crc >> 16) & 0xFF] ^ table[0][crc >> 24];
+  }
+  for (; size; --size, ++bytes) {
+    crc = table[0][(crc ^ *bytes) & 0xFF] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+static uint32_t Adler32(uint32_t adler, const char *data, size_t size)
+{
+  uint32_t a = adler & 0xFFFF;
+  uint32_t b = adler >> 16;
+  while (size) {
+    // the most bytes that can be summed before the sums have to wrap
+    size_t run = min(size, (size_t)5552);
+    for (size_t i = 0; i < run; ++i) {
+      a += (uint8_t)data[i];
+      b += a;
+    }
+    a %= 65521;
+    b %= 65521;
+    data += run;
+    size -= run;
+  }
+  return (b << 16) | a;
+}
+
+HttpDecoder::HttpDecoder()
+  : format(FORMAT_IDENTITY), state(STATE_HEADER), lastBlock(false), input(), inputPos(0),
+  bitBuf(0), bitCount(0), storedLeft(0), lengthCodes(), distanceCodes(), output(),
+  outputFlushed(0), crc(0), adler(1), decodedSize(0), expectedCheck(0), expectedSize(0)
+{
+}
+
+bool HttpDecoder::Start(const string &contentEncoding)
+{
+  string encoding = contentEncoding;
+  for (char &c : encoding) {
+    c = (char)tolower((unsigned char)c);
+  }
+  size_t start = encoding.find_first_not_of(" \t");
+  size_t end = encoding.find_last_not_of(" \t");
+  encoding = (start == string::npos) ? "" : encoding.substr(start, end - start + 1);
+  if (encoding.empty() || encoding == "identity") {
+    format = FORMAT_IDENTITY;
+  } else if (encoding == "gzip" || encoding == "x-gzip") {
+    format = FORMAT_GZIP;
+  } else if (encoding == "deflate") {
+    format = FORMAT_DEFLATE;
+  } else {
+    return false;
+  }
+  state = STATE_HEADER;
+  output.reserve(DECODER_MAX_OUTPUT + DEFLATE_WINDOW_SIZE);
+  return true;
+}
+
+bool HttpDecoder::Write(const char *data, size_t size, const HttpSink &sink)
+{
+  if (format == FORMAT_IDENTITY) {
+    decodedSize += size;
+    return sink(data, size);
+  }
+  if (state == STATE_DONE && size) {
+    // nothing can follow the end of the stream, more data means the end was
+    // read from a corrupt body or a second gzip member that isn't decoded
+    throw runtime_error("Compressed body has data after its end");
+  }
+  input.append(data, size);
+  Decode(false);
+  // the input that was read is dropped, what's left is the start of a code
+  // or header that hasn't fully arrived yet
+  input.erase(0, inputPos);
+  inputPos = 0;
+  return Flush(sink);
+}
+
+bool HttpDecoder::Finish(const HttpSink &sink)
+{
+  if (format == FORMAT_IDENTITY) {
+    return true;
+  }
+  Decode(true);
+  if (!Flush(sink)) {
+    return false;
+  }
+  if (state != STATE_DONE) {
+    throw runtime_error("Compressed body ended early");
+  }
+  // the stream ends on a whole byte, anything left is data after the end
+  if (inputPos < input.size() || bitCount >= 8) {
+    throw runtime_error("Compressed body has data after its end");
+  }
+  if (format == FORMAT_GZIP && (expectedCheck != crc || expectedSize != (uint32_t)decodedSize)) {
+    throw runtime_error("Compressed body failed its crc check");
+  }
+  if (format == FORMAT_ZLIB && expectedCheck != adler) {
+    throw runtime_error("Compressed body failed its adler check");
+  }
+  return true;
+}
+
+void HttpDecoder::Decode(bool final)
+{
+  while (true) {
+    switch (state) {
+    case STATE_HEADER:
+      if (!ReadHeader(final)) {
+        return;
+      }
+      break;
+    case STATE_BLOCK:
+      if (!ReadBlockHeader(final)) {
+        return;
+      }
+      break;
+    case STATE_STORED:
+      ReadStored(final);
+      if (state == STATE_STORED) {
+        return;
+      }
+      break;
+    case STATE_CODES:
+      ReadCodes(final);
+      if (state == STATE_CODES) {
+        return;
+      }
+      break;
+    case STATE_TRAILER:
+      if (!ReadTrailer(final)) {
+        return;
+      }
+      break;
+    case STATE_DONE:
+      return;
+    }
+  }
+}
+
+bool HttpDecoder::ReadHeader(bool final)
+{
+  // the headers are read straight from the input before any bits are
+  const uint8_t *in = (const uint8_t *)input.data() + inputPos;
+  size_t avail = input.size() - inputPos;
+  size_t pos = 0;
+  if (format == FORMAT_DEFLATE) {
+    if (avail < 2) {
+      if (!final) {
+        return false;
+      }
+      if (!avail) {
+        throw runtime_error("Compressed body ended early");
+      }
+    }
+    // a zlib header is a deflate method and a multiple of 31
+    bool zlib = avail >= 2 && (in[0] & 0x0F) == 8 && (in[0] >> 4) <= 7 && ((in[0] << 8) | in[1]) % 31 == 0;
+    format = zlib ? FORMAT_ZLIB : FORMAT_RAW;
+  }
+  if (format == FORMAT_ZLIB) {
+    if (avail < 2) {
+      return false;
+    }
+    if (in[1] & 0x20) {
+      throw runtime_error("Compressed body needs a preset dictionary");
+    }
+    pos = 2;
+  } else if (format == FORMAT_GZIP) {
+    // the fixed part then the optional fields the flags say are there
+    if (avail < 10) {
+      if (final) {
+        throw runtime_error("Compressed body ended early");
+      }
+      return false;
+    }
+    if (in[0] != 0x1F || in[1] != 0x8B || in[2] != 8) {
+      throw runtime_error("Body is not gzip");
+    }
+    uint8_t flags = in[3];
+    pos = 10;
+    bool complete = true;
+    if (flags & 0x04) {
+      complete = avail >= pos + 2;
+      if (complete) {
+        pos += 2 + (in[pos] | (in[pos + 1] << 8));
+        complete = avail >= pos;
+      }
+    }
+    // the name then the comment, both zero terminated
+    for (uint8_t flag = 0x08; complete && flag <= 0x10; flag <<= 1) {
+      if (flags & flag) {
+        const uint8_t *zero = (const uint8_t *)memchr(in + pos, 0, avail - pos);
+        complete = zero != nullptr;
+        pos = complete ? (zero - in) + 1 : pos;
+      }
+    }
+    if (complete && (flags & 0x02)) {
+      pos += 2;
+      complete = avail >= pos;
+    }
+    if (!complete) {
+      if (final) {
+        throw runtime_error("Compressed body ended early");
+      }
+      return false;
+    }
+  }
+  inputPos += pos;
+  state = STATE_BLOCK;
+  return true;
+}
+
+bool HttpDecoder::ReadBlockHeader(bool final)
+{
+  // the longest header has to be here so it can be read in one go
+  if (!final && AvailableBits() < DEFLATE_MAX_HEADER_BITS) {
+    return false;
+  }
+  lastBlock = ReadBits(1) != 0;
+  switch (ReadBits(2)) {
+  case 0:
+    // stored blocks start on a byte with their length and it's complement
+    ReadBits(bitCount % 8);
+    storedLeft = ReadBits(16);
+    if ((ReadBits(16) ^ 0xFFFF) != storedLeft) {
+      throw runtime_error("Compressed body has a corrupt stored block");
+    }
+    state = STATE_STORED;
+    break;
+  case 1:
+    lengthCodes = FixedLengthCodes();
+    distanceCodes = FixedDistanceCodes();
+    state = STATE_CODES;
+    break;
+  case 2:
+    ReadDynamicCodes();
+    state = STATE_CODES;
+    break;
+  default:
+    throw runtime_error("Compressed body has an invalid block");
+  }
+  return true;
+}
+
+void HttpDecoder::ReadDynamicCodes()
+{
+  uint32_t numLengths = ReadBits(5) + 257;
+  uint32_t numDistances = ReadBits(5) + 1;
+  uint32_t numCodeLengths = ReadBits(4) + 4;
+  if (numLengths > 286 || numDistances > 30) {
+    throw runtime_error("Compressed body has too many codes");
+  }
+  uint8_t lengths[320] = { 0 };
+  for (uint32_t i = 0; i < numCodeLengths; ++i) {
+    lengths[codeLengthOrder[i]] = (uint8_t)ReadBits(3);
+  }
+  Huffman codeLengthCodes;
+  BuildHuffman(codeLengthCodes, lengths, 19);
+  // the lengths of both codes run on from one to the other
+  memset(lengths, 0, sizeof(lengths));
+  uint32_t index = 0;
+  while (index < numLengths + numDistances) {
+    uint32_t symbol = ReadSymbol(codeLengthCodes);
+    if (symbol < 16) {
+      lengths[index++] = (uint8_t)symbol;
+      continue;
+    }
+    uint8_t repeat = 0;
+    uint32_t count;
+    if (symbol == 16) {
+      if (!index) {
+        throw runtime_error("Compressed body repeats a length that isn't there");
+      }
+      repeat = lengths[index - 1];
+      count = 3 + ReadBits(2);
+    } else if (symbol == 17) {
+      count = 3 + ReadBits(3);
+    } else {
+      count = 11 + ReadBits(7);
+    }
+    if (index + count > numLengths + numDistances) {
+      throw runtime_error("Compressed body has too many code lengths");
+    }
+    memset(lengths + index, repeat, count);
+    index += count;
+  }
+  if (!lengths[256]) {
+    throw runtime_error("Compressed body has no end of block code");
+  }
+  BuildHuffman(lengthCodes, lengths, numLengths);
+  BuildHuffman(distanceCodes, lengths + numLengths, numDistances);
+}
+
+void HttpDecoder::ReadStored(bool final)
+{
+  while (storedLeft) {
+    // whole bytes that are already in the bit buffer come first
+    if (bitCount >= 8) {
+      output.push_back((char)ReadBits(8));
+      storedLeft--;
+      continue;
+    }
+    size_t avail = input.size() - inputPos;
+    if (!avail) {
+      if (final) {
+        throw runtime_error("Compressed body ended early");
+      }
+      return;
+    }
+    size_t count = min(avail, (size_t)storedLeft);
+    output.append(input, inputPos, count);
+    inputPos += count;
+    storedLeft -= (uint32_t)count;
+  }
+  state = lastBlock ? STATE_TRAILER : STATE_BLOCK;
+}
+
+void HttpDecoder::ReadCodes(bool final)
+{
+  while (true) {
+    // a code is only read once all of it is here
+    if (!final && AvailableBits() < DEFLATE_MAX_CODE_BITS) {
+      return;
+    }
+    Refill();
+    uint32_t symbol = ReadSymbol(lengthCodes);
+    if (symbol < 256) {
+      output.push_back((char)symbol);
+      continue;
+    }
+    if (symbol == 256) {
+      state = lastBlock ? STATE_TRAILER : STATE_BLOCK;
+      return;
+    }
+    symbol -= 257;
+    if (symbol >= 29) {
+      throw runtime_error("Compressed body has an invalid length");
+    }
+    uint32_t length = lengthBase[symbol] + ReadBits(lengthExtra[symbol]);
+    symbol = ReadSymbol(distanceCodes);
+    if (symbol >= 30) {
+      throw runtime_error("Compressed body has an invalid distance");
+    }
+    uint32_t distance = distanceBase[symbol] + ReadBits(distanceExtra[symbol]);
+    if (distance > output.size()) {
+      throw runtime_error("Compressed body refers back too far");
+    }
+    size_t at = output.size();
+    output.resize(at + length);
+    char *dest = &output[at];
+    const char *src = dest - distance;
+    if (distance >= length) {
+      memcpy(dest, src, length);
+    } else {
+      // the copy overlaps what it's copying so it repeats the last bytes
+      for (uint32_t i = 0; i < length; ++i) {
+        dest[i] = src[i];
+      }
+    }
+  }
+}
+
+bool HttpDecoder::ReadTrailer(bool final)
+{
+  ReadBits(bitCount % 8);
+  uint32_t trailerBits = (format == FORMAT_GZIP) ? 64 : (format == FORMAT_ZLIB) ? 32 : 0;
+  if (AvailableBits() < trailerBits) {
+    if (final) {
+      throw runtime_error("Compressed body ended early");
+    }
+    return false;
+  }
+  if (format == FORMAT_GZIP) {
+    expectedCheck = ReadBits(32);
+    expectedSize = ReadBits(32);
+  } else if (format == FORMAT_ZLIB) {
+    // the only big endian number in either format
+    uint32_t check = ReadBits(32);
+    expectedCheck = (check >> 24) | ((check >> 8) & 0xFF00) | ((check << 8) & 0xFF0000) | (check << 24);
+  }
+  state = STATE_DONE;
+  return true;
+}
+
+bool HttpDecoder::Flush(const HttpSink &sink)
+{
+  size_t count = output.size() - outputFlushed;
+  if (count) {
+    const char *data = output.data() + outputFlushed;
+    if (format == FORMAT_GZIP) {
+      crc = Crc32(crc, data, count);
+    } else if (format == FORMAT_ZLIB) {
+      adler = Adler32(adler, data, count);
+    }
+    decodedSize += count;
+    outputFlushed = output.size();
+    if (!sink(data, count)) {
+      return false;
+    }
+  }
+  if (output.size() > DECODER_MAX_OUTPUT) {
+    output.erase(0, output.size() - DEFLATE_WINDOW_SIZE);
+    outputFlushed = output.size();
+  }
+  return true;
+}
+
+void HttpDecoder::BuildHuffman(Huffman &huffman, const uint8_t *lengths, uint32_t count)
+{
+  memset(&huffman, 0, sizeof(huffman));
+  for (uint32_t i = 0; i < count; ++i) {
+    huffman.counts[lengths[i]]++;
+  }
+  huffman.counts[0] = 0;
+  // a set of lengths that has more codes than there's room for is corrupt,
+  // and so is one with room to spare unless it has a single code, a block
+  // that only copies from one distance has just the one. Otherwise a corrupt
+  // block header can end the body early without the trailer noticing
+  uint32_t numCodes = 0;
+  int32_t left = 1;
+  uint16_t offsets[16];
+  offsets[1] = 0;
+  for (uint32_t len = 1; len < 16; ++len) {
+    left = (left << 1) - huffman.counts[len];
+    if (left < 0) {
+      throw runtime_error("Compressed body has an invalid code");
+    }
+    numCodes += huffman.counts[len];
+    if (len < 15) {
+      offsets[len + 1] = offsets[len] + huffman.counts[len];
+    }
+  }
+  if (left > 0 && numCodes > 1) {
+    throw runtime_error("Compressed body has an incomplete code");
+  }
+  for (uint32_t i = 0; i < count; ++i) {
+    if (lengths[i]) {
+      huffman.symbols[offsets[lengths[i]]++] = (uint16_t)i;
+    }
+  }
+  // the short codes go in the table under their bits in the order they are
+  // read, which is the code reversed, for every combination of the bits after
+  uint32_t code = 0;
+  uint32_t index = 0;
+  for (uint32_t len = 1; len <= HUFFMAN_FAST_BITS; ++len) {
+    for (uint32_t i = 0; i < huffman.counts[len]; ++i, ++code, ++index) {
+      uint32_t reversed = 0;
+      for (uint32_t bit = 0; bit < len; ++bit) {
+        reversed |= ((code >> bit) & 1) << (len - 1 - bit);
+      }
+      uint16_t entry = (uint16_t)((huffman.symbols[index] << 4) | len);
+      for (uint32_t fill = reversed; fill < (1u << HUFFMAN_FAST_BITS); fill += (1u << len)) {
+        huffman.fast[fill] = entry;
+      }
+    }
+    code <<= 1;
+  }
+}
+
+const HttpDecoder::Huffman &HttpDecoder::FixedLengthCodes()
+{
+  static Huffman codes;
+  static bool built = []() {
+    uint8_t lengths[288];
+    memset(lengths, 8, 144);
+    memset(lengths + 144, 9, 112);
+    memset(lengths + 256, 7, 24);
+    memset(lengths + 280, 8, 8);
+    BuildHuffman(codes, lengths, 288);
+    return true;
+  }();
+  (void)built;
+  return codes;
+}
+
+const HttpDecoder::Huffman &HttpDecoder::FixedDistanceCodes()
+{
+  static Huffman codes;
+  static bool built = []() {
+    // 32 codes though only 30 are distances, the last two are refused when
+    // they're read
+    uint8_t lengths[32];
+    memset(lengths, 5, sizeof(lengths));
+    BuildHuffman(codes, lengths, 32);
+    return true;
+  }();
+  (void)built;
+  return codes;
+}
+
+uint32_t HttpDecoder::ReadSymbol(const Huffman &huffman)
+{
+  if (bitCount < 15) {
+    Refill();
+  }
+  uint16_t entry = huffman.fast[bitBuf & ((1u << HUFFMAN_FAST_BITS) - 1)];
+  if (entry) {
+    uint32_t len = entry & 15;
+    if (len > bitCount) {
+      throw runtime_error("Compressed body ended early");
+    }
+    bitBuf >>= len;
+    bitCount -= len;
+    return entry >> 4;
+  }
+  // longer codes are read a bit at a time, the codes of each length are
+  // consecutive so the code is found once it's within a length's range
+  int32_t code = 0;
+  int32_t first = 0;
+  int32_t index = 0;
+  for (uint32_t len = 1; len < 16; ++len) {
+    code |= (int32_t)ReadBits(1);
+    int32_t count = huffman.counts[len];
+    if (code - first < count) {
+      return huffman.symbols[index + (code - first)];
+    }
+    index += count;
+    first = (first + count) << 1;
+    code <<= 1;
+  }
+  throw runtime_error("Compressed body has an invalid code");
+}
+
+uint32_t HttpDecoder::ReadBits(uint32_t count)
+{
+  if (!count) {
+    return 0;
+  }
+  if (bitCount < count) {
+    Refill();
+    if (bitCount < count) {
+      throw runtime_error("Compressed body ended early");
+    }
+  }
+  uint32_t bits = (uint32_t)(bitBuf & ((1ull << count) - 1));
+  bitBuf >>= count;
+  bitCount -= count;
+  return bits;
+}
+
+void HttpDecoder::Refill()
+{
+  while (bitCount <= 56 && inputPos < input.size()) {
+    bitBuf |= (uint64_t)(uint8_t)input[inputPos++] << bitCount;
+    bitCount += 8;
+  }
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "HttpClient.h"
+
+#include <stdint.h>
+#include <string>
+
+// codes up to this length are decoded with a single table lookup
+#define HUFFMAN_FAST_BITS 10
+
+// Decodes a gzip or deflate encoded response body as it arrives.
+//
+// The body is written in whatever blocks come off the connection and the
+// decoded bytes are handed to a sink straight away, so a body is decoded
+// while the rest of it is still on the way and only the last 32k of the
+// decoded body is ever held for back references.
+//
+// Rather than keeping the state of a half read code between blocks the
+// decoder only reads a code once enough input is buffered that the code
+// can't run past the end of it, which at most holds back the few hundred
+// bytes of a block header until more arrives. Whatever is left is decoded
+// when the body is finished.
+class HttpDecoder
+{
+public:
+  HttpDecoder();
+
+  // the encodings to ask for in requests
+  static const char *AcceptEncoding() { return "gzip, deflate"; }
+
+  // set up for the content-encoding of a response, returns false if it
+  // isn't one that can be decoded
+  bool Start(const std::string &contentEncoding);
+
+  // decode the next part of the body, returns false if the sink stopped
+  // reading. Throws runtime_error if the body is corrupt
+  bool Write(const char *data, size_t size, const HttpSink &sink);
+  // the whole body was written, decode what's left and check that it was
+  // all there
+  bool Finish(const HttpSink &sink);
+
+  // whether the body is encoded at all
+  bool IsEncoded() const { return format != FORMAT_IDENTITY; }
+
+private:
+  enum Format
+  {
+    FORMAT_IDENTITY,
+    FORMAT_GZIP,
+    // the deflate encoding is meant to be zlib wrapped but some servers
+    // send it raw, the first two bytes tell them apart
+    FORMAT_DEFLATE,
+    FORMAT_ZLIB,
+    FORMAT_RAW,
+  };
+
+  enum State
+  {
+    STATE_HEADER,
+    STATE_BLOCK,
+    STATE_STORED,
+    STATE_CODES,
+    STATE_TRAILER,
+    STATE_DONE,
+  };
+
+  // a canonical huffman code
+  struct Huffman
+  {
+    // symbol << 4 | length for every code up to the fast length, indexed
+    // by the next bits of input, zero for longer codes
+    uint16_t fast[1 << HUFFMAN_FAST_BITS];
+    uint16_t counts[16];
+    uint16_t symbols[288];
+  };
+
+  // decode as far as the buffered input goes
+  void Decode(bool final);
+  bool ReadHeader(bool final);
+  bool ReadBlockHeader(bool final);
+  void ReadDynamicCodes();
+  void ReadStored(bool final);
+  void ReadCodes(bool final);
+  bool ReadTrailer(bool final);
+  // hand the decoded bytes to the sink and drop all but the window
+  bool Flush(const HttpSink &sink);
+
+  static void BuildHuffman(Huffman &huffman, const uint8_t *lengths, uint32_t count);
+  // the codes of fixed huffman blocks, built the first time they're used
+  static const Huffman &FixedLengthCodes();
+  static const Huffman &FixedDistanceCodes();
+  uint32_t ReadSymbol(const Huffman &huffman);
+  uint32_t ReadBits(uint32_t count);
+  void Refill();
+  uint64_t AvailableBits() const { return bitCount + (uint64_t)(input.size() - inputPos) * 8; }
+
+  Format format;
+  State state;
+  bool lastBlock;
+
+  // input that hasn't been read yet
+  std::string input;
+  size_t inputPos;
+  uint64_t bitBuf;
+  uint32_t bitCount;
+
+  uint32_t storedLeft;
+  Huffman lengthCodes;
+  Huffman distanceCodes;
+
+  // decoded bytes, the start is the window of bytes that were already
+  // flushed and can still be referred back to
+  std::string output;
+  size_t outputFlushed;
+
+  // checks of the decoded body against the trailer
+  uint32_t crc;
+  uint32_t adler;
+  uint64_t decodedSize;
+  uint32_t expectedCheck;
+  uint32_t expectedSize;
+};
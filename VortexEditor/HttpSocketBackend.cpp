@@ -0,0 +1,364 @@
+#ifdef _WIN32
+// winsock must come before windows.h
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+#endif
+
+#include "HttpSocketBackend.h"
+
+#include <string.h>
+#include <stdlib.h>
+
+#include <algorithm>
+
+#ifndef _WIN32
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
+#define INVALID_SOCKET ((uintptr_t)-1)
+#endif
+
+// a send on a socket the server already closed has to fail rather than
+// raise SIGPIPE and kill the program, where there is no flag for that the
+// socket option is set on every new socket instead
+#ifdef MSG_NOSIGNAL
+#define SEND_FLAGS MSG_NOSIGNAL
+#else
+#define SEND_FLAGS 0
+#endif
+
+// the largest block read from a socket at once
+#define SOCKET_READ_SIZE 16384
+
+using namespace std;
+
+HttpSocketBackend::HttpSocketBackend(uint32_t maxIdlePerHost)
+  : lock(), idle(), maxIdlePerHost(maxIdlePerHost), numConnects(0)
+{
+#ifdef _WIN32
+  WSADATA wsaData;
+  WSAStartup(MAKEWORD(2, 2), &wsaData);
+#endif
+}
+
+HttpSocketBackend::~HttpSocketBackend()
+{
+  for (auto &host : idle) {
+    for (uintptr_t sock : host.second) {
+      CloseSocket(sock);
+    }
+  }
+#ifdef _WIN32
+  WSACleanup();
+#endif
+}
+
+uint32_t HttpSocketBackend::NumConnects() const
+{
+  lock_guard<mutex> guard(lock);
+  return numConnects;
+}
+
+void HttpSocketBackend::Send(const string &userAgent, const HttpRequest &request, HttpResponse &response,
+  const HttpSink &sink)
+{
+  if (request.secure) {
+    throw runtime_error("Secure requests need the winhttp backend");
+  }
+  string data = request.method + " " + request.path + " HTTP/1.1\r\n";
+  data += "Host: " + request.host + "\r\n";
+  data += "User-Agent: " + userAgent + "\r\n";
+  for (const auto &pair : request.headers) {
+    data += pair.first + ": " + pair.second + "\r\n";
+  }
+  if (request.body.size() || request.method == "POST" || request.method == "PUT") {
+    data += "Content-Length: " + to_string(request.body.size()) + "\r\n";
+  }
+  data += "\r\n";
+  data += request.body;
+
+  string key = request.host + ":" + to_string(request.port);
+  // a kept socket may have been closed by the server while it sat idle, in
+  // that case the request is sent once more on a new socket. Without any
+  // response there's no telling whether the server acted on the request so
+  // only requests that are safe to repeat are sent again
+  bool repeatable = (request.method == "GET" || request.method == "HEAD");
+  for (uint32_t attempt = 0; attempt < 2; ++attempt) {
+    bool reused = false;
+    uintptr_t sock = Acquire(key, request, reused);
+    bool keepAlive = false;
+    bool answered = false;
+    try {
+      answered = Exchange(sock, data, request, response, sink, keepAlive);
+    } catch (...) {
+      CloseSocket(sock);
+      throw;
+    }
+    if (!answered) {
+      CloseSocket(sock);
+      if (reused && repeatable) {
+        continue;
+      }
+      throw runtime_error("Connection closed without a response");
+    }
+    if (keepAlive) {
+      Release(key, sock);
+    } else {
+      CloseSocket(sock);
+    }
+    return;
+  }
+  throw runtime_error("Connection closed without a response");
+}
+
+uintptr_t HttpSocketBackend::Acquire(const string &key, const HttpRequest &request, bool &outReused)
+{
+  {
+    lock_guard<mutex> guard(lock);
+    auto it = idle.find(key);
+    if (it != idle.end() && it->second.size()) {
+      uintptr_t sock = it->second.back();
+      it->second.pop_back();
+      outReused = true;
+      return sock;
+    }
+  }
+  outReused = false;
+  addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo *addrs = nullptr;
+  if (getaddrinfo(request.host.c_str(), to_string(request.port).c_str(), &hints, &addrs) != 0) {
+    throw runtime_error("Failed to resolve host");
+  }
+  uintptr_t sock = INVALID_SOCKET;
+  for (addrinfo *addr = addrs; addr; addr = addr->ai_next) {
+    sock = (uintptr_t)socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+    if (sock == INVALID_SOCKET) {
+      continue;
+    }
+    if (connect(sock, addr->ai_addr, (int)addr->ai_addrlen) == 0) {
+      break;
+    }
+    CloseSocket(sock);
+    sock = INVALID_SOCKET;
+  }
+  freeaddrinfo(addrs);
+  if (sock == INVALID_SOCKET) {
+    throw runtime_error("Failed to connect");
+  }
+  // requests are small and written in one go, don't hold them back
+  int noDelay = 1;
+  setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, (const char *)&noDelay, sizeof(noDelay));
+#ifdef SO_NOSIGPIPE
+  int noSigPipe = 1;
+  setsockopt(sock, SOL_SOCKET, SO_NOSIGPIPE, (const char *)&noSigPipe, sizeof(noSigPipe));
+#endif
+  lock_guard<mutex> guard(lock);
+  numConnects++;
+  return sock;
+}
+
+void HttpSocketBackend::Release(const string &key, uintptr_t sock)
+{
+  {
+    lock_guard<mutex> guard(lock);
+    vector<uintptr_t> &socks = idle[key];
+    if (socks.size() < maxIdlePerHost) {
+      socks.push_back(sock);
+      return;
+    }
+  }
+  CloseSocket(sock);
+}
+
+void HttpSocketBackend::CloseSocket(uintptr_t sock)
+{
+#ifdef _WIN32
+  closesocket((SOCKET)sock);
+#else
+  close((int)sock);
+#endif
+}
+
+bool HttpSocketBackend::Exchange(uintptr_t sock, const string &data, const HttpRequest &request,
+  HttpResponse &response, const HttpSink &sink, bool &outKeepAlive)
+{
+  size_t sent = 0;
+  while (sent < data.size()) {
+    int len = (int)send(sock, data.data() + sent, (int)(data.size() - sent), SEND_FLAGS);
+    if (len <= 0) {
+      // nothing was answered so a stale socket can be retried
+      return false;
+    }
+    sent += len;
+  }
+  // everything received and not yet used, the headers and then whatever
+  // part of the body came in with them
+  string buffer;
+  char chunk[SOCKET_READ_SIZE];
+  bool closed = false;
+  auto receive = [&]() -> bool {
+    int len = (int)recv(sock, chunk, sizeof(chunk), 0);
+    if (len <= 0) {
+      closed = true;
+      return false;
+    }
+    buffer.append(chunk, len);
+    return true;
+  };
+  size_t headerEnd;
+  while ((headerEnd = buffer.find("\r\n\r\n")) == string::npos) {
+    if (!receive()) {
+      if (buffer.empty()) {
+        return false;
+      }
+      throw runtime_error("Connection closed in the response headers");
+    }
+  }
+  // the status line and headers
+  response.status = 0;
+  response.headers.clear();
+  response.body.clear();
+  size_t lineStart = 0;
+  size_t lineEnd = buffer.find("\r\n");
+  string statusLine = buffer.substr(0, lineEnd);
+  size_t space = statusLine.find(' ');
+  if (statusLine.compare(0, 5, "HTTP/") != 0 || space == string::npos) {
+    throw runtime_error("Malformed response");
+  }
+  response.status = strtoul(statusLine.c_str() + space + 1, nullptr, 10);
+  bool http10 = statusLine.compare(0, 8, "HTTP/1.0") == 0;
+  lineStart = lineEnd + 2;
+  while (lineStart < headerEnd) {
+    lineEnd = buffer.find("\r\n", lineStart);
+    string line = buffer.substr(lineStart, lineEnd - lineStart);
+    lineStart = lineEnd + 2;
+    size_t colon = line.find(':');
+    if (colon == string::npos) {
+      continue;
+    }
+    string name = line.substr(0, colon);
+    for (char &c : name) {
+      c = (char)tolower((unsigned char)c);
+    }
+    size_t start = line.find_first_not_of(" \t", colon + 1);
+    size_t end = line.find_last_not_of(" \t");
+    response.headers[name] = (start == string::npos) ? "" : line.substr(start, end - start + 1);
+  }
+  buffer.erase(0, headerEnd + 4);
+
+  string connection = response.headers.count("connection") ? response.headers["connection"] : "";
+  for (char &c : connection) {
+    c = (char)tolower((unsigned char)c);
+  }
+  outKeepAlive = http10 ? (connection == "keep-alive") : (connection != "close");
+
+  // responses that never have a body
+  if (request.method == "HEAD" || response.status == 204 || response.status == 304 ||
+      (response.status >= 100 && response.status < 200)) {
+    return true;
+  }
+  // hand the body over as it arrives, once the sink stops reading the rest
+  // of the response is abandoned along with the socket
+  bool stopped = false;
+  auto deliver = [&](const char *bytes, size_t size) -> bool {
+    if (!size) {
+      return true;
+    }
+    if (!sink(bytes, size)) {
+      stopped = true;
+      outKeepAlive = false;
+    }
+    return !stopped;
+  };
+  auto encoding = response.headers.find("transfer-encoding");
+  auto length = response.headers.find("content-length");
+  if (encoding != response.headers.end() && encoding->second.find("chunked") != string::npos) {
+    // each chunk is a hex size line then the data, up to an empty chunk,
+    // the data is passed on as it comes in so only a read or so is held
+    while (true) {
+      size_t sizeEnd;
+      while ((sizeEnd = buffer.find("\r\n")) == string::npos) {
+        if (!receive()) {
+          throw runtime_error("Connection closed in a chunk");
+        }
+      }
+      size_t remaining = strtoul(buffer.c_str(), nullptr, 16);
+      buffer.erase(0, sizeEnd + 2);
+      if (!remaining) {
+        // skip any trailers up to the blank line
+        while (true) {
+          size_t lineEnd;
+          while ((lineEnd = buffer.find("\r\n")) == string::npos) {
+            if (!receive()) {
+              throw runtime_error("Connection closed in the trailers");
+            }
+          }
+          buffer.erase(0, lineEnd + 2);
+          if (!lineEnd) {
+            break;
+          }
+        }
+        break;
+      }
+      while (true) {
+        size_t avail = min(buffer.size(), remaining);
+        if (!deliver(buffer.data(), avail)) {
+          return true;
+        }
+        buffer.erase(0, avail);
+        remaining -= avail;
+        if (!remaining) {
+          break;
+        }
+        if (!receive()) {
+          throw runtime_error("Connection closed in a chunk");
+        }
+      }
+      // the line break after the data
+      while (buffer.size() < 2) {
+        if (!receive()) {
+          throw runtime_error("Connection closed in a chunk");
+        }
+      }
+      buffer.erase(0, 2);
+    }
+  } else if (length != response.headers.end()) {
+    // the rest of the body is read a block at a time straight to the sink
+    size_t contentLength = strtoull(length->second.c_str(), nullptr, 10);
+    size_t received = min(buffer.size(), contentLength);
+    if (!deliver(buffer.data(), received)) {
+      return true;
+    }
+    while (received < contentLength) {
+      size_t want = min(contentLength - received, sizeof(chunk));
+      int len = (int)recv(sock, chunk, (int)want, 0);
+      if (len <= 0) {
+        throw runtime_error("Connection closed in the body");
+      }
+      received += len;
+      if (!deliver(chunk, len)) {
+        return true;
+      }
+    }
+  } else {
+    // the body runs until the server closes the connection
+    outKeepAlive = false;
+    do {
+      if (!deliver(buffer.data(), buffer.size())) {
+        return true;
+      }
+      buffer.clear();
+    } while (receive());
+  }
+  if (closed) {
+    outKeepAlive = false;
+  }
+  return true;
+}
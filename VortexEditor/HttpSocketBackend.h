@@ -0,0 +1,47 @@
+#pragma once
+
+#include "HttpClient.h"
+
+#include <stdint.h>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// A plain http backend straight on top of sockets, for servers on the
+// local machine like a stand-in for the community server. It builds on
+// windows and linux alike so the client can be tried out anywhere.
+//
+// Sockets are kept open after each response and handed to the next request
+// for the same host, up to a few idle sockets per host. A kept socket that
+// the server closed in the meantime is replaced once with a fresh one. Only
+// plain http is spoken, secure requests are refused.
+class HttpSocketBackend : public HttpBackend
+{
+public:
+  HttpSocketBackend(uint32_t maxIdlePerHost = 4);
+  ~HttpSocketBackend();
+
+  void Send(const std::string &userAgent, const HttpRequest &request, HttpResponse &response,
+    const HttpSink &sink) override;
+
+  // the number of times a new connection was opened
+  uint32_t NumConnects() const;
+
+private:
+  // take an idle socket for the host or open a new one
+  uintptr_t Acquire(const std::string &key, const HttpRequest &request, bool &outReused);
+  // hand a socket back once it's response has been read in full
+  void Release(const std::string &key, uintptr_t sock);
+  static void CloseSocket(uintptr_t sock);
+
+  // send the request and read the response, returns false if nothing at
+  // all came back which means a kept socket had gone stale
+  bool Exchange(uintptr_t sock, const std::string &data, const HttpRequest &request,
+    HttpResponse &response, const HttpSink &sink, bool &outKeepAlive);
+
+  mutable std::mutex lock;
+  std::map<std::string, std::vector<uintptr_t>> idle;
+  uint32_t maxIdlePerHost;
+  uint32_t numConnects;
+};
@@ -0,0 +1,354 @@
+// Checks the http cache against a stand-in server that counts what reaches
+// it, it doesn't need windows or the community server so it's built on its
+// own next to the cache on linux:
+//
+//   g++ -O2 -pthread -o vortex-cache-check HttpCacheCheck.cpp ../HttpCache.cpp ../HttpClient.cpp ../HttpSocketBackend.cpp ../HttpDecoder.cpp
+//   ./vortex-cache-check [directory]
+//
+// The cache is opened in the directory, the default is vortex-cache-check,
+// over and over like the editor would across sessions. Fresh responses have
+// to be served without reaching the server, stale ones served at once and
+// revalidated once in the background, 304s have to keep the cached body and
+// the size and age limits have to hold. A chunked response has to be stored
+// without the headers of the connection it came over. Files made from a
+// response have to count towards the size limit and go along with it.
+// Corrupt and leftover files are dropped and once the server is gone stale
+// pages are still served. The directory is removed at the end.
+#include "HttpStandInServer.h"
+#include "../HttpCache.h"
+#include "../HttpSocketBackend.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <dirent.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+static uint32_t numFailed = 0;
+
+#define CHECK(cond) do { \
+  if (!(cond)) { \
+    printf("  line %d: %s\n", __LINE__, #cond); \
+    numFailed++; \
+  } \
+} while (0)
+
+// bumped to change every page on the server
+static atomic<uint32_t> version(1);
+// how long the server takes over a page
+static atomic<uint32_t> delayMs(0);
+
+static void handle(const StandInRequest &request, StandInReply &reply)
+{
+  this_thread::sleep_for(chrono::milliseconds(delayMs.load()));
+  string etag = "\"v" + to_string(version.load()) + "\"";
+  if (request.path == "/pats/json" || request.path == "/chunked") {
+    reply.headers.push_back({ "ETag", etag });
+    auto match = request.headers.find("if-none-match");
+    if (match != request.headers.end() && match->second == etag) {
+      reply.status = 304;
+      return;
+    }
+    string page = request.query.count("page") ? request.query.at("page") : "1";
+    reply.headers.push_back({ "Content-Type", "application/json" });
+    reply.body = "{\"data\":[";
+    for (uint32_t i = 0; i < 15; ++i) {
+      reply.body += string(i ? "," : "") + "{\"name\":\"mode " + to_string(i) + " of page " + page +
+        " v" + to_string(version.load()) + "\"}";
+    }
+    reply.body += "],\"pages\":40}";
+    if (request.path == "/chunked") {
+      // headers that only mean anything for the connection
+      reply.chunkSize = 100;
+      reply.headers.push_back({ "Connection", "keep-alive, X-Hop" });
+      reply.headers.push_back({ "Keep-Alive", "timeout=5" });
+      reply.headers.push_back({ "X-Hop", "1" });
+    }
+  } else if (request.path == "/lastmod") {
+    string modified = "Wed, 21 Oct 2015 07:28:00 GMT";
+    auto since = request.headers.find("if-modified-since");
+    if (since != request.headers.end() && since->second == modified) {
+      reply.status = 304;
+      return;
+    }
+    reply.headers.push_back({ "Last-Modified", modified });
+    reply.body = "lastmod body";
+  } else if (request.path == "/nostore") {
+    reply.headers.push_back({ "Cache-Control", "no-store" });
+    reply.body = "secret";
+  } else if (request.path == "/maxage") {
+    reply.headers.push_back({ "Cache-Control", "public, max-age=3600" });
+    reply.body = "maxage";
+  } else if (request.path == "/error") {
+    reply.status = 500;
+    reply.body = "boom";
+  } else {
+    reply.status = 404;
+  }
+}
+
+static uint16_t port;
+
+static HttpRequest requestOf(const string &path)
+{
+  HttpRequest request;
+  request.host = "127.0.0.1";
+  request.port = port;
+  request.secure = false;
+  request.path = path;
+  return request;
+}
+
+static vector<string> listFiles(const string &directory)
+{
+  vector<string> files;
+  DIR *dir = opendir(directory.c_str());
+  while (dirent *ent = dir ? readdir(dir) : nullptr) {
+    if (ent->d_name[0] != '.') {
+      files.push_back(directory + "/" + ent->d_name);
+    }
+  }
+  if (dir) {
+    closedir(dir);
+  }
+  return files;
+}
+
+static void writeFile(const string &path, size_t size)
+{
+  FILE *file = fopen(path.c_str(), "wb");
+  string data(size, 'x');
+  fwrite(data.data(), 1, size, file);
+  fclose(file);
+}
+
+static bool exists(const string &path)
+{
+  return access(path.c_str(), F_OK) == 0;
+}
+
+static double nowMs()
+{
+  return chrono::duration<double, milli>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int main(int argc, char *argv[])
+{
+  string directory = (argc > 1) ? argv[1] : "vortex-cache-check";
+  HttpStandInServer server(handle);
+  port = server.Port();
+  HttpClient client("VortexEditor/1.0", make_shared<HttpSocketBackend>());
+  HttpRequest page1 = requestOf("/pats/json?page=1&pageSize=15");
+  HttpResponse response;
+  {
+    HttpCache cache(client, directory, 1 << 20, 60);
+    cache.Clear();
+    CHECK(cache.Get(page1, response) == HttpCache::SOURCE_NETWORK && response.status == 200);
+    string body = response.body;
+    CHECK(cache.Get(page1, response) == HttpCache::SOURCE_FRESH && response.body == body);
+    CHECK(response.headers["etag"] == "\"v1\"");
+    CHECK(server.Hits("/pats/json") == 1);
+    // a different query is a different page
+    CHECK(cache.Get(requestOf("/pats/json?page=2&pageSize=15"), response) == HttpCache::SOURCE_NETWORK);
+    CHECK(cache.NumEntries() == 2);
+    // a chunked response is stored decoded without the headers about the
+    // connection, including the one the connection header names
+    CHECK(cache.Get(requestOf("/chunked"), response) == HttpCache::SOURCE_NETWORK);
+    CHECK(cache.Get(requestOf("/chunked"), response) == HttpCache::SOURCE_FRESH);
+    CHECK(response.body.find("v1") != string::npos && response.headers["etag"] == "\"v1\"");
+    CHECK(!response.headers.count("transfer-encoding") && !response.headers.count("connection") &&
+      !response.headers.count("keep-alive") && !response.headers.count("x-hop"));
+  }
+  {
+    // the next session, straight from the disk
+    HttpCache cache(client, directory, 1 << 20, 60);
+    CHECK(cache.NumEntries() == 3);
+    CHECK(cache.Get(page1, response) == HttpCache::SOURCE_FRESH);
+    CHECK(server.Hits("/pats/json") == 2);
+    CHECK(cache.Get(requestOf("/chunked"), response) == HttpCache::SOURCE_FRESH);
+    CHECK(!response.headers.count("transfer-encoding") && response.headers["content-type"] == "application/json");
+  }
+  {
+    // everything is stale straight away, served at once then revalidated
+    HttpCache cache(client, directory, 1 << 20, 0);
+    CHECK(cache.Get(page1, response) == HttpCache::SOURCE_STALE);
+    string before = response.body;
+    cache.WaitForRefreshes();
+    CHECK(server.Hits("/pats/json") == 3 && cache.NumNotModified() == 1);
+    CHECK(cache.Get(page1, response) == HttpCache::SOURCE_STALE && response.body == before);
+    cache.WaitForRefreshes();
+    CHECK(cache.NumNotModified() == 2);
+    // a chunked page that wasn't modified keeps it's body and stays clean
+    CHECK(cache.Get(requestOf("/chunked"), response) == HttpCache::SOURCE_STALE);
+    cache.WaitForRefreshes();
+    CHECK(cache.NumNotModified() == 3);
+    CHECK(cache.Get(requestOf("/chunked"), response) == HttpCache::SOURCE_STALE);
+    CHECK(response.body.find("v1") != string::npos && !response.headers.count("transfer-encoding"));
+    cache.WaitForRefreshes();
+    // the page changes on the server, the old one is served once more and
+    // then the new one
+    version++;
+    CHECK(cache.Get(page1, response) == HttpCache::SOURCE_STALE && response.body == before);
+    cache.WaitForRefreshes();
+    CHECK(cache.Get(page1, response) == HttpCache::SOURCE_STALE && response.body.find("v2") != string::npos);
+    cache.WaitForRefreshes();
+    // gets while the revalidation is under way don't wait for it and don't
+    // start another one
+    delayMs = 200;
+    uint32_t hits = server.Hits("/pats/json");
+    double start = nowMs();
+    double worst = 0;
+    for (uint32_t i = 0; i < 20; ++i) {
+      double getStart = nowMs();
+      cache.Get(page1, response);
+      worst = max(worst, nowMs() - getStart);
+    }
+    printf("20 stale gets against a 200ms server took %.2fms, the slowest %.3fms\n", nowMs() - start, worst);
+    CHECK(worst < 100);
+    cache.WaitForRefreshes();
+    CHECK(server.Hits("/pats/json") == hits + 1);
+    delayMs = 0;
+    // last-modified validators
+    uint32_t notModified = cache.NumNotModified();
+    CHECK(cache.Get(requestOf("/lastmod"), response) == HttpCache::SOURCE_NETWORK);
+    CHECK(cache.Get(requestOf("/lastmod"), response) == HttpCache::SOURCE_STALE);
+    cache.WaitForRefreshes();
+    CHECK(cache.NumNotModified() == notModified + 1 && response.body == "lastmod body");
+    // cache-control
+    CHECK(cache.Get(requestOf("/nostore"), response) == HttpCache::SOURCE_NETWORK);
+    CHECK(cache.Get(requestOf("/nostore"), response) == HttpCache::SOURCE_NETWORK);
+    CHECK(cache.Get(requestOf("/maxage"), response) == HttpCache::SOURCE_NETWORK);
+    CHECK(cache.Get(requestOf("/maxage"), response) == HttpCache::SOURCE_FRESH);
+    // errors aren't cached
+    CHECK(cache.Get(requestOf("/error"), response) == HttpCache::SOURCE_NETWORK && response.status == 500);
+    CHECK(cache.Get(requestOf("/error"), response) == HttpCache::SOURCE_NETWORK);
+  }
+  {
+    // pages are about 1k so only a few fit, the least recently used go
+    HttpCache cache(client, directory, 4000, 60);
+    CHECK(cache.NumBytes() <= 4000);
+    for (uint32_t page = 1; page <= 10; ++page) {
+      cache.Get(requestOf("/pats/json?page=" + to_string(page)), response);
+      cache.Get(requestOf("/pats/json?page=1"), response);
+      CHECK(cache.NumBytes() <= 4000);
+    }
+    uint32_t hits = server.Hits("/pats/json");
+    CHECK(cache.Get(requestOf("/pats/json?page=1"), response) == HttpCache::SOURCE_FRESH);
+    CHECK(cache.Get(requestOf("/pats/json?page=10"), response) == HttpCache::SOURCE_FRESH);
+    CHECK(cache.Get(requestOf("/pats/json?page=2"), response) == HttpCache::SOURCE_NETWORK);
+    CHECK(server.Hits("/pats/json") == hits + 1);
+    printf("under a 4000 byte limit: %u entries, %llu bytes\n", cache.NumEntries(),
+      (unsigned long long)cache.NumBytes());
+  }
+  {
+    // a file made from a response counts towards the limit with it
+    HttpCache cache(client, directory, 4000, 60);
+    cache.Clear();
+    HttpRequest page = requestOf("/pats/json?page=1");
+    cache.Get(page, response);
+    uint64_t before = cache.NumBytes();
+    string derived = cache.DerivedPath(page, ".conv");
+    writeFile(derived, 1000);
+    cache.AddDerived(page, ".conv");
+    CHECK(cache.NumBytes() == before + 1000);
+    // made again only the new size counts
+    writeFile(derived, 500);
+    cache.AddDerived(page, ".conv");
+    CHECK(cache.NumBytes() == before + 500);
+    // and it stays when the response is stored again
+    cache.Get(page, response);
+    CHECK(cache.NumBytes() == before + 500 && exists(derived));
+    // one made from a response that isn't cached is removed straight away
+    string uncached = cache.DerivedPath(requestOf("/pats/json?page=2"), ".conv");
+    writeFile(uncached, 100);
+    cache.AddDerived(requestOf("/pats/json?page=2"), ".conv");
+    CHECK(!exists(uncached));
+    // and it goes when the response is pushed out
+    for (uint32_t p = 2; p <= 10; ++p) {
+      cache.Get(requestOf("/pats/json?page=" + to_string(p)), response);
+      CHECK(cache.NumBytes() <= 4000);
+    }
+    CHECK(!exists(derived));
+    cache.Get(page, response);
+    CHECK(cache.NumBytes() <= 4000);
+  }
+  {
+    // derived files are counted again by the next session, ones left
+    // without a response or half written are removed
+    uint64_t bytes = 0;
+    HttpRequest page = requestOf("/pats/json?page=10");
+    string derived;
+    string orphan;
+    {
+      HttpCache cache(client, directory, 1 << 20, 60);
+      cache.Get(page, response);
+      derived = cache.DerivedPath(page, ".conv");
+      writeFile(derived, 700);
+      cache.AddDerived(page, ".conv");
+      bytes = cache.NumBytes();
+      orphan = cache.DerivedPath(requestOf("/gone"), ".conv");
+    }
+    writeFile(orphan, 100);
+    writeFile(derived + ".tmp", 100);
+    writeFile(directory + "/notes.txt", 100);
+    HttpCache cache(client, directory, 1 << 20, 60);
+    CHECK(cache.NumBytes() == bytes && exists(derived));
+    CHECK(!exists(orphan) && !exists(derived + ".tmp") && exists(directory + "/notes.txt"));
+    remove((directory + "/notes.txt").c_str());
+    cache.Clear();
+    CHECK(listFiles(directory).empty());
+  }
+  {
+    // too old to serve at all
+    HttpCache cache(client, directory, 1 << 20, 0, 1);
+    cache.Get(page1, response);
+    cache.WaitForRefreshes();
+    this_thread::sleep_for(chrono::seconds(2));
+    CHECK(cache.Get(page1, response) == HttpCache::SOURCE_NETWORK);
+    this_thread::sleep_for(chrono::seconds(2));
+  }
+  {
+    // and too old by the time the next session opens
+    HttpCache cache(client, directory, 1 << 20, 60, 1);
+    CHECK(cache.NumEntries() == 0 && listFiles(directory).empty());
+    cache.Get(page1, response);
+  }
+  // corrupt files and one left behind by a write that never finished
+  for (const string &file : listFiles(directory)) {
+    CHECK(truncate(file.c_str(), 20) == 0);
+  }
+  fclose(fopen((directory + "/0123456789abcdef.http.tmp").c_str(), "wb"));
+  {
+    HttpCache cache(client, directory, 1 << 20, 60);
+    CHECK(cache.NumEntries() == 0 && listFiles(directory).empty());
+    CHECK(cache.Get(page1, response) == HttpCache::SOURCE_NETWORK);
+  }
+  // once the server is gone the cached page is still served
+  server.Stop();
+  {
+    HttpCache cache(client, directory, 1 << 20, 0);
+    CHECK(cache.Get(page1, response) == HttpCache::SOURCE_STALE && response.body.size() > 100);
+    cache.WaitForRefreshes();
+    CHECK(cache.Get(page1, response) == HttpCache::SOURCE_STALE);
+    cache.WaitForRefreshes();
+    bool threw = false;
+    try {
+      cache.Get(requestOf("/pats/json?page=39"), response);
+    } catch (const exception &) {
+      threw = true;
+    }
+    CHECK(threw);
+    cache.Clear();
+  }
+  rmdir(directory.c_str());
+  printf("%s\n", numFailed ? "FAILED" : "all passed");
+  return numFailed ? 1 : 0;
+}
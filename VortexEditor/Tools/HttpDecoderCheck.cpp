@@ -0,0 +1,402 @@
+// Checks the gzip and deflate decoder on bodies compressed by zlib, it
+// doesn't need windows or the community server so it's built on its own
+// next to the client on linux, zlib is only used to make the fixtures and
+// to compare speeds against:
+//
+//   g++ -O2 -pthread -o vortex-decoder-check HttpDecoderCheck.cpp ../HttpClient.cpp ../HttpSocketBackend.cpp ../HttpDecoder.cpp -lz
+//   ./vortex-decoder-check
+//
+// Every fixture body is compressed as gzip, zlib and raw deflate at several
+// levels, with only fixed huffman codes, with a sync flush every few k and
+// with every optional gzip header field. Each one is decoded whole, a byte
+// at a time and in random blocks and has to come back the same, cut short
+// or with anything after the end it has to throw, and with a byte flipped
+// it has to throw or at least never hand back the wrong body unnoticed
+// where the format has a check. The same fixtures are then served by a
+// stand-in server, with a length and chunked, and fetched through the
+// client. Last the decoder is timed against zlib on a few large bodies.
+#include "HttpStandInServer.h"
+#include "../HttpClient.h"
+#include "../HttpDecoder.h"
+#include "../HttpSocketBackend.h"
+
+#include <zlib.h>
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static uint32_t numFailed = 0;
+
+#define CHECK(cond) do { \
+  if (!(cond)) { \
+    printf("  line %d: %s\n", __LINE__, #cond); \
+    numFailed++; \
+  } \
+} while (0)
+
+// a fixture, the body compressed one way
+struct Fixture
+{
+  string name;
+  // the content-encoding it's served with
+  string encoding;
+  const string *body;
+  string compressed;
+};
+
+static mt19937 rng(7);
+
+// about what a page of the community server looks like
+static string communityBody(uint32_t numModes)
+{
+  string body = "{\"data\":[";
+  for (uint32_t i = 0; i < numModes; ++i) {
+    char id[32];
+    snprintf(id, sizeof(id), "%08x%08x%08x", (uint32_t)rng(), (uint32_t)rng(), (uint32_t)rng());
+    body += string(i ? "," : "") + "{\"_id\":\"" + id + "\",\"name\":\"mode " + to_string(i) +
+      "\",\"createdBy\":\"user" + to_string(rng() % 50) + "\",\"modeData\":{\"num_leds\":10,\"flags\":0," +
+      "\"single_pats\":[{\"pattern_id\":" + to_string(rng() % 60) + ",\"args\":[";
+    for (uint32_t arg = 0; arg < 8; ++arg) {
+      body += string(arg ? "," : "") + to_string(rng() % 256);
+    }
+    body += "],\"colorset\":[";
+    for (uint32_t color = 0, numColors = 1 + rng() % 8; color < numColors; ++color) {
+      body += string(color ? "," : "") + to_string(rng() % 0x1000000);
+    }
+    body += "]}]}}";
+  }
+  return body + "],\"pages\":40,\"page\":1}";
+}
+
+static string randomBody(size_t size)
+{
+  string body(size, 0);
+  for (char &c : body) {
+    c = (char)rng();
+  }
+  return body;
+}
+
+static string textBody()
+{
+  string body;
+  for (uint32_t i = 0; i < 20000; ++i) {
+    body += "  if (response.status == " + to_string(200 + i % 7) + ") {\n    return line" +
+      to_string(rng() % 1000) + ";\n  }\n";
+  }
+  return body;
+}
+
+// compress with zlib, windowBits picks zlib, gzip or raw deflate and with a
+// flush interval the body is sync flushed every that many bytes
+static string compress(const string &body, int level, int windowBits, int strategy = Z_DEFAULT_STRATEGY,
+  size_t flushEvery = 0, gz_header *header = nullptr)
+{
+  z_stream z;
+  memset(&z, 0, sizeof(z));
+  deflateInit2(&z, level, Z_DEFLATED, windowBits, 9, strategy);
+  if (header) {
+    deflateSetHeader(&z, header);
+  }
+  string out;
+  vector<char> block(1 << 16);
+  size_t step = flushEvery ? flushEvery : body.size();
+  size_t pos = 0;
+  do {
+    size_t size = min(step, body.size() - pos);
+    z.next_in = (Bytef *)body.data() + pos;
+    z.avail_in = (uInt)size;
+    pos += size;
+    int flush = (pos == body.size()) ? Z_FINISH : Z_SYNC_FLUSH;
+    int ret;
+    do {
+      z.next_out = (Bytef *)block.data();
+      z.avail_out = (uInt)block.size();
+      ret = deflate(&z, flush);
+      out.append(block.data(), block.size() - z.avail_out);
+    } while (z.avail_out == 0 || (flush == Z_FINISH && ret != Z_STREAM_END));
+  } while (pos < body.size());
+  deflateEnd(&z);
+  return out;
+}
+
+static vector<Fixture> makeFixtures(const map<string, string> &bodies)
+{
+  vector<Fixture> fixtures;
+  for (const auto &body : bodies) {
+    for (int level : { 0, 1, 6, 9 }) {
+      string suffix = "." + to_string(level);
+      fixtures.push_back({ body.first + suffix + ".gzip", "gzip", &body.second, compress(body.second, level, 31) });
+      fixtures.push_back({ body.first + suffix + ".zlib", "deflate", &body.second, compress(body.second, level, 15) });
+      fixtures.push_back({ body.first + suffix + ".raw", "deflate", &body.second, compress(body.second, level, -15) });
+    }
+    fixtures.push_back({ body.first + ".fixed.zlib", "deflate", &body.second,
+      compress(body.second, 6, 15, Z_FIXED) });
+    // flushes leave empty stored blocks and many block boundaries
+    fixtures.push_back({ body.first + ".flushed.gzip", "gzip", &body.second,
+      compress(body.second, 6, 31, Z_DEFAULT_STRATEGY, 7777) });
+    // every optional field of the gzip header
+    static char name[] = "name.json";
+    static char comment[] = "a comment";
+    static Bytef extra[] = "hello";
+    gz_header header;
+    memset(&header, 0, sizeof(header));
+    header.extra = extra;
+    header.extra_len = 5;
+    header.name = (Bytef *)name;
+    header.comment = (Bytef *)comment;
+    header.hcrc = 1;
+    fixtures.push_back({ body.first + ".header.gzip", "gzip", &body.second,
+      compress(body.second, 9, 31, Z_DEFAULT_STRATEGY, 0, &header) });
+  }
+  return fixtures;
+}
+
+// decode a body written in blocks of the given size, zero is all at once
+// and UINT32_MAX is blocks of random sizes
+static string decode(const string &encoding, const string &data, uint32_t blockSize)
+{
+  HttpDecoder decoder;
+  string out;
+  HttpSink sink = [&](const char *bytes, size_t size) {
+    out.append(bytes, size);
+    return true;
+  };
+  if (!decoder.Start(encoding)) {
+    throw runtime_error("Unknown encoding");
+  }
+  size_t pos = 0;
+  while (pos < data.size()) {
+    size_t size = blockSize ? blockSize : data.size();
+    if (blockSize == UINT32_MAX) {
+      size = 1 + rng() % 3000;
+    }
+    size = min(size, data.size() - pos);
+    decoder.Write(data.data() + pos, size, sink);
+    pos += size;
+  }
+  decoder.Finish(sink);
+  return out;
+}
+
+static void checkDecoder(const vector<Fixture> &fixtures)
+{
+  uint32_t numDecoded = 0;
+  uint32_t numDetected = 0;
+  for (const Fixture &fixture : fixtures) {
+    for (uint32_t blockSize : { 0u, 1u, UINT32_MAX }) {
+      if (blockSize == 1 && fixture.compressed.size() > 200000) {
+        continue;
+      }
+      try {
+        if (decode(fixture.encoding, fixture.compressed, blockSize) == *fixture.body) {
+          numDecoded++;
+          continue;
+        }
+        printf("  %s in blocks of %u decoded wrong\n", fixture.name.c_str(), blockSize);
+      } catch (const exception &e) {
+        printf("  %s in blocks of %u threw: %s\n", fixture.name.c_str(), blockSize, e.what());
+      }
+      numFailed++;
+    }
+    // cut short anywhere it has to throw, except the last byte of a raw
+    // deflate stream which can be padding
+    bool raw = fixture.name.find(".raw") != string::npos;
+    for (uint32_t i = 0; i < 20 && fixture.compressed.size() > 1; ++i) {
+      size_t cut = rng() % fixture.compressed.size();
+      if (raw && cut == fixture.compressed.size() - 1) {
+        continue;
+      }
+      try {
+        decode(fixture.encoding, fixture.compressed.substr(0, cut), UINT32_MAX);
+        printf("  %s cut at %zu of %zu wasn't noticed\n", fixture.name.c_str(), cut, fixture.compressed.size());
+        numFailed++;
+      } catch (const exception &) {
+        numDetected++;
+      }
+    }
+    try {
+      decode(fixture.encoding, fixture.compressed + "x", UINT32_MAX);
+      printf("  %s with a byte after the end wasn't noticed\n", fixture.name.c_str());
+      numFailed++;
+    } catch (const exception &) {
+      numDetected++;
+    }
+    // gzip and zlib have a check of the body, raw deflate doesn't and a
+    // zlib header that's corrupt is taken for the start of raw deflate
+    if (raw) {
+      continue;
+    }
+    size_t first = (fixture.encoding == "deflate") ? 2 : 0;
+    for (uint32_t i = 0; i < 20; ++i) {
+      string corrupt = fixture.compressed;
+      size_t at = first + rng() % (corrupt.size() - first);
+      corrupt[at] ^= (char)(1 + rng() % 255);
+      try {
+        if (decode(fixture.encoding, corrupt, UINT32_MAX) != *fixture.body) {
+          printf("  %s with byte %zu flipped decoded wrong unnoticed\n", fixture.name.c_str(), at);
+          numFailed++;
+        }
+      } catch (const exception &) {
+        numDetected++;
+      }
+    }
+  }
+  printf("%zu fixtures: %u decodes identical, %u cut short or corrupt bodies caught\n", fixtures.size(),
+    numDecoded, numDetected);
+}
+
+static map<string, const Fixture *> served;
+static string lastAcceptEncoding;
+
+static void handle(const StandInRequest &request, StandInReply &reply)
+{
+  auto accept = request.headers.find("accept-encoding");
+  lastAcceptEncoding = (accept == request.headers.end()) ? "none" : accept->second;
+  auto it = served.find(request.path.substr(1));
+  if (it == served.end()) {
+    reply.status = 404;
+    return;
+  }
+  reply.headers.push_back({ "Content-Encoding", request.query.count("br") ? "br" : it->second->encoding });
+  reply.body = it->second->compressed;
+  if (request.query.count("chunked")) {
+    reply.chunkSize = 4000;
+  }
+  if (request.query.count("cut")) {
+    reply.cutAfter = reply.body.size() / 2;
+  }
+}
+
+static void checkClient(const vector<Fixture> &fixtures)
+{
+  for (const Fixture &fixture : fixtures) {
+    served[fixture.name] = &fixture;
+  }
+  HttpStandInServer server(handle);
+  HttpClient client("VortexEditor/1.0", make_shared<HttpSocketBackend>());
+  HttpRequest request;
+  request.host = "127.0.0.1";
+  request.port = server.Port();
+  request.secure = false;
+  HttpResponse response;
+  for (const Fixture &fixture : fixtures) {
+    for (const char *query : { "", "?chunked" }) {
+      request.path = "/" + fixture.name + query;
+      client.Send(request, response);
+      CHECK(response.body == *fixture.body && response.bodySize == fixture.body->size());
+      CHECK(response.wireSize == fixture.compressed.size() && !response.headers.count("content-encoding"));
+      string sunk;
+      HttpResponse streamed;
+      client.Send(request, streamed, [&](const char *data, size_t size) {
+        sunk.append(data, size);
+        return true;
+      });
+      CHECK(sunk == *fixture.body && streamed.body.empty());
+      // a sink that stops early
+      size_t received = 0;
+      client.Send(request, streamed, [&](const char *, size_t size) {
+        received += size;
+        return received < 1000;
+      });
+      if (!*query && fixture.name.find(".6.gzip") != string::npos) {
+        printf("  %-22s %8llu bytes on the wire, %8llu decoded, %5.2f:1\n", fixture.name.c_str(),
+          (unsigned long long)response.wireSize, (unsigned long long)response.bodySize,
+          response.wireSize ? (double)response.bodySize / response.wireSize : 0.0);
+      }
+    }
+  }
+  // bodies cut short or in an encoding that can't be decoded throw, and the
+  // client still works after
+  for (const char *path : { "/community.6.gzip?cut", "/community.6.gzip?cut&chunked", "/community.6.gzip?br" }) {
+    request.path = path;
+    bool threw = false;
+    try {
+      client.Send(request, response);
+    } catch (const exception &) {
+      threw = true;
+    }
+    CHECK(threw);
+  }
+  request.path = "/community.6.gzip";
+  client.Send(request, response);
+  CHECK(response.body == *served["community.6.gzip"]->body);
+  // compressed bodies are asked for unless the client is told not to, or
+  // the caller asks for something itself
+  CHECK(lastAcceptEncoding == HttpDecoder::AcceptEncoding());
+  client.SetCompression(false);
+  client.Send(request, response);
+  CHECK(lastAcceptEncoding == "none" && response.body == *served["community.6.gzip"]->body);
+  client.SetCompression(true);
+  request.headers["accept-ENCODING"] = "identity";
+  client.Send(request, response);
+  CHECK(lastAcceptEncoding == "identity");
+  printf("client: %llu bytes on the wire for %llu bytes of bodies\n",
+    (unsigned long long)client.TotalWireBytes(), (unsigned long long)client.TotalBodyBytes());
+}
+
+static void timeDecoder(const Fixture &fixture)
+{
+  const uint32_t runs = 5;
+  size_t blockSize = 16384;
+  auto start = chrono::steady_clock::now();
+  for (uint32_t i = 0; i < runs; ++i) {
+    HttpDecoder decoder;
+    decoder.Start(fixture.encoding);
+    HttpSink sink = [](const char *, size_t) { return true; };
+    for (size_t pos = 0; pos < fixture.compressed.size(); pos += blockSize) {
+      decoder.Write(fixture.compressed.data() + pos, min(blockSize, fixture.compressed.size() - pos), sink);
+    }
+    decoder.Finish(sink);
+  }
+  double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+  start = chrono::steady_clock::now();
+  vector<char> block(1 << 16);
+  for (uint32_t i = 0; i < runs; ++i) {
+    z_stream z;
+    memset(&z, 0, sizeof(z));
+    inflateInit2(&z, 47);
+    z.next_in = (Bytef *)fixture.compressed.data();
+    z.avail_in = (uInt)fixture.compressed.size();
+    do {
+      z.next_out = (Bytef *)block.data();
+      z.avail_out = (uInt)block.size();
+    } while (inflate(&z, Z_NO_FLUSH) == Z_OK);
+    inflateEnd(&z);
+  }
+  double zlibMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+  double decoded = (double)fixture.body->size() * runs;
+  printf("  %-22s %7.1fMB/s decoded, zlib %7.1fMB/s\n", fixture.name.c_str(), decoded / ms / 1000.0,
+    decoded / zlibMs / 1000.0);
+}
+
+int main()
+{
+  map<string, string> bodies;
+  bodies["community"] = communityBody(15);
+  bodies["bigjson"] = communityBody(3000);
+  bodies["random"] = randomBody(300000);
+  bodies["empty"] = "";
+  bodies["one"] = "x";
+  bodies["repeat"] = string(300000, 'a');
+  bodies["text"] = textBody();
+  vector<Fixture> fixtures = makeFixtures(bodies);
+  checkDecoder(fixtures);
+  checkClient(fixtures);
+  for (const Fixture &fixture : fixtures) {
+    if (fixture.name == "bigjson.6.gzip" || fixture.name == "text.6.gzip" || fixture.name == "random.6.gzip") {
+      timeDecoder(fixture);
+    }
+  }
+  printf("%s\n", numFailed ? "FAILED" : "all passed");
+  return numFailed ? 1 : 0;
+}
@@ -0,0 +1,210 @@
+// Checks the socket http backend against a stand-in server on the local
+// machine, it doesn't need windows or the community server so it's built on
+// its own next to the client on linux:
+//
+//   g++ -O2 -pthread -o vortex-http-check HttpSocketBackendCheck.cpp ../HttpClient.cpp ../HttpSocketBackend.cpp ../HttpDecoder.cpp
+//   ./vortex-http-check
+//
+// Covers keeping connections alive between requests and sharing them
+// between threads, bodies with a length, chunked and until the connection
+// closes, binary bodies arriving intact, a sink that stops early, a kept
+// connection the server dropped while it sat idle and a server that is
+// gone. Then a page is fetched over a fresh connection each time and over
+// a kept one to show what keeping connections is worth.
+#include "HttpStandInServer.h"
+#include "../HttpClient.h"
+#include "../HttpSocketBackend.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+#define NUM_PAGES 40
+
+static uint32_t numFailed = 0;
+
+#define CHECK(cond) do { \
+  if (!(cond)) { \
+    printf("  line %d: %s\n", __LINE__, #cond); \
+    numFailed++; \
+  } \
+} while (0)
+
+// every byte value so any conversion of the body shows
+static string binaryBody(size_t size)
+{
+  string body(size, 0);
+  uint32_t seed = 0x12345678;
+  for (char &c : body) {
+    seed = seed * 1103515245 + 12345;
+    c = (char)(seed >> 16);
+  }
+  return body;
+}
+
+static const string bigBody = binaryBody(16 << 20);
+
+// a page of the community server, about the size of a real one
+static string pageBody(const string &page)
+{
+  string body = "{\"data\":[";
+  for (uint32_t i = 0; i < 15; ++i) {
+    body += string(i ? "," : "") + "{\"name\":\"mode " + to_string(i) + " of page " + page +
+      "\",\"modeData\":{\"num_leds\":10,\"single_pats\":[{\"pattern_id\":" + to_string(i) + "}]}}";
+  }
+  return body + "],\"pages\":" + to_string(NUM_PAGES) + "}";
+}
+
+static void handle(const StandInRequest &request, StandInReply &reply)
+{
+  if (request.path == "/chunked") {
+    reply.body = "{\"a\":[1,2,3]}";
+    reply.chunkSize = 5;
+  } else if (request.path == "/close") {
+    reply.body = "until close";
+    reply.close = true;
+  } else if (request.path == "/big") {
+    reply.body = bigBody;
+    if (request.query.count("chunked")) {
+      reply.chunkSize = 65536;
+    }
+  } else if (request.path == "/post") {
+    reply.body = request.body;
+  } else {
+    reply.headers.push_back({ "Content-Type", "application/json" });
+    reply.body = pageBody(request.query.count("page") ? request.query.at("page") : "1");
+  }
+}
+
+static HttpRequest requestOf(uint16_t port, const string &path)
+{
+  HttpRequest request;
+  request.host = "127.0.0.1";
+  request.port = port;
+  request.secure = false;
+  request.path = path;
+  return request;
+}
+
+int main()
+{
+  HttpStandInServer server(handle);
+  uint16_t port = server.Port();
+  auto backend = make_shared<HttpSocketBackend>();
+  HttpClient client("VortexEditor/1.0", backend);
+  HttpResponse response;
+
+  // bodies of each kind on the one kept connection
+  client.Send(requestOf(port, "/chunked"), response);
+  CHECK(response.status == 200 && response.body == "{\"a\":[1,2,3]}");
+  client.Send(requestOf(port, "/pats/json?page=3"), response);
+  CHECK(response.body == pageBody("3") && response.headers["content-type"] == "application/json");
+  CHECK(backend->NumConnects() == 1);
+  client.Send(requestOf(port, "/close"), response);
+  CHECK(response.body == "until close");
+  client.Send(requestOf(port, "/pats/json"), response);
+  CHECK(response.body == pageBody("1"));
+  CHECK(backend->NumConnects() == 2);
+  for (const char *path : { "/big", "/big?chunked" }) {
+    client.Send(requestOf(port, path), response);
+    CHECK(response.body == bigBody);
+    string sunk;
+    HttpResponse streamed;
+    client.Send(requestOf(port, path), streamed, [&](const char *data, size_t size) {
+      sunk.append(data, size);
+      return true;
+    });
+    CHECK(sunk == bigBody && streamed.body.empty());
+  }
+  CHECK(backend->NumConnects() == 2);
+
+  // a sink that stops early gives up the connection but not the client
+  size_t received = 0;
+  client.Send(requestOf(port, "/big"), response, [&](const char *, size_t size) {
+    received += size;
+    return received < 100000;
+  });
+  CHECK(received < bigBody.size());
+  client.Send(requestOf(port, "/pats/json"), response);
+  CHECK(response.body == pageBody("1"));
+  CHECK(backend->NumConnects() == 3);
+
+  // the server drops the kept connection while it's idle, a GET is sent
+  // again on a new one but a POST might have been acted on so it isn't
+  server.DropIdle();
+  client.Send(requestOf(port, "/pats/json"), response);
+  CHECK(response.body == pageBody("1"));
+  CHECK(backend->NumConnects() == 4);
+  server.DropIdle();
+  HttpRequest post = requestOf(port, "/post");
+  post.method = "POST";
+  post.body = "once";
+  bool threw = false;
+  try {
+    client.Send(post, response);
+  } catch (const exception &) {
+    threw = true;
+  }
+  CHECK(threw && server.Hits("/post") == 0);
+  client.Send(post, response);
+  CHECK(response.body == "once" && server.Hits("/post") == 1);
+
+  // several threads sharing the kept connections
+  auto shared = make_shared<HttpSocketBackend>();
+  HttpClient sharedClient("VortexEditor/1.0", shared);
+  vector<thread> threads;
+  uint32_t numWrong[4] = { 0 };
+  for (uint32_t t = 0; t < 4; ++t) {
+    threads.emplace_back([&, t]() {
+      for (uint32_t i = 0; i < 50; ++i) {
+        string page = to_string(t * 50 + i);
+        HttpResponse threadResponse;
+        sharedClient.Send(requestOf(port, "/pats/json?page=" + page), threadResponse);
+        if (threadResponse.body != pageBody(page)) {
+          numWrong[t]++;
+        }
+      }
+    });
+  }
+  for (thread &t : threads) {
+    t.join();
+  }
+  CHECK(!numWrong[0] && !numWrong[1] && !numWrong[2] && !numWrong[3]);
+  CHECK(shared->NumConnects() <= 4);
+  printf("200 requests on 4 threads took %u connections\n", shared->NumConnects());
+
+  // what keeping the connection is worth, a fresh backend per page is how
+  // the client used to work
+  double freshMs = 0;
+  for (uint32_t i = 0; i < NUM_PAGES; ++i) {
+    HttpClient fresh("VortexEditor/1.0", make_shared<HttpSocketBackend>());
+    fresh.Send(requestOf(port, "/pats/json?page=" + to_string(i + 1)), response);
+    freshMs += fresh.LastLatencyMs();
+  }
+  auto kept = make_shared<HttpSocketBackend>();
+  HttpClient keptClient("VortexEditor/1.0", kept);
+  for (uint32_t i = 0; i < NUM_PAGES; ++i) {
+    keptClient.Send(requestOf(port, "/pats/json?page=" + to_string(i + 1)), response);
+  }
+  printf("%u pages: fresh connection %.3fms/page, kept connection %.3fms/page over %u connection\n",
+    NUM_PAGES, freshMs / NUM_PAGES, keptClient.AverageLatencyMs(), kept->NumConnects());
+
+  // nothing answers once the server is gone
+  server.Stop();
+  threw = false;
+  try {
+    client.Send(requestOf(port, "/pats/json"), response);
+  } catch (const exception &) {
+    threw = true;
+  }
+  CHECK(threw);
+
+  printf("%s\n", numFailed ? "FAILED" : "all passed");
+  return numFailed ? 1 : 0;
+}
@@ -0,0 +1,325 @@
+#pragma once
+
+// A small http server on the local machine for the http checks to talk to in
+// place of the community server. It's only built with the tools on linux, it
+// answers every request on a connection of it's own thread and keeps
+// connections open between requests like a real server would.
+//
+// Each request is handed to a handler that fills out the reply, the server
+// counts connections and requests per path so the checks can tell what
+// actually went over the wire.
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct StandInRequest
+{
+  std::string method;
+  // the path without the query
+  std::string path;
+  std::map<std::string, std::string> query;
+  // the header names are all lowercase
+  std::map<std::string, std::string> headers;
+  std::string body;
+};
+
+struct StandInReply
+{
+  uint32_t status = 200;
+  std::vector<std::pair<std::string, std::string>> headers;
+  std::string body;
+  // send the body in chunks of this size instead of with a length
+  size_t chunkSize = 0;
+  // close the connection after this much of the body, counting the chunk
+  // sizes of a chunked body, as if the server died
+  size_t cutAfter = std::string::npos;
+  // close the connection after the reply
+  bool close = false;
+};
+
+typedef std::function<void(const StandInRequest &request, StandInReply &reply)> StandInHandler;
+
+class HttpStandInServer
+{
+public:
+  HttpStandInServer(StandInHandler handler)
+    : handler(handler), listenSock(-1), port(0), acceptThread(), stopped(false), lock(),
+      connections(), threads(), numConnections(0), numRequests(0), hits()
+  {
+    listenSock = socket(AF_INET, SOCK_STREAM, 0);
+    int reuse = 1;
+    setsockopt(listenSock, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    if (bind(listenSock, (sockaddr *)&addr, sizeof(addr)) != 0 || listen(listenSock, 64) != 0 ||
+        getsockname(listenSock, (sockaddr *)&addr, &len) != 0) {
+      throw std::runtime_error("Failed to listen");
+    }
+    port = ntohs(addr.sin_port);
+    acceptThread = std::thread(&HttpStandInServer::AcceptThread, this);
+  }
+
+  ~HttpStandInServer()
+  {
+    Stop();
+  }
+
+  uint16_t Port() const { return port; }
+
+  uint32_t NumConnections() const
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    return numConnections;
+  }
+
+  uint32_t NumRequests() const
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    return numRequests;
+  }
+
+  // the number of requests for a path
+  uint32_t Hits(const std::string &path) const
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    auto it = hits.find(path);
+    return (it == hits.end()) ? 0 : it->second;
+  }
+
+  // close every connection that is waiting for it's next request, like a
+  // server timing out idle keep-alive connections
+  void DropIdle()
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    for (auto &conn : connections) {
+      if (conn.second) {
+        shutdown(conn.first, SHUT_RDWR);
+      }
+    }
+  }
+
+  // stop listening and close every connection, after this nothing answers
+  void Stop()
+  {
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      if (stopped) {
+        return;
+      }
+      stopped = true;
+      shutdown(listenSock, SHUT_RDWR);
+      for (auto &conn : connections) {
+        shutdown(conn.first, SHUT_RDWR);
+      }
+    }
+    // connection threads are only added by the accept thread
+    acceptThread.join();
+    for (std::thread &thread : threads) {
+      thread.join();
+    }
+    threads.clear();
+    close(listenSock);
+  }
+
+private:
+  void AcceptThread()
+  {
+    while (true) {
+      int sock = accept(listenSock, nullptr, nullptr);
+      if (sock < 0) {
+        return;
+      }
+      int noDelay = 1;
+      setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+      std::lock_guard<std::mutex> guard(lock);
+      if (stopped) {
+        close(sock);
+        return;
+      }
+      numConnections++;
+      connections[sock] = true;
+      threads.emplace_back(&HttpStandInServer::ConnectionThread, this, sock);
+    }
+  }
+
+  void ConnectionThread(int sock)
+  {
+    std::string buffer;
+    while (ServeOne(sock, buffer)) {
+    }
+    std::lock_guard<std::mutex> guard(lock);
+    connections.erase(sock);
+    close(sock);
+  }
+
+  static bool Receive(int sock, std::string &buffer)
+  {
+    char chunk[16384];
+    ssize_t len = recv(sock, chunk, sizeof(chunk), 0);
+    if (len <= 0) {
+      return false;
+    }
+    buffer.append(chunk, len);
+    return true;
+  }
+
+  static bool SendAll(int sock, const char *data, size_t size)
+  {
+    while (size) {
+      ssize_t len = send(sock, data, size, MSG_NOSIGNAL);
+      if (len <= 0) {
+        return false;
+      }
+      data += len;
+      size -= len;
+    }
+    return true;
+  }
+
+  static void ParseQuery(const std::string &query, std::map<std::string, std::string> &outQuery)
+  {
+    size_t start = 0;
+    while (start < query.size()) {
+      size_t end = query.find('&', start);
+      if (end == std::string::npos) {
+        end = query.size();
+      }
+      std::string param = query.substr(start, end - start);
+      size_t equals = param.find('=');
+      outQuery[param.substr(0, equals)] = (equals == std::string::npos) ? "" : param.substr(equals + 1);
+      start = end + 1;
+    }
+  }
+
+  // read a request, answer it and return whether the connection stays open
+  bool ServeOne(int sock, std::string &buffer)
+  {
+    size_t headerEnd;
+    while ((headerEnd = buffer.find("\r\n\r\n")) == std::string::npos) {
+      if (!Receive(sock, buffer)) {
+        return false;
+      }
+      std::lock_guard<std::mutex> guard(lock);
+      connections[sock] = false;
+    }
+    StandInRequest request;
+    size_t lineEnd = buffer.find("\r\n");
+    std::string requestLine = buffer.substr(0, lineEnd);
+    size_t space = requestLine.find(' ');
+    size_t space2 = requestLine.find(' ', space + 1);
+    request.method = requestLine.substr(0, space);
+    std::string target = requestLine.substr(space + 1, space2 - space - 1);
+    size_t question = target.find('?');
+    request.path = target.substr(0, question);
+    if (question != std::string::npos) {
+      ParseQuery(target.substr(question + 1), request.query);
+    }
+    size_t lineStart = lineEnd + 2;
+    while (lineStart < headerEnd) {
+      lineEnd = buffer.find("\r\n", lineStart);
+      std::string line = buffer.substr(lineStart, lineEnd - lineStart);
+      lineStart = lineEnd + 2;
+      size_t colon = line.find(':');
+      if (colon == std::string::npos) {
+        continue;
+      }
+      std::string name = line.substr(0, colon);
+      for (char &c : name) {
+        c = (char)tolower((unsigned char)c);
+      }
+      size_t start = line.find_first_not_of(" \t", colon + 1);
+      request.headers[name] = (start == std::string::npos) ? "" : line.substr(start);
+    }
+    buffer.erase(0, headerEnd + 4);
+    auto length = request.headers.find("content-length");
+    size_t bodySize = (length == request.headers.end()) ? 0 : strtoull(length->second.c_str(), nullptr, 10);
+    while (buffer.size() < bodySize) {
+      if (!Receive(sock, buffer)) {
+        return false;
+      }
+    }
+    request.body = buffer.substr(0, bodySize);
+    buffer.erase(0, bodySize);
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      numRequests++;
+      hits[request.path]++;
+    }
+
+    StandInReply reply;
+    handler(request, reply);
+    std::string out = "HTTP/1.1 " + std::to_string(reply.status) + " Stand-In\r\n";
+    for (const auto &header : reply.headers) {
+      out += header.first + ": " + header.second + "\r\n";
+    }
+    bool noBody = (request.method == "HEAD" || reply.status == 204 || reply.status == 304);
+    if (!noBody) {
+      out += reply.chunkSize ? "Transfer-Encoding: chunked\r\n" :
+        "Content-Length: " + std::to_string(reply.body.size()) + "\r\n";
+    }
+    if (reply.close) {
+      out += "Connection: close\r\n";
+    }
+    out += "\r\n";
+    size_t headSize = out.size();
+    if (!noBody && !reply.chunkSize) {
+      out += reply.body;
+    } else if (!noBody) {
+      for (size_t pos = 0; pos < reply.body.size(); pos += reply.chunkSize) {
+        size_t size = std::min(reply.chunkSize, reply.body.size() - pos);
+        char sizeLine[32];
+        snprintf(sizeLine, sizeof(sizeLine), "%zx\r\n", size);
+        out += sizeLine + reply.body.substr(pos, size) + "\r\n";
+      }
+      out += "0\r\n\r\n";
+    }
+    bool cut = (reply.cutAfter != std::string::npos && headSize + reply.cutAfter < out.size());
+    if (cut) {
+      out.resize(headSize + reply.cutAfter);
+    }
+    bool keepAlive = !cut && !reply.close;
+    // the connection counts as idle before the reply goes out, so by the
+    // time the client has the reply it can be dropped
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      connections[sock] = keepAlive && buffer.empty();
+    }
+    return SendAll(sock, out.data(), out.size()) && keepAlive;
+  }
+
+  StandInHandler handler;
+  int listenSock;
+  uint16_t port;
+  std::thread acceptThread;
+  bool stopped;
+
+  // guards everything below
+  mutable std::mutex lock;
+  // every open connection and whether it's waiting for a request
+  std::map<int, bool> connections;
+  std::vector<std::thread> threads;
+  uint32_t numConnections;
+  uint32_t numRequests;
+  std::map<std::string, uint32_t> hits;
+};
@@ -0,0 +1,123 @@
+// Checks the pixel fills the editor draws with against a plain per-pixel
+// version, it doesn't need windows so it's built on its own next to them:
+//
+//   g++ -O2 -o vortex-pixels-check VPixelsCheck.cpp ../GUI/VPixels.cpp
+//   ./vortex-pixels-check [iterations]
+//
+// Every iteration fills a random buffer with random columns or a random
+// rectangle, including start positions past the right edge, columns that
+// straddle it and rectangles hanging off every side. The buffer is part
+// of a wider one so anything written past the end of a row is caught.
+#include "../GUI/VPixels.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <vector>
+
+using namespace std;
+
+// what is in the buffer before anything is drawn
+#define GUARD_COLOR 0xDEADBEEF
+
+static uint32_t seed = 0x12345678;
+
+static uint32_t nextRandom(uint32_t range)
+{
+  seed = seed * 1103515245 + 12345;
+  return (seed >> 8) % range;
+}
+
+// every pixel of a column one at a time, the way the comment describes it
+static void referenceColumns(vector<uint32_t> &pixels, uint32_t width, uint32_t height,
+  uint32_t pitch, const vector<uint32_t> &colors, uint32_t columnWidth, uint32_t startX,
+  uint32_t backColor)
+{
+  for (uint32_t y = 0; y < height; ++y) {
+    uint32_t *row = pixels.data() + (size_t)y * pitch;
+    for (uint32_t x = 0; x < width; ++x) {
+      row[x] = backColor;
+    }
+    for (uint32_t i = 0; i < colors.size(); ++i) {
+      uint32_t start = (uint32_t)((startX + (uint64_t)i * columnWidth) % width);
+      for (uint32_t x = start; x < start + columnWidth && x < width; ++x) {
+        row[x] = colors[i];
+      }
+    }
+  }
+}
+
+static void referenceRect(vector<uint32_t> &pixels, uint32_t width, uint32_t height,
+  int32_t left, int32_t top, int32_t right, int32_t bottom, uint32_t color)
+{
+  for (int32_t y = 0; y < (int32_t)height; ++y) {
+    for (int32_t x = 0; x < (int32_t)width; ++x) {
+      if (x >= left && x < right && y >= top && y < bottom) {
+        pixels[(size_t)y * width + x] = color;
+      }
+    }
+  }
+}
+
+// returns true if the buffers match, and prints the first difference
+static bool compare(const char *what, uint32_t iteration, const vector<uint32_t> &expected,
+  const vector<uint32_t> &actual, uint32_t pitch)
+{
+  for (size_t i = 0; i < expected.size(); ++i) {
+    if (expected[i] != actual[i]) {
+      printf("  %s %u: pixel %u,%u is 0x%08X instead of 0x%08X\n", what, iteration,
+        (uint32_t)(i % pitch), (uint32_t)(i / pitch), actual[i], expected[i]);
+      return false;
+    }
+  }
+  return true;
+}
+
+int main(int argc, char *argv[])
+{
+  uint32_t iterations = (argc > 1) ? strtoul(argv[1], nullptr, 10) : 100000;
+  uint32_t numWrong = 0;
+  vector<uint32_t> colors;
+  vector<uint32_t> expected;
+  vector<uint32_t> actual;
+  for (uint32_t i = 0; i < iterations; ++i) {
+    uint32_t width = 1 + nextRandom(300);
+    uint32_t height = 1 + nextRandom(6);
+    uint32_t pitch = width + nextRandom(8);
+    uint32_t backColor = nextRandom(0x1000000);
+    if (nextRandom(2)) {
+      // the widths of the columns the list box draws and then some
+      uint32_t columnWidth = 1 + nextRandom(5);
+      uint32_t startX = nextRandom(width * 2);
+      colors.resize(nextRandom(width + 20));
+      for (uint32_t &color : colors) {
+        color = nextRandom(0x1000000);
+      }
+      expected.assign((size_t)pitch * height, GUARD_COLOR);
+      actual = expected;
+      referenceColumns(expected, width, height, pitch, colors, columnWidth, startX, backColor);
+      VPixels::fillColumns(actual.data(), width, height, pitch, colors.data(),
+        (uint32_t)colors.size(), columnWidth, startX, backColor);
+      if (!compare("fillColumns", i, expected, actual, pitch)) {
+        numWrong++;
+      }
+      continue;
+    }
+    // rectangles that hang off any side of the buffer
+    int32_t left = (int32_t)nextRandom(width + 20) - 10;
+    int32_t top = (int32_t)nextRandom(height + 4) - 2;
+    int32_t right = left + (int32_t)nextRandom(width + 10);
+    int32_t bottom = top + (int32_t)nextRandom(height + 4);
+    expected.assign((size_t)width * height, GUARD_COLOR);
+    actual = expected;
+    referenceRect(expected, width, height, left, top, right, bottom, backColor);
+    VPixels::fillRect(actual.data(), width, height, left, top, right, bottom, backColor);
+    if (!compare("fillRect", i, expected, actual, width)) {
+      numWrong++;
+    }
+  }
+  printf("%u fills, %s\n", iterations, numWrong ? "MISMATCH" : "identical");
+  return numWrong ? 1 : 0;
+}
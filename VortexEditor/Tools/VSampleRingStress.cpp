@@ -0,0 +1,71 @@
+// Stress test for the sample ring the pattern list rows play into, one
+// thread pushes as fast as it can while another takes snapshots, it doesn't
+// need windows so it's built on its own, ideally with the thread sanitizer:
+//
+//   g++ -O1 -g -fsanitize=thread -pthread -o vortex-ring-stress VSampleRingStress.cpp ../GUI/VSampleRing.cpp
+//   ./vortex-ring-stress [seconds] [capacity]
+//
+// Every sample is the low 24 bits of its sequence number so each snapshot
+// can be checked for a run of consecutive samples that ends no later than
+// the last one pushed. Small rings make the writer lap the reader mid copy
+// which is the case the sequence numbers in the slots are there for.
+#include "../GUI/VSampleRing.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+#define SAMPLE_MASK 0xFFFFFF
+
+int main(int argc, char *argv[])
+{
+  uint32_t seconds = (argc > 1) ? strtoul(argv[1], nullptr, 10) : 5;
+  uint32_t capacity = (argc > 2) ? strtoul(argv[2], nullptr, 10) : 64;
+  VSampleRing ring;
+  ring.init(capacity);
+  atomic<bool> stop(false);
+  thread writer([&]() {
+    uint32_t seq = 0;
+    while (!stop.load(memory_order_relaxed)) {
+      ring.push(seq++ & SAMPLE_MASK);
+    }
+  });
+  uint64_t numSnapshots = 0;
+  uint64_t numSamples = 0;
+  uint64_t numBad = 0;
+  vector<uint32_t> samples;
+  auto end = chrono::steady_clock::now() + chrono::seconds(seconds);
+  while (chrono::steady_clock::now() < end) {
+    uint32_t count = ring.snapshot(samples);
+    uint64_t pushed = ring.numPushed();
+    numSnapshots++;
+    numSamples += count;
+    bool bad = count > capacity;
+    for (uint32_t i = 1; !bad && i < count; ++i) {
+      bad = samples[i] != ((samples[i - 1] + 1) & SAMPLE_MASK);
+    }
+    // the newest sample in the snapshot must already have been pushed
+    if (!bad && count && pushed < (1u << 24)) {
+      bad = samples[count - 1] >= pushed;
+    }
+    if (bad) {
+      if (!numBad) {
+        printf("snapshot %llu of %u samples is not consecutive\n", (unsigned long long)numSnapshots, count);
+      }
+      numBad++;
+    }
+  }
+  stop = true;
+  writer.join();
+  printf("%llu pushed, %llu snapshots averaging %.1f samples, %llu bad\n",
+    (unsigned long long)ring.numPushed(), (unsigned long long)numSnapshots,
+    numSnapshots ? (double)numSamples / numSnapshots : 0.0, (unsigned long long)numBad);
+  return numBad ? 1 : 0;
+}
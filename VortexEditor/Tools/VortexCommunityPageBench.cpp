@@ -0,0 +1,266 @@
+// Times getting a community page ready to show the three ways the browser
+// can: cold, the first time it's seen, when the json comes from the server
+// and is converted; from disk, in a later session, when the json and the
+// converted page both come out of the http cache; and warm, going back to a
+// page that is still held in memory. It's built against the engine's
+// VortexLib like the editor:
+//
+//   cl /EHsc /O2 /I.. /I..\VortexEngine\VortexEngine\src VortexCommunityPageBench.cpp ..\VortexCommunityPage.cpp
+//     ..\VortexModeLibrary.cpp ..\VortexModeHash.cpp ..\VortexFile.cpp ..\HttpCache.cpp ..\HttpClient.cpp
+//     ..\HttpDecoder.cpp <VortexLib.lib> winhttp.lib
+//   vortex-page-bench [directory] [iterations]
+//
+// The server is a backend in the same process that answers with pages shaped
+// like the community server's, so the cold time is the conversion and the
+// cache rather than the network. The cache is in the directory, the default
+// is vortex-page-bench, and the pages are visited the given number of times
+// each way, the default is 5, keeping the best. Then the cache is opened
+// with a limit that only fits half of what was stored, the converted pages
+// have to stay within it and go along with the json they came from. The
+// cache is cleared at the end.
+#include "../VortexCommunityPage.h"
+#include "../VortexModeHash.h"
+#include "../HttpCache.h"
+
+// VortexEngine includes
+#include "VortexLib.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+#define NUM_PAGES 40
+#define MODES_PER_PAGE 15
+
+static uint32_t numFailed = 0;
+
+#define CHECK(cond) do { \
+  if (!(cond)) { \
+    printf("  line %d: %s\n", __LINE__, #cond); \
+    numFailed++; \
+  } \
+} while (0)
+
+static double msSince(chrono::steady_clock::time_point start)
+{
+  return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+// a page the way the community server sends it, every page is different
+static string pageBody(uint32_t page)
+{
+  uint32_t seed = 0x12345678 + page;
+  json data = json::array();
+  for (uint32_t i = 0; i < MODES_PER_PAGE; ++i) {
+    json pat;
+    seed = seed * 1103515245 + 12345;
+    pat["pattern_id"] = (seed >> 16) % 40;
+    pat["args"] = json::array();
+    for (uint32_t arg = 0; arg < 8; ++arg) {
+      seed = seed * 1103515245 + 12345;
+      pat["args"].push_back((seed >> 16) & 0xFF);
+    }
+    pat["colorset"] = json::array();
+    for (uint32_t color = 0; color < 1 + i % 8; ++color) {
+      seed = seed * 1103515245 + 12345;
+      pat["colorset"].push_back((seed >> 8) & 0xFFFFFF);
+    }
+    json mode;
+    mode["name"] = "mode " + to_string(i) + " of page " + to_string(page);
+    mode["modeData"]["num_leds"] = 10;
+    mode["modeData"]["flags"] = 0;
+    mode["modeData"]["single_pats"] = json::array({ pat });
+    data.push_back(mode);
+  }
+  json js;
+  js["data"] = data;
+  js["page"] = page;
+  js["pages"] = NUM_PAGES;
+  return js.dump();
+}
+
+// answers every page with an etag so the cache can revalidate it
+class PageBackend : public HttpBackend
+{
+public:
+  void Send(const string &userAgent, const HttpRequest &request, HttpResponse &response,
+    const HttpSink &sink) override
+  {
+    numRequests++;
+    size_t pos = request.path.find("page=");
+    uint32_t page = (pos == string::npos) ? 1 : strtoul(request.path.c_str() + pos + 5, nullptr, 10);
+    string etag = "\"page" + to_string(page) + "\"";
+    response.headers.clear();
+    response.body.clear();
+    response.headers["etag"] = etag;
+    auto match = request.headers.find("If-None-Match");
+    if (match != request.headers.end() && match->second == etag) {
+      response.status = 304;
+      return;
+    }
+    string body = pageBody(page);
+    response.status = 200;
+    response.headers["content-type"] = "application/json";
+    response.headers["content-length"] = to_string(body.size());
+    sink(body.data(), body.size());
+  }
+
+  atomic<uint32_t> numRequests{ 0 };
+};
+
+static HttpRequest modesRequest(uint32_t page)
+{
+  HttpRequest request;
+  request.host = "vortex.community";
+  request.path = HttpClient::BuildFullPath("/pats/json", {
+    { "page", to_string(page + 1) },
+    { "pageSize", to_string(MODES_PER_PAGE) },
+  });
+  return request;
+}
+
+// what the browser's fetchPage does, the json through the cache then the
+// converted page that was kept with it or a fresh conversion
+static shared_ptr<VortexCommunityPage> fetchPage(Vortex &vortex, HttpCache &cache, uint32_t page,
+  HttpCache::Source &outSource, bool &outLoaded)
+{
+  HttpRequest request = modesRequest(page);
+  HttpResponse response;
+  outSource = cache.Get(request, response);
+  outLoaded = false;
+  if (response.status != 200) {
+    return nullptr;
+  }
+  uint64_t sourceHash = VortexModeHash::hash(response.body.data(), response.body.size());
+  string filename = cache.DerivedPath(request, COMMUNITY_PAGE_EXTENSION);
+  shared_ptr<VortexCommunityPage> modes = make_shared<VortexCommunityPage>();
+  outLoaded = modes->load(filename, sourceHash);
+  if (!outLoaded) {
+    json js = json::parse(response.body, nullptr, false);
+    if (!modes->convert(vortex, js, sourceHash)) {
+      return nullptr;
+    }
+    if (modes->save(filename)) {
+      cache.AddDerived(request, COMMUNITY_PAGE_EXTENSION);
+    }
+  }
+  return modes;
+}
+
+static bool exists(const string &path)
+{
+  FILE *file = fopen(path.c_str(), "rb");
+  if (file) {
+    fclose(file);
+  }
+  return file != nullptr;
+}
+
+int main(int argc, char *argv[])
+{
+  string directory = (argc > 1) ? argv[1] : "vortex-page-bench";
+  uint32_t iterations = (argc > 2) ? strtoul(argv[2], nullptr, 10) : 5;
+  if (!iterations) {
+    iterations = 1;
+  }
+  Vortex vortex;
+  vortex.init();
+  auto backend = make_shared<PageBackend>();
+  HttpClient client("VortexEditor/1.0", backend);
+  vector<shared_ptr<VortexCommunityPage>> pages(NUM_PAGES);
+  double bestCold = 0;
+  double bestDisk = 0;
+  double bestWarm = 0;
+  uint64_t storedBytes = 0;
+  for (uint32_t i = 0; i < iterations; ++i) {
+    {
+      HttpCache cache(client, directory, 1ull << 30);
+      cache.Clear();
+      auto start = chrono::steady_clock::now();
+      for (uint32_t page = 0; page < NUM_PAGES; ++page) {
+        HttpCache::Source source;
+        bool loaded;
+        pages[page] = fetchPage(vortex, cache, page, source, loaded);
+        CHECK(pages[page] && source == HttpCache::SOURCE_NETWORK && !loaded);
+      }
+      double ms = msSince(start) / NUM_PAGES;
+      bestCold = i ? min(bestCold, ms) : ms;
+      storedBytes = cache.NumBytes();
+    }
+    {
+      // the next session, nothing reaches the server or is converted
+      HttpCache cache(client, directory, 1ull << 30);
+      uint32_t requests = backend->numRequests;
+      auto start = chrono::steady_clock::now();
+      for (uint32_t page = 0; page < NUM_PAGES; ++page) {
+        HttpCache::Source source;
+        bool loaded;
+        shared_ptr<VortexCommunityPage> modes = fetchPage(vortex, cache, page, source, loaded);
+        CHECK(modes && source == HttpCache::SOURCE_FRESH && loaded);
+        CHECK(modes && modes->numModes() == pages[page]->numModes());
+      }
+      double ms = msSince(start) / NUM_PAGES;
+      bestDisk = i ? min(bestDisk, ms) : ms;
+      CHECK(backend->numRequests == requests);
+    }
+    // going back to a page in memory only copies the modes into the strips
+    auto start = chrono::steady_clock::now();
+    size_t numBytes = 0;
+    for (uint32_t page = 0; page < NUM_PAGES; ++page) {
+      for (uint32_t m = 0; m < pages[page]->numModes(); ++m) {
+        ByteStream copy = *pages[page]->mode(m);
+        numBytes += copy.rawSize();
+      }
+    }
+    double ms = msSince(start) / NUM_PAGES;
+    bestWarm = i ? min(bestWarm, ms) : ms;
+    CHECK(numBytes > 0);
+  }
+  printf("%u pages of %u modes, %llu bytes cached with their converted pages\n", NUM_PAGES, MODES_PER_PAGE,
+    (unsigned long long)storedBytes);
+  printf("cold %.4fms/page  disk %.4fms/page  warm %.4fms/page\n", bestCold, bestDisk, bestWarm);
+
+  // the converted pages are counted with the json, under a limit that only
+  // fits half of it both go together
+  uint64_t limit = storedBytes / 2;
+  {
+    HttpCache cache(client, directory, limit);
+    CHECK(cache.NumBytes() <= limit);
+    // every converted page left has it's json and the other way around
+    uint32_t numKept = 0;
+    for (uint32_t page = 0; page < NUM_PAGES; ++page) {
+      HttpRequest request = modesRequest(page);
+      if (exists(cache.DerivedPath(request, COMMUNITY_PAGE_EXTENSION))) {
+        HttpResponse response;
+        CHECK(cache.Get(request, response) == HttpCache::SOURCE_FRESH);
+        numKept++;
+      }
+    }
+    CHECK(numKept == cache.NumEntries());
+    printf("under a %llu byte limit: %u of %u pages kept, %llu bytes\n", (unsigned long long)limit, numKept,
+      NUM_PAGES, (unsigned long long)cache.NumBytes());
+    CHECK(numKept > 0 && numKept < NUM_PAGES);
+    // paging through everything again stays under the limit
+    for (uint32_t page = 0; page < NUM_PAGES; ++page) {
+      HttpCache::Source source;
+      bool loaded;
+      CHECK(fetchPage(vortex, cache, page, source, loaded) != nullptr);
+      CHECK(cache.NumBytes() <= limit);
+    }
+    cache.Clear();
+    for (uint32_t page = 0; page < NUM_PAGES; ++page) {
+      CHECK(!exists(cache.DerivedPath(modesRequest(page), COMMUNITY_PAGE_EXTENSION)));
+    }
+  }
+  printf("%s\n", numFailed ? "FAILED" : "all passed");
+  return numFailed ? 1 : 0;
+}
@@ -0,0 +1,83 @@
+// Times saving and loading multi-megabyte libraries through VortexFile, it
+// doesn't need windows so it's built on its own against the engine's linux
+// build of VortexLib for the ByteStream:
+//
+//   g++ -O2 -I../VortexEngine/VortexEngine/src -o vortex-file-bench VortexFileBench.cpp ../VortexFile.cpp <VortexLib>
+//   ./vortex-file-bench [file] [iterations]
+//
+// Libraries of 1, 4, 16 and 64MB of random data are written to the file
+// and read back the given number of times, the default is 5, and every
+// read is compared against what was written. Saves include the flush to
+// the disk and the rename over the old file, loads are from the page cache
+// since the file was just written.
+#include "../VortexFile.h"
+#include "Serial/ByteStream.h"
+
+#include <string.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static const uint32_t librarySizes[] = { 1, 4, 16, 64 };
+
+static double secondsSince(chrono::steady_clock::time_point start)
+{
+  return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char *argv[])
+{
+  string filename = (argc > 1) ? argv[1] : "vortex-file-bench.vortex";
+  uint32_t iterations = (argc > 2) ? strtoul(argv[2], nullptr, 10) : 5;
+  if (!iterations) {
+    iterations = 1;
+  }
+  uint32_t numFailed = 0;
+  uint32_t seed = 0x12345678;
+  for (uint32_t megabytes : librarySizes) {
+    uint32_t size = megabytes * 1024 * 1024;
+    ByteStream library;
+    if (!library.init(size)) {
+      printf("%uMB: failed to allocate\n", megabytes);
+      return 1;
+    }
+    // random data doesn't compress so nothing is faster than a real save
+    uint8_t *data = (uint8_t *)library.rawData() + sizeof(VortexFile::Header);
+    for (uint32_t i = 0; i < size; ++i) {
+      seed = seed * 1103515245 + 12345;
+      data[i] = (uint8_t)(seed >> 16);
+    }
+    double bestSave = 0;
+    double bestLoad = 0;
+    bool ok = true;
+    for (uint32_t i = 0; ok && i < iterations; ++i) {
+      auto start = chrono::steady_clock::now();
+      ok = VortexFile::write(filename, library);
+      double saveSec = secondsSince(start);
+      ByteStream loaded;
+      start = chrono::steady_clock::now();
+      ok = ok && VortexFile::read(filename, loaded);
+      double loadSec = secondsSince(start);
+      ok = ok && loaded.rawSize() == library.rawSize() &&
+        memcmp(loaded.rawData(), library.rawData(), library.rawSize()) == 0;
+      bestSave = i ? min(bestSave, saveSec) : saveSec;
+      bestLoad = i ? min(bestLoad, loadSec) : loadSec;
+    }
+    if (!ok) {
+      printf("%uMB: the library didn't load back the same\n", megabytes);
+      numFailed++;
+      continue;
+    }
+    printf("%3uMB: save %8.2fms %7.1fMB/s  load %8.2fms %7.1fMB/s\n", megabytes,
+      bestSave * 1000.0, megabytes / bestSave, bestLoad * 1000.0, megabytes / bestLoad);
+  }
+  remove(filename.c_str());
+  return numFailed ? 1 : 0;
+}
@@ -0,0 +1,323 @@
+// Checks the community page store the way the browser drives it, paging
+// back and forth as fast as possible while the workers fetch and other
+// threads read the store. The store is built on win32 so this is a windows
+// console program, built against the engine's VortexLib for the pages:
+//
+//   cl /EHsc /O2 /I.. /I..\VortexEngine\VortexEngine\src VortexPageStoreCheck.cpp ..\VortexPageStore.cpp
+//     ..\VortexCommunityPage.cpp ..\VortexModeLibrary.cpp ..\VortexModeHash.cpp ..\VortexFile.cpp
+//     <VortexLib.lib> user32.lib
+//   vortex-page-check
+//
+// The fetcher stands in for the server and the disk cache with a sleep. The ui is a message only window that takes the arrived pages the
+// same way the browser does. Navigating must never wait on a fetch, every
+// page shown must be the page navigated to, no page is fetched while it's
+// stored or already being fetched, and the store must stay within the pages
+// kept around the current one however far it's paged.
+#include "../VortexPageStore.h"
+
+// VortexEngine includes
+#include "VortexLib.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+#define NUM_PAGES 40
+#define PREFETCH_RADIUS 2
+#define PREFETCH_WORKERS 4
+#define PAGE_KEEP_RADIUS 8
+// the shortest a fetch takes, a navigation that waited on one would show
+#define FETCH_MS 30
+#define WM_PAGES_ARRIVED (WM_USER + 0)
+
+// the most the store can hold, the pages kept around the current page and
+// any that arrive after it moves on
+#define MAX_STORED (PAGE_KEEP_RADIUS * 2 + 1 + PREFETCH_WORKERS)
+
+static uint32_t numFailed = 0;
+
+#define CHECK(cond) do { \
+  if (!(cond)) { \
+    printf("  line %d: %s\n", __LINE__, #cond); \
+    numFailed++; \
+  } \
+} while (0)
+
+static double nowMs()
+{
+  LARGE_INTEGER freq;
+  LARGE_INTEGER now;
+  QueryPerformanceFrequency(&freq);
+  QueryPerformanceCounter(&now);
+  return (double)now.QuadPart * 1000.0 / (double)freq.QuadPart;
+}
+
+// every page converted up front, the fetcher only hands them out
+static VortexPageStore::Page pages[NUM_PAGES];
+static atomic<bool> failing[NUM_PAGES];
+static atomic<uint32_t> fetching[NUM_PAGES];
+static atomic<uint32_t> numFetching(0);
+static atomic<uint32_t> mostFetching(0);
+static atomic<uint32_t> numBadFetches(0);
+
+// the browser as far as the store goes
+struct Browser
+{
+  VortexPageStore store;
+  HWND hwnd = nullptr;
+  uint32_t curPage = 0;
+  // the page on screen and what the page label says
+  int32_t shownPage = -1;
+  string label;
+  double worstNavMs = 0;
+  uint32_t mostStored = 0;
+
+  static string nameOf(uint32_t page)
+  {
+    return "page " + to_string(page);
+  }
+
+  void loadPage(uint32_t page)
+  {
+    double start = nowMs();
+    store.prefetch(page, PREFETCH_RADIUS, PAGE_KEEP_RADIUS);
+    VortexPageStore::Page modes = store.get(page);
+    if (!modes) {
+      label = store.isPending(page) ? "loading" : "offline";
+    } else {
+      shownPage = (modes->numModes() && nameOf(page) == modes->entry(0)->name) ? (int32_t)page : -2;
+      label = "ok";
+    }
+    worstNavMs = max(worstNavMs, nowMs() - start);
+    mostStored = max(mostStored, store.numStored());
+  }
+
+  void pagesArrived()
+  {
+    vector<uint32_t> arrived;
+    store.takeArrived(arrived);
+    for (uint32_t page : arrived) {
+      if (page != curPage) {
+        continue;
+      }
+      if (store.get(page)) {
+        loadPage(curPage);
+      } else {
+        label = "offline";
+      }
+    }
+  }
+
+  bool next()
+  {
+    uint32_t numPages = store.numPages();
+    if (numPages && curPage + 1 >= numPages) {
+      return false;
+    }
+    loadPage(++curPage);
+    return true;
+  }
+
+  bool prev()
+  {
+    if (!curPage) {
+      return false;
+    }
+    loadPage(--curPage);
+    return true;
+  }
+
+  // run the message loop for a while
+  void pump(double ms)
+  {
+    double end = nowMs() + ms;
+    do {
+      MSG msg;
+      while (PeekMessageA(&msg, nullptr, 0, 0, PM_REMOVE)) {
+        DispatchMessageA(&msg);
+      }
+      Sleep(1);
+    } while (nowMs() < end);
+  }
+};
+
+static Browser *browser = nullptr;
+
+static LRESULT CALLBACK windowProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
+{
+  if (msg == WM_PAGES_ARRIVED && browser) {
+    browser->pagesArrived();
+    return 0;
+  }
+  return DefWindowProcA(hwnd, msg, wParam, lParam);
+}
+
+static VortexPageStore::Page fetchPage(uint32_t page)
+{
+  uint32_t count = ++numFetching;
+  uint32_t most = mostFetching;
+  while (count > most && !mostFetching.compare_exchange_weak(most, count)) {
+  }
+  // a page is only fetched once at a time and never while it's stored
+  if (page >= NUM_PAGES || fetching[page]++ || (browser && browser->store.get(page))) {
+    numBadFetches++;
+  }
+  Sleep(FETCH_MS + page % 7);
+  fetching[page]--;
+  numFetching--;
+  if (page >= NUM_PAGES || failing[page]) {
+    return nullptr;
+  }
+  return pages[page];
+}
+
+static bool openBrowser(Browser &b)
+{
+  browser = &b;
+  b.hwnd = CreateWindowExA(0, "VortexPageStoreCheck", "", 0, 0, 0, 0, 0, HWND_MESSAGE, nullptr,
+    GetModuleHandleA(nullptr), nullptr);
+  return b.hwnd && b.store.init(fetchPage, PREFETCH_WORKERS, b.hwnd, WM_PAGES_ARRIVED);
+}
+
+static void closeBrowser(Browser &b)
+{
+  b.store.cleanup();
+  DestroyWindow(b.hwnd);
+  browser = nullptr;
+}
+
+int main()
+{
+  WNDCLASSA wc = {};
+  wc.lpfnWndProc = windowProc;
+  wc.hInstance = GetModuleHandleA(nullptr);
+  wc.lpszClassName = "VortexPageStoreCheck";
+  RegisterClassA(&wc);
+  Vortex vortex;
+  vortex.init();
+  for (uint32_t page = 0; page < NUM_PAGES; ++page) {
+    json mode;
+    mode["name"] = Browser::nameOf(page);
+    json js;
+    js["data"] = json::array({ mode });
+    js["pages"] = NUM_PAGES;
+    shared_ptr<VortexCommunityPage> modes = make_shared<VortexCommunityPage>();
+    modes->convert(vortex, js, page);
+    pages[page] = modes;
+  }
+  {
+    Browser b;
+    CHECK(openBrowser(b));
+    b.loadPage(0);
+    b.pump(100);
+    CHECK(b.store.numPages() == NUM_PAGES && b.store.numStored() == PREFETCH_RADIUS + 1);
+    CHECK(b.label == "ok" && b.shownPage == 0);
+    printf("warm: %u pages stored, at most %u fetched at once\n", b.store.numStored(), mostFetching.load());
+    // with a moment on each page the next one is always there already
+    uint32_t instant = 0;
+    for (uint32_t i = 0; i < 10; ++i) {
+      b.next();
+      instant += (b.label == "ok" && b.shownPage == (int32_t)b.curPage);
+      b.pump(30);
+    }
+    printf("stepping with 30ms on each page: %u of 10 shown straight away\n", instant);
+    CHECK(instant == 10);
+    // a random walk without waiting at all while other threads read
+    atomic<bool> stop(false);
+    atomic<uint32_t> numWrong(0);
+    vector<thread> readers;
+    for (uint32_t r = 0; r < 3; ++r) {
+      readers.emplace_back([&]() {
+        while (!stop) {
+          for (uint32_t page = 0; page < NUM_PAGES; ++page) {
+            VortexPageStore::Page modes = b.store.get(page);
+            if (modes && (!modes->numModes() || Browser::nameOf(page) != modes->entry(0)->name)) {
+              numWrong++;
+            }
+            b.store.isPending(page);
+          }
+        }
+      });
+    }
+    mt19937 rng(7);
+    for (uint32_t i = 0; i < 5000; ++i) {
+      if (rng() % 2) {
+        b.next();
+      } else {
+        b.prev();
+      }
+      if (i % 50 == 0) {
+        b.pump(2);
+      }
+      if (b.label == "ok") {
+        CHECK(b.shownPage == (int32_t)b.curPage);
+      }
+    }
+    b.pump(200);
+    stop = true;
+    for (thread &reader : readers) {
+      reader.join();
+    }
+    CHECK(!numWrong && !numBadFetches);
+    CHECK(b.label == "ok" && b.shownPage == (int32_t)b.curPage);
+    for (uint32_t page = b.curPage - min(b.curPage, (uint32_t)PREFETCH_RADIUS);
+      page <= b.curPage + PREFETCH_RADIUS && page < NUM_PAGES; ++page) {
+      CHECK(b.store.get(page) != nullptr);
+    }
+    CHECK(b.mostStored <= MAX_STORED);
+    printf("random walk of 5000 steps: slowest navigation %.3fms, at most %u pages stored, %u fetches,"
+      " %u dropped\n", b.worstNavMs, b.mostStored, b.store.numFetches(), b.store.numDropped());
+    CHECK(b.worstNavMs < FETCH_MS / 2);
+    closeBrowser(b);
+  }
+  {
+    // paging straight to the end only fetches what's near and only keeps
+    // what's near the end
+    Browser b;
+    CHECK(openBrowser(b));
+    b.loadPage(0);
+    b.pump(100);
+    while (b.next()) {
+    }
+    b.pump(200);
+    printf("paged 0 to %u without waiting: %u fetches, %u pages stored\n", b.curPage,
+      b.store.numFetches(), b.store.numStored());
+    CHECK(b.curPage == NUM_PAGES - 1 && b.label == "ok" && b.shownPage == NUM_PAGES - 1);
+    CHECK(b.store.numFetches() < 20 && b.store.numStored() <= MAX_STORED);
+    CHECK(!b.store.get(0) && b.store.numDropped() > 0);
+    // a dropped page is fetched again when it's navigated back to
+    uint32_t fetches = b.store.numFetches();
+    b.curPage = 0;
+    b.loadPage(0);
+    CHECK(b.label == "loading");
+    b.pump(100);
+    CHECK(b.label == "ok" && b.shownPage == 0 && b.store.numFetches() > fetches);
+    // a failed page is reported and fetched again on the next visit
+    failing[25] = true;
+    b.curPage = 25;
+    b.loadPage(25);
+    CHECK(b.label == "loading");
+    b.pump(100);
+    CHECK(b.label == "offline");
+    failing[25] = false;
+    b.next();
+    b.prev();
+    b.pump(100);
+    CHECK(b.label == "ok" && b.shownPage == 25);
+    CHECK(!numBadFetches);
+    // closing while fetches are in flight
+    b.curPage = 10;
+    b.loadPage(10);
+    closeBrowser(b);
+  }
+  printf("%s\n", numFailed ? "FAILED" : "all passed");
+  return numFailed ? 1 : 0;
+}
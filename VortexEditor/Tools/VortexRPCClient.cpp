@@ -0,0 +1,175 @@
+// A small client for the automation endpoint of the editor, this is built
+// on linux separately from the editor to drive a headless editor and
+// measure how many calls per second it can handle:
+//
+//   g++ -O2 -o vortex-rpc VortexRPCClient.cpp
+//
+//   wine VortexEditor.exe --headless Z:\\tmp\\vortex.sock
+//   ./vortex-rpc /tmp/vortex.sock modes.list
+//   ./vortex-rpc /tmp/vortex.sock modes.select '{"index":2}'
+//   ./vortex-rpc /tmp/vortex.sock --bench 100000 64 editor.ping
+//
+// The benchmark runs the method one call at a time and then pipelined with
+// the given number of calls in flight, every response is checked for an
+// error before it counts.
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include <string>
+
+using namespace std;
+
+static int connectEditor(const char *path)
+{
+  sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (strlen(path) >= sizeof(addr.sun_path)) {
+    return -1;
+  }
+  strcpy(addr.sun_path, path);
+  int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (sock < 0) {
+    return -1;
+  }
+  if (connect(sock, (sockaddr *)&addr, sizeof(addr)) < 0) {
+    close(sock);
+    return -1;
+  }
+  return sock;
+}
+
+static bool writeAll(int sock, const string &data)
+{
+  size_t offset = 0;
+  while (offset < data.size()) {
+    ssize_t sent = write(sock, data.c_str() + offset, data.size() - offset);
+    if (sent <= 0) {
+      return false;
+    }
+    offset += sent;
+  }
+  return true;
+}
+
+// read lines until count responses arrived, returns the number of errors
+// or -1 if the editor went away
+static int32_t readResponses(int sock, string &buffer, uint32_t count, string *outLast = nullptr)
+{
+  int32_t numErrors = 0;
+  char chunk[64 * 1024];
+  while (count > 0) {
+    size_t end = buffer.find('\n');
+    if (end == string::npos) {
+      ssize_t amount = read(sock, chunk, sizeof(chunk));
+      if (amount <= 0) {
+        return -1;
+      }
+      buffer.append(chunk, amount);
+      continue;
+    }
+    string line = buffer.substr(0, end);
+    if (line.find("\"error\"") != string::npos) {
+      numErrors++;
+    }
+    if (outLast) {
+      *outLast = line;
+    }
+    buffer.erase(0, end + 1);
+    count--;
+  }
+  return numErrors;
+}
+
+static double now()
+{
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static string request(uint32_t id, const string &method, const string &params)
+{
+  return "{\"jsonrpc\":\"2.0\",\"id\":" + to_string(id) + ",\"method\":\"" + method +
+    "\",\"params\":" + params + "}\n";
+}
+
+// run count calls with depth calls in flight at once, returns calls per second
+static double bench(int sock, uint32_t count, uint32_t depth, const string &method,
+  const string &params, int32_t &outErrors)
+{
+  string buffer;
+  outErrors = 0;
+  double start = now();
+  for (uint32_t sent = 0; sent < count; ) {
+    uint32_t batch = (count - sent < depth) ? count - sent : depth;
+    string data;
+    for (uint32_t i = 0; i < batch; ++i) {
+      data += request(sent + i, method, params);
+    }
+    if (!writeAll(sock, data)) {
+      return 0;
+    }
+    int32_t numErrors = readResponses(sock, buffer, batch);
+    if (numErrors < 0) {
+      return 0;
+    }
+    outErrors += numErrors;
+    sent += batch;
+  }
+  return count / (now() - start);
+}
+
+int main(int argc, char *argv[])
+{
+  if (argc < 3) {
+    printf("usage: %s <socket> <method> [params]\n", argv[0]);
+    printf("       %s <socket> --bench [count] [depth] [method] [params]\n", argv[0]);
+    return 1;
+  }
+  int sock = connectEditor(argv[1]);
+  if (sock < 0) {
+    printf("Failed to connect to the editor at %s\n", argv[1]);
+    return 1;
+  }
+  string command = argv[2];
+  if (command != "--bench") {
+    string params = (argc > 3) ? argv[3] : "{}";
+    string buffer;
+    string response;
+    if (!writeAll(sock, request(1, command, params)) || readResponses(sock, buffer, 1, &response) < 0) {
+      printf("The editor closed the connection\n");
+      close(sock);
+      return 1;
+    }
+    printf("%s\n", response.c_str());
+    close(sock);
+    return (response.find("\"error\"") == string::npos) ? 0 : 1;
+  }
+  uint32_t count = (argc > 3) ? strtoul(argv[3], nullptr, 10) : 100000;
+  uint32_t depth = (argc > 4) ? strtoul(argv[4], nullptr, 10) : 64;
+  string method = (argc > 5) ? argv[5] : "editor.ping";
+  string params = (argc > 6) ? argv[6] : "{}";
+  if (!count || !depth) {
+    printf("The count and depth must be at least 1\n");
+    close(sock);
+    return 1;
+  }
+  // one at a time is bound by the round trip through the ui thread
+  int32_t numErrors = 0;
+  uint32_t serialCount = (count < 10000) ? count : 10000;
+  double serialRate = bench(sock, serialCount, 1, method, params, numErrors);
+  printf("%s: %u calls one at a time: %.0f calls/s (%d errors)\n",
+    method.c_str(), serialCount, serialRate, numErrors);
+  double pipedRate = bench(sock, count, depth, method, params, numErrors);
+  printf("%s: %u calls %u in flight: %.0f calls/s (%d errors)\n",
+    method.c_str(), count, depth, pipedRate, numErrors);
+  close(sock);
+  return (serialRate > 0 && pipedRate > 0) ? 0 : 1;
+}
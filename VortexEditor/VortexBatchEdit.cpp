@@ -0,0 +1,143 @@
+#include "VortexBatchEdit.h"
+
+// VortexEngine includes
+#include "Colors/Colortypes.h"
+#include "Patterns/PatternBuilder.h"
+#include "VortexLib.h"
+
+using namespace std;
+
+VortexBatchEdit::VortexBatchEdit() :
+  m_modes(),
+  m_leds(),
+  m_edits()
+{
+}
+
+void VortexBatchEdit::selectModes(const vector<uint32_t> &modes)
+{
+  m_modes = modes;
+}
+
+void VortexBatchEdit::selectLeds(const vector<LedPos> &leds)
+{
+  m_leds = leds;
+}
+
+void VortexBatchEdit::setColorset(const Colorset &set)
+{
+  m_edits.push_back([set](PatternID &id, PatternArgs &args, Colorset &outSet) {
+    outSet = set;
+  });
+}
+
+void VortexBatchEdit::setPattern(PatternID id)
+{
+  m_edits.push_back([id](PatternID &outID, PatternArgs &args, Colorset &set) {
+    // the args of another pattern mean nothing to this one, it starts from
+    // it's defaults and any args queued after this still apply on top
+    if (outID != id) {
+      args = PatternBuilder::getDefaultArgs(id);
+    }
+    outID = id;
+  });
+}
+
+void VortexBatchEdit::setPatternArgs(const PatternArgs &args)
+{
+  m_edits.push_back([args](PatternID &id, PatternArgs &outArgs, Colorset &set) {
+    outArgs = args;
+  });
+}
+
+void VortexBatchEdit::setParam(uint32_t index, uint8_t value)
+{
+  m_edits.push_back([index, value](PatternID &id, PatternArgs &args, Colorset &set) {
+    if (index < BATCH_MAX_PARAMS) {
+      args.args[index] = value;
+    }
+  });
+}
+
+void VortexBatchEdit::transform(const Transform &fn)
+{
+  m_edits.push_back(fn);
+}
+
+void VortexBatchEdit::shiftHue(uint8_t amount)
+{
+  m_edits.push_back([amount](PatternID &id, PatternArgs &args, Colorset &set) {
+    for (uint32_t i = 0; i < set.numColors(); ++i) {
+      HSVColor hsv = set.get(i);
+      hsv.hue += amount;
+      set.set(i, hsv);
+    }
+  });
+}
+
+uint32_t VortexBatchEdit::apply(Vortex &vortex) const
+{
+  if (m_edits.empty() || !vortex.numModes()) {
+    return 0;
+  }
+  vector<uint32_t> modes = m_modes;
+  if (modes.empty()) {
+    for (uint32_t i = 0; i < vortex.numModes(); ++i) {
+      modes.push_back(i);
+    }
+  }
+  uint32_t curSel = vortex.curModeIndex();
+  uint32_t numChanged = 0;
+  for (uint32_t mode : modes) {
+    if (mode >= vortex.numModes() || !vortex.setCurMode(mode, false)) {
+      continue;
+    }
+    if (m_leds.empty()) {
+      // the multi led pattern or every led
+      if (vortex.isCurModeMulti()) {
+        applyLed(vortex, LED_MULTI);
+        numChanged++;
+        continue;
+      }
+      for (LedPos pos = LED_FIRST; pos < vortex.numLedsInMode(); ++pos) {
+        numChanged++;
+        if (!applyLed(vortex, pos)) {
+          break;
+        }
+      }
+      continue;
+    }
+    for (LedPos pos : m_leds) {
+      if (pos != LED_MULTI && pos >= vortex.numLedsInMode()) {
+        continue;
+      }
+      numChanged++;
+      if (!applyLed(vortex, pos)) {
+        break;
+      }
+    }
+  }
+  // going back to the original mode is the only save, so the engine takes
+  // a single undo snapshot of every edit in the batch
+  vortex.setCurMode(curSel, true);
+  return numChanged;
+}
+
+bool VortexBatchEdit::applyLed(Vortex &vortex, LedPos pos) const
+{
+  PatternID id = vortex.getPatternID(pos);
+  PatternArgs args;
+  vortex.getPatternArgs(pos, args);
+  Colorset set;
+  vortex.getColorset(pos, set);
+  for (const Transform &edit : m_edits) {
+    edit(id, args, set);
+  }
+  if ((pos == LED_MULTI) != isMultiLedPatternID(id)) {
+    // changing between single and multi led patterns converts the whole mode
+    vortex.setPattern(id, &args, &set, false);
+    return false;
+  }
+  vortex.setPatternAt(pos, id, &args, &set, false);
+  return true;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stdint.h>
+#include <functional>
+#include <vector>
+
+// engine includes
+#include "Patterns/Patterns.h"
+#include "Patterns/PatternArgs.h"
+#include "Colors/Colorset.h"
+#include "Leds/LedTypes.h"
+
+class Vortex;
+
+// the number of pattern params that can be set, the same as the editor
+#define BATCH_MAX_PARAMS 8
+
+// A batch of edits applied to many leds of many modes as one change.
+//
+// The edits are queued up first and then applied in order to every
+// selected led of every selected mode. Nothing is saved until the end so
+// the engine only takes a single undo snapshot for the whole batch, and
+// the caller only needs to refresh the ui and demo once afterwards.
+//
+// By default every mode is edited, and within each mode the multi led
+// pattern if there is one, otherwise every led. A single led pattern set
+// on a multi led mode, or a multi led pattern set on any led, converts the
+// whole mode the same way picking the pattern in the editor would.
+class VortexBatchEdit
+{
+public:
+  VortexBatchEdit();
+
+  // a transform can change anything about an led
+  typedef std::function<void(PatternID &id, PatternArgs &args, Colorset &set)> Transform;
+
+  // pick the modes and leds to edit
+  void selectModes(const std::vector<uint32_t> &modes);
+  void selectLeds(const std::vector<LedPos> &leds);
+
+  // queue edits, each led gets them in the order they were queued, a
+  // different pattern starts from the default args of that pattern
+  void setColorset(const Colorset &set);
+  void setPattern(PatternID id);
+  void setPatternArgs(const PatternArgs &args);
+  void setParam(uint32_t index, uint8_t value);
+  void transform(const Transform &fn);
+  // rotate the hue of every color, a full turn is 256
+  void shiftHue(uint8_t amount);
+
+  bool empty() const { return m_edits.empty(); }
+
+  // apply the batch and save once, returns the number of leds changed
+  uint32_t apply(Vortex &vortex) const;
+
+private:
+  // apply the edits to a single led in the current mode, returns false if
+  // the whole mode was converted and no other leds need to be edited
+  bool applyLed(Vortex &vortex, LedPos pos) const;
+
+  std::vector<uint32_t> m_modes;
+  std::vector<LedPos> m_leds;
+  std::vector<Transform> m_edits;
+};
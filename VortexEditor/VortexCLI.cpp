@@ -0,0 +1,892 @@
+#include "VortexCLI.h"
+
+// windows includes
+#include <windows.h>
+
+// VortexEngine includes
+#include "Serial/ByteStream.h"
+#include "Patterns/Patterns.h"
+#include "Colors/Colortypes.h"
+#include "Patterns/PatternBuilder.h"
+#include "VortexLib.h"
+
+// Editor includes
+#include "VortexModeLibrary.h"
+#include "VortexModeIndex.h"
+#include "VortexBatchEdit.h"
+#include "VortexModeHash.h"
+#include "VortexColorConvert.h"
+#include "VortexModeRenderer.h"
+#include "VortexTimeline.h"
+#include "VortexFile.h"
+
+#include <algorithm>
+#include <vector>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdio.h>
+
+// the extension of individual modes and savefiles
+#define VORTEX_MODE_EXTENSION ".vtxmode"
+#define VORTEX_SAVE_EXTENSION ".vortex"
+// the extension of rendered modes
+#define VORTEX_RENDER_EXTENSION ".vtxrender"
+
+// the number of modes hashed by the benchmark by default
+#define BENCH_HASH_DEFAULT_COUNT 100000
+// the number of distinct random modes the benchmark cycles through
+#define BENCH_HASH_NUM_MODES 1024
+
+// the number of random modes the search benchmark indexes by default and
+// how many times each query is run
+#define BENCH_SEARCH_DEFAULT_MODES 100000
+#define BENCH_SEARCH_RUNS 100
+
+// the default size of the batch benchmark, a full orbit of modes
+#define BENCH_BATCH_DEFAULT_MODES 64
+#define BENCH_BATCH_DEFAULT_LEDS 28
+
+// a looped timeline is checked against the engine for at least this long
+#define VERIFY_TIMELINE_MIN_TICKS 10000
+
+// the length of a render and the size of the render benchmark by default
+#define RENDER_DEFAULT_TICKS 1024
+#define BENCH_RENDER_DEFAULT_MODES 256
+#define BENCH_RENDER_LEDS 28
+
+// the size of the buffer converted by the color benchmark by default
+#define BENCH_COLOR_DEFAULT_PIXELS (1024 * 1024)
+// every color is checked against the engine in chunks of this many
+#define BENCH_COLOR_CHUNK (1024 * 1024)
+// each version is timed for at least this long
+#define BENCH_COLOR_MIN_SEC 0.25
+
+using namespace std;
+
+bool VortexCLI::run(int argc, char *argv[], int &exitCode)
+{
+  if (argc < 2) {
+    return false;
+  }
+  string command = argv[1];
+  if (command != "--pack" && command != "--unpack" && command != "--search" &&
+      command != "--batch" && command != "--bench-hash" && command != "--bench-batch" &&
+      command != "--verify-batch" &&
+      command != "--verify-timeline" && command != "--render" && command != "--bench-render" &&
+      command != "--bench-color") {
+    return false;
+  }
+  // this is a gui program so there is no console unless one is attached
+  if (AttachConsole(ATTACH_PARENT_PROCESS)) {
+    FILE *con = nullptr;
+    freopen_s(&con, "CONOUT$", "w", stdout);
+  }
+  if (command == "--bench-hash") {
+    uint32_t count = (argc > 2) ? strtoul(argv[2], nullptr, 10) : BENCH_HASH_DEFAULT_COUNT;
+    exitCode = benchHash(count ? count : BENCH_HASH_DEFAULT_COUNT) ? 0 : 1;
+    return true;
+  }
+  if (command == "--bench-search") {
+    uint32_t numModes = (argc > 2) ? strtoul(argv[2], nullptr, 10) : BENCH_SEARCH_DEFAULT_MODES;
+    exitCode = benchSearch(numModes ? numModes : BENCH_SEARCH_DEFAULT_MODES) ? 0 : 1;
+    return true;
+  }
+  if (command == "--bench-batch") {
+    uint32_t numModes = (argc > 2) ? strtoul(argv[2], nullptr, 10) : BENCH_BATCH_DEFAULT_MODES;
+    uint32_t numLeds = (argc > 3) ? strtoul(argv[3], nullptr, 10) : BENCH_BATCH_DEFAULT_LEDS;
+    exitCode = benchBatch(numModes ? numModes : BENCH_BATCH_DEFAULT_MODES,
+      numLeds ? numLeds : BENCH_BATCH_DEFAULT_LEDS) ? 0 : 1;
+    return true;
+  }
+  if (command == "--verify-batch") {
+    exitCode = verifyBatch() ? 0 : 1;
+    return true;
+  }
+  if (command == "--bench-render") {
+    uint32_t numModes = (argc > 2) ? strtoul(argv[2], nullptr, 10) : BENCH_RENDER_DEFAULT_MODES;
+    uint32_t numTicks = (argc > 3) ? strtoul(argv[3], nullptr, 10) : RENDER_DEFAULT_TICKS;
+    exitCode = benchRender(numModes ? numModes : BENCH_RENDER_DEFAULT_MODES,
+      numTicks ? numTicks : RENDER_DEFAULT_TICKS) ? 0 : 1;
+    return true;
+  }
+  if (command == "--bench-color") {
+    uint32_t numPixels = (argc > 2) ? strtoul(argv[2], nullptr, 10) : BENCH_COLOR_DEFAULT_PIXELS;
+    exitCode = benchColor(numPixels ? numPixels : BENCH_COLOR_DEFAULT_PIXELS) ? 0 : 1;
+    return true;
+  }
+  if (command == "--verify-timeline" && argc > 2) {
+    uint32_t numTicks = (argc > 3) ? strtoul(argv[3], nullptr, 10) : 0;
+    exitCode = verifyTimeline(argv[2], numTicks) ? 0 : 1;
+    return true;
+  }
+  if (argc < 4 || (command == "--batch" && argc < 5)) {
+    print("Usage: %s --pack <directory> <library%s>", argv[0], VORTEX_LIBRARY_EXTENSION);
+    print("       %s --unpack <library%s> <directory>", argv[0], VORTEX_LIBRARY_EXTENSION);
+    print("       %s --search <library%s> <query>", argv[0], VORTEX_LIBRARY_EXTENSION);
+    print("       %s --batch <in%s> <out%s> <edit> [<edit> ...]", argv[0],
+      VORTEX_SAVE_EXTENSION, VORTEX_SAVE_EXTENSION);
+    print("       %s --bench-hash [count]", argv[0]);
+    print("       %s --bench-search [modes]", argv[0]);
+    print("       %s --bench-batch [modes] [leds]", argv[0]);
+    print("       %s --verify-batch", argv[0]);
+    print("       %s --verify-timeline <in%s> [ticks]", argv[0], VORTEX_SAVE_EXTENSION);
+    print("       %s --render <in%s> <out%s> [ticks]", argv[0], VORTEX_SAVE_EXTENSION,
+      VORTEX_RENDER_EXTENSION);
+    print("       %s --bench-render [modes] [ticks]", argv[0]);
+    print("       %s --bench-color [pixels]", argv[0]);
+    exitCode = 1;
+    return true;
+  }
+  bool success = false;
+  if (command == "--pack") {
+    success = pack(argv[2], argv[3]);
+  } else if (command == "--search") {
+    // the rest of the arguments are the query
+    string query = argv[3];
+    for (int i = 4; i < argc; ++i) {
+      query += " " + string(argv[i]);
+    }
+    success = search(argv[2], query);
+  } else if (command == "--batch") {
+    success = batch(argv[2], argv[3], vector<string>(argv + 4, argv + argc));
+  } else if (command == "--render") {
+    uint32_t numTicks = (argc > 4) ? strtoul(argv[4], nullptr, 10) : RENDER_DEFAULT_TICKS;
+    success = render(argv[2], argv[3], numTicks ? numTicks : RENDER_DEFAULT_TICKS);
+  } else {
+    success = unpack(argv[2], argv[3]);
+  }
+  exitCode = success ? 0 : 1;
+  return true;
+}
+
+bool VortexCLI::pack(const string &directory, const string &libraryFile)
+{
+  WIN32_FIND_DATA findData;
+  HANDLE hFind = FindFirstFile((directory + "\\*" VORTEX_MODE_EXTENSION).c_str(), &findData);
+  if (hFind == INVALID_HANDLE_VALUE) {
+    print("No %s files found in %s", VORTEX_MODE_EXTENSION, directory.c_str());
+    return false;
+  }
+  // a scratch engine is used to summarize each mode
+  Vortex vortex;
+  vortex.init();
+  vector<VortexModeLibrary::Entry> entries;
+  vector<ByteStream> modes;
+  do {
+    string filename = findData.cFileName;
+    ByteStream stream;
+    if (!VortexFile::read(directory + "\\" + filename, stream)) {
+      print("Skipping %s: corrupt or unreadable", filename.c_str());
+      continue;
+    }
+    vortex.engine().modes().clearModes();
+    vortex.matchLedCount(stream, true);
+    if (!vortex.addNewMode(stream, false)) {
+      print("Skipping %s: invalid mode", filename.c_str());
+      continue;
+    }
+    vortex.setCurMode(0, false);
+    VortexModeLibrary::Entry entry;
+    string name = filename.substr(0, filename.length() - strlen(VORTEX_MODE_EXTENSION));
+    VortexModeLibrary::summarize(vortex, name, entry);
+    entries.push_back(entry);
+    modes.push_back(stream);
+  } while (FindNextFile(hFind, &findData));
+  FindClose(hFind);
+  // packing always writes a fresh library which then replaces the old one
+  string tempFile = libraryFile + ".tmp";
+  DeleteFile(tempFile.c_str());
+  VortexModeLibrary library;
+  if (!library.append(tempFile, entries, modes) ||
+      !MoveFileEx(tempFile.c_str(), libraryFile.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+    DeleteFile(tempFile.c_str());
+    print("Failed to write %s", libraryFile.c_str());
+    return false;
+  }
+  print("Packed %u modes into %s", (uint32_t)modes.size(), libraryFile.c_str());
+  return true;
+}
+
+bool VortexCLI::unpack(const string &libraryFile, const string &directory)
+{
+  VortexModeLibrary library;
+  if (!library.open(libraryFile)) {
+    print("%s is not a valid mode library", libraryFile.c_str());
+    return false;
+  }
+  CreateDirectory(directory.c_str(), NULL);
+  uint32_t numUnpacked = 0;
+  for (uint32_t i = 0; i < library.numEntries(); ++i) {
+    const VortexModeLibrary::Entry *entry = library.entry(i);
+    string name(entry->name, strnlen(entry->name, sizeof(entry->name)));
+    // only keep characters that are safe in a filename
+    replace_if(name.begin(), name.end(), [](char c) {
+      return !isalnum((unsigned char)c) && c != '-' && c != '_' && c != '.';
+    }, '_');
+    if (name.empty()) {
+      name = "Mode_" + to_string(i);
+    }
+    ByteStream stream;
+    if (!library.loadMode(i, stream)) {
+      print("Skipping mode %u (%s): corrupt", i, name.c_str());
+      continue;
+    }
+    string filename = directory + "\\" + name + VORTEX_MODE_EXTENSION;
+    // don't overwrite modes that share a name
+    if (GetFileAttributes(filename.c_str()) != INVALID_FILE_ATTRIBUTES) {
+      filename = directory + "\\" + name + "_" + to_string(i) + VORTEX_MODE_EXTENSION;
+    }
+    if (!VortexFile::write(filename, stream)) {
+      print("Failed to write %s", filename.c_str());
+      continue;
+    }
+    numUnpacked++;
+  }
+  print("Unpacked %u of %u modes into %s", numUnpacked, library.numEntries(), directory.c_str());
+  return numUnpacked == library.numEntries();
+}
+
+bool VortexCLI::search(const string &libraryFile, const string &query)
+{
+  VortexModeLibrary library;
+  if (!library.open(libraryFile)) {
+    print("%s is not a valid mode library", libraryFile.c_str());
+    return false;
+  }
+  // the pattern names come from the engine
+  Vortex vortex;
+  vortex.init();
+  vector<string> patternNames;
+  for (PatternID id = PATTERN_NONE; id < PATTERN_COUNT; ++id) {
+    patternNames.push_back(vortex.patternToString(id));
+  }
+  VortexModeIndex index;
+  index.setPatternNames(patternNames);
+  LARGE_INTEGER freq;
+  LARGE_INTEGER startTime;
+  LARGE_INTEGER indexTime;
+  LARGE_INTEGER endTime;
+  QueryPerformanceFrequency(&freq);
+  QueryPerformanceCounter(&startTime);
+  for (uint32_t i = 0; i < library.numEntries(); ++i) {
+    index.update(VortexModeIndex::SOURCE_LIBRARY, i, *library.entry(i));
+  }
+  QueryPerformanceCounter(&indexTime);
+  uint32_t numMatches = 0;
+  vector<VortexModeIndex::Result> results = index.search(query, UINT32_MAX, &numMatches);
+  QueryPerformanceCounter(&endTime);
+  for (const VortexModeIndex::Result &result : results) {
+    print("%u: %s", result.index, index.nameOf(result).c_str());
+  }
+  double indexMs = (double)(indexTime.QuadPart - startTime.QuadPart) * 1000.0 / (double)freq.QuadPart;
+  double searchMs = (double)(endTime.QuadPart - indexTime.QuadPart) * 1000.0 / (double)freq.QuadPart;
+  print("%u of %u modes match (indexed in %.3f ms, searched in %.3f ms)", numMatches,
+    library.numEntries(), indexMs, searchMs);
+  return true;
+}
+
+bool VortexCLI::batch(const string &inFile, const string &outFile, const vector<string> &edits)
+{
+  Vortex vortex;
+  vortex.init();
+  ByteStream stream;
+  if (!VortexFile::read(inFile, stream) || !vortex.setModes(stream, false)) {
+    print("%s is corrupt or could not be read", inFile.c_str());
+    return false;
+  }
+  VortexBatchEdit batch;
+  for (const string &edit : edits) {
+    if (!parseEdit(vortex, edit, batch)) {
+      print("Invalid edit: %s", edit.c_str());
+      return false;
+    }
+  }
+  uint32_t numChanged = batch.apply(vortex);
+  ByteStream outStream;
+  vortex.getModes(outStream);
+  if (!VortexFile::write(outFile, outStream)) {
+    print("Failed to write %s", outFile.c_str());
+    return false;
+  }
+  print("Changed %u leds across %u modes, saved to %s", numChanged, vortex.numModes(), outFile.c_str());
+  return true;
+}
+
+// parse a list of numbers and ranges like 0,2,5-9, anything at or past the
+// limit is dropped and every number is only listed once
+static bool parseList(const string &list, uint32_t limit, vector<uint32_t> &outList)
+{
+  if (!limit) {
+    return false;
+  }
+  vector<uint8_t> listed(limit, 0);
+  size_t pos = 0;
+  while (pos < list.length()) {
+    size_t end = list.find(',', pos);
+    if (end == string::npos) {
+      end = list.length();
+    }
+    string item = list.substr(pos, end - pos);
+    if (item.empty() || !isdigit((unsigned char)item[0])) {
+      return false;
+    }
+    char *rangeEnd = nullptr;
+    uint32_t first = strtoul(item.c_str(), &rangeEnd, 10);
+    uint32_t last = first;
+    if (*rangeEnd == '-') {
+      if (!isdigit((unsigned char)rangeEnd[1])) {
+        return false;
+      }
+      last = strtoul(rangeEnd + 1, &rangeEnd, 10);
+      if (last < first) {
+        return false;
+      }
+    }
+    if (*rangeEnd) {
+      return false;
+    }
+    // the range is clamped before the loop so it always ends
+    if (last >= limit) {
+      last = limit - 1;
+    }
+    for (uint32_t i = first; i <= last; ++i) {
+      if (!listed[i]) {
+        listed[i] = 1;
+        outList.push_back(i);
+      }
+    }
+    pos = end + 1;
+  }
+  return outList.size() > 0;
+}
+
+bool VortexCLI::parseEdit(Vortex &vortex, const string &edit, VortexBatchEdit &batch)
+{
+  size_t equals = edit.find('=');
+  if (equals == string::npos || equals + 1 == edit.length()) {
+    return false;
+  }
+  string field = edit.substr(0, equals);
+  string value = edit.substr(equals + 1);
+  if (field == "modes") {
+    vector<uint32_t> modes;
+    if (!parseList(value, vortex.numModes(), modes)) {
+      return false;
+    }
+    batch.selectModes(modes);
+  } else if (field == "leds") {
+    vector<uint32_t> positions;
+    if (value != "multi" && !parseList(value, LED_COUNT, positions)) {
+      return false;
+    }
+    vector<LedPos> leds;
+    if (value == "multi") {
+      leds.push_back(LED_MULTI);
+    }
+    for (uint32_t pos : positions) {
+      leds.push_back((LedPos)pos);
+    }
+    batch.selectLeds(leds);
+  } else if (field == "colorset") {
+    Colorset set;
+    size_t pos = 0;
+    while (pos < value.length()) {
+      size_t end = value.find(',', pos);
+      if (end == string::npos) {
+        end = value.length();
+      }
+      set.addColor(strtoul(value.substr(pos, end - pos).c_str(), nullptr, 16));
+      pos = end + 1;
+    }
+    batch.setColorset(set);
+  } else if (field == "pattern") {
+    PatternID id = PATTERN_COUNT;
+    if (isdigit((unsigned char)value[0])) {
+      id = (PatternID)strtoul(value.c_str(), nullptr, 10);
+    }
+    for (PatternID i = PATTERN_FIRST; i < PATTERN_COUNT && id == PATTERN_COUNT; ++i) {
+      string name = vortex.patternToString(i);
+      replace(name.begin(), name.end(), ' ', '_');
+      if (_stricmp(name.c_str(), value.c_str()) == 0) {
+        id = i;
+      }
+    }
+    if (id >= PATTERN_COUNT) {
+      return false;
+    }
+    batch.setPattern(id);
+  } else if (field.compare(0, 5, "param") == 0 && field.length() > 5 && isdigit((unsigned char)field[5])) {
+    uint32_t index = strtoul(field.c_str() + 5, nullptr, 10);
+    if (index >= BATCH_MAX_PARAMS) {
+      return false;
+    }
+    batch.setParam(index, (uint8_t)strtoul(value.c_str(), nullptr, 10));
+  } else if (field == "hue") {
+    batch.shiftHue((uint8_t)strtol(value.c_str(), nullptr, 10));
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool VortexCLI::benchHash(uint32_t count)
+{
+  // a pool of random modes serialized out of the engine, the same streams
+  // the editor hashes when it refreshes the mode list or imports modes
+  Vortex vortex;
+  vortex.init();
+  vortex.engine().modes().clearModes();
+  vector<ByteStream> modes;
+  uint64_t totalSize = 0;
+  for (uint32_t i = 0; i < BENCH_HASH_NUM_MODES; ++i) {
+    if (!vortex.addNewMode()) {
+      break;
+    }
+    ByteStream mode;
+    vortex.setCurMode(vortex.numModes() - 1, false);
+    vortex.getCurMode(mode);
+    totalSize += mode.rawSize();
+    modes.push_back(mode);
+  }
+  if (!modes.size()) {
+    print("Failed to create any modes to hash");
+    return false;
+  }
+  uint32_t avgSize = (uint32_t)(totalSize / modes.size());
+  LARGE_INTEGER freq;
+  LARGE_INTEGER startTime;
+  LARGE_INTEGER endTime;
+  QueryPerformanceFrequency(&freq);
+  QueryPerformanceCounter(&startTime);
+  // fold the hashes together so the work can't be optimized away
+  uint64_t combined = 0;
+  for (uint32_t i = 0; i < count; ++i) {
+    combined ^= VortexModeHash::hashMode(modes[i % modes.size()]);
+  }
+  QueryPerformanceCounter(&endTime);
+  double seconds = (double)(endTime.QuadPart - startTime.QuadPart) / (double)freq.QuadPart;
+  double rate = (seconds > 0) ? (count / seconds) : 0;
+  double mbps = rate * avgSize / (1024.0 * 1024.0);
+  print("Hashed %u serialized modes of %u bytes on average in %.3fs", count, avgSize, seconds);
+  print("  %.0f modes/s, %.1f MB/s (%016llx)", rate, mbps, (unsigned long long)combined);
+  return true;
+}
+
+bool VortexCLI::benchSearch(uint32_t numModes)
+{
+  Vortex vortex;
+  vortex.init();
+  vector<string> patternNames;
+  for (PatternID id = PATTERN_NONE; id < PATTERN_COUNT; ++id) {
+    patternNames.push_back(vortex.patternToString(id));
+  }
+  VortexModeIndex index;
+  index.setPatternNames(patternNames);
+  // random summaries with a few patterns and colors each and two word
+  // names, about what a large community library looks like
+  static const char *words[] = {
+    "neon", "fire", "ice", "rainbow", "strobe", "dream", "galaxy", "ocean",
+    "candy", "storm", "ghost", "pulse", "sunset", "toxic", "aurora", "blaze"
+  };
+  static const uint8_t ledCounts[] = { 1, 2, 3, 10, 20, 28 };
+  const uint32_t numWords = sizeof(words) / sizeof(words[0]);
+  uint32_t seed = 0x12345678;
+  auto next = [&seed]() {
+    seed = seed * 1103515245 + 12345;
+    return seed >> 8;
+  };
+  LARGE_INTEGER freq;
+  LARGE_INTEGER startTime;
+  LARGE_INTEGER endTime;
+  QueryPerformanceFrequency(&freq);
+  QueryPerformanceCounter(&startTime);
+  for (uint32_t i = 0; i < numModes; ++i) {
+    VortexModeLibrary::Entry entry;
+    memset(&entry, 0, sizeof(entry));
+    memset(entry.patternIDs, PATTERN_NONE, sizeof(entry.patternIDs));
+    entry.hash = ((uint64_t)next() << 32) | next();
+    entry.numLeds = ledCounts[next() % sizeof(ledCounts)];
+    entry.numColors = (uint8_t)(1 + next() % LIBRARY_MAX_COLORS);
+    uint32_t numPatterns = 1 + next() % 3;
+    for (uint32_t p = 0; p < numPatterns; ++p) {
+      entry.patternIDs[p] = (uint8_t)(PATTERN_FIRST + next() % (PATTERN_COUNT - PATTERN_FIRST));
+    }
+    for (uint32_t c = 0; c < entry.numColors; ++c) {
+      entry.colors[c] = next() & 0xFFFFFF;
+    }
+    snprintf(entry.name, sizeof(entry.name), "%s %s %u", words[next() % numWords],
+      words[next() % numWords], i);
+    index.update(VortexModeIndex::SOURCE_LIBRARY, i, entry);
+  }
+  QueryPerformanceCounter(&endTime);
+  double indexMs = (double)(endTime.QuadPart - startTime.QuadPart) * 1000.0 / (double)freq.QuadPart;
+  print("Indexed %u random modes in %.1f ms", index.size(), indexMs);
+  // from a single broad term to several narrow ones
+  string pattern = "pattern:" + vortex.patternToString(PATTERN_FIRST);
+  replace(pattern.begin(), pattern.end(), ' ', '_');
+  const string queries[] = {
+    "hue:red",
+    pattern,
+    "storm",
+    "leds:28 colors:3",
+    "dominant:blue hue:red",
+    pattern + " hue:green leds:10",
+    "neon fire dominant:pink",
+  };
+  for (const string &query : queries) {
+    uint32_t numMatches = 0;
+    QueryPerformanceCounter(&startTime);
+    for (uint32_t i = 0; i < BENCH_SEARCH_RUNS; ++i) {
+      index.search(query, UINT32_MAX, &numMatches);
+    }
+    QueryPerformanceCounter(&endTime);
+    double ms = (double)(endTime.QuadPart - startTime.QuadPart) * 1000.0 / (double)freq.QuadPart;
+    print("  %-40s %6u matches %8.3f ms", query.c_str(), numMatches, ms / BENCH_SEARCH_RUNS);
+  }
+  return true;
+}
+
+bool VortexCLI::benchBatch(uint32_t numModes, uint32_t numLeds)
+{
+  Vortex vortex;
+  vortex.init();
+  vortex.setLedCount(numLeds);
+  vortex.engine().modes().clearModes();
+  for (uint32_t i = 0; i < numModes; ++i) {
+    vortex.addNewMode();
+  }
+  numModes = vortex.numModes();
+  // make sure every mode has a pattern on every led to recolor
+  vector<LedPos> leds;
+  for (LedPos pos = LED_FIRST; pos < (LedPos)numLeds; ++pos) {
+    leds.push_back(pos);
+  }
+  VortexBatchEdit setup;
+  setup.selectLeds(leds);
+  setup.setPattern(PATTERN_FIRST);
+  setup.apply(vortex);
+  Colorset set;
+  set.addColor(0xFF0000);
+  set.addColor(0x00FF00);
+  set.addColor(0x0000FF);
+  LARGE_INTEGER freq;
+  LARGE_INTEGER startTime;
+  LARGE_INTEGER endTime;
+  QueryPerformanceFrequency(&freq);
+  // one led at a time the way the editor used to, each change is saved
+  QueryPerformanceCounter(&startTime);
+  uint32_t curSel = vortex.curModeIndex();
+  for (uint32_t i = 0; i < numModes; ++i) {
+    vortex.setCurMode(i, false);
+    for (LedPos pos : leds) {
+      vortex.setColorset(pos, set);
+    }
+  }
+  vortex.setCurMode(curSel, false);
+  QueryPerformanceCounter(&endTime);
+  double perLedMs = (double)(endTime.QuadPart - startTime.QuadPart) * 1000.0 / (double)freq.QuadPart;
+  // and the same recolor as a single batch
+  VortexBatchEdit batch;
+  batch.selectLeds(leds);
+  batch.setColorset(set);
+  QueryPerformanceCounter(&startTime);
+  uint32_t numChanged = batch.apply(vortex);
+  QueryPerformanceCounter(&endTime);
+  double batchMs = (double)(endTime.QuadPart - startTime.QuadPart) * 1000.0 / (double)freq.QuadPart;
+  print("Recolored %u leds across %u modes of %u leds", numChanged, numModes, numLeds);
+  print("  one led at a time: %.3f ms", perLedMs);
+  print("  single batch:      %.3f ms (%.1fx)", batchMs, (batchMs > 0) ? (perLedMs / batchMs) : 0);
+  return true;
+}
+
+bool VortexCLI::verifyBatch()
+{
+  PatternID from = PATTERN_FIRST;
+  PatternID to = (PatternID)(PATTERN_FIRST + 1);
+  // every arg of the first pattern moved away from it's default
+  PatternArgs custom = PatternBuilder::getDefaultArgs(from);
+  for (uint32_t i = 0; i < BATCH_MAX_PARAMS; ++i) {
+    custom.args[i] += 1;
+  }
+  struct Check
+  {
+    const char *what;
+    vector<string> edits;
+    // the pattern and args every led should end up with
+    PatternID id;
+    PatternArgs args;
+  };
+  PatternArgs toWithParam = PatternBuilder::getDefaultArgs(to);
+  toWithParam.args[0] = 7;
+  vector<Check> checks = {
+    { "another pattern gets it's defaults", { "pattern=" + to_string(to) }, to,
+      PatternBuilder::getDefaultArgs(to) },
+    { "a param after the pattern still applies", { "pattern=" + to_string(to), "param0=7" }, to,
+      toWithParam },
+    { "the same pattern keeps it's args", { "pattern=" + to_string(from) }, from, custom },
+  };
+  uint32_t numFailed = 0;
+  for (const Check &check : checks) {
+    Vortex vortex;
+    vortex.init();
+    vortex.engine().modes().clearModes();
+    vortex.addNewMode();
+    VortexBatchEdit setup;
+    setup.setPattern(from);
+    setup.setPatternArgs(custom);
+    setup.apply(vortex);
+    VortexBatchEdit batch;
+    bool parsed = true;
+    for (const string &edit : check.edits) {
+      parsed = parsed && parseEdit(vortex, edit, batch);
+    }
+    bool passed = parsed && batch.apply(vortex) > 0;
+    vortex.setCurMode(0, false);
+    for (LedPos pos = LED_FIRST; passed && pos < vortex.numLedsInMode(); ++pos) {
+      PatternArgs args;
+      vortex.getPatternArgs(pos, args);
+      passed = vortex.getPatternID(pos) == check.id;
+      for (uint32_t i = 0; passed && i < BATCH_MAX_PARAMS; ++i) {
+        passed = args.args[i] == check.args.args[i];
+      }
+    }
+    print("%s: %s", check.what, passed ? "ok" : "FAILED");
+    if (!passed) {
+      numFailed++;
+    }
+  }
+  return !numFailed;
+}
+
+bool VortexCLI::verifyTimeline(const string &inFile, uint32_t numTicks)
+{
+  ByteStream stream;
+  if (!VortexFile::read(inFile, stream)) {
+    print("%s is corrupt or could not be read", inFile.c_str());
+    return false;
+  }
+  uint32_t numFailed = 0;
+  uint32_t numInexact = 0;
+  uint32_t numModes = 0;
+  for (uint32_t i = 0; ; ++i) {
+    // the mode is freshly loaded into two engines, one to record and one to
+    // compare against live
+    Vortex recorder;
+    Vortex live;
+    recorder.init();
+    live.init();
+    recorder.matchLedCount(stream, false);
+    live.matchLedCount(stream, false);
+    if (!recorder.setModes(stream, false) || !live.setModes(stream, false)) {
+      print("%s is corrupt or could not be read", inFile.c_str());
+      return false;
+    }
+    numModes = recorder.numModes();
+    if (i >= numModes) {
+      break;
+    }
+    recorder.setCurMode(i, false);
+    live.setCurMode(i, false);
+    live.setInstantTimestep(true);
+    VortexTimeline timeline;
+    if (!timeline.record(recorder)) {
+      print("Mode %u: failed to record", i);
+      numFailed++;
+      continue;
+    }
+    // a loop is checked over a few times round and well past the end of the
+    // recording, a requested number of ticks can only check more than that,
+    // without a loop only the recording itself can match
+    uint32_t length = timeline.introLength() + timeline.loopLength();
+    uint32_t ticks = max(length * 2, timeline.introLength() + timeline.loopLength() * 3);
+    ticks = max(ticks, max(numTicks, (uint32_t)VERIFY_TIMELINE_MIN_TICKS));
+    if (!timeline.isExact() && ticks > length) {
+      ticks = length;
+    }
+    VortexTimeline::Cursor cursor = { 0, 0 };
+    uint32_t mismatch = UINT32_MAX;
+    for (uint32_t t = 0; t < ticks; ++t) {
+      live.engine().tick();
+      if (timeline.next(cursor) != live.engine().leds().getLed(LED_FIRST).raw()) {
+        mismatch = t;
+        break;
+      }
+    }
+    if (!timeline.isExact()) {
+      numInexact++;
+    }
+    if (mismatch != UINT32_MAX) {
+      numFailed++;
+      print("Mode %u: differs from the engine at tick %u", i, mismatch);
+      continue;
+    }
+    print("Mode %u: %u tick intro, %u tick %s, %u runs, matched %u ticks", i,
+      timeline.introLength(), timeline.loopLength(), timeline.isExact() ? "loop" : "recording",
+      timeline.numRuns(), ticks);
+  }
+  print("%u of %u modes matched, %u without a loop", numModes - numFailed, numModes, numInexact);
+  return numFailed == 0;
+}
+
+bool VortexCLI::render(const string &inFile, const string &outFile, uint32_t numTicks)
+{
+  Vortex vortex;
+  vortex.init();
+  ByteStream stream;
+  if (!VortexFile::read(inFile, stream) || !vortex.setModes(stream, false)) {
+    print("%s is corrupt or could not be read", inFile.c_str());
+    return false;
+  }
+  // the renderer takes each mode on it's own
+  vector<ByteStream> modes(vortex.numModes());
+  for (uint32_t i = 0; i < modes.size(); ++i) {
+    vortex.setCurMode(i, false);
+    vortex.getCurMode(modes[i]);
+  }
+  VortexModeRenderer renderer;
+  vector<VortexModeRenderer::Render> renders;
+  uint32_t numRendered = renderer.render(modes, numTicks, renders);
+  if (!VortexModeRenderer::write(outFile, renders)) {
+    print("Failed to write %s", outFile.c_str());
+    return false;
+  }
+  print("Rendered %u of %u modes for %u ticks to %s", numRendered, (uint32_t)modes.size(),
+    numTicks, outFile.c_str());
+  return numRendered == modes.size();
+}
+
+bool VortexCLI::benchRender(uint32_t numModes, uint32_t numTicks)
+{
+  // random modes on a full set of leds
+  Vortex vortex;
+  vortex.init();
+  vortex.setLedCount(BENCH_RENDER_LEDS);
+  vortex.engine().modes().clearModes();
+  vector<ByteStream> modes;
+  for (uint32_t i = 0; i < numModes; ++i) {
+    vortex.addNewMode();
+    ByteStream mode;
+    vortex.getCurMode(mode);
+    modes.push_back(mode);
+  }
+  SYSTEM_INFO sysInfo;
+  GetSystemInfo(&sysInfo);
+  uint32_t numCores = sysInfo.dwNumberOfProcessors ? sysInfo.dwNumberOfProcessors : 1;
+  print("Rendering %u modes of %u leds for %u ticks on up to %u cores", numModes,
+    BENCH_RENDER_LEDS, numTicks, numCores);
+  LARGE_INTEGER freq;
+  LARGE_INTEGER startTime;
+  LARGE_INTEGER endTime;
+  QueryPerformanceFrequency(&freq);
+  double baseRate = 0;
+  for (uint32_t numWorkers = 1; ; numWorkers *= 2) {
+    if (numWorkers > numCores) {
+      numWorkers = numCores;
+    }
+    VortexModeRenderer renderer;
+    renderer.init(numWorkers);
+    vector<VortexModeRenderer::Render> renders;
+    QueryPerformanceCounter(&startTime);
+    uint32_t numRendered = renderer.render(modes, numTicks, renders);
+    QueryPerformanceCounter(&endTime);
+    double seconds = (double)(endTime.QuadPart - startTime.QuadPart) / (double)freq.QuadPart;
+    double rate = (seconds > 0) ? (numRendered / seconds) : 0;
+    if (numWorkers == 1) {
+      baseRate = rate;
+    }
+    print("  %2u workers: %.0f modes/s (%.2fx)", numWorkers, rate, (baseRate > 0) ? (rate / baseRate) : 0);
+    if (numWorkers >= numCores) {
+      break;
+    }
+  }
+  return true;
+}
+
+bool VortexCLI::benchColor(uint32_t numPixels)
+{
+  VortexColorConvert::Isa bestIsa = VortexColorConvert::isa();
+  // every packed color is both a valid hsv and a valid rgb, so the whole
+  // 24 bit range covers every input of both conversions
+  const uint32_t numColors = 1 << 24;
+  vector<uint32_t> input(BENCH_COLOR_CHUNK);
+  vector<uint32_t> refRgb(BENCH_COLOR_CHUNK);
+  vector<uint32_t> refHsv(BENCH_COLOR_CHUNK);
+  vector<uint32_t> output(BENCH_COLOR_CHUNK);
+  uint32_t mismatches[VortexColorConvert::ISA_COUNT] = { 0 };
+  for (uint32_t base = 0; base < numColors; base += BENCH_COLOR_CHUNK) {
+    for (uint32_t i = 0; i < BENCH_COLOR_CHUNK; ++i) {
+      uint32_t col = base + i;
+      input[i] = col;
+      RGBColor rgb = HSVColor((uint8_t)(col >> 16), (uint8_t)(col >> 8), (uint8_t)col);
+      refRgb[i] = ((uint32_t)rgb.red << 16) | ((uint32_t)rgb.green << 8) | rgb.blue;
+      HSVColor hsv = RGBColor((uint8_t)(col >> 16), (uint8_t)(col >> 8), (uint8_t)col);
+      refHsv[i] = ((uint32_t)hsv.hue << 16) | ((uint32_t)hsv.sat << 8) | hsv.val;
+    }
+    for (uint32_t isa = 0; isa < VortexColorConvert::ISA_COUNT; ++isa) {
+      if (!VortexColorConvert::setIsa((VortexColorConvert::Isa)isa)) {
+        continue;
+      }
+      VortexColorConvert::hsvToRgb(input.data(), output.data(), BENCH_COLOR_CHUNK);
+      for (uint32_t i = 0; i < BENCH_COLOR_CHUNK; ++i) {
+        mismatches[isa] += (output[i] != refRgb[i]);
+      }
+      VortexColorConvert::rgbToHsv(input.data(), output.data(), BENCH_COLOR_CHUNK);
+      for (uint32_t i = 0; i < BENCH_COLOR_CHUNK; ++i) {
+        mismatches[isa] += (output[i] != refHsv[i]);
+      }
+    }
+  }
+  print("Converting %u pixels, checked against the engine for all %u colors", numPixels, numColors);
+  input.resize(numPixels);
+  output.resize(numPixels);
+  for (uint32_t i = 0; i < numPixels; ++i) {
+    input[i] = (i * 2654435761u) & 0xFFFFFF;
+  }
+  LARGE_INTEGER freq;
+  LARGE_INTEGER startTime;
+  LARGE_INTEGER endTime;
+  QueryPerformanceFrequency(&freq);
+  bool success = true;
+  for (uint32_t isa = 0; isa < VortexColorConvert::ISA_COUNT; ++isa) {
+    if (!VortexColorConvert::setIsa((VortexColorConvert::Isa)isa)) {
+      continue;
+    }
+    double rates[2] = { 0, 0 };
+    for (uint32_t dir = 0; dir < 2; ++dir) {
+      uint32_t reps = 0;
+      double seconds = 0;
+      QueryPerformanceCounter(&startTime);
+      do {
+        if (dir == 0) {
+          VortexColorConvert::hsvToRgb(input.data(), output.data(), numPixels);
+        } else {
+          VortexColorConvert::rgbToHsv(input.data(), output.data(), numPixels);
+        }
+        reps++;
+        QueryPerformanceCounter(&endTime);
+        seconds = (double)(endTime.QuadPart - startTime.QuadPart) / (double)freq.QuadPart;
+      } while (seconds < BENCH_COLOR_MIN_SEC);
+      rates[dir] = ((double)reps * numPixels) / seconds;
+    }
+    print("  %-6s hsv->rgb %8.1f Mpx/s  rgb->hsv %8.1f Mpx/s  %s%s",
+      VortexColorConvert::isaName((VortexColorConvert::Isa)isa), rates[0] / 1e6, rates[1] / 1e6,
+      mismatches[isa] ? "MISMATCH" : "exact", (isa == (uint32_t)bestIsa) ? " (in use)" : "");
+    if (mismatches[isa]) {
+      success = false;
+    }
+  }
+  VortexColorConvert::setIsa(bestIsa);
+  return success;
+}
+
+void VortexCLI::print(const char *msg, ...)
+{
+  va_list list;
+  va_start(list, msg);
+  vprintf(msg, list);
+  va_end(list);
+  printf("\n");
+  fflush(stdout);
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+class VortexBatchEdit;
+class Vortex;
+
+// Command line interface for tasks that don't need the editor window:
+//
+//   VortexEditor.exe --pack <directory> <library.vtxlib>
+//   VortexEditor.exe --unpack <library.vtxlib> <directory>
+//   VortexEditor.exe --search <library.vtxlib> <query>
+//   VortexEditor.exe --batch <in.vortex> <out.vortex> <edit> [<edit> ...]
+//   VortexEditor.exe --bench-hash [count]
+//   VortexEditor.exe --bench-search [modes]
+//   VortexEditor.exe --bench-batch [modes] [leds]
+//   VortexEditor.exe --verify-batch
+//   VortexEditor.exe --verify-timeline <in.vortex> [ticks]
+//   VortexEditor.exe --render <in.vortex> <out.vtxrender> [ticks]
+//   VortexEditor.exe --bench-render [modes] [ticks]
+//   VortexEditor.exe --bench-color [pixels]
+//
+// The edits of a batch are applied in order to the selected modes and leds:
+//
+//   modes=<list>        the modes to edit, ie 0,2,5-9 (default all)
+//   leds=<list>         the leds to edit, 'multi' for the multi led pattern
+//   colorset=<colors>   set the colorset, ie ff0000,00ff00,0000ff
+//   pattern=<name|id>   set the pattern, spaces in the name as underscores
+//   param<n>=<value>    set a single pattern param
+//   hue=<amount>        rotate the hue of every color, a full turn is 256
+//
+class VortexCLI
+{
+public:
+  // run the command line if any command was given, returns false if there
+  // was no command and the editor should be opened as normal
+  static bool run(int argc, char *argv[], int &exitCode);
+
+  // parse a single edit argument into a batch, the automation server takes
+  // the same edits
+  static bool parseEdit(Vortex &vortex, const std::string &edit, VortexBatchEdit &batch);
+
+private:
+  // pack all of the .vtxmode files in a directory into a library
+  static bool pack(const std::string &directory, const std::string &libraryFile);
+  // unpack all of the modes in a library into .vtxmode files
+  static bool unpack(const std::string &libraryFile, const std::string &directory);
+  // search the modes of a library, see VortexModeIndex for the query syntax
+  static bool search(const std::string &libraryFile, const std::string &query);
+  // apply a batch of edits to the modes of a savefile
+  static bool batch(const std::string &inFile, const std::string &outFile,
+    const std::vector<std::string> &edits);
+  // measure the throughput of the mode content hash
+  static bool benchHash(uint32_t count);
+  // measure queries against an index of random mode summaries
+  static bool benchSearch(uint32_t numModes);
+  // measure recoloring every led of every mode with and without a batch
+  static bool benchBatch(uint32_t numModes, uint32_t numLeds);
+  // check the pattern args batch edits leave behind
+  static bool verifyBatch();
+  // check the looped preview timeline of every mode against the engine
+  static bool verifyTimeline(const std::string &inFile, uint32_t numTicks);
+  // render every led of every mode of a savefile to a file
+  static bool render(const std::string &inFile, const std::string &outFile, uint32_t numTicks);
+  // measure modes rendered per second with more and more workers
+  static bool benchRender(uint32_t numModes, uint32_t numTicks);
+  // check every version of the color conversions against the engine for
+  // every color, then time each of them
+  static bool benchColor(uint32_t numPixels);
+
+  // print to the console the editor was launched from
+  static void print(const char *msg, ...);
+};
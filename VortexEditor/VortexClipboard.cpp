@@ -0,0 +1,238 @@
+#include "VortexClipboard.h"
+
+// VortexEngine includes
+#include "Serial/ByteStream.h"
+
+#include <string.h>
+
+// 'VCLP'
+#define CLIPBOARD_MAGIC   0x504C4356
+#define CLIPBOARD_VERSION 1
+
+// the name the binary format is registered with
+#define CLIPBOARD_FORMAT_NAME "VortexEditor.Payload"
+
+using namespace std;
+
+UINT VortexClipboard::format()
+{
+  static UINT clipFormat = RegisterClipboardFormat(CLIPBOARD_FORMAT_NAME);
+  return clipFormat;
+}
+
+VortexClipboard::Writer::Writer(PayloadType type) :
+  m_buffer(sizeof(Header), 0)
+{
+  Header *header = (Header *)m_buffer.data();
+  header->magic = CLIPBOARD_MAGIC;
+  header->version = CLIPBOARD_VERSION;
+  header->type = type;
+  header->count = 0;
+  header->length = 0;
+}
+
+void VortexClipboard::Writer::addColorset(const ColorsetData &colorset)
+{
+  const uint8_t *data = (const uint8_t *)&colorset;
+  m_buffer.insert(m_buffer.end(), data, data + sizeof(colorset));
+  Header *header = (Header *)m_buffer.data();
+  header->count++;
+  header->length += sizeof(colorset);
+}
+
+void VortexClipboard::Writer::addLed(const LedData &led)
+{
+  const uint8_t *data = (const uint8_t *)&led;
+  m_buffer.insert(m_buffer.end(), data, data + sizeof(led));
+  Header *header = (Header *)m_buffer.data();
+  header->count++;
+  header->length += sizeof(led);
+}
+
+void VortexClipboard::Writer::addMode(const ByteStream &mode)
+{
+  uint32_t size = mode.rawSize();
+  const uint8_t *sizeData = (const uint8_t *)&size;
+  const uint8_t *data = (const uint8_t *)mode.rawData();
+  m_buffer.insert(m_buffer.end(), sizeData, sizeData + sizeof(size));
+  m_buffer.insert(m_buffer.end(), data, data + size);
+  Header *header = (Header *)m_buffer.data();
+  header->count++;
+  header->length += sizeof(size) + size;
+}
+
+VortexClipboard::Reader::Reader() :
+  m_hData(nullptr),
+  m_clipboardOpen(false),
+  m_pData(nullptr),
+  m_size(0),
+  m_type(PAYLOAD_COLORSET),
+  m_count(0),
+  m_pos(0)
+{
+}
+
+VortexClipboard::Reader::~Reader()
+{
+  close();
+}
+
+bool VortexClipboard::Reader::open(HWND owner)
+{
+  close();
+  if (!IsClipboardFormatAvailable(format()) || !OpenClipboard(owner)) {
+    return false;
+  }
+  m_clipboardOpen = true;
+  m_hData = GetClipboardData(format());
+  if (!m_hData) {
+    close();
+    return false;
+  }
+  const void *data = GlobalLock(m_hData);
+  if (!data) {
+    close();
+    return false;
+  }
+  if (!parse(data, GlobalSize(m_hData))) {
+    GlobalUnlock(m_hData);
+    close();
+    return false;
+  }
+  return true;
+}
+
+void VortexClipboard::Reader::close()
+{
+  if (m_hData && m_pData) {
+    GlobalUnlock(m_hData);
+  }
+  m_hData = nullptr;
+  if (m_clipboardOpen) {
+    CloseClipboard();
+    m_clipboardOpen = false;
+  }
+  m_pData = nullptr;
+  m_size = 0;
+  m_count = 0;
+  m_pos = 0;
+}
+
+bool VortexClipboard::Reader::parse(const void *data, size_t size)
+{
+  if (!data || size < sizeof(Header)) {
+    return false;
+  }
+  const Header *header = (const Header *)data;
+  if (header->magic != CLIPBOARD_MAGIC || header->version != CLIPBOARD_VERSION ||
+      header->length > size - sizeof(Header)) {
+    return false;
+  }
+  // the fixed size records must exactly fill the payload
+  switch (header->type) {
+  case PAYLOAD_COLORSET:
+    if ((uint64_t)header->count * sizeof(ColorsetData) != header->length) {
+      return false;
+    }
+    break;
+  case PAYLOAD_LEDS:
+    if ((uint64_t)header->count * sizeof(LedData) != header->length) {
+      return false;
+    }
+    break;
+  case PAYLOAD_MODES:
+    // each mode is checked as it's walked
+    break;
+  default:
+    return false;
+  }
+  m_pData = (const uint8_t *)data;
+  // GlobalSize may be rounded up so only trust the length in the header
+  m_size = sizeof(Header) + header->length;
+  m_type = (PayloadType)header->type;
+  m_count = header->count;
+  m_pos = sizeof(Header);
+  return true;
+}
+
+const VortexClipboard::ColorsetData *VortexClipboard::Reader::colorset(uint32_t index) const
+{
+  if (!m_pData || index >= m_count) {
+    return nullptr;
+  }
+  if (m_type == PAYLOAD_LEDS) {
+    // the colorset of an led can be pasted on it's own
+    return &led(index)->colorset;
+  }
+  if (m_type != PAYLOAD_COLORSET) {
+    return nullptr;
+  }
+  return (const ColorsetData *)(m_pData + sizeof(Header)) + index;
+}
+
+const VortexClipboard::LedData *VortexClipboard::Reader::led(uint32_t index) const
+{
+  if (!m_pData || m_type != PAYLOAD_LEDS || index >= m_count) {
+    return nullptr;
+  }
+  return (const LedData *)(m_pData + sizeof(Header)) + index;
+}
+
+bool VortexClipboard::Reader::nextMode(const uint8_t *&outData, uint32_t &outSize)
+{
+  if (!m_pData || m_type != PAYLOAD_MODES || m_size - m_pos < sizeof(uint32_t)) {
+    return false;
+  }
+  uint32_t size = 0;
+  memcpy(&size, m_pData + m_pos, sizeof(size));
+  if (size > m_size - m_pos - sizeof(size)) {
+    return false;
+  }
+  outData = m_pData + m_pos + sizeof(size);
+  outSize = size;
+  m_pos += sizeof(size) + size;
+  return true;
+}
+
+bool VortexClipboard::set(HWND owner, const Writer &payload, const string &text)
+{
+  const vector<uint8_t> &buffer = payload.buffer();
+  HGLOBAL hPayload = GlobalAlloc(GMEM_MOVEABLE, buffer.size());
+  if (!hPayload) {
+    return false;
+  }
+  void *payloadData = GlobalLock(hPayload);
+  if (!payloadData) {
+    GlobalFree(hPayload);
+    return false;
+  }
+  memcpy(payloadData, buffer.data(), buffer.size());
+  GlobalUnlock(hPayload);
+  // there isn't a text format for everything
+  HGLOBAL hText = nullptr;
+  if (text.length()) {
+    hText = GlobalAlloc(GMEM_MOVEABLE, text.length() + 1);
+    void *textData = hText ? GlobalLock(hText) : nullptr;
+    if (textData) {
+      memcpy(textData, text.c_str(), text.length() + 1);
+      GlobalUnlock(hText);
+    }
+  }
+  if (!OpenClipboard(owner)) {
+    GlobalFree(hPayload);
+    if (hText) {
+      GlobalFree(hText);
+    }
+    return false;
+  }
+  EmptyClipboard();
+  // the clipboard owns the memory once it's set
+  if (!SetClipboardData(format(), hPayload)) {
+    GlobalFree(hPayload);
+  }
+  if (hText && !SetClipboardData(CF_TEXT, hText)) {
+    GlobalFree(hText);
+  }
+  CloseClipboard();
+  return true;
+}
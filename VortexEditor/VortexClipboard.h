@@ -0,0 +1,122 @@
+#pragma once
+
+// windows includes
+#include <windows.h>
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+class ByteStream;
+
+// the most colors and pattern args carried for each led
+#define CLIPBOARD_MAX_COLORS 8
+#define CLIPBOARD_MAX_ARGS 8
+
+// The editor places a binary payload on the clipboard in a registered
+// format alongside the older text format, the binary payload can carry
+// a colorset, any number of leds with their full pattern args, or any
+// number of whole modes. The text format is still written for pasting
+// into older editors and still read when there's no binary payload.
+//
+// The payload is a header followed by a fixed size record for each
+// colorset or led, or a length prefixed ByteStream for each mode. The
+// reader parses it directly out of the locked clipboard memory without
+// copying or allocating anything.
+class VortexClipboard
+{
+public:
+  enum PayloadType : uint16_t
+  {
+    PAYLOAD_COLORSET,
+    PAYLOAD_LEDS,
+    PAYLOAD_MODES,
+  };
+
+  // a colorset record
+  struct ColorsetData
+  {
+    uint8_t numColors;
+    uint8_t reserved[3];
+    uint32_t colors[CLIPBOARD_MAX_COLORS];
+  };
+
+  // an led record, the position is where it was copied from
+  struct LedData
+  {
+    uint8_t pos;
+    uint8_t patternID;
+    uint8_t reserved[2];
+    uint8_t args[CLIPBOARD_MAX_ARGS];
+    ColorsetData colorset;
+  };
+
+  // builds a payload to place on the clipboard
+  class Writer
+  {
+  public:
+    Writer(PayloadType type);
+
+    void addColorset(const ColorsetData &colorset);
+    void addLed(const LedData &led);
+    void addMode(const ByteStream &mode);
+
+    const std::vector<uint8_t> &buffer() const { return m_buffer; }
+
+  private:
+    std::vector<uint8_t> m_buffer;
+  };
+
+  // reads a payload in place from the clipboard, the clipboard is held
+  // open until the reader is closed or destroyed
+  class Reader
+  {
+  public:
+    Reader();
+    ~Reader();
+
+    // open the clipboard and parse the payload, fails if there is no
+    // binary payload on the clipboard or it is damaged
+    bool open(HWND owner);
+    void close();
+
+    // parse a payload that is already in memory
+    bool parse(const void *data, size_t size);
+
+    PayloadType type() const { return m_type; }
+    uint32_t count() const { return m_count; }
+
+    // records of colorset and led payloads
+    const ColorsetData *colorset(uint32_t index) const;
+    const LedData *led(uint32_t index) const;
+    // walk the modes of a mode payload, returns false after the last one
+    bool nextMode(const uint8_t *&outData, uint32_t &outSize);
+
+  private:
+    HANDLE m_hData;
+    bool m_clipboardOpen;
+    const uint8_t *m_pData;
+    size_t m_size;
+    PayloadType m_type;
+    uint32_t m_count;
+    // the cursor for walking modes
+    size_t m_pos;
+  };
+
+  // place a payload and it's text fallback on the clipboard
+  static bool set(HWND owner, const Writer &payload, const std::string &text);
+
+  // the registered clipboard format
+  static UINT format();
+
+private:
+  // the header at the front of every payload
+  struct Header
+  {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t type;
+    uint32_t count;
+    uint32_t length;
+  };
+};
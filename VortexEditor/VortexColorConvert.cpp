@@ -0,0 +1,604 @@
+#include "VortexColorConvert.h"
+
+// the vector versions that can be built for this cpu, the avx2 functions
+// are built for avx2 on their own and only called if the cpu has it
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CONVERT_X86
+#include <emmintrin.h>
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define CONVERT_TARGET_SSE2
+#define CONVERT_TARGET_AVX2
+#else
+#include <cpuid.h>
+#define CONVERT_TARGET_SSE2 __attribute__((target("sse2")))
+#define CONVERT_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#define CONVERT_NEON
+#include <arm_neon.h>
+#endif
+
+// the hue is split into six regions of 43 steps
+#define HUE_REGION_SIZE 43
+// the region of a hue is (hue * this) >> 16, the same as dividing by 43
+// for every hue from 0 to 255
+#define HUE_REGION_RECIP 1525
+// the start of the green and blue hue regions for rgb to hsv
+#define HUE_GREEN 85
+#define HUE_BLUE 171
+
+VortexColorConvert::Isa VortexColorConvert::m_isa = VortexColorConvert::bestIsa();
+
+// the generic algorithms of the engine one color at a time, every vector
+// version has to give the same result as these
+static uint32_t hsvToRgbScalar(uint32_t hsv)
+{
+  uint32_t hue = (hsv >> 16) & 0xFF;
+  uint32_t sat = (hsv >> 8) & 0xFF;
+  uint32_t val = hsv & 0xFF;
+  if (!sat) {
+    return (val << 16) | (val << 8) | val;
+  }
+  uint32_t region = hue / HUE_REGION_SIZE;
+  uint32_t remainder = (hue - (region * HUE_REGION_SIZE)) * 6;
+  uint32_t p = (val * (255 - sat)) >> 8;
+  uint32_t q = (val * (255 - ((sat * remainder) >> 8))) >> 8;
+  uint32_t t = (val * (255 - ((sat * (255 - remainder)) >> 8))) >> 8;
+  switch (region) {
+  case 0: return (val << 16) | (t << 8) | p;
+  case 1: return (q << 16) | (val << 8) | p;
+  case 2: return (p << 16) | (val << 8) | t;
+  case 3: return (p << 16) | (q << 8) | val;
+  case 4: return (t << 16) | (p << 8) | val;
+  default: return (val << 16) | (p << 8) | q;
+  }
+}
+
+static uint32_t rgbToHsvScalar(uint32_t rgb)
+{
+  int32_t red = (rgb >> 16) & 0xFF;
+  int32_t green = (rgb >> 8) & 0xFF;
+  int32_t blue = rgb & 0xFF;
+  int32_t rgbMin = red < green ? (red < blue ? red : blue) : (green < blue ? green : blue);
+  int32_t rgbMax = red > green ? (red > blue ? red : blue) : (green > blue ? green : blue);
+  int32_t delta = rgbMax - rgbMin;
+  if (!delta) {
+    // no saturation, or no value at all
+    return (uint32_t)rgbMax;
+  }
+  uint32_t sat = (uint32_t)((255 * delta) / rgbMax);
+  int32_t hue;
+  if (rgbMax == red) {
+    hue = 0 + (43 * (green - blue)) / delta;
+  } else if (rgbMax == green) {
+    hue = HUE_GREEN + (43 * (blue - red)) / delta;
+  } else {
+    hue = HUE_BLUE + (43 * (red - green)) / delta;
+  }
+  return (((uint32_t)hue & 0xFF) << 16) | (sat << 8) | (uint32_t)rgbMax;
+}
+
+#ifdef CONVERT_X86
+// pick a where the mask is set and b everywhere else
+static inline CONVERT_TARGET_SSE2 __m128i select128(__m128i mask, __m128i a, __m128i b)
+{
+  return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+// pack 8 rgb colors out of 16 bit channels
+static inline CONVERT_TARGET_SSE2 void store128(uint32_t *out, __m128i x, __m128i y, __m128i z)
+{
+  __m128i zero = _mm_setzero_si128();
+  __m128i lo = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(_mm_unpacklo_epi16(x, zero), 16),
+    _mm_slli_epi32(_mm_unpacklo_epi16(y, zero), 8)), _mm_unpacklo_epi16(z, zero));
+  __m128i hi = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(_mm_unpackhi_epi16(x, zero), 16),
+    _mm_slli_epi32(_mm_unpackhi_epi16(y, zero), 8)), _mm_unpackhi_epi16(z, zero));
+  _mm_storeu_si128((__m128i *)out, lo);
+  _mm_storeu_si128((__m128i *)(out + 4), hi);
+}
+
+// 8 colors at a time in 16 bit lanes, all of the math of the generic
+// algorithm fits in 16 bits so it's the same as the scalar version
+static CONVERT_TARGET_SSE2 uint32_t hsvToRgbSSE2(const uint32_t *hsv, uint32_t *outRgb, uint32_t count)
+{
+  const __m128i byteMask = _mm_set1_epi32(0xFF);
+  const __m128i c255 = _mm_set1_epi16(255);
+  const __m128i zero = _mm_setzero_si128();
+  uint32_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m128i a = _mm_loadu_si128((const __m128i *)(hsv + i));
+    __m128i b = _mm_loadu_si128((const __m128i *)(hsv + i + 4));
+    __m128i hue = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(a, 16), byteMask),
+      _mm_and_si128(_mm_srli_epi32(b, 16), byteMask));
+    __m128i sat = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(a, 8), byteMask),
+      _mm_and_si128(_mm_srli_epi32(b, 8), byteMask));
+    __m128i val = _mm_packs_epi32(_mm_and_si128(a, byteMask), _mm_and_si128(b, byteMask));
+    __m128i region = _mm_mulhi_epu16(hue, _mm_set1_epi16(HUE_REGION_RECIP));
+    __m128i remainder = _mm_mullo_epi16(_mm_sub_epi16(hue,
+      _mm_mullo_epi16(region, _mm_set1_epi16(HUE_REGION_SIZE))), _mm_set1_epi16(6));
+    __m128i p = _mm_srli_epi16(_mm_mullo_epi16(val, _mm_sub_epi16(c255, sat)), 8);
+    __m128i q = _mm_srli_epi16(_mm_mullo_epi16(val, _mm_sub_epi16(c255,
+      _mm_srli_epi16(_mm_mullo_epi16(sat, remainder), 8))), 8);
+    __m128i t = _mm_srli_epi16(_mm_mullo_epi16(val, _mm_sub_epi16(c255,
+      _mm_srli_epi16(_mm_mullo_epi16(sat, _mm_sub_epi16(c255, remainder)), 8))), 8);
+    __m128i r0 = _mm_cmpeq_epi16(region, zero);
+    __m128i r1 = _mm_cmpeq_epi16(region, _mm_set1_epi16(1));
+    __m128i r2 = _mm_cmpeq_epi16(region, _mm_set1_epi16(2));
+    __m128i r3 = _mm_cmpeq_epi16(region, _mm_set1_epi16(3));
+    __m128i r4 = _mm_cmpeq_epi16(region, _mm_set1_epi16(4));
+    __m128i r5 = _mm_cmpeq_epi16(region, _mm_set1_epi16(5));
+    __m128i red = select128(_mm_or_si128(r0, r5), val, select128(r1, q,
+      select128(_mm_or_si128(r2, r3), p, t)));
+    __m128i green = select128(r0, t, select128(_mm_or_si128(r1, r2), val,
+      select128(r3, q, p)));
+    __m128i blue = select128(_mm_or_si128(r0, r1), p, select128(r2, t,
+      select128(_mm_or_si128(r3, r4), val, q)));
+    // no saturation is just grey
+    __m128i grey = _mm_cmpeq_epi16(sat, zero);
+    red = select128(grey, val, red);
+    green = select128(grey, val, green);
+    blue = select128(grey, val, blue);
+    store128(outRgb + i, red, green, blue);
+  }
+  return i;
+}
+
+// divide two halves of 16 bit lanes as floats and truncate, the quotients
+// are small enough that this is exactly the same as an integer divide
+static inline CONVERT_TARGET_SSE2 __m128i divide128(__m128i numLo, __m128i numHi, __m128i den)
+{
+  __m128i zero = _mm_setzero_si128();
+  __m128 denLo = _mm_cvtepi32_ps(_mm_unpacklo_epi16(den, zero));
+  __m128 denHi = _mm_cvtepi32_ps(_mm_unpackhi_epi16(den, zero));
+  __m128i lo = _mm_cvttps_epi32(_mm_div_ps(_mm_cvtepi32_ps(numLo), denLo));
+  __m128i hi = _mm_cvttps_epi32(_mm_div_ps(_mm_cvtepi32_ps(numHi), denHi));
+  return _mm_packs_epi32(lo, hi);
+}
+
+static CONVERT_TARGET_SSE2 uint32_t rgbToHsvSSE2(const uint32_t *rgb, uint32_t *outHsv, uint32_t count)
+{
+  const __m128i byteMask = _mm_set1_epi32(0xFF);
+  const __m128i zero = _mm_setzero_si128();
+  uint32_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m128i a = _mm_loadu_si128((const __m128i *)(rgb + i));
+    __m128i b = _mm_loadu_si128((const __m128i *)(rgb + i + 4));
+    __m128i red = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(a, 16), byteMask),
+      _mm_and_si128(_mm_srli_epi32(b, 16), byteMask));
+    __m128i green = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(a, 8), byteMask),
+      _mm_and_si128(_mm_srli_epi32(b, 8), byteMask));
+    __m128i blue = _mm_packs_epi32(_mm_and_si128(a, byteMask), _mm_and_si128(b, byteMask));
+    __m128i rgbMax = _mm_max_epi16(_mm_max_epi16(red, green), blue);
+    __m128i rgbMin = _mm_min_epi16(_mm_min_epi16(red, green), blue);
+    __m128i delta = _mm_sub_epi16(rgbMax, rgbMin);
+    // the saturation is 255 * delta / max, which only fits unsigned
+    __m128i satNum = _mm_mullo_epi16(delta, _mm_set1_epi16(255));
+    __m128i sat = divide128(_mm_unpacklo_epi16(satNum, zero), _mm_unpackhi_epi16(satNum, zero), rgbMax);
+    // the hue is measured from whichever channel is the max, red first
+    __m128i isRed = _mm_cmpeq_epi16(rgbMax, red);
+    __m128i isGreen = _mm_andnot_si128(isRed, _mm_cmpeq_epi16(rgbMax, green));
+    __m128i diff = select128(isRed, _mm_sub_epi16(green, blue),
+      select128(isGreen, _mm_sub_epi16(blue, red), _mm_sub_epi16(red, green)));
+    __m128i base = select128(isRed, zero, select128(isGreen,
+      _mm_set1_epi16(HUE_GREEN), _mm_set1_epi16(HUE_BLUE)));
+    __m128i hueNum = _mm_mullo_epi16(diff, _mm_set1_epi16(43));
+    // sign extend the signed numerators to 32 bits
+    __m128i hue = divide128(_mm_srai_epi32(_mm_unpacklo_epi16(hueNum, hueNum), 16),
+      _mm_srai_epi32(_mm_unpackhi_epi16(hueNum, hueNum), 16), delta);
+    hue = _mm_and_si128(_mm_add_epi16(base, hue), _mm_set1_epi16(0xFF));
+    // no saturation or no value has no hue either
+    __m128i flat = _mm_cmpeq_epi16(delta, zero);
+    hue = _mm_andnot_si128(flat, hue);
+    sat = _mm_andnot_si128(flat, sat);
+    store128(outHsv + i, hue, sat, rgbMax);
+  }
+  return i;
+}
+
+static inline CONVERT_TARGET_AVX2 __m256i select256(__m256i mask, __m256i a, __m256i b)
+{
+  return _mm256_blendv_epi8(b, a, mask);
+}
+
+// the 256 bit packs and unpacks work within each 128 bit half, packing and
+// then unpacking again puts every color back where it started
+static inline CONVERT_TARGET_AVX2 void store256(uint32_t *out, __m256i x, __m256i y, __m256i z)
+{
+  __m256i zero = _mm256_setzero_si256();
+  __m256i lo = _mm256_or_si256(_mm256_or_si256(_mm256_slli_epi32(_mm256_unpacklo_epi16(x, zero), 16),
+    _mm256_slli_epi32(_mm256_unpacklo_epi16(y, zero), 8)), _mm256_unpacklo_epi16(z, zero));
+  __m256i hi = _mm256_or_si256(_mm256_or_si256(_mm256_slli_epi32(_mm256_unpackhi_epi16(x, zero), 16),
+    _mm256_slli_epi32(_mm256_unpackhi_epi16(y, zero), 8)), _mm256_unpackhi_epi16(z, zero));
+  _mm256_storeu_si256((__m256i *)out, lo);
+  _mm256_storeu_si256((__m256i *)(out + 8), hi);
+}
+
+static CONVERT_TARGET_AVX2 uint32_t hsvToRgbAVX2(const uint32_t *hsv, uint32_t *outRgb, uint32_t count)
+{
+  const __m256i byteMask = _mm256_set1_epi32(0xFF);
+  const __m256i c255 = _mm256_set1_epi16(255);
+  const __m256i zero = _mm256_setzero_si256();
+  uint32_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m256i a = _mm256_loadu_si256((const __m256i *)(hsv + i));
+    __m256i b = _mm256_loadu_si256((const __m256i *)(hsv + i + 8));
+    __m256i hue = _mm256_packs_epi32(_mm256_and_si256(_mm256_srli_epi32(a, 16), byteMask),
+      _mm256_and_si256(_mm256_srli_epi32(b, 16), byteMask));
+    __m256i sat = _mm256_packs_epi32(_mm256_and_si256(_mm256_srli_epi32(a, 8), byteMask),
+      _mm256_and_si256(_mm256_srli_epi32(b, 8), byteMask));
+    __m256i val = _mm256_packs_epi32(_mm256_and_si256(a, byteMask), _mm256_and_si256(b, byteMask));
+    __m256i region = _mm256_mulhi_epu16(hue, _mm256_set1_epi16(HUE_REGION_RECIP));
+    __m256i remainder = _mm256_mullo_epi16(_mm256_sub_epi16(hue,
+      _mm256_mullo_epi16(region, _mm256_set1_epi16(HUE_REGION_SIZE))), _mm256_set1_epi16(6));
+    __m256i p = _mm256_srli_epi16(_mm256_mullo_epi16(val, _mm256_sub_epi16(c255, sat)), 8);
+    __m256i q = _mm256_srli_epi16(_mm256_mullo_epi16(val, _mm256_sub_epi16(c255,
+      _mm256_srli_epi16(_mm256_mullo_epi16(sat, remainder), 8))), 8);
+    __m256i t = _mm256_srli_epi16(_mm256_mullo_epi16(val, _mm256_sub_epi16(c255,
+      _mm256_srli_epi16(_mm256_mullo_epi16(sat, _mm256_sub_epi16(c255, remainder)), 8))), 8);
+    __m256i r0 = _mm256_cmpeq_epi16(region, zero);
+    __m256i r1 = _mm256_cmpeq_epi16(region, _mm256_set1_epi16(1));
+    __m256i r2 = _mm256_cmpeq_epi16(region, _mm256_set1_epi16(2));
+    __m256i r3 = _mm256_cmpeq_epi16(region, _mm256_set1_epi16(3));
+    __m256i r4 = _mm256_cmpeq_epi16(region, _mm256_set1_epi16(4));
+    __m256i r5 = _mm256_cmpeq_epi16(region, _mm256_set1_epi16(5));
+    __m256i red = select256(_mm256_or_si256(r0, r5), val, select256(r1, q,
+      select256(_mm256_or_si256(r2, r3), p, t)));
+    __m256i green = select256(r0, t, select256(_mm256_or_si256(r1, r2), val,
+      select256(r3, q, p)));
+    __m256i blue = select256(_mm256_or_si256(r0, r1), p, select256(r2, t,
+      select256(_mm256_or_si256(r3, r4), val, q)));
+    __m256i grey = _mm256_cmpeq_epi16(sat, zero);
+    red = select256(grey, val, red);
+    green = select256(grey, val, green);
+    blue = select256(grey, val, blue);
+    store256(outRgb + i, red, green, blue);
+  }
+  return i;
+}
+
+static inline CONVERT_TARGET_AVX2 __m256i divide256(__m256i numLo, __m256i numHi, __m256i den)
+{
+  __m256i zero = _mm256_setzero_si256();
+  __m256 denLo = _mm256_cvtepi32_ps(_mm256_unpacklo_epi16(den, zero));
+  __m256 denHi = _mm256_cvtepi32_ps(_mm256_unpackhi_epi16(den, zero));
+  __m256i lo = _mm256_cvttps_epi32(_mm256_div_ps(_mm256_cvtepi32_ps(numLo), denLo));
+  __m256i hi = _mm256_cvttps_epi32(_mm256_div_ps(_mm256_cvtepi32_ps(numHi), denHi));
+  return _mm256_packs_epi32(lo, hi);
+}
+
+static CONVERT_TARGET_AVX2 uint32_t rgbToHsvAVX2(const uint32_t *rgb, uint32_t *outHsv, uint32_t count)
+{
+  const __m256i byteMask = _mm256_set1_epi32(0xFF);
+  const __m256i zero = _mm256_setzero_si256();
+  uint32_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m256i a = _mm256_loadu_si256((const __m256i *)(rgb + i));
+    __m256i b = _mm256_loadu_si256((const __m256i *)(rgb + i + 8));
+    __m256i red = _mm256_packs_epi32(_mm256_and_si256(_mm256_srli_epi32(a, 16), byteMask),
+      _mm256_and_si256(_mm256_srli_epi32(b, 16), byteMask));
+    __m256i green = _mm256_packs_epi32(_mm256_and_si256(_mm256_srli_epi32(a, 8), byteMask),
+      _mm256_and_si256(_mm256_srli_epi32(b, 8), byteMask));
+    __m256i blue = _mm256_packs_epi32(_mm256_and_si256(a, byteMask), _mm256_and_si256(b, byteMask));
+    __m256i rgbMax = _mm256_max_epi16(_mm256_max_epi16(red, green), blue);
+    __m256i rgbMin = _mm256_min_epi16(_mm256_min_epi16(red, green), blue);
+    __m256i delta = _mm256_sub_epi16(rgbMax, rgbMin);
+    __m256i satNum = _mm256_mullo_epi16(delta, _mm256_set1_epi16(255));
+    __m256i sat = divide256(_mm256_unpacklo_epi16(satNum, zero),
+      _mm256_unpackhi_epi16(satNum, zero), rgbMax);
+    __m256i isRed = _mm256_cmpeq_epi16(rgbMax, red);
+    __m256i isGreen = _mm256_andnot_si256(isRed, _mm256_cmpeq_epi16(rgbMax, green));
+    __m256i diff = select256(isRed, _mm256_sub_epi16(green, blue),
+      select256(isGreen, _mm256_sub_epi16(blue, red), _mm256_sub_epi16(red, green)));
+    __m256i base = select256(isRed, zero, select256(isGreen,
+      _mm256_set1_epi16(HUE_GREEN), _mm256_set1_epi16(HUE_BLUE)));
+    __m256i hueNum = _mm256_mullo_epi16(diff, _mm256_set1_epi16(43));
+    __m256i hue = divide256(_mm256_srai_epi32(_mm256_unpacklo_epi16(hueNum, hueNum), 16),
+      _mm256_srai_epi32(_mm256_unpackhi_epi16(hueNum, hueNum), 16), delta);
+    hue = _mm256_and_si256(_mm256_add_epi16(base, hue), _mm256_set1_epi16(0xFF));
+    __m256i flat = _mm256_cmpeq_epi16(delta, zero);
+    hue = _mm256_andnot_si256(flat, hue);
+    sat = _mm256_andnot_si256(flat, sat);
+    store256(outHsv + i, hue, sat, rgbMax);
+  }
+  return i;
+}
+#endif
+
+#ifdef CONVERT_NEON
+// pack 8 colors out of 16 bit channels
+static inline void storeNEON(uint32_t *out, uint16x8_t x, uint16x8_t y, uint16x8_t z)
+{
+  uint32x4_t lo = vorrq_u32(vorrq_u32(vshlq_n_u32(vmovl_u16(vget_low_u16(x)), 16),
+    vshlq_n_u32(vmovl_u16(vget_low_u16(y)), 8)), vmovl_u16(vget_low_u16(z)));
+  uint32x4_t hi = vorrq_u32(vorrq_u32(vshlq_n_u32(vmovl_u16(vget_high_u16(x)), 16),
+    vshlq_n_u32(vmovl_u16(vget_high_u16(y)), 8)), vmovl_u16(vget_high_u16(z)));
+  vst1q_u32(out, lo);
+  vst1q_u32(out + 4, hi);
+}
+
+// pull one channel of 8 colors out into 16 bit lanes
+static inline uint16x8_t channelNEON(uint32x4_t a, uint32x4_t b, int shift)
+{
+  uint32x4_t byteMask = vdupq_n_u32(0xFF);
+  int32x4_t shiftBy = vdupq_n_s32(-shift);
+  return vcombine_u16(vmovn_u32(vandq_u32(vshlq_u32(a, shiftBy), byteMask)),
+    vmovn_u32(vandq_u32(vshlq_u32(b, shiftBy), byteMask)));
+}
+
+static uint32_t hsvToRgbNEON(const uint32_t *hsv, uint32_t *outRgb, uint32_t count)
+{
+  const uint16x8_t c255 = vdupq_n_u16(255);
+  uint32_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    uint32x4_t a = vld1q_u32(hsv + i);
+    uint32x4_t b = vld1q_u32(hsv + i + 4);
+    uint16x8_t hue = channelNEON(a, b, 16);
+    uint16x8_t sat = channelNEON(a, b, 8);
+    uint16x8_t val = channelNEON(a, b, 0);
+    uint16x4_t recip = vdup_n_u16(HUE_REGION_RECIP);
+    uint16x8_t region = vcombine_u16(vshrn_n_u32(vmull_u16(vget_low_u16(hue), recip), 16),
+      vshrn_n_u32(vmull_u16(vget_high_u16(hue), recip), 16));
+    uint16x8_t remainder = vmulq_u16(vsubq_u16(hue, vmulq_u16(region,
+      vdupq_n_u16(HUE_REGION_SIZE))), vdupq_n_u16(6));
+    uint16x8_t p = vshrq_n_u16(vmulq_u16(val, vsubq_u16(c255, sat)), 8);
+    uint16x8_t q = vshrq_n_u16(vmulq_u16(val, vsubq_u16(c255,
+      vshrq_n_u16(vmulq_u16(sat, remainder), 8))), 8);
+    uint16x8_t t = vshrq_n_u16(vmulq_u16(val, vsubq_u16(c255,
+      vshrq_n_u16(vmulq_u16(sat, vsubq_u16(c255, remainder)), 8))), 8);
+    uint16x8_t r0 = vceqq_u16(region, vdupq_n_u16(0));
+    uint16x8_t r1 = vceqq_u16(region, vdupq_n_u16(1));
+    uint16x8_t r2 = vceqq_u16(region, vdupq_n_u16(2));
+    uint16x8_t r3 = vceqq_u16(region, vdupq_n_u16(3));
+    uint16x8_t r4 = vceqq_u16(region, vdupq_n_u16(4));
+    uint16x8_t r5 = vceqq_u16(region, vdupq_n_u16(5));
+    uint16x8_t red = vbslq_u16(vorrq_u16(r0, r5), val, vbslq_u16(r1, q,
+      vbslq_u16(vorrq_u16(r2, r3), p, t)));
+    uint16x8_t green = vbslq_u16(r0, t, vbslq_u16(vorrq_u16(r1, r2), val,
+      vbslq_u16(r3, q, p)));
+    uint16x8_t blue = vbslq_u16(vorrq_u16(r0, r1), p, vbslq_u16(r2, t,
+      vbslq_u16(vorrq_u16(r3, r4), val, q)));
+    uint16x8_t grey = vceqq_u16(sat, vdupq_n_u16(0));
+    red = vbslq_u16(grey, val, red);
+    green = vbslq_u16(grey, val, green);
+    blue = vbslq_u16(grey, val, blue);
+    storeNEON(outRgb + i, red, green, blue);
+  }
+  return i;
+}
+
+// divide as floats and truncate, exactly the same as an integer divide for
+// numerators this small
+static inline uint16x8_t divideNEON(int32x4_t numLo, int32x4_t numHi, uint16x8_t den)
+{
+  float32x4_t denLo = vcvtq_f32_u32(vmovl_u16(vget_low_u16(den)));
+  float32x4_t denHi = vcvtq_f32_u32(vmovl_u16(vget_high_u16(den)));
+  int32x4_t lo = vcvtq_s32_f32(vdivq_f32(vcvtq_f32_s32(numLo), denLo));
+  int32x4_t hi = vcvtq_s32_f32(vdivq_f32(vcvtq_f32_s32(numHi), denHi));
+  return vreinterpretq_u16_s16(vcombine_s16(vmovn_s32(lo), vmovn_s32(hi)));
+}
+
+static uint32_t rgbToHsvNEON(const uint32_t *rgb, uint32_t *outHsv, uint32_t count)
+{
+  uint32_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    uint32x4_t a = vld1q_u32(rgb + i);
+    uint32x4_t b = vld1q_u32(rgb + i + 4);
+    uint16x8_t red = channelNEON(a, b, 16);
+    uint16x8_t green = channelNEON(a, b, 8);
+    uint16x8_t blue = channelNEON(a, b, 0);
+    uint16x8_t rgbMax = vmaxq_u16(vmaxq_u16(red, green), blue);
+    uint16x8_t rgbMin = vminq_u16(vminq_u16(red, green), blue);
+    uint16x8_t delta = vsubq_u16(rgbMax, rgbMin);
+    uint16x8_t satNum = vmulq_u16(delta, vdupq_n_u16(255));
+    uint16x8_t sat = divideNEON(vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(satNum))),
+      vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(satNum))), rgbMax);
+    uint16x8_t isRed = vceqq_u16(rgbMax, red);
+    uint16x8_t isGreen = vbicq_u16(vceqq_u16(rgbMax, green), isRed);
+    uint16x8_t diff = vbslq_u16(isRed, vsubq_u16(green, blue),
+      vbslq_u16(isGreen, vsubq_u16(blue, red), vsubq_u16(red, green)));
+    uint16x8_t base = vbslq_u16(isRed, vdupq_n_u16(0), vbslq_u16(isGreen,
+      vdupq_n_u16(HUE_GREEN), vdupq_n_u16(HUE_BLUE)));
+    int16x8_t hueNum = vmulq_s16(vreinterpretq_s16_u16(diff), vdupq_n_s16(43));
+    uint16x8_t hue = divideNEON(vmovl_s16(vget_low_s16(hueNum)),
+      vmovl_s16(vget_high_s16(hueNum)), delta);
+    hue = vandq_u16(vaddq_u16(base, hue), vdupq_n_u16(0xFF));
+    uint16x8_t flat = vceqq_u16(delta, vdupq_n_u16(0));
+    hue = vbicq_u16(hue, flat);
+    sat = vbicq_u16(sat, flat);
+    storeNEON(outHsv + i, hue, sat, rgbMax);
+  }
+  return i;
+}
+#endif
+
+void VortexColorConvert::hsvToRgb(const uint32_t *hsv, uint32_t *outRgb, uint32_t count)
+{
+  // the vector versions do as many whole vectors as they can and the rest
+  // are done one at a time
+  uint32_t done = 0;
+  switch (m_isa) {
+#ifdef CONVERT_X86
+  case ISA_SSE2:
+    done = hsvToRgbSSE2(hsv, outRgb, count);
+    break;
+  case ISA_AVX2:
+    done = hsvToRgbAVX2(hsv, outRgb, count);
+    break;
+#endif
+#ifdef CONVERT_NEON
+  case ISA_NEON:
+    done = hsvToRgbNEON(hsv, outRgb, count);
+    break;
+#endif
+  default:
+    break;
+  }
+  for (uint32_t i = done; i < count; ++i) {
+    outRgb[i] = hsvToRgbScalar(hsv[i]);
+  }
+}
+
+void VortexColorConvert::rgbToHsv(const uint32_t *rgb, uint32_t *outHsv, uint32_t count)
+{
+  uint32_t done = 0;
+  switch (m_isa) {
+#ifdef CONVERT_X86
+  case ISA_SSE2:
+    done = rgbToHsvSSE2(rgb, outHsv, count);
+    break;
+  case ISA_AVX2:
+    done = rgbToHsvAVX2(rgb, outHsv, count);
+    break;
+#endif
+#ifdef CONVERT_NEON
+  case ISA_NEON:
+    done = rgbToHsvNEON(rgb, outHsv, count);
+    break;
+#endif
+  default:
+    break;
+  }
+  for (uint32_t i = done; i < count; ++i) {
+    outHsv[i] = rgbToHsvScalar(rgb[i]);
+  }
+}
+
+void VortexColorConvert::svPlane(uint8_t hue, uint32_t *pixels, uint32_t stride)
+{
+  // within a plane the hue region and the remainder never change, so the
+  // part of the conversion that only depends on the saturation is worked
+  // out once per column and every row is just a multiply by the value
+  uint32_t region = hue / HUE_REGION_SIZE;
+  uint32_t remainder = (hue - (region * HUE_REGION_SIZE)) * 6;
+  uint16_t pFactor[SV_PLANE_SIZE];
+  uint16_t qFactor[SV_PLANE_SIZE];
+  uint16_t tFactor[SV_PLANE_SIZE];
+  for (uint32_t sat = 0; sat < SV_PLANE_SIZE; ++sat) {
+    pFactor[sat] = (uint16_t)(255 - sat);
+    qFactor[sat] = (uint16_t)(255 - ((sat * remainder) >> 8));
+    tFactor[sat] = (uint16_t)(255 - ((sat * (255 - remainder)) >> 8));
+  }
+  for (uint32_t y = 0; y < SV_PLANE_SIZE; ++y) {
+    uint8_t val = (uint8_t)(255 - y);
+    uint32_t *row = pixels + (y * stride);
+    svRow(region, val, pFactor, qFactor, tFactor, row);
+    // no saturation is just grey
+    row[0] = ((uint32_t)val << 16) | ((uint32_t)val << 8) | val;
+  }
+}
+
+void VortexColorConvert::svRow(uint32_t region, uint8_t val, const uint16_t *pFactor,
+  const uint16_t *qFactor, const uint16_t *tFactor, uint32_t *out)
+{
+  // each region is it's own loop so that the channel order isn't decided
+  // per pixel, the plain 16 bit math in these loops is what the optimizer
+  // turns into vector multiplies and shifts
+  uint32_t v = val;
+  switch (region) {
+  case 0:
+    for (uint32_t i = 0; i < SV_PLANE_SIZE; ++i) {
+      uint32_t p = (v * pFactor[i]) >> 8;
+      uint32_t t = (v * tFactor[i]) >> 8;
+      out[i] = (v << 16) | (t << 8) | p;
+    }
+    break;
+  case 1:
+    for (uint32_t i = 0; i < SV_PLANE_SIZE; ++i) {
+      uint32_t p = (v * pFactor[i]) >> 8;
+      uint32_t q = (v * qFactor[i]) >> 8;
+      out[i] = (q << 16) | (v << 8) | p;
+    }
+    break;
+  case 2:
+    for (uint32_t i = 0; i < SV_PLANE_SIZE; ++i) {
+      uint32_t p = (v * pFactor[i]) >> 8;
+      uint32_t t = (v * tFactor[i]) >> 8;
+      out[i] = (p << 16) | (v << 8) | t;
+    }
+    break;
+  case 3:
+    for (uint32_t i = 0; i < SV_PLANE_SIZE; ++i) {
+      uint32_t p = (v * pFactor[i]) >> 8;
+      uint32_t q = (v * qFactor[i]) >> 8;
+      out[i] = (p << 16) | (q << 8) | v;
+    }
+    break;
+  case 4:
+    for (uint32_t i = 0; i < SV_PLANE_SIZE; ++i) {
+      uint32_t p = (v * pFactor[i]) >> 8;
+      uint32_t t = (v * tFactor[i]) >> 8;
+      out[i] = (t << 16) | (p << 8) | v;
+    }
+    break;
+  default:
+    for (uint32_t i = 0; i < SV_PLANE_SIZE; ++i) {
+      uint32_t p = (v * pFactor[i]) >> 8;
+      uint32_t q = (v * qFactor[i]) >> 8;
+      out[i] = (v << 16) | (p << 8) | q;
+    }
+    break;
+  }
+}
+
+bool VortexColorConvert::setIsa(Isa isa)
+{
+  if (!isSupported(isa)) {
+    return false;
+  }
+  m_isa = isa;
+  return true;
+}
+
+bool VortexColorConvert::isSupported(Isa isa)
+{
+  switch (isa) {
+  case ISA_SCALAR:
+    return true;
+#ifdef CONVERT_X86
+  case ISA_SSE2:
+  case ISA_AVX2:
+  {
+#if defined(_MSC_VER)
+    int regs[4] = { 0 };
+    __cpuid(regs, 1);
+    bool sse2 = (regs[3] & (1 << 26)) != 0;
+    // avx needs the os to save the ymm registers as well as the cpu bit
+    bool osAvx = (regs[2] & (1 << 27)) && (regs[2] & (1 << 28)) && ((_xgetbv(0) & 6) == 6);
+    __cpuidex(regs, 7, 0);
+    bool avx2 = osAvx && (regs[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    bool sse2 = __builtin_cpu_supports("sse2");
+    bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+    return (isa == ISA_SSE2) ? sse2 : avx2;
+  }
+#endif
+#ifdef CONVERT_NEON
+  case ISA_NEON:
+    // neon is always there on arm64
+    return true;
+#endif
+  default:
+    return false;
+  }
+}
+
+const char *VortexColorConvert::isaName(Isa isa)
+{
+  static const char *names[ISA_COUNT] = { "scalar", "sse2", "avx2", "neon" };
+  return (isa < ISA_COUNT) ? names[isa] : "unknown";
+}
+
+VortexColorConvert::Isa VortexColorConvert::bestIsa()
+{
+  static const Isa order[] = { ISA_AVX2, ISA_SSE2, ISA_NEON };
+  for (uint32_t i = 0; i < sizeof(order) / sizeof(order[0]); ++i) {
+    if (isSupported(order[i])) {
+      return order[i];
+    }
+  }
+  return ISA_SCALAR;
+}
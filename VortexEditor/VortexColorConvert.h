@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stdint.h>
+
+// the size of a saturation/value plane, one pixel per saturation and value
+#define SV_PLANE_SIZE 256
+
+// Fast color conversions for drawing the color picker, these work on whole
+// spans of pixels at a time instead of converting a color at a time through
+// the engine types.
+//
+// Colors are packed into 32 bits the same as the raw engine colors, rgb is
+// 0x00RRGGBB which is also the layout of a pixel in a 32 bit dib, and hsv is
+// 0x00HHSSVV. The conversions follow the generic hsv/rgb algorithms of the
+// engine, callers that need to match the engine exactly should compare
+// against it once before relying on them.
+//
+// Each conversion has a plain version and vector versions for sse2 and avx2
+// on x86 and neon on arm64, the best one the cpu supports is picked when the
+// program starts. Every version gives exactly the same output.
+class VortexColorConvert
+{
+public:
+  enum Isa
+  {
+    ISA_SCALAR,
+    ISA_SSE2,
+    ISA_AVX2,
+    ISA_NEON,
+
+    ISA_COUNT
+  };
+
+  // convert a span of colors, the output can be the same as the input
+  static void hsvToRgb(const uint32_t *hsv, uint32_t *outRgb, uint32_t count);
+  static void rgbToHsv(const uint32_t *rgb, uint32_t *outHsv, uint32_t count);
+
+  // fill a plane of every saturation across and every value down for a
+  // single hue, the top row is full value, stride is in pixels
+  static void svPlane(uint8_t hue, uint32_t *pixels, uint32_t stride);
+
+  // the version of the conversions in use, it can be changed to compare them
+  static Isa isa() { return m_isa; }
+  static bool setIsa(Isa isa);
+  static bool isSupported(Isa isa);
+  static const char *isaName(Isa isa);
+
+private:
+  // convert one row of saturations at a single hue and value, the factors
+  // for the row are shared by every row of the plane
+  static void svRow(uint32_t region, uint8_t val, const uint16_t *pFactor,
+    const uint16_t *qFactor, const uint16_t *tFactor, uint32_t *out);
+
+  // the best version this cpu supports
+  static Isa bestIsa();
+
+  static Isa m_isa;
+};
@@ -9,6 +9,8 @@
 
 #include "Serial/Compression.h"
 
+#include "VortexColorConvert.h"
+
 #define FIELD_EDIT_ID       55001
 
 #define SATVAL_BOX_ID       56001
@@ -27,7 +29,12 @@ VortexColorPicker::VortexColorPicker() :
   m_isOpen(false),
   m_mutex(nullptr),
   m_loadThread(nullptr),
-  m_svBitmaps(),
+  m_svBitmap(nullptr),
+  m_svPixels(nullptr),
+  m_svHue(-1),
+  m_fastConvert(false),
+  m_svCache(),
+  m_svUseCount(0),
   m_hueBitmap(nullptr),
   m_redBitmap(nullptr),
   m_greenBitmap(nullptr),
@@ -53,6 +60,9 @@ VortexColorPicker::VortexColorPicker() :
 VortexColorPicker::~VortexColorPicker()
 {
   DestroyIcon(m_hIcon);
+  if (m_svBitmap) {
+    DeleteObject(m_svBitmap);
+  }
 }
 
 void VortexColorPicker::load()
@@ -67,8 +77,8 @@ DWORD __stdcall VortexColorPicker::loadThread(void *arg)
   // grab the loading mutex
   WaitForSingleObject(colorPicker->m_mutex, INFINITE);
 
-  // load the backgrounds
-  colorPicker->genSVBackgrounds();
+  // the sv planes are only drawn once a hue is shown
+  colorPicker->initSVBackground();
   // load the hue bitmap
   colorPicker->m_hueBitmap = colorPicker->genHueBackground(24, 256);
 
@@ -94,7 +104,8 @@ bool VortexColorPicker::loaded()
   CloseHandle(m_mutex);
   m_mutex = nullptr;
 
-  m_satValBox.setBackground(m_svBitmaps[0]);
+  showSVBackground(m_curHSV.hue);
+  m_satValBox.setBackground(m_svBitmap);
   m_satValBox.redraw();
 
   m_hueSlider.setBackground(m_hueBitmap);
@@ -227,34 +238,98 @@ bool VortexColorPicker::init(HINSTANCE hInst)
   return true;
 }
 
-// set a background via callback to convert x/y to rgb
-void VortexColorPicker::genSVBackgrounds()
+bool VortexColorPicker::initSVBackground()
+{
+  // a top down 32 bit dib, the pixels are the same layout as a raw color
+  BITMAPINFO bmi;
+  memset(&bmi, 0, sizeof(bmi));
+  bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+  bmi.bmiHeader.biWidth = SV_PLANE_SIZE;
+  bmi.bmiHeader.biHeight = -SV_PLANE_SIZE;
+  bmi.bmiHeader.biPlanes = 1;
+  bmi.bmiHeader.biBitCount = 32;
+  bmi.bmiHeader.biCompression = BI_RGB;
+  m_svBitmap = CreateDIBSection(nullptr, &bmi, DIB_RGB_COLORS, (void **)&m_svPixels, nullptr, 0);
+  if (!m_svBitmap) {
+    m_svPixels = nullptr;
+    return false;
+  }
+  // the fast conversions follow the generic algorithm of the engine, only
+  // use them if they give the same colors as the engine does, a few hues
+  // at the edges of the hue regions are enough to tell
+  static const uint8_t checkHues[] = { 0, 1, 42, 43, 85, 86, 128, 129, 170, 171, 213, 214, 255 };
+  const uint32_t planeSize = SV_PLANE_SIZE * SV_PLANE_SIZE;
+  vector<uint32_t> plane(planeSize);
+  vector<uint32_t> batch(planeSize);
+  m_fastConvert = true;
+  for (uint32_t i = 0; i < sizeof(checkHues) && m_fastConvert; ++i) {
+    VortexColorConvert::svPlane(checkHues[i], plane.data(), SV_PLANE_SIZE);
+    for (uint32_t y = 0; y < SV_PLANE_SIZE; ++y) {
+      for (uint32_t x = 0; x < SV_PLANE_SIZE; ++x) {
+        batch[(y * SV_PLANE_SIZE) + x] = ((uint32_t)checkHues[i] << 16) | (x << 8) | (255 - y);
+      }
+    }
+    VortexColorConvert::hsvToRgb(batch.data(), batch.data(), planeSize);
+    for (uint32_t y = 0; y < SV_PLANE_SIZE && m_fastConvert; ++y) {
+      for (uint32_t x = 0; x < SV_PLANE_SIZE; ++x) {
+        uint32_t index = (y * SV_PLANE_SIZE) + x;
+        RGBColor rgbCol = HSVColor(checkHues[i], x, 255 - y);
+        if (plane[index] != rgbCol.raw() || batch[index] != rgbCol.raw()) {
+          m_fastConvert = false;
+          break;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+void VortexColorPicker::showSVBackground(uint8_t hue)
 {
-  for (uint32_t i = 0; i < sizeof(m_svBitmaps) / sizeof(m_svBitmaps[0]); ++i) {
-    m_svBitmaps[i] = genSVBackground(i);
+  // nothing to draw into until the loader is done
+  if (m_mutex || !m_svPixels || m_svHue == hue) {
+    return;
   }
+  // gdi may still be reading the last plane
+  GdiFlush();
+  m_svUseCount++;
+  SVPlane *oldest = &m_svCache[0];
+  for (uint32_t i = 0; i < SV_CACHE_SIZE; ++i) {
+    SVPlane &plane = m_svCache[i];
+    if (plane.hue == hue && plane.pixels.size()) {
+      memcpy(m_svPixels, plane.pixels.data(), plane.pixels.size() * sizeof(uint32_t));
+      plane.lastUse = m_svUseCount;
+      m_svHue = hue;
+      m_satValBox.invalidateBackground();
+      return;
+    }
+    if (plane.lastUse < oldest->lastUse) {
+      oldest = &plane;
+    }
+  }
+  // draw the plane straight into the bitmap then keep a copy of it in
+  // place of the plane that was used the longest time ago
+  genSVBackground(hue, m_svPixels);
+  oldest->hue = hue;
+  oldest->lastUse = m_svUseCount;
+  oldest->pixels.assign(m_svPixels, m_svPixels + (SV_PLANE_SIZE * SV_PLANE_SIZE));
+  m_svHue = hue;
+  // the sv box keeps its own copy of the plane
+  m_satValBox.invalidateBackground();
 }
 
-HBITMAP VortexColorPicker::genSVBackground(uint32_t hue)
+void VortexColorPicker::genSVBackground(uint8_t hue, uint32_t *pixels)
 {
-  uint32_t width = 256;
-  uint32_t height = 256;
-  COLORREF *cols = new COLORREF[256 * 256];
-  if (!cols) {
-    return nullptr;
+  if (m_fastConvert) {
+    VortexColorConvert::svPlane(hue, pixels, SV_PLANE_SIZE);
+    return;
   }
-  // the real x and y are the internal coords inside the border where as
-  // m_width and m_height contain the border size in them
-  for (uint32_t y = 0; y < height; ++y) {
-    for (uint32_t x = 0; x < width; ++x) {
-      //RGBColor rgbCol = hsv_to_rgb_generic(HSVColor(hue, x, 255 - y));
+  for (uint32_t y = 0; y < SV_PLANE_SIZE; ++y) {
+    for (uint32_t x = 0; x < SV_PLANE_SIZE; ++x) {
       RGBColor rgbCol = HSVColor(hue, x, 255 - y);
-      cols[(y * width) + x] = rgbCol.raw();
+      pixels[(y * SV_PLANE_SIZE) + x] = rgbCol.raw();
     }
   }
-  HBITMAP bitmap = CreateBitmap(width, height, 1, 32, cols);
-  delete[] cols;
-  return bitmap;
 }
 
 void VortexColorPicker::selectSV(VSelectBox::SelectEvent sevent, uint32_t s, uint32_t v)
@@ -408,11 +483,22 @@ HBITMAP VortexColorPicker::genHueBackground(uint32_t width, uint32_t height)
   }
   // the real x and y are the internal coords inside the border where as
   // m_width and m_height contain the border size in them
+  // every hue down the slider is converted in one go
+  vector<uint32_t> hues(height);
+  for (uint32_t y = 0; y < height; ++y) {
+    hues[y] = ((y & 0xFF) << 16) | 0xFFFF;
+  }
+  if (m_fastConvert) {
+    VortexColorConvert::hsvToRgb(hues.data(), hues.data(), height);
+  } else {
+    for (uint32_t y = 0; y < height; ++y) {
+      RGBColor rgbCol = HSVColor(y, 255, 255);
+      hues[y] = rgbCol.raw();
+    }
+  }
   for (uint32_t y = 0; y < height; ++y) {
-    //RGBColor rgbCol = hsv_to_rgb_generic(HSVColor(y, 255, 255));
-    RGBColor rgbCol = HSVColor(y, 255, 255);
     for (uint32_t x = 0; x < width; ++x) {
-      cols[(y * width) + x] = rgbCol.raw();
+      cols[(y * width) + x] = hues[y];
     }
   }
   HBITMAP bitmap = CreateBitmap(width, height, 1, 32, cols);
@@ -452,6 +538,8 @@ void VortexColorPicker::show()
   while (!loaded());
   m_colorPickerWindow.setVisible(true);
   m_colorPickerWindow.setEnabled(true);
+  // start counting the paints from when the picker opens
+  VBackBuffer::paintsPerSec();
   m_isOpen = true;
 }
 
@@ -471,6 +559,9 @@ void VortexColorPicker::hide()
     g_pEditor->m_colorSelects[i].redraw();
     m_savedColors[i].setSelected(false);
   }
+  // what dragging around the picker cost while it was open
+  debug("Widgets painted %.1f times a second holding %u gdi objects, %u in the process",
+    VBackBuffer::paintsPerSec(), VBackBuffer::numObjects(), VBackBuffer::processObjects());
   m_isOpen = false;
 }
 
@@ -594,7 +685,7 @@ void VortexColorPicker::refreshColor()
   m_blueSlider.setSelection(0, 255 - m_curRGB.blue);
   m_hueSlider.setSelection(0, m_curHSV.hue);
   m_satValBox.setSelection(m_curHSV.sat, 255 - m_curHSV.val);
-  m_satValBox.setBackground(m_svBitmaps[m_curHSV.hue]);
+  showSVBackground(m_curHSV.hue);
   uint64_t now = GetCurrentTime();
   uint32_t rawCol = m_curRGB.raw();
   m_colorPreview.setColor(rawCol);
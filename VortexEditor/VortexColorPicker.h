@@ -14,6 +14,11 @@
 
 #include "Colors/Colortypes.h"
 
+#include <vector>
+
+// how many recently shown sv planes are kept around
+#define SV_CACHE_SIZE 8
+
 class VortexColorPicker
 {
 public:
@@ -107,8 +112,11 @@ private:
   void selectG(VSelectBox::SelectEvent sevent, uint32_t g);
   void selectB(VSelectBox::SelectEvent sevent, uint32_t b);
 
-  void genSVBackgrounds();
-  HBITMAP genSVBackground(uint32_t hue);
+  // create the sv plane bitmap and check the fast conversions
+  bool initSVBackground();
+  // show the sv plane of a hue in the sv box background
+  void showSVBackground(uint8_t hue);
+  void genSVBackground(uint8_t hue, uint32_t *pixels);
   HBITMAP genHueBackground(uint32_t width, uint32_t height);
   HBITMAP genRGBBackground(uint32_t width, uint32_t height, int rmult, int gmult, int bmult);
   void pushHistory(uint32_t rawCol);
@@ -130,8 +138,25 @@ private:
   HANDLE m_mutex;
   HANDLE m_loadThread;
 
-  // array of bitmaps for the SV selector background
-  HBITMAP m_svBitmaps[256];
+  // the SV selector background, a single dib that the plane of the
+  // current hue is drawn into whenever the hue changes
+  HBITMAP m_svBitmap;
+  uint32_t *m_svPixels;
+  // the hue in the bitmap right now, or -1 for none
+  int32_t m_svHue;
+  // whether the fast conversions match the engine
+  bool m_fastConvert;
+
+  // the most recently shown planes so dragging back and forth over the
+  // same hues doesn't convert them again
+  struct SVPlane
+  {
+    int32_t hue;
+    uint64_t lastUse;
+    std::vector<uint32_t> pixels;
+  };
+  SVPlane m_svCache[SV_CACHE_SIZE];
+  uint64_t m_svUseCount;
 
   // bitmap for the H selector background
   HBITMAP m_hueBitmap;
@@ -8,8 +8,11 @@
 #include "resource.h"
 
 #include "Serial/Compression.h"
+#include "Serial/ByteStream.h"
 
 #include "HttpClient.h"
+#include "VortexModeHash.h"
+#include "GUI/VPatternScheduler.h"
 
 #include <winhttp.h>
 #include <iostream>
@@ -17,35 +20,53 @@
 #pragma comment(lib, "winhttp.lib")
 
 #define PREVIEW_ID 55501
-#define PATTERN_STRIP_ID 55601
+#define PATTERN_LIST_ID 55601
 
 #define NEXT_PAGE_ID 55705
 #define PREV_PAGE_ID 55706
 #define PAGE_LABEL_ID 55707
 
+// posted by the page store when fetched pages have arrived
+#define WM_PAGES_ARRIVED WM_USER + 0
+
 // number of modes requested and displayed on each page
 #define MODES_PER_PAGE 15
 
+// where fetched pages are kept between sessions
+#define COMMUNITY_CACHE_DIR "VortexCommunity.cache"
+
+// how many pages either side of the current page are kept ready, how many
+// are fetched at once and how far away a page is dropped from memory
+#define PREFETCH_RADIUS 2
+#define PREFETCH_WORKERS 4
+#define PAGE_KEEP_RADIUS 8
+
 using namespace std;
 
 VortexCommunityBrowser::VortexCommunityBrowser() :
-  m_hThread(nullptr),
   m_hInstance(nullptr),
   m_isOpen(false),
   m_hIcon(nullptr),
+  m_httpClient("VortexEditor/1.0"),
+  m_httpCache(m_httpClient, COMMUNITY_CACHE_DIR),
+  m_pages(),
+  m_convertVortex(),
+  m_convertLock(),
   m_mutex(nullptr),
   m_communityBrowserWindow(),
-  m_patternStrips(),
+  m_patternList(),
   m_prevPageButton(),
   m_nextPageButton(),
   m_pageLabel(),
-  m_curPage(0),
-  m_lastPage(false)
+  m_curPage(0)
 {
+  InitializeSRWLock(&m_convertLock);
 }
 
 VortexCommunityBrowser::~VortexCommunityBrowser()
 {
+  // the workers fetch through the cache so they have to stop first
+  m_pages.cleanup();
   DestroyIcon(m_hIcon);
 }
 
@@ -77,28 +98,22 @@ bool VortexCommunityBrowser::init(HINSTANCE hInst)
   m_hIcon = LoadIcon(hInst, MAKEINTRESOURCE(IDI_ICON1));
   SendMessage(m_communityBrowserWindow.hwnd(), WM_SETICON, ICON_BIG, (LPARAM)m_hIcon);
 
-  // 15 modes per page
-  for (uint32_t i = 0; i < MODES_PER_PAGE; ++i) {
-    unique_ptr<VPatternStrip> strip = make_unique<VPatternStrip>(m_hInstance,
-      m_communityBrowserWindow, "", BACK_COL,
-      370, 32, 16, 16 + (i * 38), 2, json(), PATTERN_STRIP_ID + i, nullptr);
-    m_patternStrips.push_back(move(strip));
-  }
+  // a single list previews the modes, only the rows on screen are live
+  m_patternList.init(hInst, m_communityBrowserWindow, BACK_COL,
+    388, 570, 16, 16, PATTERN_LIST_ID);
 
-  m_hThread = CreateThread(NULL, 0, backgroundLoader, this, 0, NULL);
+  m_convertVortex.init();
+  m_convertVortex.setLedCount(1);
 
-  return true;
-}
+  // start fetching the first pages in the background, the pages are only
+  // ever converted on the workers and only shown on the ui thread
+  m_communityBrowserWindow.installUserCallback(WM_PAGES_ARRIVED, pagesArrivedCallback);
+  m_pages.init([this](uint32_t page) {
+    return fetchPage(page);
+  }, PREFETCH_WORKERS, m_communityBrowserWindow.hwnd(), WM_PAGES_ARRIVED);
+  m_pages.prefetch(0, PREFETCH_RADIUS, PAGE_KEEP_RADIUS);
 
-DWORD __stdcall VortexCommunityBrowser::backgroundLoader(void *pthis)
-{
-  VortexCommunityBrowser *browser = (VortexCommunityBrowser *)pthis;
-  // load the first two pages
-  browser->loadPage(0, false);
-  browser->loadPage(1, false);
-  CloseHandle(browser->m_hThread);
-  browser->m_hThread = nullptr;
-  return 0;
+  return true;
 }
 
 void VortexCommunityBrowser::show()
@@ -108,9 +123,9 @@ void VortexCommunityBrowser::show()
   }
   m_communityBrowserWindow.setVisible(true);
   m_communityBrowserWindow.setEnabled(true);
-  for (uint32_t i = 0; i < MODES_PER_PAGE; ++i) {
-    m_patternStrips[i]->setActive(true);
-  }
+  m_patternList.setActive(true);
+  // start measuring the cost of the previews from here
+  VPatternScheduler::load();
   m_isOpen = true;
 }
 
@@ -129,9 +144,10 @@ void VortexCommunityBrowser::hide()
     g_pEditor->m_colorSelects[i].setSelected(false);
     g_pEditor->m_colorSelects[i].redraw();
   }
-  for (uint32_t i = 0; i < MODES_PER_PAGE; ++i) {
-    m_patternStrips[i]->setActive(false);
-  }
+  // how much the previews cost while the browser was open
+  debug("Pattern list drew frames in %.3fms on average, %u timelines recorded, played on %.1f%% of a core",
+    m_patternList.averageFrameMs(), m_patternList.numRecorded(), VPatternScheduler::load());
+  m_patternList.setActive(false);
   m_isOpen = false;
 }
 
@@ -139,22 +155,78 @@ void VortexCommunityBrowser::loseFocus()
 {
 }
 
-json VortexCommunityBrowser::fetchModesJson(uint32_t page, uint32_t pageSize)
+HttpRequest VortexCommunityBrowser::modesRequest(uint32_t page, uint32_t pageSize)
+{
+  map<string, string> queryParams = {
+    { "page", to_string(page) },
+    { "pageSize", to_string(pageSize) },
+  };
+  HttpRequest request;
+  request.host = "vortex.community";
+  request.path = HttpClient::BuildFullPath("/pats/json", queryParams);
+  return request;
+}
+
+bool VortexCommunityBrowser::fetchModes(uint32_t page, uint32_t pageSize, string &outBody)
 {
-  HttpClient httpClient("VortexEditor/1.0");
-  json result;
   try {
-    map<string, string> queryParams = {
-      { "page", to_string(page) },
-      { "pageSize", to_string(pageSize) },
-    };
-    string jsonResponse = httpClient.SendRequest("vortex.community", "/pats/json", "GET", {}, "", queryParams);
-    // Parse and return the JSON object
-    result = json::parse(jsonResponse);
+    HttpResponse response;
+    HttpCache::Source source = m_httpCache.Get(modesRequest(page, pageSize), response);
+    if (source == HttpCache::SOURCE_NETWORK) {
+      debug("Fetched page %u in %.1fms (%.1fms average over %u requests), %llu bytes decoded from %llu", page,
+        m_httpClient.LastLatencyMs(), m_httpClient.AverageLatencyMs(), m_httpClient.NumRequests(),
+        (unsigned long long)response.bodySize, (unsigned long long)response.wireSize);
+    } else {
+      debug("Loaded page %u from the cache%s", page, (source == HttpCache::SOURCE_STALE) ? ", revalidating" : "");
+    }
+    if (response.status != 200) {
+      cerr << "Fetching page " << page << " failed with status " << response.status << endl;
+      return false;
+    }
+    outBody = move(response.body);
   } catch (const exception &e) {
     cerr << "Exception caught: " << e.what() << endl;
+    return false;
+  }
+  return true;
+}
+
+VortexPageStore::Page VortexCommunityBrowser::fetchPage(uint32_t page)
+{
+  string body;
+  if (!fetchModes(page + 1, MODES_PER_PAGE, body)) {
+    return nullptr;
+  }
+  LARGE_INTEGER freq;
+  LARGE_INTEGER startTime;
+  LARGE_INTEGER endTime;
+  QueryPerformanceFrequency(&freq);
+  QueryPerformanceCounter(&startTime);
+  // the converted page is only used if it came from the exact same json,
+  // it's kept with the cached json so it counts towards the cache limits
+  // and goes when the json does
+  uint64_t sourceHash = VortexModeHash::hash(body.data(), body.size());
+  HttpRequest request = modesRequest(page + 1, MODES_PER_PAGE);
+  string filename = m_httpCache.DerivedPath(request, COMMUNITY_PAGE_EXTENSION);
+  shared_ptr<VortexCommunityPage> modes = make_shared<VortexCommunityPage>();
+  bool loaded = modes->load(filename, sourceHash);
+  if (!loaded) {
+    json js = json::parse(body, nullptr, false);
+    AcquireSRWLockExclusive(&m_convertLock);
+    bool converted = modes->convert(m_convertVortex, js, sourceHash);
+    ReleaseSRWLockExclusive(&m_convertLock);
+    if (!converted) {
+      cerr << "Page " << page << " has no modes" << endl;
+      return nullptr;
+    }
+    if (modes->save(filename)) {
+      m_httpCache.AddDerived(request, COMMUNITY_PAGE_EXTENSION);
+    }
   }
-  return result;
+  QueryPerformanceCounter(&endTime);
+  double ms = (double)(endTime.QuadPart - startTime.QuadPart) * 1000.0 / (double)freq.QuadPart;
+  debug("%s page %u in %.3fms", loaded ? "Loaded converted" : "Converted", page, ms);
+  return modes;
 }
 
 bool VortexCommunityBrowser::loadCurPage(bool active)
@@ -164,30 +236,78 @@ bool VortexCommunityBrowser::loadCurPage(bool active)
 
 bool VortexCommunityBrowser::loadPage(uint32_t page, bool active)
 {
-  // if the page hasn't been loaded yet
-  if (m_communityModes.size() <= m_curPage) {
-    // fetch json of modes from community api
-    try {
-      // cache the page of data
-      m_communityModes.push_back(fetchModesJson(m_curPage + 1, MODES_PER_PAGE));
-    } catch (...) {
-      return false;
+  // this never waits on a fetch, a page that isn't here yet is shown by
+  // pagesArrived() once it is
+  m_pages.prefetch(page, PREFETCH_RADIUS, PAGE_KEEP_RADIUS);
+  VortexPageStore::Page modes = m_pages.get(page);
+  uint32_t numPages = m_pages.numPages();
+  string pageText = to_string(page + 1) + " / " + (numPages ? to_string(numPages) : "?");
+  if (!modes) {
+    m_patternList.clearItems();
+    m_pageLabel.setText(pageText + (m_pages.isPending(page) ? " ..." : " (offline)"));
+    return false;
+  }
+  LARGE_INTEGER freq;
+  LARGE_INTEGER startTime;
+  LARGE_INTEGER endTime;
+  QueryPerformanceFrequency(&freq);
+  QueryPerformanceCounter(&startTime);
+  // the timelines are recorded as the rows are drawn
+  m_patternList.clearItems();
+  for (uint32_t i = 0; i < modes->numModes(); ++i) {
+    m_patternList.addItem(modes->entry(i)->name, *modes->mode(i));
+  }
+  m_patternList.setActive(active);
+  QueryPerformanceCounter(&endTime);
+  double ms = (double)(endTime.QuadPart - startTime.QuadPart) * 1000.0 / (double)freq.QuadPart;
+  debug("Showed page %u in %.3fms", page, ms);
+  m_pageLabel.setText(pageText);
+  return true;
+}
+
+void VortexCommunityBrowser::pagesArrived()
+{
+  vector<uint32_t> pages;
+  m_pages.takeArrived(pages);
+  for (uint32_t page : pages) {
+    VortexPageStore::Page modes = m_pages.get(page);
+    if (modes) {
+      indexPage(page, *modes);
     }
-    // Verify if 'data' is an array
-    if (!m_communityModes[m_curPage].contains("data")) {
-      cerr << "'data' is not an array or does not exist" << endl;
-      return false;
+    if (page != m_curPage) {
+      continue;
+    }
+    if (modes) {
+      loadCurPage(m_isOpen);
+    } else {
+      // the page failed, it's tried again next time it's navigated to
+      uint32_t numPages = m_pages.numPages();
+      m_pageLabel.setText(to_string(page + 1) + " / " + (numPages ? to_string(numPages) : "?") + " (offline)");
     }
   }
-  for (uint32_t i = 0; i < MODES_PER_PAGE; ++i) {
-    auto mode = m_communityModes[m_curPage]["data"][i];
-    m_patternStrips[i]->loadJson(mode);
-    m_patternStrips[i]->setActive(active);
+}
+
+void VortexCommunityBrowser::indexPage(uint32_t page, const VortexCommunityPage &modes)
+{
+  // the summaries were made when the page was converted
+  for (uint32_t i = 0; i < modes.numModes(); ++i) {
+    if (!modes.mode(i)->rawSize()) {
+      continue;
+    }
+    g_pEditor->m_modeIndex.update(VortexModeIndex::SOURCE_COMMUNITY, (page * MODES_PER_PAGE) + i, *modes.entry(i));
   }
-  uint32_t numPages = m_communityModes[m_curPage]["pages"];
-  m_lastPage = (m_curPage == (numPages - 1));
-  m_pageLabel.setText(to_string(m_curPage + 1) + " / " + to_string(numPages));
-  return true;
+}
+
+bool VortexCommunityBrowser::showMode(uint32_t index)
+{
+  uint32_t page = index / MODES_PER_PAGE;
+  // only pages that were fetched have modes in the index
+  if (!m_pages.get(page)) {
+    return false;
+  }
+  show();
+  m_curPage = page;
+  return loadCurPage();
 }
 
 bool VortexCommunityBrowser::prevPage()
@@ -201,7 +321,9 @@ bool VortexCommunityBrowser::prevPage()
 
 bool VortexCommunityBrowser::nextPage()
 {
-  if (m_lastPage) {
+  // until the first page arrives the number of pages isn't known
+  uint32_t numPages = m_pages.numPages();
+  if (numPages && m_curPage + 1 >= numPages) {
     return false;
   }
   m_curPage++;
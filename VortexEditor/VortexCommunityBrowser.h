@@ -5,7 +5,7 @@
 
 // gui includes
 #include "GUI/VChildwindow.h"
-#include "GUI/VPatternStrip.h"
+#include "GUI/VPatternListBox.h"
 #include "GUI/VSelectBox.h"
 #include "GUI/VComboBox.h"
 #include "GUI/VTextBox.h"
@@ -19,6 +19,10 @@
 
 #include "json.hpp"
 
+#include "HttpClient.h"
+#include "HttpCache.h"
+#include "VortexPageStore.h"
+
 class VortexCommunityBrowser
 {
 public:
@@ -32,11 +36,14 @@ public:
   void show();
   void hide();
   void loseFocus();
-  json fetchModesJson(uint32_t page = 1, uint32_t pageSize = 15);
+  // fetch the json of a page of modes, from the cache if it's there
+  bool fetchModes(uint32_t page, uint32_t pageSize, std::string &outBody);
   bool loadCurPage(bool active = true);
   bool loadPage(uint32_t page, bool active = true);
   bool prevPage();
   bool nextPage();
+  // show the window on the page of a mode by it's index across all pages
+  bool showMode(uint32_t index);
 
   bool isOpen() const { return m_isOpen; }
   HWND hwnd() const { return m_communityBrowserWindow.hwnd(); }
@@ -56,10 +63,22 @@ private:
   static void nextPageCallback(void *pthis, VWindow *window) {
     ((VortexCommunityBrowser *)pthis)->nextPage();
   }
+  static void pagesArrivedCallback(void *pthis, VWindow *window) {
+    ((VortexCommunityBrowser *)pthis)->pagesArrived();
+  }
+
+  // index and show the pages the prefetcher fetched
+  void pagesArrived();
+
+  // the request for a page of modes from the community api
+  static HttpRequest modesRequest(uint32_t page, uint32_t pageSize);
+
+  // fetch a page and convert it's modes, or load the page converted in an
+  // earlier session if the server sent the same modes. Runs on the workers
+  VortexPageStore::Page fetchPage(uint32_t page);
 
-  static DWORD __stdcall backgroundLoader(void *pthis);
-  // a handle to the thread that initializes in the background
-  HANDLE m_hThread;
+  // add the modes of a fetched page to the editor search index
+  void indexPage(uint32_t page, const VortexCommunityPage &modes);
 
   HINSTANCE m_hInstance;
 
@@ -67,8 +86,18 @@ private:
 
   HICON m_hIcon;
 
-  // modes fetched from community api
-  std::vector<nlohmann::json> m_communityModes;
+  // kept for the life of the browser so every page after the first goes
+  // out on the same connection
+  HttpClient m_httpClient;
+  // pages fetched in earlier sessions, shown straight away and revalidated
+  // in the background so the browser works offline too
+  HttpCache m_httpCache;
+  // pages of modes fetched from community api, the pages around the
+  // current page are fetched in the background before they're needed
+  VortexPageStore m_pages;
+  // engine for converting the fetched modes, shared by the workers
+  Vortex m_convertVortex;
+  SRWLOCK m_convertLock;
 
   // mutex to synchronize access to vortex engine
   HANDLE m_mutex;
@@ -77,8 +106,8 @@ private:
 
   // child window for mode randomizer tool
   VChildWindow m_communityBrowserWindow;
-  // preview of color
-  std::vector<std::unique_ptr<VPatternStrip>> m_patternStrips;
+  // previews of the modes on the page
+  VPatternListBox m_patternList;
 
   // next/prev page buttons
   VButton m_prevPageButton;
@@ -87,6 +116,4 @@ private:
 
   // the current page of the browser
   uint32_t m_curPage;
-  // whether we're on the last page (received all responses)
-  bool m_lastPage;
 };
\ No newline at end of file
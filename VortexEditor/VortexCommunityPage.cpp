@@ -0,0 +1,174 @@
+#include "VortexCommunityPage.h"
+
+// VortexEngine includes
+#include "VortexLib.h"
+
+// Editor includes
+#include "VortexModeHash.h"
+#include "VortexFile.h"
+
+#include <string.h>
+#include <fstream>
+
+// 'VCPG'
+#define PAGE_MAGIC   0x47504356
+#define PAGE_VERSION 1
+
+// no page holds anywhere near this many modes, anything more is corrupt
+#define PAGE_MAX_MODES 4096
+
+// the size of a mode rounded up to the next 4 bytes
+#define PAGE_ALIGN(size) (((size) + 3) & ~3)
+
+using namespace std;
+
+VortexCommunityPage::VortexCommunityPage() :
+  m_sourceHash(0),
+  m_numPages(0),
+  m_entries(),
+  m_modes()
+{
+}
+
+bool VortexCommunityPage::convert(Vortex &vortex, const json &page, uint64_t sourceHash)
+{
+  m_entries.clear();
+  m_modes.clear();
+  m_sourceHash = sourceHash;
+  m_numPages = 0;
+  if (!page.is_object() || !page.contains("data") || !page["data"].is_array()) {
+    return false;
+  }
+  if (page.contains("pages") && page["pages"].is_number_integer()) {
+    m_numPages = page["pages"].get<uint32_t>();
+  }
+  const json &data = page["data"];
+  m_entries.resize(data.size());
+  m_modes.resize(data.size());
+  for (uint32_t i = 0; i < data.size(); ++i) {
+    const json &mode = data[i];
+    string name = (mode.contains("name") && mode["name"].is_string()) ? mode["name"].get<string>() : "";
+    VortexModeLibrary::Entry &entry = m_entries[i];
+    ByteStream &stream = m_modes[i];
+    // a mode that can't be loaded keeps it's place on the page with no data
+    // so the rest of the modes stay where the server put them
+    vortex.engine().modes().clearModes();
+    if (mode.contains("modeData")) {
+      vortex.loadModeFromJson(mode["modeData"]);
+    }
+    if (!vortex.numModes() || !vortex.setCurMode(0, false) || !vortex.getCurMode(stream)) {
+      memset(&entry, 0, sizeof(entry));
+      strncpy_s(entry.name, name.c_str(), _TRUNCATE);
+      stream = ByteStream();
+      continue;
+    }
+    VortexModeLibrary::summarize(vortex, name, entry);
+    entry.hash = VortexModeHash::hashMode(stream);
+    entry.crc32 = stream.recalcCRC();
+    entry.size = stream.rawSize();
+  }
+  return true;
+}
+
+bool VortexCommunityPage::load(const string &filename, uint64_t sourceHash)
+{
+  m_entries.clear();
+  m_modes.clear();
+  ifstream file(filename, ios::binary | ios::ate);
+  if (!file.is_open()) {
+    return false;
+  }
+  // the whole page is read at once then the modes are copied out of it
+  uint64_t fileSize = (uint64_t)file.tellg();
+  if (fileSize < sizeof(Header)) {
+    return false;
+  }
+  vector<uint8_t> buffer((size_t)fileSize);
+  file.seekg(0);
+  if (!file.read((char *)buffer.data(), buffer.size())) {
+    return false;
+  }
+  const Header *header = (const Header *)buffer.data();
+  if (header->magic != PAGE_MAGIC || header->version != PAGE_VERSION ||
+      header->entrySize != sizeof(VortexModeLibrary::Entry) || header->numModes > PAGE_MAX_MODES ||
+      header->sourceHash != sourceHash) {
+    return false;
+  }
+  uint64_t entriesSize = (uint64_t)header->numModes * sizeof(VortexModeLibrary::Entry);
+  if (entriesSize > fileSize - sizeof(Header)) {
+    return false;
+  }
+  const VortexModeLibrary::Entry *entries = (const VortexModeLibrary::Entry *)(buffer.data() + sizeof(Header));
+  vector<ByteStream> modes(header->numModes);
+  for (uint32_t i = 0; i < header->numModes; ++i) {
+    const VortexModeLibrary::Entry &entry = entries[i];
+    if (!entry.size) {
+      continue;
+    }
+    if ((entry.offset & 3) || entry.offset > fileSize || entry.size > fileSize - entry.offset ||
+        !VortexFile::parse(buffer.data() + entry.offset, entry.size, modes[i]) ||
+        modes[i].CRC() != entry.crc32) {
+      return false;
+    }
+  }
+  m_entries.assign(entries, entries + header->numModes);
+  m_modes.swap(modes);
+  m_sourceHash = sourceHash;
+  m_numPages = header->numPages;
+  return true;
+}
+
+bool VortexCommunityPage::save(const string &filename) const
+{
+  Header header;
+  memset(&header, 0, sizeof(header));
+  header.magic = PAGE_MAGIC;
+  header.version = PAGE_VERSION;
+  header.entrySize = sizeof(VortexModeLibrary::Entry);
+  header.numModes = (uint32_t)m_modes.size();
+  header.sourceHash = m_sourceHash;
+  header.numPages = m_numPages;
+  // the modes go after the entries in order, each one starts on a 4 byte
+  // boundary so it's header can be read straight out of the file
+  vector<VortexModeLibrary::Entry> entries = m_entries;
+  uint64_t offset = sizeof(Header) + entries.size() * sizeof(VortexModeLibrary::Entry);
+  for (VortexModeLibrary::Entry &entry : entries) {
+    entry.offset = entry.size ? offset : 0;
+    offset += PAGE_ALIGN(entry.size);
+  }
+  string tempFilename = filename + ".tmp";
+  ofstream file(tempFilename, ios::binary | ios::trunc);
+  if (!file.is_open()) {
+    return false;
+  }
+  file.write((const char *)&header, sizeof(header));
+  file.write((const char *)entries.data(), entries.size() * sizeof(VortexModeLibrary::Entry));
+  static const char padding[4] = { 0 };
+  for (uint32_t i = 0; i < m_modes.size(); ++i) {
+    file.write((const char *)m_modes[i].rawData(), entries[i].size);
+    file.write(padding, PAGE_ALIGN(entries[i].size) - entries[i].size);
+  }
+  file.close();
+  if (!file) {
+    DeleteFile(tempFilename.c_str());
+    return false;
+  }
+  // swapped into place so a page that was being written is never loaded
+  return MoveFileEx(tempFilename.c_str(), filename.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+}
+
+const VortexModeLibrary::Entry *VortexCommunityPage::entry(uint32_t index) const
+{
+  if (index >= m_entries.size()) {
+    return nullptr;
+  }
+  return &m_entries[index];
+}
+
+const ByteStream *VortexCommunityPage::mode(uint32_t index) const
+{
+  if (index >= m_modes.size()) {
+    return nullptr;
+  }
+  return &m_modes[index];
+}
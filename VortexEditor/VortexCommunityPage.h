@@ -0,0 +1,75 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "Serial/ByteStream.h"
+#include "json.hpp"
+
+#include "VortexModeLibrary.h"
+
+class Vortex;
+
+// the extension of converted pages in the community cache
+#define COMMUNITY_PAGE_EXTENSION ".vtxpage"
+
+// A page of modes from the community server converted to the binary form
+// the engine loads.
+//
+// The server sends each mode as json which takes a parse and a trip
+// through loadModeFromJson before the engine can use it. A page is only
+// converted once, each mode is turned into it's serialized ByteStream
+// along with the same summary the mode libraries keep, so showing the page
+// again only has to copy the streams into the engine.
+//
+// Converted pages are also saved to disk with the json in the http cache:
+//
+//   [Header] [Entry] [Entry] ... [Entry] [mode] [mode] ... [mode]
+//
+// The header holds a hash of the json the page was converted from, when the
+// server still sends the same json the saved page is loaded with a single
+// read and nothing is parsed or converted at all. The modes are validated
+// the same way as a .vtxmode file so a damaged file can't corrupt the engine.
+class VortexCommunityPage
+{
+public:
+  VortexCommunityPage();
+
+  // convert the json of a page, the modes are loaded into the vortex one by
+  // one to serialize them. The hash identifies the json for load()
+  bool convert(Vortex &vortex, const json &page, uint64_t sourceHash);
+
+  // load a page that was saved from the same json, fails if there is no
+  // saved page or it was converted from some other json
+  bool load(const std::string &filename, uint64_t sourceHash);
+  bool save(const std::string &filename) const;
+
+  // the number of pages on the server when this page was fetched
+  uint32_t numPages() const { return m_numPages; }
+  uint32_t numModes() const { return (uint32_t)m_modes.size(); }
+
+  // the name and summary of a mode, and the mode itself which is empty if
+  // the server sent a mode that couldn't be loaded
+  const VortexModeLibrary::Entry *entry(uint32_t index) const;
+  const ByteStream *mode(uint32_t index) const;
+
+private:
+  // the header at the front of a saved page
+  struct Header
+  {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entrySize;
+    uint32_t numModes;
+    uint64_t sourceHash;
+    uint32_t numPages;
+    uint32_t reserved;
+  };
+
+  uint64_t m_sourceHash;
+  uint32_t m_numPages;
+  // the offsets in the entries are only filled out when the page is saved
+  std::vector<VortexModeLibrary::Entry> m_entries;
+  std::vector<ByteStream> m_modes;
+};
@@ -13,14 +13,21 @@
 #include "ArduinoSerial.h"
 #include "EditorConfig.h"
 #include "GUI/VWindow.h"
+#include "VortexModeHash.h"
+#include "VortexFile.h"
+#include "VortexCLI.h"
 #include "VortexPort.h"
 #include "resource.h"
 
+// windows includes
+#include <shlobj.h>
+
 // stl includes
 #include <algorithm>
 #include <memory>
 #include <sstream>
 #include <string>
+#include <unordered_map>
 
 // for registering ui elements for events
 #define SELECT_PORT_ID      50001
@@ -40,6 +47,7 @@
 #define WM_REFRESH_UI       WM_USER + 0 // refresh the UI
 #define WM_TEST_CONNECT     WM_USER + 1 // new test framework connection
 #define WM_TEST_DISCONNECT  WM_USER + 2 // test framework disconnect
+#define WM_RPC_CALL         WM_USER + 3 // automation calls are waiting
 
 // the prefix of colorsets copied to clipboard
 #define COLORSET_CLIPBOARD_MARKER "COLORSET:"
@@ -50,6 +58,15 @@
 #define VORTEX_SAVE_EXTENSION ".vortex"
 #define VORTEX_MODE_EXTENSION ".vtxmode"
 
+// the storage bar is drawn in this many steps
+#define STORAGE_BAR_STEPS 280
+
+// size of the buffer for selecting multiple files to import
+#define IMPORT_BUFFER_SIZE (64 * 1024)
+
+// journal of the editing session for crash recovery
+#define JOURNAL_FILENAME "VortexEditor.journal"
+
 using namespace std;
 
 VortexEditor *g_pEditor = nullptr;
@@ -64,6 +81,18 @@ VortexEditor::VortexEditor() :
   m_accelTable(),
   m_lastClickedColor(0),
   m_scanPortsThread(nullptr),
+  m_headless(false),
+  m_modeStorage(),
+  m_storageOverhead(0),
+  m_storageTotal(0),
+  m_storageDirty(true),
+  m_storagePct(0),
+  m_storageBitmap(nullptr),
+  m_journal(),
+  m_workerPool(),
+  m_scratchVortex(),
+  m_modeIndex(),
+  m_rpcServer(),
   m_window(),
   m_portSelection(),
   m_pushButton(),
@@ -86,6 +115,9 @@ VortexEditor::~VortexEditor()
   if (m_hIcon) {
     DestroyIcon(m_hIcon);
   }
+  if (m_storageBitmap) {
+    DeleteObject(m_storageBitmap);
+  }
 }
 
 class VortexEditorCallbacks : public VortexCallbacks
@@ -118,7 +150,7 @@ public:
   virtual void ledsShow() { }
 };
 
-bool VortexEditor::init(HINSTANCE hInst)
+bool VortexEditor::init(HINSTANCE hInst, bool headless, const string &rpcEndpoint)
 {
   if (g_pEditor) {
     return false;
@@ -143,6 +175,10 @@ bool VortexEditor::init(HINSTANCE hInst)
 
   // initialize the window accordingly
   m_window.init(hInst, EDITOR_TITLE, BACK_COL, EDITOR_WIDTH, EDITOR_HEIGHT, g_pEditor, "VortexEditor");
+  m_headless = headless;
+  if (m_headless) {
+    m_window.setVisible(false);
+  }
 
   m_portSelection.init(hInst, m_window, "Select Port", BACK_COL, 72, 100, 16, 15, SELECT_PORT_ID, selectPortCallback);
 
@@ -213,6 +249,11 @@ bool VortexEditor::init(HINSTANCE hInst)
   m_window.addCallback(ID_HELP_WIKI, handleMenusCallback);
   m_window.addCallback(ID_EDIT_COPY_COLORSET, handleMenusCallback);
   m_window.addCallback(ID_EDIT_PASTE_COLORSET, handleMenusCallback);
+  m_window.addCallback(ID_EDIT_COPY_MODE, handleMenusCallback);
+  m_window.addCallback(ID_EDIT_COPY_ALL_MODES, handleMenusCallback);
+  m_window.addCallback(ID_EDIT_PASTE_MODES, handleMenusCallback);
+  m_window.addCallback(ID_EDIT_COLORSET_TO_ALL_MODES, handleMenusCallback);
+  m_window.addCallback(ID_EDIT_PATTERN_TO_ALL_MODES, handleMenusCallback);
   m_window.addCallback(ID_EDIT_CLEAR_PATTERN, handleMenusCallback);
   m_window.addCallback(ID_OPTIONS_TRANSMIT_DUO, handleMenusCallback);
   m_window.addCallback(ID_OPTIONS_TRANSMIT_INFRARED, handleMenusCallback);
@@ -225,10 +266,13 @@ bool VortexEditor::init(HINSTANCE hInst)
   m_window.addCallback(ID_FILE_SAVE, handleMenusCallback);
   m_window.addCallback(ID_FILE_IMPORT, handleMenusCallback);
   m_window.addCallback(ID_FILE_EXPORT, handleMenusCallback);
+  m_window.addCallback(ID_FILE_EXPORT_ALL, handleMenusCallback);
   m_window.addCallback(ID_TOOLS_COLOR_PICKER, handleMenusCallback);
   m_window.addCallback(ID_TOOLS_MODE_RANDOMIZER, handleMenusCallback);
   m_window.addCallback(ID_TOOLS_COMMUNITY_BROWSER, handleMenusCallback);
   m_window.addCallback(ID_TOOLS_CHROMALINK, handleMenusCallback);
+  m_window.addCallback(ID_TOOLS_MODE_LIBRARY, handleMenusCallback);
+  m_window.addCallback(ID_TOOLS_MODE_SEARCH, handleMenusCallback);
   m_window.addCallback(ID_CHOOSE_DEVICE_ORBIT, handleMenusCallback);
   m_window.addCallback(ID_CHOOSE_DEVICE_HANDLE, handleMenusCallback);
   m_window.addCallback(ID_CHOOSE_DEVICE_GLOVES, handleMenusCallback);
@@ -240,6 +284,7 @@ bool VortexEditor::init(HINSTANCE hInst)
   m_window.installUserCallback(WM_REFRESH_UI, refreshWindowCallback);
   m_window.installUserCallback(WM_TEST_CONNECT, connectTestFrameworkCallback);
   m_window.installUserCallback(WM_TEST_DISCONNECT, disconnectTestFrameworkCallback);
+  m_window.installUserCallback(WM_RPC_CALL, rpcCallback);
 
   // current window pos for child window init
   RECT pos;
@@ -261,6 +306,14 @@ bool VortexEditor::init(HINSTANCE hInst)
   m_chromalink.init(hInst);
   SetWindowPos(m_chromalink.hwnd(), 0, pos.left + 200, pos.bottom - 50, 0, 0, SWP_NOSIZE);
 
+  // initialize the mode library browser
+  m_libraryBrowser.init(hInst);
+  SetWindowPos(m_libraryBrowser.hwnd(), 0, pos.right + 2, pos.top, 0, 0, SWP_NOSIZE);
+
+  // initialize the mode search
+  m_modeSearch.init(hInst);
+  SetWindowPos(m_modeSearch.hwnd(), 0, pos.right + 2, pos.top + 50, 0, 0, SWP_NOSIZE);
+
   // initialize the tutorial
   m_tutorial.init(hInst);
   SetWindowPos(m_tutorial.hwnd(), 0, pos.left + 180, pos.top + 50, 0, 0, SWP_NOSIZE);
@@ -307,6 +360,8 @@ bool VortexEditor::init(HINSTANCE hInst)
     { FCONTROL | FSHIFT | FVIRTKEY, 'O', ID_FILE_IMPORT },
     // ctrl + d
     { FCONTROL | FVIRTKEY, 'D', ID_EDIT_CLEAR_PATTERN },
+    // ctrl + f   search modes
+    { FCONTROL | FVIRTKEY, 'F', ID_TOOLS_MODE_SEARCH },
     // ctrl + u
     { FCONTROL | FVIRTKEY, 'U', ID_OPTIONS_TRANSMIT_DUO },
     // ctrl + i
@@ -337,6 +392,27 @@ bool VortexEditor::init(HINSTANCE hInst)
   // check for connected devices
   m_scanPortsThread = CreateThread(NULL, 0, scanPortsThread, this, 0, NULL);
 
+  // workers for bulk imports and exports
+  m_workerPool.init();
+
+  // the search index resolves pattern names to ids
+  vector<string> patternNames;
+  for (PatternID id = PATTERN_NONE; id < PATTERN_COUNT; ++id) {
+    patternNames.push_back(m_vortex.patternToString(id));
+  }
+  m_modeIndex.setPatternNames(patternNames);
+
+  // recover the last session if it crashed then start journaling this one,
+  // a headless editor has nobody to ask and is driven by a script anyway,
+  // and if another editor is running the journal is its live session
+  if (!m_headless && m_journal.acquire(JOURNAL_FILENAME)) {
+    recoverJournal();
+    m_journal.start(JOURNAL_FILENAME);
+  }
+
+  // scripts and tests drive the editor through the automation endpoint
+  initAutomation(rpcEndpoint);
+
   // trigger a ui refresh
   refreshModeList();
 
@@ -352,6 +428,255 @@ DWORD __stdcall VortexEditor::scanPortsThread(void *arg)
   return 0;
 }
 
+void VortexEditor::initAutomation(const string &endpoint)
+{
+  // every method runs on the ui thread through the same actions as the
+  // editor window, the selection and list boxes are kept in sync so the
+  // window reflects what a script did
+  m_rpcServer.addMethod("editor.ping", [this](const json &params, json &result) {
+    result = { { "version", EDITOR_VERSION }, { "calls", m_rpcServer.numCalls() } };
+    return true;
+  });
+  m_rpcServer.addMethod("editor.quit", [this](const json &params, json &result) {
+    PostMessage(m_window.hwnd(), WM_CLOSE, 0, 0);
+    result = true;
+    return true;
+  });
+  m_rpcServer.addMethod("edit.undo", [this](const json &params, json &result) {
+    handleMenus(ID_EDIT_UNDO);
+    result = m_vortex.numModes();
+    return true;
+  });
+  m_rpcServer.addMethod("edit.redo", [this](const json &params, json &result) {
+    handleMenus(ID_EDIT_REDO);
+    result = m_vortex.numModes();
+    return true;
+  });
+  m_rpcServer.addMethod("modes.list", [this](const json &params, json &result) {
+    // the cached storage already has the hash and name of every mode
+    getStorageStats(nullptr, nullptr);
+    result = json::array();
+    for (uint32_t i = 0; i < m_modeStorage.size(); ++i) {
+      char hash[32] = {0};
+      snprintf(hash, sizeof(hash), "%016llx", (unsigned long long)m_modeStorage[i].hash);
+      result.push_back({ { "index", i },
+        { "name", m_modeIndex.nameOf({ VortexModeIndex::SOURCE_EDITOR, i }) },
+        { "hash", hash }, { "size", m_modeStorage[i].compressedSize } });
+    }
+    return true;
+  });
+  m_rpcServer.addMethod("modes.get", [this](const json &params, json &result) {
+    uint32_t index = params.value("index", m_vortex.curModeIndex());
+    uint32_t cur = m_vortex.curModeIndex();
+    ByteStream stream;
+    if (index >= m_vortex.numModes() || !m_vortex.setCurMode(index, false)) {
+      result = "No mode at that index";
+      return false;
+    }
+    bool success = m_vortex.getCurMode(stream);
+    m_vortex.setCurMode(cur, false);
+    if (!success) {
+      result = "Failed to serialize the mode";
+      return false;
+    }
+    // the same bytes as an exported .vtxmode file
+    result = { { "index", index },
+      { "data", VortexRPCServer::encodeBase64(stream.rawData(), stream.rawSize()) } };
+    return true;
+  });
+  m_rpcServer.addMethod("modes.add", [this](const json &params, json &result) {
+    if (!params.contains("data")) {
+      // a new random mode like the add button
+      uint32_t count = m_vortex.numModes();
+      addMode(nullptr);
+      if (m_vortex.numModes() == count) {
+        result = "The mode list is full";
+        return false;
+      }
+      result = m_vortex.numModes() - 1;
+      return true;
+    }
+    vector<uint8_t> data;
+    ByteStream stream;
+    if (!VortexRPCServer::decodeBase64(params["data"].get<string>(), data) ||
+        !VortexFile::parse(data.data(), data.size(), stream) || !addModeFromStream(stream)) {
+      result = "The mode is corrupt or could not be added";
+      return false;
+    }
+    m_modeListBox.setSelection(m_vortex.curModeIndex());
+    result = m_vortex.numModes() - 1;
+    return true;
+  });
+  m_rpcServer.addMethod("modes.delete", [this](const json &params, json &result) {
+    uint32_t index = params.value("index", m_vortex.curModeIndex());
+    if (index >= m_vortex.numModes() || !m_vortex.setCurMode(index, false)) {
+      result = "No mode at that index";
+      return false;
+    }
+    delMode(nullptr);
+    result = m_vortex.numModes();
+    return true;
+  });
+  m_rpcServer.addMethod("modes.select", [this](const json &params, json &result) {
+    uint32_t index = params.at("index").get<uint32_t>();
+    if (index >= m_vortex.numModes()) {
+      result = "No mode at that index";
+      return false;
+    }
+    m_modeListBox.setSelection(index);
+    selectMode(nullptr);
+    result = m_vortex.curModeIndex();
+    return true;
+  });
+  m_rpcServer.addMethod("modes.move", [this](const json &params, json &result) {
+    uint32_t index = params.value("index", m_vortex.curModeIndex());
+    string direction = params.at("direction").get<string>();
+    if (index >= m_vortex.numModes() || !m_vortex.setCurMode(index, false)) {
+      result = "No mode at that index";
+      return false;
+    }
+    if (direction == "up") {
+      moveModeUp(nullptr);
+    } else if (direction == "down") {
+      moveModeDown(nullptr);
+    } else {
+      result = "The direction must be up or down";
+      return false;
+    }
+    result = m_vortex.curModeIndex();
+    return true;
+  });
+  m_rpcServer.addMethod("modes.load", [this](const json &params, json &result) {
+    string filename = params.at("filename").get<string>();
+    ByteStream stream;
+    if (!VortexFile::read(filename, stream)) {
+      result = "The savefile is corrupt or could not be read";
+      return false;
+    }
+    m_vortex.setModes(stream);
+    invalidateStorage();
+    refreshModeList();
+    demoCurMode();
+    result = m_vortex.numModes();
+    return true;
+  });
+  m_rpcServer.addMethod("modes.save", [this](const json &params, json &result) {
+    string filename = params.at("filename").get<string>();
+    ByteStream stream;
+    m_vortex.getModes(stream);
+    if (!VortexFile::write(filename, stream)) {
+      result = "Failed to write the savefile";
+      return false;
+    }
+    result = m_vortex.numModes();
+    return true;
+  });
+  m_rpcServer.addMethod("modes.search", [this](const json &params, json &result) {
+    static const char *sourceNames[VortexModeIndex::SOURCE_COUNT] = { "editor", "library", "community" };
+    uint32_t numMatches = 0;
+    vector<VortexModeIndex::Result> results = searchModes(params.value("query", ""),
+      params.value("max", 100u), &numMatches);
+    json list = json::array();
+    for (const VortexModeIndex::Result &res : results) {
+      list.push_back({ { "source", sourceNames[res.source] }, { "index", res.index },
+        { "name", m_modeIndex.nameOf(res) } });
+    }
+    result = { { "matches", numMatches }, { "results", list } };
+    return true;
+  });
+  m_rpcServer.addMethod("modes.batch", [this](const json &params, json &result) {
+    // the edits are the same as the command line, ie "modes=0-3" "hue=64"
+    VortexBatchEdit batch;
+    for (const json &edit : params.at("edits")) {
+      if (!VortexCLI::parseEdit(m_vortex, edit.get<string>(), batch)) {
+        result = "Bad edit: " + edit.get<string>();
+        return false;
+      }
+    }
+    result = applyBatch(batch);
+    return true;
+  });
+  m_rpcServer.addMethod("device.list", [this](const json &params, json &result) {
+    VortexPort *curPort = nullptr;
+    getCurPort(&curPort);
+    result = json::array();
+    for (auto &port : m_portList) {
+      result.push_back({ { "port", port.first }, { "active", port.second->isActive() },
+        { "connected", port.second->isConnected() }, { "selected", port.second.get() == curPort } });
+    }
+    return true;
+  });
+  m_rpcServer.addMethod("device.select", [this](const json &params, json &result) {
+    uint32_t portNum = params.at("port").get<uint32_t>();
+    // the port dropdown only lists the active ports
+    int sel = 0;
+    for (auto &port : m_portList) {
+      if (!port.second->isActive()) {
+        continue;
+      }
+      if (port.first == portNum) {
+        m_portSelection.setSelection(sel);
+        selectPort(nullptr);
+        result = isConnected();
+        return true;
+      }
+      sel++;
+    }
+    result = "No active device on that port";
+    return false;
+  });
+  m_rpcServer.addMethod("device.push", [this](const json &params, json &result) {
+    if (!isConnected()) {
+      result = "No device is connected";
+      return false;
+    }
+    // a script can't answer the storage warning so it just fails
+    uint32_t total = 0;
+    uint32_t used = 0;
+    invalidateStorage();
+    getStorageStats(&total, &used);
+    if (used > total) {
+      result = "The modes need " + to_string(used) + " bytes but the device only has " + to_string(total);
+      return false;
+    }
+    push(nullptr);
+    result = m_vortex.numModes();
+    return true;
+  });
+  m_rpcServer.addMethod("device.pull", [this](const json &params, json &result) {
+    if (!isConnected()) {
+      result = "No device is connected";
+      return false;
+    }
+    pull(nullptr);
+    result = m_vortex.numModes();
+    return true;
+  });
+  m_rpcServer.addMethod("device.demo", [this](const json &params, json &result) {
+    if (!isConnected()) {
+      result = "No device is connected";
+      return false;
+    }
+    // demo a single color or the current mode
+    if (params.contains("color")) {
+      demoColor(strtoul(params["color"].get<string>().c_str(), nullptr, 16));
+    } else {
+      demoCurMode();
+    }
+    result = true;
+    return true;
+  });
+  m_rpcServer.addMethod("device.clearDemo", [this](const json &params, json &result) {
+    clearDemo();
+    result = true;
+    return true;
+  });
+  if (!m_rpcServer.start(endpoint, m_window.hwnd(), WM_RPC_CALL)) {
+    // most likely another editor already owns the endpoint
+    debug("Failed to start automation on %s", endpoint.c_str());
+  }
+}
+
 void VortexEditor::run()
 {
   // main message loop
@@ -368,6 +693,12 @@ void VortexEditor::run()
       DispatchMessage(&msg);
     }
   }
+  m_rpcServer.stop();
+  debug("Handled %llu automation calls", m_rpcServer.numCalls());
+  debug("Journaled %u edits, %.2fus average on the ui thread",
+    m_journal.numLogged(), m_journal.avgLogMicroseconds());
+  // clean exit so the journal isn't needed
+  m_journal.discard();
 }
 
 void VortexEditor::triggerRefresh()
@@ -427,15 +758,26 @@ void VortexEditor::handleMenus(uintptr_t hMenu)
   case ID_EDIT_PASTE_LED:
     pasteLED();
     return;
+  case ID_EDIT_COPY_MODE:
+    copyModes(false);
+    return;
+  case ID_EDIT_COPY_ALL_MODES:
+    copyModes(true);
+    return;
+  case ID_EDIT_PASTE_MODES:
+    pasteModes();
+    return;
   case ID_EDIT_CLEAR_PATTERN:
     clearLED();
     return;
   case ID_EDIT_UNDO:
     m_vortex.undo();
+    invalidateStorage();
     refreshModeList();
     return;
   case ID_EDIT_REDO:
     m_vortex.redo();
+    invalidateStorage();
     refreshModeList();
     return;
   case ID_FILE_PULL:
@@ -456,6 +798,9 @@ void VortexEditor::handleMenus(uintptr_t hMenu)
   case ID_FILE_EXPORT:
     exportMode(nullptr);
     return;
+  case ID_FILE_EXPORT_ALL:
+    exportAllModes(nullptr);
+    return;
   case ID_OPTIONS_TRANSMIT_DUO:
     transmitVL(nullptr);
     return;
@@ -477,23 +822,35 @@ void VortexEditor::handleMenus(uintptr_t hMenu)
   case ID_TOOLS_CHROMALINK:
     m_chromalink.show();
     return;
+  case ID_TOOLS_MODE_LIBRARY:
+    m_libraryBrowser.show();
+    return;
+  case ID_TOOLS_MODE_SEARCH:
+    m_modeSearch.show();
+    return;
   case ID_CHOOSE_DEVICE_ORBIT:
     m_vortex.setLedCount(28);
+    invalidateStorage();
     break;
   case ID_CHOOSE_DEVICE_HANDLE:
     m_vortex.setLedCount(3);
+    invalidateStorage();
     break;
   case ID_CHOOSE_DEVICE_GLOVES:
     m_vortex.setLedCount(10);
+    invalidateStorage();
     break;
   case ID_CHOOSE_DEVICE_CHROMADECK:
     m_vortex.setLedCount(20);
+    invalidateStorage();
     break;
   case ID_CHOOSE_DEVICE_SPARK:
     m_vortex.setLedCount(6);
+    invalidateStorage();
     break;
   case ID_CHOOSE_DEVICE_DUO:
     m_vortex.setLedCount(2);
+    invalidateStorage();
     break;
   default:
     break;
@@ -512,6 +869,10 @@ void VortexEditor::handleMenus(uintptr_t hMenu)
   // TODO seed me properly?
   Random ctx((uint32_t)time(NULL));
   Colorset newSet;
+  PatternArgs args;
+  VortexBatchEdit batch;
+  // the led that is copied to every mode
+  LedPos src = m_vortex.isCurModeMulti() ? LED_MULTI : (LedPos)pos;
   switch (menu) {
   case ID_COLORSET_RANDOM_COMPLIMENTARY:
     newSet.randomizeComplimentary(ctx);
@@ -560,6 +921,17 @@ void VortexEditor::handleMenus(uintptr_t hMenu)
     newSet.clear();
     applyColorset(newSet, sels);
     break;
+  case ID_EDIT_COLORSET_TO_ALL_MODES:
+    m_vortex.getColorset(src, newSet);
+    batch.setColorset(newSet);
+    applyBatch(batch);
+    break;
+  case ID_EDIT_PATTERN_TO_ALL_MODES:
+    m_vortex.getPatternArgs(src, args);
+    batch.setPattern(m_vortex.getPatternID(src));
+    batch.setPatternArgs(args);
+    applyBatch(batch);
+    break;
 #if 0
   // this is kinda pointless if we have ctrl+c/ctrl+v
   case ID_EDIT_COPY_COLOR_SET_TO_ALL:
@@ -681,32 +1053,61 @@ void VortexEditor::applyPattern(PatternID id, const vector<int> &selections)
 
 void VortexEditor::applyColorsetToAll(const Colorset &set)
 {
-  // TODO: put multi-led in a separate position in UI so this is more elegant
-  if (m_vortex.isCurModeMulti()) {
-    m_vortex.setColorset(LED_MULTI, set);
-  } else {
-    for (uint32_t i = 0; i < m_vortex.numLedsInMode(); ++i) {
-      m_vortex.setColorset((LedPos)i, set);
-    }
-  }
-  refreshColorSelect();
-  // update the demo
-  demoCurMode();
+  // the multi led pattern or every led of the current mode
+  VortexBatchEdit batch;
+  batch.selectModes({ m_vortex.curModeIndex() });
+  batch.setColorset(set);
+  applyBatch(batch);
 }
 
 void VortexEditor::applyPatternToAll(PatternID id)
 {
+  vector<LedPos> leds;
   for (LedPos i = LED_FIRST; i < m_vortex.numLedsInMode(); ++i) {
-    m_vortex.setPatternAt(i, id);
+    leds.push_back(i);
   }
-  refreshLedList();
+  VortexBatchEdit batch;
+  batch.selectModes({ m_vortex.curModeIndex() });
+  batch.selectLeds(leds);
+  batch.setPattern(id);
+  applyBatch(batch);
+}
+
+uint32_t VortexEditor::applyBatch(const VortexBatchEdit &batch)
+{
+  uint32_t numChanged = batch.apply(m_vortex);
+  if (!numChanged) {
+    return 0;
+  }
+  invalidateStorage();
+  refreshModeList();
   // update the demo
   demoCurMode();
+  return numChanged;
+}
+
+// convert between colorsets and the colorsets in clipboard payloads
+static void toClipboardColorset(const Colorset &set, VortexClipboard::ColorsetData &outData)
+{
+  memset(&outData, 0, sizeof(outData));
+  for (uint32_t i = 0; i < set.numColors() && i < CLIPBOARD_MAX_COLORS; ++i) {
+    outData.colors[outData.numColors++] = set.get(i).raw();
+  }
+}
+
+static void fromClipboardColorset(const VortexClipboard::ColorsetData &data, Colorset &outSet)
+{
+  outSet.clear();
+  for (uint32_t i = 0; i < data.numColors && i < CLIPBOARD_MAX_COLORS; ++i) {
+    outSet.addColor(data.colors[i]);
+  }
 }
 
 void VortexEditor::copyColorset()
 {
   string colorset = COLORSET_CLIPBOARD_MARKER;
+  VortexClipboard::ColorsetData data;
+  memset(&data, 0, sizeof(data));
   for (uint32_t i = 0; i < 8; ++i) {
     if (!m_colorSelects[i].isActive()) {
       break;
@@ -716,8 +1117,11 @@ void VortexEditor::copyColorset()
       colorset += ",";
     }
     colorset += name;
+    data.colors[data.numColors++] = m_colorSelects[i].getColor();
   }
-  setClipboard(colorset);
+  VortexClipboard::Writer payload(VortexClipboard::PAYLOAD_COLORSET);
+  payload.addColorset(data);
+  VortexClipboard::set(m_window.hwnd(), payload, colorset);
 }
 
 void VortexEditor::pasteColorset()
@@ -727,20 +1131,28 @@ void VortexEditor::pasteColorset()
   if (!sels.size()) {
     return;
   }
-  string colorset;
-  getClipboard(colorset);
-  // check for the colorset marker
-  if (strncmp(colorset.c_str(), COLORSET_CLIPBOARD_MARKER, sizeof(COLORSET_CLIPBOARD_MARKER) - 1) != 0) {
-    return;
-  }
-  vector<string> splits;
-  splitString(colorset.c_str() + sizeof(COLORSET_CLIPBOARD_MARKER) - 1, splits, ',');
   Colorset newSet;
-  for (auto field : splits) {
-    if (field == "blank" || field[0] != '#') {
-      newSet.addColor(0);
-    } else {
-      newSet.addColor(strtoul(field.c_str() + 1, NULL, 16));
+  // the binary payload is preferred, the colorset of a copied led works too
+  VortexClipboard::Reader reader;
+  if (reader.open(m_window.hwnd()) && reader.colorset(0)) {
+    fromClipboardColorset(*reader.colorset(0), newSet);
+    reader.close();
+  } else {
+    reader.close();
+    string colorset;
+    getClipboard(colorset);
+    // check for the colorset marker
+    if (strncmp(colorset.c_str(), COLORSET_CLIPBOARD_MARKER, sizeof(COLORSET_CLIPBOARD_MARKER) - 1) != 0) {
+      return;
+    }
+    vector<string> splits;
+    splitString(colorset.c_str() + sizeof(COLORSET_CLIPBOARD_MARKER) - 1, splits, ',');
+    for (auto field : splits) {
+      if (field == "blank" || field[0] != '#') {
+        newSet.addColor(0);
+      } else {
+        newSet.addColor(strtoul(field.c_str() + 1, NULL, 16));
+      }
     }
   }
   // TODO: put multi-led in a separate position in UI so this is more elegant
@@ -752,6 +1164,9 @@ void VortexEditor::pasteColorset()
     }
   }
   refreshColorSelect();
+  // the mode list isn't refreshed so measure the edited mode here
+  recalcCurModeStorage();
+  refreshStorageBar();
   demoCurMode();
 }
 
@@ -787,7 +1202,27 @@ void VortexEditor::copyLED()
     }
     led += name;
   }
-  setClipboard(led);
+  // the binary payload carries every selected led with all of it's args
+  VortexClipboard::Writer payload(VortexClipboard::PAYLOAD_LEDS);
+  vector<int> sels;
+  m_ledsMultiListBox.getSelections(sels);
+  if (pos == LED_MULTI) {
+    sels.assign(1, LED_MULTI);
+  }
+  for (int sel : sels) {
+    VortexClipboard::LedData data;
+    memset(&data, 0, sizeof(data));
+    data.pos = (uint8_t)sel;
+    data.patternID = (uint8_t)m_vortex.getPatternID((LedPos)sel);
+    PatternArgs ledArgs;
+    m_vortex.getPatternArgs((LedPos)sel, ledArgs);
+    memcpy(data.args, ledArgs.args, min(sizeof(data.args), sizeof(ledArgs.args)));
+    Colorset set;
+    m_vortex.getColorset((LedPos)sel, set);
+    toClipboardColorset(set, data.colorset);
+    payload.addLed(data);
+  }
+  VortexClipboard::set(m_window.hwnd(), payload, led);
 }
 
 void VortexEditor::splitString(const string &str, vector<string> &splits, char letter)
@@ -806,6 +1241,35 @@ void VortexEditor::pasteLED()
   if (!sels.size()) {
     return;
   }
+  // the binary payload is preferred, it's parsed in place
+  VortexClipboard::Reader reader;
+  if (reader.open(m_window.hwnd()) && reader.type() == VortexClipboard::PAYLOAD_LEDS && reader.count()) {
+    for (uint32_t i = 0; i < reader.count(); ++i) {
+      const VortexClipboard::LedData *data = reader.led(i);
+      PatternID id = (data->patternID == (uint8_t)PATTERN_NONE) ? PATTERN_NONE : (PatternID)data->patternID;
+      PatternArgs args;
+      memcpy(args.args, data->args, min(sizeof(args.args), sizeof(data->args)));
+      Colorset newSet;
+      fromClipboardColorset(data->colorset, newSet);
+      if (data->pos == LED_MULTI || isMultiLedPatternID(id) || isMultiLedPatternID(m_vortex.getPatternID(LED_ANY))) {
+        // multi led patterns set-all like the text format
+        m_vortex.setPattern(id, &args, &newSet);
+      } else if (reader.count() == 1) {
+        // a single led is pasted onto every selected led
+        for (uint32_t j = 0; j < sels.size(); ++j) {
+          m_vortex.setPatternAt((LedPos)sels[j], id, &args, &newSet);
+        }
+      } else if (data->pos < m_vortex.numLedsInMode()) {
+        // multiple leds go back to the positions they were copied from
+        m_vortex.setPatternAt((LedPos)data->pos, id, &args, &newSet);
+      }
+    }
+    reader.close();
+    refreshModeList();
+    demoCurMode();
+    return;
+  }
+  reader.close();
   // TODO: this is so ugly
   string led;
   getClipboard(led);
@@ -860,6 +1324,70 @@ void VortexEditor::pasteLED()
   demoCurMode();
 }
 
+void VortexEditor::copyModes(bool allModes)
+{
+  if (!m_vortex.numModes()) {
+    return;
+  }
+  VortexClipboard::Writer payload(VortexClipboard::PAYLOAD_MODES);
+  if (!allModes) {
+    ByteStream stream;
+    m_vortex.getCurMode(stream);
+    payload.addMode(stream);
+  } else {
+    int curSel = m_vortex.curModeIndex();
+    m_vortex.setCurMode(0, false);
+    for (uint32_t i = 0; i < m_vortex.numModes(); ++i) {
+      ByteStream stream;
+      m_vortex.getCurMode(stream);
+      payload.addMode(stream);
+      m_vortex.nextMode(false);
+    }
+    m_vortex.setCurMode(curSel, false);
+  }
+  // modes don't have a text format
+  VortexClipboard::set(m_window.hwnd(), payload, "");
+}
+
+void VortexEditor::pasteModes()
+{
+  LARGE_INTEGER freq;
+  LARGE_INTEGER startTime;
+  LARGE_INTEGER endTime;
+  QueryPerformanceFrequency(&freq);
+  QueryPerformanceCounter(&startTime);
+  VortexClipboard::Reader reader;
+  if (!reader.open(m_window.hwnd()) || reader.type() != VortexClipboard::PAYLOAD_MODES) {
+    return;
+  }
+  uint32_t count = reader.count();
+  vector<ByteStream> modes;
+  modes.reserve(count);
+  const uint8_t *data = nullptr;
+  uint32_t size = 0;
+  // a corrupt mode is skipped, the size in front of each one still leads
+  // to the next
+  while (reader.nextMode(data, size)) {
+    ByteStream stream;
+    if (!VortexFile::parse(data, size, stream)) {
+      continue;
+    }
+    modes.push_back(stream);
+  }
+  reader.close();
+  uint32_t numPasted = insertModes(modes);
+  QueryPerformanceCounter(&endTime);
+  double seconds = (double)(endTime.QuadPart - startTime.QuadPart) / (double)freq.QuadPart;
+  debug("Pasted %u of %u modes in %.3fms (%.0f modes/s)", numPasted, count, seconds * 1000.0,
+    (seconds > 0) ? (numPasted / seconds) : 0);
+  // anything that didn't make it, whether it was corrupt or wouldn't fit
+  if (numPasted < count) {
+    string msg = to_string(count - numPasted) + " of " + to_string(count) +
+      " copied modes were corrupt or could not be pasted";
+    MessageBox(m_window.hwnd(), msg.c_str(), "Paste Failed", MB_ICONERROR);
+  }
+}
+
 void VortexEditor::clearLED()
 {
   vector<int> sels;
@@ -983,6 +1511,10 @@ void VortexEditor::push(VWindow *window)
   if (!isConnected() || !getCurPort(&port)) {
     return;
   }
+  // don't push modes that won't fit unless the user really wants to
+  if (!checkStorageFits()) {
+    return;
+  }
   // send the push modes command
   port->writeData(EDITOR_VERB_PUSH_MODES);
   // read data again
@@ -1017,6 +1549,7 @@ void VortexEditor::pull(VWindow *window)
   // now set the modes
   m_vortex.matchLedCount(stream, false);
   m_vortex.setModes(stream);
+  invalidateStorage();
   // unserialized all our modes
   debug("Unserialized %u modes", m_vortex.numModes());
   // refresh the mode list
@@ -1043,18 +1576,13 @@ void VortexEditor::load(VWindow *window)
   if (!GetOpenFileName(&ofn)) {
     return;
   }
-  HANDLE hFile = CreateFile(szFile, GENERIC_READ, 0, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
-  if (!hFile) {
-    // error
+  ByteStream stream;
+  if (!VortexFile::read(szFile, stream)) {
+    MessageBox(m_window.hwnd(), "The savefile is corrupt or could not be read", "Load Failed", MB_ICONERROR);
     return;
   }
-  DWORD bytesRead = 0;
-  ByteStream stream(4096);
-  if (!ReadFile(hFile, (void *)stream.rawData(), stream.capacity(), &bytesRead, NULL)) {
-    // error
-  }
-  CloseHandle(hFile);
   m_vortex.setModes(stream);
+  invalidateStorage();
   debug("Loaded from [%s]", szFile);
   refreshModeList();
   demoCurMode();
@@ -1085,57 +1613,280 @@ void VortexEditor::save(VWindow *window)
   if (filename.substr(filename.length() - strlen(VORTEX_SAVE_EXTENSION)) != VORTEX_SAVE_EXTENSION) {
     filename.append(VORTEX_SAVE_EXTENSION);
   }
-  HANDLE hFile = CreateFile(filename.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
-  if (!hFile) {
-    // error
-    return;
-  }
-  DWORD written = 0;
   ByteStream stream;
   m_vortex.getModes(stream);
-  if (!WriteFile(hFile, stream.rawData(), stream.rawSize(), &written, NULL)) {
-    // error
+  if (!VortexFile::write(filename, stream)) {
+    MessageBox(m_window.hwnd(), "Failed to write the savefile", "Save Failed", MB_ICONERROR);
+    return;
   }
-  CloseHandle(hFile);
   debug("Saved to [%s]", filename.c_str());
   refreshModeList();
 }
 
+// the filename a mode is exported to, mode names can contain characters
+// that windows doesn't allow in filenames so those are replaced too
+static string modeFilename(uint32_t index, const string &name)
+{
+  string filename = "Mode_" + to_string(index) + "_" + name;
+  for (char &c : filename) {
+    if (c == ' ' || strchr("\\/:*?\"<>|", c)) {
+      c = '_';
+    }
+  }
+  return filename + VORTEX_MODE_EXTENSION;
+}
+
 void VortexEditor::importMode(VWindow *window)
 {
   OPENFILENAME ofn;
   memset(&ofn, 0, sizeof(ofn));
   ofn.lStructSize = sizeof(ofn);
   ofn.hwndOwner = g_pEditor->m_window.hwnd();
-  char szFile[MAX_PATH] = {0};
-  ofn.lpstrFile = szFile;
-  ofn.nMaxFile = sizeof(szFile);
+  // big enough for a few hundred filenames
+  vector<char> szFiles(IMPORT_BUFFER_SIZE, 0);
+  ofn.lpstrFile = szFiles.data();
+  ofn.nMaxFile = (DWORD)szFiles.size();
   ofn.lpstrFilter = "Vortex Mode\0*"  VORTEX_MODE_EXTENSION "\0";
   ofn.nFilterIndex = 1;
   ofn.lpstrFileTitle = NULL;
   ofn.nMaxFileTitle = 0;
   ofn.lpstrInitialDir = NULL;
-  ofn.Flags = OFN_PATHMUSTEXIST | OFN_FILEMUSTEXIST;
+  ofn.Flags = OFN_PATHMUSTEXIST | OFN_FILEMUSTEXIST | OFN_ALLOWMULTISELECT | OFN_EXPLORER;
   if (!GetOpenFileName(&ofn)) {
     return;
   }
-  HANDLE hFile = CreateFile(szFile, GENERIC_READ, 0, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
-  if (!hFile) {
-    // error
+  // a single file is just the full path, otherwise it's the directory
+  // followed by each filename all separated by nulls
+  vector<string> filenames;
+  const char *pos = szFiles.data();
+  string first = pos;
+  pos += first.length() + 1;
+  if (!*pos) {
+    filenames.push_back(first);
+  }
+  while (*pos) {
+    filenames.push_back(first + "\\" + pos);
+    pos += strlen(pos) + 1;
+  }
+  importModes(filenames);
+}
+
+void VortexEditor::importModes(const vector<string> &filenames)
+{
+  uint32_t count = (uint32_t)filenames.size();
+  if (!count) {
+    return;
+  }
+  LARGE_INTEGER freq;
+  LARGE_INTEGER startTime;
+  LARGE_INTEGER endTime;
+  QueryPerformanceFrequency(&freq);
+  QueryPerformanceCounter(&startTime);
+  // each worker validates with it's own engine
+  while (m_scratchVortex.size() < m_workerPool.numWorkers() || !m_scratchVortex.size()) {
+    m_scratchVortex.push_back(make_unique<Vortex>());
+    m_scratchVortex.back()->init();
+  }
+  vector<ByteStream> streams(count);
+  vector<uint64_t> hashes(count, 0);
+  vector<uint8_t> valid(count, 0);
+  m_workerPool.parallelFor(count, [&](uint32_t i, uint32_t worker) {
+    if (!VortexFile::read(filenames[i], streams[i])) {
+      return;
+    }
+    // the same checks as adding the mode to the editor
+    Vortex &scratch = *m_scratchVortex[worker];
+    scratch.engine().modes().clearModes();
+    ByteStream copy = streams[i];
+    // modes made for a different device still import
+    scratch.matchLedCount(copy, true);
+    valid[i] = scratch.addNewMode(copy, false);
+    hashes[i] = VortexModeHash::hashMode(streams[i]);
+  });
+  // find any modes that are already in the list or repeated in the batch
+  vector<uint8_t> inList;
+  findModes(streams, hashes, inList);
+  vector<uint8_t> duplicate(count, 0);
+  uint32_t numDuplicates = 0;
+  unordered_map<uint64_t, uint32_t> seen;
+  for (uint32_t i = 0; i < count; ++i) {
+    if (!valid[i]) {
+      continue;
+    }
+    auto first = seen.emplace(hashes[i], i).first;
+    bool repeated = (first->second != i) && VortexModeHash::sameMode(streams[first->second], streams[i]);
+    if (repeated || inList[i]) {
+      duplicate[i] = 1;
+      numDuplicates++;
+    }
+  }
+  bool skipDuplicates = false;
+  if (numDuplicates) {
+    string msg = to_string(numDuplicates) + " of the selected modes are already in the mode list. Skip the duplicates?";
+    skipDuplicates = MessageBox(m_window.hwnd(), msg.c_str(), "Duplicate Modes", MB_YESNO | MB_ICONQUESTION) == IDYES;
+  }
+  // add every valid mode in order
+  vector<ByteStream> modes;
+  uint32_t numSkipped = 0;
+  for (uint32_t i = 0; i < count; ++i) {
+    if (!valid[i]) {
+      continue;
+    }
+    if (skipDuplicates && duplicate[i]) {
+      numSkipped++;
+      continue;
+    }
+    modes.push_back(streams[i]);
+  }
+  uint32_t numImported = insertModes(modes);
+  QueryPerformanceCounter(&endTime);
+  double seconds = (double)(endTime.QuadPart - startTime.QuadPart) / (double)freq.QuadPart;
+  double rate = (seconds > 0) ? (numImported / seconds) : 0;
+  debug("Imported %u of %u modes in %.3fs (%.0f modes/s)", numImported, count, seconds, rate);
+  if (numImported + numSkipped < count) {
+    string msg = to_string(count - numImported - numSkipped) + " of " + to_string(count) +
+      " mode files were corrupt or could not be imported";
+    MessageBox(m_window.hwnd(), msg.c_str(), "Import Failed", MB_ICONERROR);
+  }
+  if (count > 1) {
+    m_statusBar.setStatus(RGB(0, 255, 255), ("Imported " + to_string(numImported) +
+      " modes (" + to_string((uint32_t)rate) + " modes/s)");
+  }
+}
+
+uint32_t VortexEditor::insertModes(vector<ByteStream> &modes)
+{
+  uint32_t numAdded = 0;
+  for (uint32_t i = 0; i < modes.size(); ++i) {
+    if (m_vortex.addNewMode(modes[i], false)) {
+      numAdded++;
+    }
+  }
+  if (numAdded) {
+    // a single save after the batch so it's a single undo step, even if
+    // the last mode is the one that failed
+    m_vortex.setCurMode(m_vortex.curModeIndex(), true);
+    invalidateStorage();
+    refreshModeList();
+    demoCurMode();
+  }
+  return numAdded;
+}
+
+void VortexEditor::exportAllModes(VWindow *window)
+{
+  if (!m_vortex.numModes()) {
     return;
   }
-  DWORD bytesRead = 0;
-  ByteStream stream(4096);
-  if (!ReadFile(hFile, (void *)stream.rawData(), stream.capacity(), &bytesRead, NULL)) {
-    // error
+  BROWSEINFO bi;
+  memset(&bi, 0, sizeof(bi));
+  bi.hwndOwner = m_window.hwnd();
+  bi.lpszTitle = "Export all modes to folder";
+  bi.ulFlags = BIF_RETURNONLYFSDIRS;
+  LPITEMIDLIST pidl = SHBrowseForFolder(&bi);
+  if (!pidl) {
+    return;
+  }
+  char szDir[MAX_PATH] = {0};
+  bool gotPath = SHGetPathFromIDList(pidl, szDir);
+  CoTaskMemFree(pidl);
+  if (!gotPath) {
+    return;
+  }
+  LARGE_INTEGER freq;
+  LARGE_INTEGER startTime;
+  LARGE_INTEGER endTime;
+  QueryPerformanceFrequency(&freq);
+  QueryPerformanceCounter(&startTime);
+  // the modes are serialized here because the engine isn't thread safe,
+  // the workers only write the files
+  uint32_t count = m_vortex.numModes();
+  vector<ByteStream> modes(count);
+  vector<string> filenames(count);
+  int curSel = m_vortex.curModeIndex();
+  m_vortex.setCurMode(0, false);
+  for (uint32_t i = 0; i < count; ++i) {
+    m_vortex.getCurMode(modes[i]);
+    filenames[i] = string(szDir) + "\\" + modeFilename(i, m_vortex.getModeName());
+    m_vortex.nextMode(false);
+  }
+  m_vortex.setCurMode(curSel, false);
+  vector<uint8_t> written(count, 0);
+  m_workerPool.parallelFor(count, [&](uint32_t i, uint32_t worker) {
+    written[i] = VortexFile::write(filenames[i], modes[i]);
+  });
+  uint32_t numExported = 0;
+  for (uint32_t i = 0; i < count; ++i) {
+    numExported += written[i];
   }
-  CloseHandle(hFile);
+  QueryPerformanceCounter(&endTime);
+  double seconds = (double)(endTime.QuadPart - startTime.QuadPart) / (double)freq.QuadPart;
+  double rate = (seconds > 0) ? (numExported / seconds) : 0;
+  debug("Exported %u of %u modes to [%s] in %.3fs (%.0f modes/s)", numExported, count, szDir, seconds, rate);
+  if (numExported < count) {
+    string msg = "Failed to write " + to_string(count - numExported) + " of " + to_string(count) + " mode files";
+    MessageBox(m_window.hwnd(), msg.c_str(), "Export Failed", MB_ICONERROR);
+  }
+  m_statusBar.setStatus(RGB(0, 255, 255), ("Exported " + to_string(numExported) +
+    " modes (" + to_string((uint32_t)rate) + " modes/s)");
+}
+
+bool VortexEditor::addModeFromStream(ByteStream &stream)
+{
   if (!m_vortex.addNewMode(stream)) {
-    // error
+    return false;
   }
-  debug("Loaded from [%s]", szFile);
+  invalidateStorage();
   refreshModeList();
   demoCurMode();
+  return true;
+}
+
+vector<VortexModeIndex::Result> VortexEditor::searchModes(const string &query,
+  uint32_t maxResults, uint32_t *outNumMatches)
+{
+  // bring the index of the modes in the editor up to date first
+  getStorageStats(nullptr, nullptr);
+  return m_modeIndex.search(query, maxResults, outNumMatches);
+}
+
+bool VortexEditor::hasMode(const ByteStream &mode)
+{
+  vector<uint8_t> found;
+  findModes({ mode }, { VortexModeHash::hashMode(mode) }, found);
+  return found[0] != 0;
+}
+
+void VortexEditor::findModes(const vector<ByteStream> &modes, const vector<uint64_t> &hashes,
+  vector<uint8_t> &outFound)
+{
+  outFound.assign(modes.size(), 0);
+  // bring the cached hashes up to date first
+  getStorageStats(nullptr, nullptr);
+  unordered_multimap<uint64_t, uint32_t> stored;
+  for (uint32_t i = 0; i < m_modeStorage.size(); ++i) {
+    stored.emplace(m_modeStorage[i].hash, i);
+  }
+  // the modes in the list that a hash matched, by index
+  unordered_map<uint32_t, ByteStream> existing;
+  int curSel = m_vortex.curModeIndex();
+  for (uint32_t i = 0; i < modes.size(); ++i) {
+    auto range = stored.equal_range(hashes[i]);
+    for (auto it = range.first; !outFound[i] && it != range.second; ++it) {
+      auto ent = existing.find(it->second);
+      if (ent == existing.end()) {
+        ByteStream stream;
+        m_vortex.setCurMode(it->second, false);
+        m_vortex.getCurMode(stream);
+        ent = existing.emplace(it->second, stream).first;
+      }
+      // the hash only narrows it down, the mode itself has to match
+      outFound[i] = VortexModeHash::sameMode(ent->second, modes[i]);
+    }
+  }
+  if (existing.size()) {
+    m_vortex.setCurMode(curSel, false);
+  }
 }
 
 void VortexEditor::exportMode(VWindow *window)
@@ -1147,9 +1898,7 @@ void VortexEditor::exportMode(VWindow *window)
   memset(&ofn, 0, sizeof(ofn));
   ofn.lStructSize = sizeof(ofn);
   ofn.hwndOwner = NULL;
-  string modeName = "Mode_" + to_string(m_vortex.curModeIndex()) + "_" + m_vortex.getModeName();
-  replace(modeName.begin(), modeName.end(), ' ', '_');
-  modeName += VORTEX_MODE_EXTENSION;
+  string modeName = modeFilename(m_vortex.curModeIndex(), m_vortex.getModeName());
   char szFile[MAX_PATH] = {0};
   memcpy(szFile, modeName.c_str(), modeName.length());
   ofn.lpstrFile = szFile;
@@ -1170,18 +1919,12 @@ void VortexEditor::exportMode(VWindow *window)
   if (filename.substr(filename.length() - strlen(VORTEX_MODE_EXTENSION)) != VORTEX_MODE_EXTENSION) {
     filename.append(VORTEX_MODE_EXTENSION);
   }
-  HANDLE hFile = CreateFile(filename.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
-  if (!hFile) {
-    // error
-    return;
-  }
-  DWORD written = 0;
   ByteStream stream;
   m_vortex.getCurMode(stream);
-  if (!WriteFile(hFile, stream.rawData(), stream.rawSize(), &written, NULL)) {
-    // error
+  if (!VortexFile::write(filename, stream)) {
+    MessageBox(m_window.hwnd(), "Failed to write the mode file", "Export Failed", MB_ICONERROR);
+    return;
   }
-  CloseHandle(hFile);
   debug("Saved to [%s]", filename.c_str());
 }
 
@@ -1263,6 +2006,8 @@ void VortexEditor::selectMode(VWindow *window)
   if (sel < 0) {
     return;
   }
+  // only the current mode is measured, so measure it before leaving it
+  recalcCurModeStorage();
   if (!m_vortex.setCurMode(sel)) {
     // error!
     return;
@@ -1325,6 +2070,7 @@ void VortexEditor::addMode(VWindow *window)
 #endif
   debug("Adding mode %u", m_vortex.numModes() + 1);
   m_vortex.addNewMode();
+  invalidateStorage();
   m_modeListBox.setSelection(m_vortex.curModeIndex());
   refreshModeList();
   if (m_vortex.numModes() == 1) {
@@ -1346,6 +2092,7 @@ void VortexEditor::addMode(VWindow *window, const Mode *mode)
 #endif
   debug("Adding mode %u", m_vortex.numModes() + 1);
   m_vortex.addMode(mode);
+  invalidateStorage();
   m_vortex.setCurMode(m_vortex.numModes() - 1);
   m_modeListBox.setSelection(m_vortex.curModeIndex());
   refreshModeList();
@@ -1357,6 +2104,7 @@ void VortexEditor::delMode(VWindow *window)
   debug("Deleting mode %u", m_vortex.curModeIndex());
   uint32_t cur = m_vortex.curModeIndex();
   m_vortex.delCurMode();
+  invalidateStorage();
   refreshModeList();
   if (!m_vortex.numModes()) {
     clearDemo();
@@ -1378,18 +2126,21 @@ void VortexEditor::copyMode(VWindow *window)
   ByteStream stream;
   m_vortex.getCurMode(stream);
   m_vortex.addNewMode(stream);
+  invalidateStorage();
   refreshModeList();
 }
 
 void VortexEditor::moveModeUp(VWindow *window)
 {
   m_vortex.shiftCurMode(-1);
+  invalidateStorage();
   refreshModeList();
 }
 
 void VortexEditor::moveModeDown(VWindow *window)
 {
   m_vortex.shiftCurMode(1);
+  invalidateStorage();
   refreshModeList();
 }
 
@@ -1453,15 +2204,19 @@ void VortexEditor::copyToAll(VWindow *window)
   m_vortex.getPatternArgs((LedPos)pos, args);
   Colorset set;
   m_vortex.getColorset((LedPos)pos, set);
+  vector<LedPos> leds;
   for (LedPos i = LED_FIRST; i < m_vortex.numLedsInMode(); ++i) {
-    if (pos == i) {
-      continue;
+    if (pos != i) {
+      leds.push_back(i);
     }
-    m_vortex.setPatternAt(i, pat, &args, &set);
   }
-  refreshModeList();
-  // update the demo
-  demoCurMode();
+  VortexBatchEdit batch;
+  batch.selectModes({ m_vortex.curModeIndex() });
+  batch.selectLeds(leds);
+  batch.setPattern(pat);
+  batch.setPatternArgs(args);
+  batch.setColorset(set);
+  applyBatch(batch);
 }
 
 void VortexEditor::paramEdit(VWindow *window)
@@ -1504,6 +2259,9 @@ void VortexEditor::paramEdit(VWindow *window)
       refreshLedList(false);
     }
   }
+  // the mode list isn't refreshed so measure the edited mode here
+  recalcCurModeStorage();
+  refreshStorageBar();
   // update the demo
   demoCurMode();
 }
@@ -1676,18 +2434,27 @@ void VortexEditor::refreshStorageBar()
 {
   uint32_t total = 0;
   uint32_t used = 0;
-  m_vortex.getStorageStats(&total, &used);
+  getStorageStats(&total, &used);
+  if (!total) {
+    return;
+  }
   float percent = (float)used / (float)total;
+  if (percent > 1.0f) {
+    percent = 1.0f;
+  }
   // integer percent from 0 - 280
-  uint32_t intPct = (uint32_t)(percent * 280.0);
+  uint32_t intPct = (uint32_t)(percent * STORAGE_BAR_STEPS);
   m_storageProgress.setSelection(intPct, 0);
-  m_storageProgress.redraw();
-  static HBITMAP bitty = nullptr;
-  if (bitty) {
-    DeleteObject(bitty);
+  // only generate a new background when the bar actually moves
+  if (!m_storageBitmap || intPct != m_storagePct) {
+    if (m_storageBitmap) {
+      DeleteObject(m_storageBitmap);
+    }
+    m_storageBitmap = genProgressBack(STORAGE_BAR_STEPS, 16, intPct);
+    m_storagePct = intPct;
+    m_storageProgress.setBackground(m_storageBitmap);
+    m_storageProgress.redraw();
   }
-  bitty = genProgressBack(280, 16, percent);
-  m_storageProgress.setBackground(bitty);
   string space = "Storage Space (";
   space += to_string(used);
   space += " / ";
@@ -1696,30 +2463,171 @@ void VortexEditor::refreshStorageBar()
   m_storageProgress.setTooltip(space);
 }
 
-HBITMAP VortexEditor::genProgressBack(uint32_t width, uint32_t height, float progress)
+void VortexEditor::recalcStorage()
 {
-  COLORREF *cols = new COLORREF[width * height];
-  if (!cols) {
-    return nullptr;
+  uint32_t numModes = m_vortex.numModes();
+  m_modeStorage.resize(numModes);
+  uint32_t curSel = m_vortex.curModeIndex();
+  uint32_t sum = 0;
+  vector<ByteStream> modes;
+  m_vortex.setCurMode(0, false);
+  for (uint32_t i = 0; i < numModes; ++i) {
+    ByteStream stream;
+    m_vortex.getCurMode(stream);
+    m_modeStorage[i].crc32 = stream.recalcCRC();
+    m_modeStorage[i].rawSize = stream.rawSize();
+    m_modeStorage[i].hash = VortexModeHash::hashMode(stream);
+    indexCurMode(i, m_modeStorage[i].hash);
+    modes.push_back(stream);
+    stream.compress();
+    m_modeStorage[i].compressedSize = stream.rawSize();
+    sum += m_modeStorage[i].compressedSize;
+    m_vortex.nextMode(false);
   }
-  uint32_t threshold = (uint32_t)(width * progress);
-  // the real x and y are the internal coords inside the border where as
-  // m_width and m_height contain the border size in them
-  for (uint32_t x = 0; x < width; ++x) {
-    RGBColor rgbCol;
-    COLORREF col = 0;
-    if (x < threshold) {
+  m_vortex.setCurMode(curSel, false);
+  // any modes past the end were deleted
+  m_modeIndex.truncate(VortexModeIndex::SOURCE_EDITOR, numModes);
+  // the real stats are only fetched here, the overhead of the savefile is
+  // whatever isn't accounted for by the modes and it stays fixed so the
+  // cached sizes can be updated one mode at a time after this
+  uint32_t used = 0;
+  m_vortex.getStorageStats(&m_storageTotal, &used);
+  m_storageOverhead = (int32_t)used - (int32_t)sum;
+  m_storageDirty = false;
+  // anything that invalidates the storage may have changed every mode
+  m_journal.logSnapshot(modes);
+}
+
+void VortexEditor::recalcCurModeStorage()
+{
+  uint32_t cur = m_vortex.curModeIndex();
+  if (m_storageDirty || m_modeStorage.size() != m_vortex.numModes() || cur >= m_modeStorage.size()) {
+    // the next refresh measures every mode anyway
+    return;
+  }
+  ByteStream stream;
+  m_vortex.getCurMode(stream);
+  uint32_t crc = stream.recalcCRC();
+  if (crc == m_modeStorage[cur].crc32 && stream.rawSize() == m_modeStorage[cur].rawSize) {
+    // the mode hasn't changed since it was last measured
+    return;
+  }
+  m_journal.logMode(cur, stream);
+  m_modeStorage[cur].crc32 = crc;
+  m_modeStorage[cur].rawSize = stream.rawSize();
+  m_modeStorage[cur].hash = VortexModeHash::hashMode(stream);
+  indexCurMode(cur, m_modeStorage[cur].hash);
+  stream.compress();
+  m_modeStorage[cur].compressedSize = stream.rawSize();
+}
+
+void VortexEditor::getStorageStats(uint32_t *outTotal, uint32_t *outUsed)
+{
+  if (m_storageDirty || m_modeStorage.size() != m_vortex.numModes()) {
+    recalcStorage();
+  } else {
+    // only the current mode can be edited between refreshes
+    recalcCurModeStorage();
+  }
+  int32_t used = m_storageOverhead;
+  for (auto &mode : m_modeStorage) {
+    used += mode.compressedSize;
+  }
+  if (outTotal) {
+    *outTotal = m_storageTotal;
+  }
+  if (outUsed) {
+    *outUsed = (used > 0) ? (uint32_t)used : 0;
+  }
+}
+
+void VortexEditor::indexCurMode(uint32_t index, uint64_t hash)
+{
+  uint64_t indexedHash = 0;
+  if (m_modeIndex.hashOf(VortexModeIndex::SOURCE_EDITOR, index, indexedHash) && indexedHash == hash) {
+    // only summarize modes that changed
+    return;
+  }
+  VortexModeLibrary::Entry summary;
+  VortexModeLibrary::summarize(m_vortex, m_vortex.getModeName(), summary);
+  summary.hash = hash;
+  m_modeIndex.update(VortexModeIndex::SOURCE_EDITOR, index, summary);
+}
+
+bool VortexEditor::checkStorageFits()
+{
+  // the cached stats are only an estimate so get the real thing before
+  // actually deciding whether the modes will fit
+  invalidateStorage();
+  uint32_t total = 0;
+  uint32_t used = 0;
+  getStorageStats(&total, &used);
+  if (used <= total) {
+    return true;
+  }
+  string msg = "The modes need " + to_string(used) + " bytes but the device only has " +
+    to_string(total) + " bytes of storage, some modes may be lost.\n\nPush anyway?";
+  return MessageBox(m_window.hwnd(), msg.c_str(), "Not Enough Storage", MB_YESNO | MB_ICONWARNING) == IDYES;
+}
+
+void VortexEditor::recoverJournal()
+{
+  vector<ByteStream> modes;
+  if (!VortexJournal::recover(JOURNAL_FILENAME, modes)) {
+    DeleteFile(JOURNAL_FILENAME);
+    return;
+  }
+  string msg = "The editor did not close properly last time, recover the " +
+    to_string(modes.size()) + " modes from that session?";
+  if (MessageBox(m_window.hwnd(), msg.c_str(), "Recover Session", MB_YESNO | MB_ICONQUESTION) != IDYES) {
+    DeleteFile(JOURNAL_FILENAME);
+    return;
+  }
+  m_vortex.engine().modes().clearModes();
+  if (modes.size()) {
+    m_vortex.matchLedCount(modes[0], true);
+  }
+  for (ByteStream &mode : modes) {
+    m_vortex.addNewMode(mode, false);
+  }
+  m_vortex.setCurMode(0, false);
+  invalidateStorage();
+  debug("Recovered %u modes from the journal", (uint32_t)modes.size());
+}
+
+HBITMAP VortexEditor::genProgressBack(uint32_t width, uint32_t height, uint32_t intPct)
+{
+  // the color of the bar for each step is only calculated once
+  static COLORREF gradient[STORAGE_BAR_STEPS + 1] = { 0 };
+  static bool gradientReady = false;
+  if (!gradientReady) {
+    for (uint32_t i = 0; i <= STORAGE_BAR_STEPS; ++i) {
+      float progress = (float)i / STORAGE_BAR_STEPS;
       uint32_t r = (uint32_t)(progress * 255);
       // scale green to 512 to make it stay green longer
       uint32_t g = (uint32_t)((1.0f - progress) * 512);
       if (g > 255) {
         g = 255;
       }
-      col = (r << 16) | (g << 8);
-    }
-    for (uint32_t y = 0; y < height; ++y) {
-      cols[(y * width) + x] = col;
+      gradient[i] = (r << 16) | (g << 8);
     }
+    gradientReady = true;
+  }
+  if (intPct > STORAGE_BAR_STEPS) {
+    intPct = STORAGE_BAR_STEPS;
+  }
+  COLORREF *cols = new COLORREF[width * height];
+  if (!cols) {
+    return nullptr;
+  }
+  uint32_t threshold = (width * intPct) / STORAGE_BAR_STEPS;
+  COLORREF col = gradient[intPct];
+  // fill the first row then copy it down the rest of the bitmap
+  for (uint32_t x = 0; x < width; ++x) {
+    cols[x] = (x < threshold) ? col : 0;
+  }
+  for (uint32_t y = 1; y < height; ++y) {
+    memcpy(cols + (y * width), cols, width * sizeof(COLORREF));
   }
   HBITMAP bitmap = CreateBitmap(width, height, 1, 32, cols);
   delete[] cols;
@@ -30,6 +30,14 @@
 #include "VortexCommunityBrowser.h"
 #include "VortexChromaLink.h"
 #include "VortexEditorTutorial.h"
+#include "VortexLibraryBrowser.h"
+#include "VortexModeSearch.h"
+#include "VortexModeIndex.h"
+#include "VortexBatchEdit.h"
+#include "VortexJournal.h"
+#include "VortexThreadPool.h"
+#include "VortexClipboard.h"
+#include "VortexRPCServer.h"
 #include "ArduinoSerial.h"
 
 // stl includes
@@ -53,12 +61,16 @@ class VortexEditor
   friend class VortexColorPicker;
   friend class VortexModeRandomizer;
   friend class VortexCommunityBrowser;
+  friend class VortexLibraryBrowser;
+  friend class VortexModeSearch;
 public:
   VortexEditor();
   ~VortexEditor();
 
-  // initialize the test framework
-  bool init(HINSTANCE hInstance);
+  // initialize the test framework, a headless editor keeps the window
+  // hidden and is only driven through the automation endpoint
+  bool init(HINSTANCE hInstance, bool headless = false,
+    const std::string &rpcEndpoint = RPC_DEFAULT_ENDPOINT);
   // run the test framework
   void run();
 
@@ -68,6 +80,22 @@ public:
   HINSTANCE hInst() const { return m_hInstance; }
 
   void addMode(VWindow *window, const Mode *mode);
+  // add a mode from a serialized .vtxmode stream
+  bool addModeFromStream(ByteStream &stream);
+  // whether the mode is already in the mode list
+  bool hasMode(const ByteStream &mode);
+  // which of a batch of modes are already in the mode list, given the
+  // VortexModeHash of each one, a mode in the list that has to be compared
+  // against is only serialized once for the whole batch
+  void findModes(const std::vector<ByteStream> &modes, const std::vector<uint64_t> &hashes,
+    std::vector<uint8_t> &outFound);
+  // search the modes in the editor, the open library and the community
+  // pages, see VortexModeIndex for the query syntax
+  std::vector<VortexModeIndex::Result> searchModes(const std::string &query,
+    uint32_t maxResults = UINT32_MAX, uint32_t *outNumMatches = nullptr);
+  // apply a batch of edits as a single undo step with a single refresh,
+  // returns the number of leds that were changed
+  uint32_t applyBatch(const VortexBatchEdit &batch);
 
 private:
   static DWORD __stdcall scanPortsThread(void *arg);
@@ -107,6 +135,9 @@ private:
   static void connectTestFrameworkCallback(void *editor, VWindow *window) { ((VortexEditor *)editor)->connectPort(0); }
   static void disconnectTestFrameworkCallback(void *editor, VWindow *window) { ((VortexEditor *)editor)->disconnectPort(0); }
 
+  // run the automation calls that are waiting
+  static void rpcCallback(void *editor, VWindow *window) { ((VortexEditor *)editor)->m_rpcServer.dispatch(); }
+
   // device change handler
   static void deviceChangeCallback(void *editor, DEV_BROADCAST_HDR *dbh, bool added) { ((VortexEditor *)editor)->deviceChange(dbh, added); }
 
@@ -123,6 +154,12 @@ private:
   void save(VWindow *window);
   void importMode(VWindow *window);
   void exportMode(VWindow *window);
+  void exportAllModes(VWindow *window);
+  // read and validate a batch of .vtxmode files on the worker pool then
+  // add them all at once
+  void importModes(const std::vector<std::string> &filenames);
+  // add a batch of modes as a single undo step, returns how many were added
+  uint32_t insertModes(std::vector<ByteStream> &modes);
   void transmitVL(VWindow *window);
   void transmitIR(VWindow *window);
   void receiveVL(VWindow *window);
@@ -162,6 +199,8 @@ private:
   void copyLED();
   void pasteLED();
   void clearLED();
+  void copyModes(bool allModes);
+  void pasteModes();
 
   // helper for clipboard
   void getClipboard(std::string &clipData);
@@ -173,6 +212,19 @@ private:
   void refreshPortList();
   void refreshStatus();
   void refreshStorageBar();
+
+  // the storage bar works off cached per-mode sizes so that only the modes
+  // which actually changed need to be re-serialized on each refresh
+  void recalcStorage();
+  void recalcCurModeStorage();
+  void invalidateStorage() { m_storageDirty = true; }
+  void getStorageStats(uint32_t *outTotal, uint32_t *outUsed);
+  // update the search index with the current mode if it changed
+  void indexCurMode(uint32_t index, uint64_t hash);
+  // check whether the modes will fit on the device, warns the user if not
+  bool checkStorageFits();
+  // offer to recover the modes from the journal of a session that crashed
+  void recoverJournal();
   // but the mode list, led list, etc are all considered a heirarchy so
   // there is an option to recursively refresh all children elements
   void refreshModeList(bool recursive = true);
@@ -193,7 +245,7 @@ private:
   void splitString(const std::string &str, std::vector<std::string> &splits, char letter);
 
   // generate the progress bar background for storage space
-  HBITMAP genProgressBack(uint32_t width, uint32_t height, float progress);
+  HBITMAP genProgressBack(uint32_t width, uint32_t height, uint32_t intPct);
 
   // get the current pattern selection from the pattern dropdown
   PatternID patternSelection() const;
@@ -201,6 +253,9 @@ private:
   // start the interactive tutorial
   void beginTutorial();
 
+  // register the automation methods and start listening for clients
+  void initAutomation(const std::string &endpoint);
+
   // ==================================
   //  Member data
 
@@ -224,6 +279,48 @@ private:
   uint32_t m_lastClickedColor;
   // thread for scanning the ports for connected devices on init
   HANDLE m_scanPortsThread;
+  // whether the window is hidden and only automation drives the editor
+  bool m_headless;
+
+  // the cached storage size of a single mode
+  struct ModeStorage
+  {
+    // size of the serialized mode
+    uint32_t rawSize;
+    // size of the serialized mode once compressed
+    uint32_t compressedSize;
+    // crc of the serialized mode to detect when it changes
+    uint32_t crc32;
+    // content hash of the mode to detect duplicates
+    uint64_t hash;
+  };
+  // cached storage sizes of each mode
+  std::vector<ModeStorage> m_modeStorage;
+  // size of the savefile header etc that isn't part of any mode
+  int32_t m_storageOverhead;
+  // total storage space available
+  uint32_t m_storageTotal;
+  // whether the cached sizes of all modes need to be recalculated
+  bool m_storageDirty;
+  // the percent currently shown in the storage bar and it's background
+  uint32_t m_storagePct;
+  HBITMAP m_storageBitmap;
+
+  // the modes serialized for the storage bar are also written to the
+  // journal so the session can be recovered after a crash
+  VortexJournal m_journal;
+
+  // workers for bulk file operations and a scratch engine for each worker
+  // to validate modes with
+  VortexThreadPool m_workerPool;
+  std::vector<std::unique_ptr<Vortex>> m_scratchVortex;
+
+  // the search index over every mode the editor knows about, the modes in
+  // the editor are kept up to date along with the cached storage sizes
+  VortexModeIndex m_modeIndex;
+
+  // the automation endpoint, each method maps onto an editor action
+  VortexRPCServer m_rpcServer;
 
   // ==================================
   //  GUI Members
@@ -264,6 +361,8 @@ private:
   VortexCommunityBrowser m_communityBrowser;
   VortexEditorTutorial m_tutorial;
   VortexChromaLink m_chromalink;
+  VortexLibraryBrowser m_libraryBrowser;
+  VortexModeSearch m_modeSearch;
 };
 
 extern VortexEditor *g_pEditor;
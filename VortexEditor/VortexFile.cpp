@@ -0,0 +1,158 @@
+#include "VortexFile.h"
+
+#include "Serial/ByteStream.h"
+
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+// files are streamed through a buffer of this size
+#define FILE_CHUNK_SIZE (64 * 1024)
+
+using namespace std;
+
+bool VortexFile::read(const string &filename, ByteStream &outStream)
+{
+  ifstream file(filename, ios::binary | ios::ate);
+  if (!file.is_open()) {
+    return false;
+  }
+  uint64_t fileSize = (uint64_t)file.tellg();
+  if (fileSize < sizeof(Header)) {
+    return false;
+  }
+  file.seekg(0, ios::beg);
+  Header header;
+  if (!file.read((char *)&header, sizeof(header))) {
+    return false;
+  }
+  // the size in the header must fit within the file, anything trailing the
+  // data is ignored because older saves didn't truncate when overwriting
+  if (!header.size || header.size > (fileSize - sizeof(Header))) {
+    return false;
+  }
+  // nothing is touched until the entire buffer is read and validated
+  ByteStream stream;
+  if (!stream.init(header.size)) {
+    return false;
+  }
+  uint8_t *raw = (uint8_t *)stream.rawData();
+  memcpy(raw, &header, sizeof(header));
+  uint64_t remaining = header.size;
+  uint8_t *pos = raw + sizeof(header);
+  while (remaining > 0) {
+    uint32_t amt = (remaining > FILE_CHUNK_SIZE) ? FILE_CHUNK_SIZE : (uint32_t)remaining;
+    if (!file.read((char *)pos, amt)) {
+      return false;
+    }
+    pos += amt;
+    remaining -= amt;
+  }
+  // recalculate the crc of the data that was read and compare it against
+  // the crc that was stored in the file
+  if (stream.recalcCRC(true) != header.crc32) {
+    return false;
+  }
+  outStream = stream;
+  return true;
+}
+
+bool VortexFile::parse(const void *data, uint64_t size, ByteStream &outStream)
+{
+  if (!data || size < sizeof(Header)) {
+    return false;
+  }
+  const Header *header = (const Header *)data;
+  if (!header->size || header->size > (size - sizeof(Header))) {
+    return false;
+  }
+  ByteStream stream;
+  if (!stream.init(header->size)) {
+    return false;
+  }
+  memcpy((void *)stream.rawData(), data, sizeof(Header) + header->size);
+  if (stream.recalcCRC(true) != header->crc32) {
+    return false;
+  }
+  outStream = stream;
+  return true;
+}
+
+bool VortexFile::write(const string &filename, ByteStream &stream)
+{
+  if (!stream.rawSize()) {
+    return false;
+  }
+  // make sure the crc written to disk actually matches the data
+  stream.recalcCRC();
+  string tempFilename = filename + ".tmp";
+  if (!writeDurable(tempFilename, stream.rawData(), stream.rawSize())) {
+    remove(tempFilename.c_str());
+    return false;
+  }
+  if (!replaceFile(tempFilename, filename)) {
+    remove(tempFilename.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool VortexFile::writeDurable(const string &filename, const void *data, uint32_t size)
+{
+  // the data has to actually be on the disk before the temp file replaces
+  // the real one, otherwise a crash right after the rename can still leave
+  // an empty or partial savefile behind
+  const char *pos = (const char *)data;
+  uint32_t remaining = size;
+#ifdef _WIN32
+  HANDLE hFile = CreateFile(filename.c_str(), GENERIC_WRITE, 0, NULL,
+    CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (hFile == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  while (remaining > 0) {
+    DWORD amt = (remaining > FILE_CHUNK_SIZE) ? FILE_CHUNK_SIZE : remaining;
+    DWORD written = 0;
+    if (!WriteFile(hFile, pos, amt, &written, NULL) || written != amt) {
+      break;
+    }
+    pos += amt;
+    remaining -= amt;
+  }
+  bool success = !remaining && FlushFileBuffers(hFile);
+  CloseHandle(hFile);
+  return success;
+#else
+  FILE *file = fopen(filename.c_str(), "wb");
+  if (!file) {
+    return false;
+  }
+  while (remaining > 0) {
+    uint32_t amt = (remaining > FILE_CHUNK_SIZE) ? FILE_CHUNK_SIZE : remaining;
+    if (fwrite(pos, 1, amt, file) != amt) {
+      break;
+    }
+    pos += amt;
+    remaining -= amt;
+  }
+  bool success = !remaining && fflush(file) == 0 && fsync(fileno(file)) == 0;
+  fclose(file);
+  return success;
+#endif
+}
+
+bool VortexFile::replaceFile(const string &from, const string &to)
+{
+#ifdef _WIN32
+  // rename() on windows won't overwrite an existing file
+  return MoveFileEx(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+  return rename(from.c_str(), to.c_str()) == 0;
+#endif
+}
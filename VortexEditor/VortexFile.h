@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+
+class ByteStream;
+
+// Reads and writes the raw ByteStream files used for savefiles (.vortex)
+// and mode exports (.vtxmode), these are plain portable C++ file streams
+class VortexFile
+{
+public:
+  // read a file of any size into the stream, the header and CRC of the
+  // file are validated before anything is returned so a corrupt or
+  // truncated file will never make it into the engine
+  static bool read(const std::string &filename, ByteStream &outStream);
+
+  // write the stream to a temporary file then swap it into place so a
+  // failed write can never leave a half-written or stale file behind
+  static bool write(const std::string &filename, ByteStream &stream);
+
+  // parse a file that is already in memory (mapped or otherwise), this
+  // performs the same validation as read()
+  static bool parse(const void *data, uint64_t size, ByteStream &outStream);
+
+  // the header at the front of every file, this matches the raw layout
+  // of a ByteStream which is what gets written to disk
+  struct Header
+  {
+    uint32_t size;
+    uint32_t flags;
+    uint32_t crc32;
+  };
+
+private:
+  // write and flush the data all the way to the disk
+  static bool writeDurable(const std::string &filename, const void *data, uint32_t size);
+  // move the temporary file over the real one
+  static bool replaceFile(const std::string &from, const std::string &to);
+};
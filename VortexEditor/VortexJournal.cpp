@@ -0,0 +1,424 @@
+#include "VortexJournal.h"
+
+// VortexEngine includes
+#include "Serial/ByteStream.h"
+
+// Editor includes
+#include "VortexEditor.h"
+#include "VortexFile.h"
+
+#include <fstream>
+#include <cctype>
+
+// 'VJRN'
+#define JOURNAL_MAGIC 0x4E524A56
+
+// how long the writer waits for more records before writing a batch
+#define JOURNAL_BATCH_DELAY_MS 250
+
+// the journal is compacted once it grows beyond this size
+#define JOURNAL_COMPACT_SIZE (256 * 1024)
+
+using namespace std;
+
+VortexJournal::VortexJournal() :
+  m_filename(),
+  m_hOwner(nullptr),
+  m_hFile(INVALID_HANDLE_VALUE),
+  m_fileSize(0),
+  m_hThread(nullptr),
+  m_hEvent(nullptr),
+  m_queueLock(),
+  m_queue(),
+  m_stopping(false),
+  m_state(),
+  m_numLogged(0),
+  m_logTicks(0)
+{
+  InitializeCriticalSection(&m_queueLock);
+}
+
+VortexJournal::~VortexJournal()
+{
+  stop();
+  if (m_hOwner) {
+    CloseHandle(m_hOwner);
+  }
+  DeleteCriticalSection(&m_queueLock);
+}
+
+bool VortexJournal::acquire(const string &filename)
+{
+  if (m_hOwner) {
+    return true;
+  }
+  // the mutex is named after the full path of the journal so two editors
+  // started from the same folder find each other, a backslash can't be
+  // part of the name though
+  char fullPath[MAX_PATH] = {0};
+  if (!GetFullPathName(filename.c_str(), sizeof(fullPath), fullPath, NULL)) {
+    return false;
+  }
+  string name = "Local\\VortexJournal:";
+  for (const char *p = fullPath; *p; ++p) {
+    name += (*p == '\\') ? '/' : (char)tolower(*p);
+  }
+  HANDLE hMutex = CreateMutex(NULL, FALSE, name.c_str());
+  if (!hMutex) {
+    return false;
+  }
+  if (GetLastError() == ERROR_ALREADY_EXISTS) {
+    // another editor is running and its journal is live
+    CloseHandle(hMutex);
+    return false;
+  }
+  m_hOwner = hMutex;
+  return true;
+}
+
+bool VortexJournal::start(const string &filename)
+{
+  if (isRunning() || !acquire(filename)) {
+    return false;
+  }
+  m_hFile = CreateFile(filename.c_str(), GENERIC_WRITE, 0, NULL,
+    OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (m_hFile == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  LARGE_INTEGER zero = {0};
+  LARGE_INTEGER end = {0};
+  SetFilePointerEx(m_hFile, zero, &end, FILE_END);
+  m_fileSize = (uint64_t)end.QuadPart;
+  m_filename = filename;
+  m_stopping = false;
+  m_state.clear();
+  m_hEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+  m_hThread = CreateThread(NULL, 0, writerThread, this, 0, NULL);
+  if (!m_hThread) {
+    CloseHandle(m_hEvent);
+    m_hEvent = nullptr;
+    CloseHandle(m_hFile);
+    m_hFile = INVALID_HANDLE_VALUE;
+    return false;
+  }
+  return true;
+}
+
+void VortexJournal::stop()
+{
+  if (!isRunning()) {
+    return;
+  }
+  EnterCriticalSection(&m_queueLock);
+  m_stopping = true;
+  LeaveCriticalSection(&m_queueLock);
+  SetEvent(m_hEvent);
+  WaitForSingleObject(m_hThread, INFINITE);
+  CloseHandle(m_hThread);
+  m_hThread = nullptr;
+  CloseHandle(m_hEvent);
+  m_hEvent = nullptr;
+  CloseHandle(m_hFile);
+  m_hFile = INVALID_HANDLE_VALUE;
+}
+
+void VortexJournal::discard()
+{
+  stop();
+  if (!m_filename.empty()) {
+    DeleteFile(m_filename.c_str());
+  }
+}
+
+void VortexJournal::logSnapshot(const vector<ByteStream> &modes)
+{
+  if (!isRunning()) {
+    return;
+  }
+  LARGE_INTEGER startTime;
+  LARGE_INTEGER endTime;
+  QueryPerformanceCounter(&startTime);
+  Record record;
+  record.type = RECORD_SNAPSHOT;
+  record.index = (uint32_t)modes.size();
+  for (const ByteStream &mode : modes) {
+    const uint8_t *raw = (const uint8_t *)mode.rawData();
+    record.data.insert(record.data.end(), raw, raw + mode.rawSize());
+  }
+  EnterCriticalSection(&m_queueLock);
+  // a snapshot replaces anything that hasn't been written yet
+  m_queue.clear();
+  m_queue.push_back(move(record));
+  LeaveCriticalSection(&m_queueLock);
+  SetEvent(m_hEvent);
+  QueryPerformanceCounter(&endTime);
+  m_logTicks += endTime.QuadPart - startTime.QuadPart;
+  m_numLogged++;
+}
+
+void VortexJournal::logMode(uint32_t index, const ByteStream &mode)
+{
+  if (!isRunning()) {
+    return;
+  }
+  LARGE_INTEGER startTime;
+  LARGE_INTEGER endTime;
+  QueryPerformanceCounter(&startTime);
+  Record record;
+  record.type = RECORD_MODE;
+  record.index = index;
+  const uint8_t *raw = (const uint8_t *)mode.rawData();
+  record.data.assign(raw, raw + mode.rawSize());
+  EnterCriticalSection(&m_queueLock);
+  // consecutive edits to the same mode only need the latest copy
+  if (m_queue.size() && m_queue.back().type == RECORD_MODE && m_queue.back().index == index) {
+    m_queue.back() = move(record);
+  } else {
+    m_queue.push_back(move(record));
+  }
+  LeaveCriticalSection(&m_queueLock);
+  SetEvent(m_hEvent);
+  QueryPerformanceCounter(&endTime);
+  m_logTicks += endTime.QuadPart - startTime.QuadPart;
+  m_numLogged++;
+}
+
+double VortexJournal::avgLogMicroseconds() const
+{
+  if (!m_numLogged) {
+    return 0;
+  }
+  LARGE_INTEGER freq;
+  QueryPerformanceFrequency(&freq);
+  return ((double)m_logTicks * 1000000.0 / (double)freq.QuadPart) / m_numLogged;
+}
+
+bool VortexJournal::recover(const string &filename, vector<ByteStream> &outModes)
+{
+  ifstream file(filename, ios::binary | ios::ate);
+  if (!file.is_open()) {
+    return false;
+  }
+  uint64_t fileSize = (uint64_t)file.tellg();
+  vector<uint8_t> buffer((size_t)fileSize);
+  file.seekg(0, ios::beg);
+  if (!fileSize || !file.read((char *)buffer.data(), fileSize)) {
+    return false;
+  }
+  vector<vector<uint8_t>> modes;
+  bool recovered = false;
+  uint64_t pos = 0;
+  // replay records until the end of the file or the first damaged record,
+  // which would be a write that was cut off
+  while (fileSize - pos >= sizeof(RecordHeader)) {
+    const RecordHeader *header = (const RecordHeader *)(buffer.data() + pos);
+    if (header->magic != JOURNAL_MAGIC || header->length > (fileSize - pos - sizeof(RecordHeader))) {
+      break;
+    }
+    Record record;
+    record.type = (RecordType)header->type;
+    record.index = header->index;
+    const uint8_t *data = buffer.data() + pos + sizeof(RecordHeader);
+    record.data.assign(data, data + header->length);
+    // every mode in the record must be intact
+    uint32_t numModes = (record.type == RECORD_SNAPSHOT) ? record.index : 1;
+    uint64_t offset = 0;
+    bool valid = true;
+    for (uint32_t i = 0; valid && i < numModes; ++i) {
+      const uint8_t *mode = record.data.data() + offset;
+      ByteStream stream;
+      valid = VortexFile::parse(mode, record.data.size() - offset, stream);
+      if (valid) {
+        offset += sizeof(VortexFile::Header) + ((const VortexFile::Header *)mode)->size;
+      }
+    }
+    if (!valid || offset != record.data.size()) {
+      break;
+    }
+    // a mode past the end can only come from a damaged journal
+    if (!apply(record, modes)) {
+      debug("Journal record for mode %u doesn't fit in %u modes", record.index, (uint32_t)modes.size());
+      break;
+    }
+    recovered = true;
+    pos += sizeof(RecordHeader) + header->length;
+  }
+  if (!recovered) {
+    return false;
+  }
+  outModes.clear();
+  uint32_t numDropped = 0;
+  for (auto &mode : modes) {
+    ByteStream stream;
+    if (!VortexFile::parse(mode.data(), mode.size(), stream)) {
+      numDropped++;
+      continue;
+    }
+    outModes.push_back(stream);
+  }
+  if (numDropped) {
+    debug("Dropped %u modes from the journal that weren't intact", numDropped);
+  }
+  return true;
+}
+
+DWORD __stdcall VortexJournal::writerThread(void *arg)
+{
+  ((VortexJournal *)arg)->writer();
+  return 0;
+}
+
+void VortexJournal::writer()
+{
+  bool stopping = false;
+  while (!stopping) {
+    WaitForSingleObject(m_hEvent, INFINITE);
+    EnterCriticalSection(&m_queueLock);
+    stopping = m_stopping;
+    LeaveCriticalSection(&m_queueLock);
+    // give the ui a moment to queue up more edits so they all go to disk
+    // together, this is skipped when stopping so the editor exits quickly
+    if (!stopping) {
+      Sleep(JOURNAL_BATCH_DELAY_MS);
+    }
+    deque<Record> batch;
+    EnterCriticalSection(&m_queueLock);
+    batch.swap(m_queue);
+    stopping = m_stopping;
+    LeaveCriticalSection(&m_queueLock);
+    if (!batch.size()) {
+      continue;
+    }
+    bool failed = false;
+    for (const Record &record : batch) {
+      // a record the state can't take would make the journal unrecoverable
+      if (!apply(record, m_state)) {
+        continue;
+      }
+      if (failed) {
+        continue;
+      }
+      if (!writeRecord(m_hFile, record)) {
+        // part of the record may have been written which would hide
+        // anything appended after it, so cut it off again
+        truncate(m_fileSize);
+        failed = true;
+        continue;
+      }
+      m_fileSize += sizeof(RecordHeader) + record.data.size();
+    }
+    // one flush for the entire batch
+    FlushFileBuffers(m_hFile);
+    // the records after a failed write are only in the state, rewriting
+    // the journal as a snapshot of the state gets them back into the file
+    if (failed || m_fileSize > JOURNAL_COMPACT_SIZE) {
+      compact();
+    }
+  }
+}
+
+bool VortexJournal::apply(const Record &record, vector<vector<uint8_t>> &modes)
+{
+  if (record.type == RECORD_MODE) {
+    if (record.index > modes.size()) {
+      return false;
+    }
+    if (record.index == modes.size()) {
+      modes.push_back(record.data);
+    } else {
+      modes[record.index] = record.data;
+    }
+    return true;
+  }
+  if (record.type != RECORD_SNAPSHOT) {
+    return false;
+  }
+  // split the snapshot back into modes, each one starts with a header
+  // that contains the size of the data following it
+  modes.clear();
+  uint64_t offset = 0;
+  for (uint32_t i = 0; i < record.index; ++i) {
+    if (record.data.size() - offset < sizeof(VortexFile::Header)) {
+      break;
+    }
+    const VortexFile::Header *header = (const VortexFile::Header *)(record.data.data() + offset);
+    uint64_t size = sizeof(VortexFile::Header) + header->size;
+    if (size > record.data.size() - offset) {
+      break;
+    }
+    const uint8_t *data = record.data.data() + offset;
+    modes.push_back(vector<uint8_t>(data, data + size));
+    offset += size;
+  }
+  return true;
+}
+
+void VortexJournal::buildSnapshot(const vector<vector<uint8_t>> &modes, Record &outRecord)
+{
+  outRecord.type = RECORD_SNAPSHOT;
+  outRecord.index = (uint32_t)modes.size();
+  outRecord.data.clear();
+  for (auto &mode : modes) {
+    outRecord.data.insert(outRecord.data.end(), mode.begin(), mode.end());
+  }
+}
+
+bool VortexJournal::writeRecord(HANDLE hFile, const Record &record)
+{
+  RecordHeader header;
+  header.magic = JOURNAL_MAGIC;
+  header.type = record.type;
+  header.reserved = 0;
+  header.index = record.index;
+  header.length = (uint32_t)record.data.size();
+  DWORD written = 0;
+  if (!WriteFile(hFile, &header, sizeof(header), &written, NULL) || written != sizeof(header)) {
+    return false;
+  }
+  if (!header.length) {
+    return true;
+  }
+  return WriteFile(hFile, record.data.data(), header.length, &written, NULL) && written == header.length;
+}
+
+void VortexJournal::truncate(uint64_t size)
+{
+  LARGE_INTEGER pos;
+  pos.QuadPart = (LONGLONG)size;
+  if (SetFilePointerEx(m_hFile, pos, NULL, FILE_BEGIN)) {
+    SetEndOfFile(m_hFile);
+  }
+}
+
+bool VortexJournal::compact()
+{
+  // write the current state to a new journal then swap it into place
+  string tempFilename = m_filename + ".tmp";
+  HANDLE hTemp = CreateFile(tempFilename.c_str(), GENERIC_WRITE, 0, NULL,
+    CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (hTemp == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  Record snapshot;
+  buildSnapshot(m_state, snapshot);
+  bool success = writeRecord(hTemp, snapshot) && FlushFileBuffers(hTemp);
+  CloseHandle(hTemp);
+  if (!success) {
+    DeleteFile(tempFilename.c_str());
+    return false;
+  }
+  CloseHandle(m_hFile);
+  m_hFile = INVALID_HANDLE_VALUE;
+  if (!MoveFileEx(tempFilename.c_str(), m_filename.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+    DeleteFile(tempFilename.c_str());
+  }
+  // keep appending to whichever journal is in place now
+  m_hFile = CreateFile(m_filename.c_str(), GENERIC_WRITE, 0, NULL,
+    OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+  LARGE_INTEGER zero = {0};
+  LARGE_INTEGER end = {0};
+  SetFilePointerEx(m_hFile, zero, &end, FILE_END);
+  m_fileSize = (uint64_t)end.QuadPart;
+  return success;
+}
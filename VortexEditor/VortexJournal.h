@@ -0,0 +1,120 @@
+#pragma once
+
+// windows includes
+#include <windows.h>
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <deque>
+
+class ByteStream;
+
+// The journal is an append-only log of the modes in the editor which is
+// used to recover the session if the editor doesn't close cleanly.
+//
+// The editor hands over the modes it already serialized for the storage bar
+// so logging an edit is only a copy into the queue, a background thread
+// does all of the disk work and flushes once per batch of records. Every
+// record is either a snapshot of all the modes or a single mode that was
+// changed, and once the file grows too large it is compacted down to a
+// single snapshot.
+class VortexJournal
+{
+public:
+  VortexJournal();
+  ~VortexJournal();
+
+  // take ownership of a journal so no other editor recovers or writes it
+  // while this one is using it, returns false if another editor owns it
+  bool acquire(const std::string &filename);
+  bool isOwner() const { return m_hOwner != nullptr; }
+
+  // start journaling to a file, new records are appended to the file, the
+  // journal must be owned first
+  bool start(const std::string &filename);
+  // stop journaling, anything still queued is written first
+  void stop();
+  // stop journaling and delete the journal, for a clean exit
+  void discard();
+
+  bool isRunning() const { return m_hThread != nullptr; }
+
+  // queue a snapshot of all the modes
+  void logSnapshot(const std::vector<ByteStream> &modes);
+  // queue a single mode that changed
+  void logMode(uint32_t index, const ByteStream &mode);
+
+  // replay a journal to find the modes at the point it was last written,
+  // returns false if there is no journal or nothing could be recovered
+  static bool recover(const std::string &filename, std::vector<ByteStream> &outModes);
+
+  // the number of records logged and the average time spent on the ui
+  // thread to log each one
+  uint32_t numLogged() const { return m_numLogged; }
+  double avgLogMicroseconds() const;
+
+private:
+  static DWORD __stdcall writerThread(void *arg);
+  void writer();
+
+  enum RecordType : uint16_t
+  {
+    RECORD_SNAPSHOT,
+    RECORD_MODE,
+  };
+
+  // the header in front of every record in the file
+  struct RecordHeader
+  {
+    uint32_t magic;
+    uint16_t type;
+    uint16_t reserved;
+    // number of modes in a snapshot or index of a single mode
+    uint32_t index;
+    // length of the data following the header
+    uint32_t length;
+  };
+
+  // a record waiting to be written
+  struct Record
+  {
+    RecordType type;
+    uint32_t index;
+    std::vector<uint8_t> data;
+  };
+
+  // apply a record to a set of modes, a mode record can only replace a
+  // mode or add one to the end so a record that would leave a gap before
+  // it is rejected as corrupt
+  static bool apply(const Record &record, std::vector<std::vector<uint8_t>> &modes);
+  // build a snapshot record out of a set of modes
+  static void buildSnapshot(const std::vector<std::vector<uint8_t>> &modes, Record &outRecord);
+  // write a record to a file
+  static bool writeRecord(HANDLE hFile, const Record &record);
+  // cut the journal back to the end of the last record that was written
+  void truncate(uint64_t size);
+  // rewrite the journal as a single snapshot
+  bool compact();
+
+  std::string m_filename;
+  // named mutex held for as long as this editor owns the journal
+  HANDLE m_hOwner;
+  HANDLE m_hFile;
+  uint64_t m_fileSize;
+
+  // the writer thread and the queue it writes from
+  HANDLE m_hThread;
+  HANDLE m_hEvent;
+  CRITICAL_SECTION m_queueLock;
+  std::deque<Record> m_queue;
+  bool m_stopping;
+
+  // the modes as of the last record written, only touched by the writer
+  // thread and used to compact the journal
+  std::vector<std::vector<uint8_t>> m_state;
+
+  // time spent on the ui thread
+  uint32_t m_numLogged;
+  uint64_t m_logTicks;
+};
@@ -0,0 +1,253 @@
+#include "VortexLibraryBrowser.h"
+#include "VortexEditor.h"
+#include "EditorConfig.h"
+
+#include "Serial/ByteStream.h"
+#include "Patterns/Patterns.h"
+
+#include "resource.h"
+
+#include <windowsx.h>
+#include <string.h>
+#include <stdio.h>
+
+#define LIBRARY_OPEN_ID       59001
+#define LIBRARY_IMPORT_ID     59002
+#define LIBRARY_ADD_MODES_ID  59003
+#define LIBRARY_MODE_LIST_ID  59004
+
+using namespace std;
+
+VortexLibraryBrowser::VortexLibraryBrowser() :
+  m_isOpen(false),
+  m_hIcon(nullptr),
+  m_library(),
+  m_libraryWindow(),
+  m_openButton(),
+  m_importButton(),
+  m_addModesButton(),
+  m_modeListBox(),
+  m_libraryLabel(),
+  m_summaryLabel()
+{
+}
+
+VortexLibraryBrowser::~VortexLibraryBrowser()
+{
+  DestroyIcon(m_hIcon);
+}
+
+// initialize the library browser
+bool VortexLibraryBrowser::init(HINSTANCE hInst)
+{
+  // the library browser
+  m_libraryWindow.init(hInst, "Vortex Mode Library", BACK_COL, 420, 420, this);
+  m_libraryWindow.setVisible(false);
+  m_libraryWindow.setCloseCallback(hideGUICallback);
+  m_libraryWindow.installLoseFocusCallback(loseFocusCallback);
+
+  m_openButton.init(hInst, m_libraryWindow, "Open", BACK_COL,
+    80, 28, 10, 10, LIBRARY_OPEN_ID, openCallback);
+  m_importButton.init(hInst, m_libraryWindow, "Import", BACK_COL,
+    80, 28, 95, 10, LIBRARY_IMPORT_ID, importCallback);
+  m_addModesButton.init(hInst, m_libraryWindow, "Add Modes", BACK_COL,
+    80, 28, 180, 10, LIBRARY_ADD_MODES_ID, addModesCallback);
+  m_libraryLabel.init(hInst, m_libraryWindow, "No library open", BACK_COL,
+    390, 18, 10, 44, 0, nullptr);
+  m_modeListBox.init(hInst, m_libraryWindow, "Library Modes", BACK_COL,
+    390, 280, 10, 64, LIBRARY_MODE_LIST_ID, selectCallback);
+  m_summaryLabel.init(hInst, m_libraryWindow, "", BACK_COL,
+    390, 36, 10, 344, 0, nullptr);
+
+  // apply the icon
+  m_hIcon = LoadIcon(hInst, MAKEINTRESOURCE(IDI_ICON1));
+  SendMessage(m_libraryWindow.hwnd(), WM_SETICON, ICON_BIG, (LPARAM)m_hIcon);
+
+  return true;
+}
+
+void VortexLibraryBrowser::show()
+{
+  if (m_isOpen) {
+    return;
+  }
+  m_libraryWindow.setVisible(true);
+  m_libraryWindow.setEnabled(true);
+  m_isOpen = true;
+}
+
+void VortexLibraryBrowser::hide()
+{
+  if (!m_isOpen) {
+    return;
+  }
+  if (m_libraryWindow.isVisible()) {
+    m_libraryWindow.setVisible(false);
+  }
+  if (m_libraryWindow.isEnabled()) {
+    m_libraryWindow.setEnabled(false);
+  }
+  m_isOpen = false;
+}
+
+void VortexLibraryBrowser::loseFocus()
+{
+}
+
+bool VortexLibraryBrowser::openLibrary(const string &filename)
+{
+  if (!m_library.open(filename)) {
+    MessageBox(m_libraryWindow.hwnd(), "The file is not a valid mode library", "Open Failed", MB_ICONERROR);
+    return false;
+  }
+  refreshList();
+  return true;
+}
+
+void VortexLibraryBrowser::showEntry(uint32_t index)
+{
+  show();
+  m_modeListBox.setSelection(index);
+  selectEntry();
+}
+
+void VortexLibraryBrowser::browseLibrary()
+{
+  OPENFILENAME ofn;
+  memset(&ofn, 0, sizeof(ofn));
+  ofn.lStructSize = sizeof(ofn);
+  ofn.hwndOwner = m_libraryWindow.hwnd();
+  char szFile[MAX_PATH] = {0};
+  ofn.lpstrFile = szFile;
+  ofn.nMaxFile = sizeof(szFile);
+  ofn.lpstrFilter = "Vortex Mode Library\0*" VORTEX_LIBRARY_EXTENSION "\0";
+  ofn.nFilterIndex = 1;
+  ofn.Flags = OFN_PATHMUSTEXIST | OFN_FILEMUSTEXIST;
+  if (!GetOpenFileName(&ofn)) {
+    return;
+  }
+  openLibrary(szFile);
+}
+
+void VortexLibraryBrowser::selectEntry()
+{
+  int sel = m_modeListBox.getSelection();
+  const VortexModeLibrary::Entry *entry = m_library.entry((uint32_t)sel);
+  if (sel < 0 || !entry) {
+    m_summaryLabel.setText("");
+    return;
+  }
+  // the summary comes straight out of the table, the mode isn't loaded
+  string summary = to_string(entry->numLeds) + " leds, " + to_string(entry->numColors) + " colors:";
+  for (uint32_t i = 0; i < entry->numColors && i < LIBRARY_MAX_COLORS; ++i) {
+    char hex[16] = {0};
+    snprintf(hex, sizeof(hex), " #%06X", entry->colors[i] & 0xFFFFFF);
+    summary += hex;
+  }
+  summary += "\r\n";
+  for (uint32_t i = 0; i < LIBRARY_MAX_PATTERNS; ++i) {
+    if (entry->patternIDs[i] == (uint8_t)PATTERN_NONE) {
+      break;
+    }
+    if (i > 0) {
+      summary += ", ";
+    }
+    summary += g_pEditor->m_vortex.patternToString((PatternID)entry->patternIDs[i]);
+  }
+  m_summaryLabel.setText(summary);
+}
+
+void VortexLibraryBrowser::importEntry()
+{
+  int sel = m_modeListBox.getSelection();
+  if (sel < 0) {
+    return;
+  }
+  ByteStream stream;
+  if (!m_library.loadMode((uint32_t)sel, stream)) {
+    MessageBox(m_libraryWindow.hwnd(), "The mode is corrupt or could not be read", "Import Failed", MB_ICONERROR);
+    return;
+  }
+  if (g_pEditor->hasMode(stream)) {
+    if (MessageBox(m_libraryWindow.hwnd(), "This mode is already in the mode list. Import it again?",
+        "Duplicate Mode", MB_YESNO | MB_ICONQUESTION) != IDYES) {
+      return;
+    }
+  }
+  if (!g_pEditor->addModeFromStream(stream)) {
+    MessageBox(m_libraryWindow.hwnd(), "The mode could not be imported", "Import Failed", MB_ICONERROR);
+  }
+}
+
+void VortexLibraryBrowser::addModes()
+{
+  Vortex &vortex = g_pEditor->m_vortex;
+  if (!vortex.numModes()) {
+    return;
+  }
+  string filename = m_library.filename();
+  if (filename.empty()) {
+    // no library is open so pick one to create or append to
+    OPENFILENAME ofn;
+    memset(&ofn, 0, sizeof(ofn));
+    ofn.lStructSize = sizeof(ofn);
+    ofn.hwndOwner = m_libraryWindow.hwnd();
+    char szFile[MAX_PATH] = {0};
+    ofn.lpstrFile = szFile;
+    ofn.nMaxFile = sizeof(szFile);
+    ofn.lpstrFilter = "Vortex Mode Library\0*" VORTEX_LIBRARY_EXTENSION "\0";
+    ofn.nFilterIndex = 1;
+    ofn.Flags = OFN_PATHMUSTEXIST;
+    if (!GetSaveFileName(&ofn)) {
+      return;
+    }
+    filename = szFile;
+    if (filename.length() <= strlen(VORTEX_LIBRARY_EXTENSION) ||
+        filename.substr(filename.length() - strlen(VORTEX_LIBRARY_EXTENSION)) != VORTEX_LIBRARY_EXTENSION) {
+      filename.append(VORTEX_LIBRARY_EXTENSION);
+    }
+  }
+  // gather every mode in the editor along with it's summary
+  vector<VortexModeLibrary::Entry> entries(vortex.numModes());
+  vector<ByteStream> modes(vortex.numModes());
+  int curSel = vortex.curModeIndex();
+  vortex.setCurMode(0, false);
+  for (uint32_t i = 0; i < vortex.numModes(); ++i) {
+    vortex.getCurMode(modes[i]);
+    string modeName = "Mode_" + to_string(i) + "_" + vortex.getModeName();
+    VortexModeLibrary::summarize(vortex, modeName, entries[i]);
+    vortex.nextMode(false);
+  }
+  vortex.setCurMode(curSel, false);
+  if (!m_library.append(filename, entries, modes)) {
+    MessageBox(m_libraryWindow.hwnd(), "Failed to write the mode library", "Add Failed", MB_ICONERROR);
+    return;
+  }
+  // the library is re-opened by append if it was already open
+  if (!m_library.isOpen()) {
+    openLibrary(filename);
+    return;
+  }
+  refreshList();
+}
+
+void VortexLibraryBrowser::refreshList()
+{
+  // the list is filled without redrawing so large libraries stay quick
+  SendMessage(m_modeListBox.hwnd(), WM_SETREDRAW, FALSE, 0);
+  m_modeListBox.clearItems();
+  for (uint32_t i = 0; i < m_library.numEntries(); ++i) {
+    const VortexModeLibrary::Entry *entry = m_library.entry(i);
+    string name(entry->name, strnlen(entry->name, sizeof(entry->name)));
+    m_modeListBox.addItem(to_string(i) + ": " + name);
+    // the table already has everything the search index needs
+    g_pEditor->m_modeIndex.update(VortexModeIndex::SOURCE_LIBRARY, i, *entry);
+  }
+  g_pEditor->m_modeIndex.truncate(VortexModeIndex::SOURCE_LIBRARY, m_library.numEntries());
+  SendMessage(m_modeListBox.hwnd(), WM_SETREDRAW, TRUE, 0);
+  InvalidateRect(m_modeListBox.hwnd(), NULL, TRUE);
+  string filename = m_library.filename();
+  filename = filename.substr(filename.find_last_of('\\') + 1);
+  m_libraryLabel.setText(filename + " (" + to_string(m_library.numEntries()) + " modes)");
+  m_summaryLabel.setText("");
+}
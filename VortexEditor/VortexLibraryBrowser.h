@@ -0,0 +1,86 @@
+#pragma once
+
+// windows includes
+#include <windows.h>
+
+// gui includes
+#include "GUI/VChildwindow.h"
+#include "GUI/VListBox.h"
+#include "GUI/VButton.h"
+#include "GUI/VLabel.h"
+
+#include "VortexModeLibrary.h"
+
+class VortexLibraryBrowser
+{
+public:
+  VortexLibraryBrowser();
+  ~VortexLibraryBrowser();
+
+  // initialize the library browser
+  bool init(HINSTANCE hInstance);
+
+  // show/hide the library browser window
+  void show();
+  void hide();
+  void loseFocus();
+
+  bool isOpen() const { return m_isOpen; }
+
+  HWND hwnd() const { return m_libraryWindow.hwnd(); }
+
+  // open a library and list the modes in it
+  bool openLibrary(const std::string &filename);
+  // show the window with a mode of the open library selected
+  void showEntry(uint32_t index);
+
+private:
+  // ==================================
+  //  Library Browser GUI
+  static void hideGUICallback(void *pthis, VWindow *window) {
+    ((VortexLibraryBrowser *)pthis)->hide();
+  }
+  static void loseFocusCallback(void *pthis, VWindow *window) {
+    ((VortexLibraryBrowser *)pthis)->loseFocus();
+  }
+  static void openCallback(void *pthis, VWindow *window) {
+    ((VortexLibraryBrowser *)pthis)->browseLibrary();
+  }
+  static void selectCallback(void *pthis, VWindow *window) {
+    ((VortexLibraryBrowser *)pthis)->selectEntry();
+  }
+  static void importCallback(void *pthis, VWindow *window) {
+    ((VortexLibraryBrowser *)pthis)->importEntry();
+  }
+  static void addModesCallback(void *pthis, VWindow *window) {
+    ((VortexLibraryBrowser *)pthis)->addModes();
+  }
+
+  // prompt for a library to open
+  void browseLibrary();
+  // show the summary of the selected mode
+  void selectEntry();
+  // import the selected mode into the editor
+  void importEntry();
+  // append all of the modes in the editor to the library
+  void addModes();
+  // refill the list of modes from the library
+  void refreshList();
+
+  bool m_isOpen;
+
+  HICON m_hIcon;
+
+  // the currently open library
+  VortexModeLibrary m_library;
+
+  // child window for library browser tool
+  VChildWindow m_libraryWindow;
+
+  VButton m_openButton;
+  VButton m_importButton;
+  VButton m_addModesButton;
+  VListBox m_modeListBox;
+  VLabel m_libraryLabel;
+  VLabel m_summaryLabel;
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+class ByteStream;
+
+// Content hash of a mode, two modes with the same hash are almost certainly
+// byte for byte identical once serialized, but a match is only a hint and
+// sameMode() has the final say before anything is dropped as a duplicate.
+// The hash is taken over the uncompressed mode data so it doesn't matter
+// whether the mode came from a compressed file, the clipboard, or straight
+// out of the engine.
+//
+// The hash itself is XXH64 which reads 32 bytes per step across four
+// independent lanes, fast enough that hashing every mode on every refresh
+// is lost in the noise of serializing them.
+class VortexModeHash
+{
+public:
+  // hash a serialized mode, the mode is decompressed first if necessary
+  static uint64_t hashMode(const ByteStream &mode);
+
+  // hash a buffer of uncompressed mode data
+  static uint64_t hash(const void *data, size_t size, uint64_t seed = 0);
+
+  // whether two serialized modes are actually the same, for when their
+  // hashes match, both are decompressed first if necessary
+  static bool sameMode(const ByteStream &a, const ByteStream &b);
+};
@@ -0,0 +1,488 @@
+#include "VortexModeIndex.h"
+
+#include <algorithm>
+#include <ctype.h>
+#include <string.h>
+#include <stdlib.h>
+
+// colors darker or greyer than this don't have a hue
+#define INDEX_MIN_VALUE 32
+#define INDEX_MIN_SATURATION 0.25f
+
+// the names of the hue buckets starting at red and going around the wheel
+static const char *hueNames[INDEX_HUE_BUCKETS] = {
+  "red", "orange", "yellow", "lime", "green", "teal",
+  "cyan", "azure", "blue", "purple", "magenta", "pink"
+};
+
+// the names of the sources for in: terms
+static const char *sourceNames[VortexModeIndex::SOURCE_COUNT] = {
+  "editor", "library", "community"
+};
+
+using namespace std;
+
+// the hue bucket of a color and how much it counts towards the dominant
+// hue, brighter and more saturated colors count for more
+static int hueOf(uint32_t rgb, float &outWeight)
+{
+  int r = (rgb >> 16) & 0xFF;
+  int g = (rgb >> 8) & 0xFF;
+  int b = rgb & 0xFF;
+  int maxVal = max(r, max(g, b));
+  int minVal = min(r, min(g, b));
+  int delta = maxVal - minVal;
+  outWeight = 0;
+  if (maxVal < INDEX_MIN_VALUE || !delta) {
+    return -1;
+  }
+  float saturation = (float)delta / maxVal;
+  if (saturation < INDEX_MIN_SATURATION) {
+    return -1;
+  }
+  float hue;
+  if (maxVal == r) {
+    hue = 60.0f * ((float)(g - b) / delta);
+  } else if (maxVal == g) {
+    hue = 60.0f * ((float)(b - r) / delta) + 120.0f;
+  } else {
+    hue = 60.0f * ((float)(r - g) / delta) + 240.0f;
+  }
+  if (hue < 0) {
+    hue += 360.0f;
+  }
+  outWeight = saturation * maxVal;
+  // each bucket is centered on it's hue so red covers both sides of 0
+  const float bucketSize = 360.0f / INDEX_HUE_BUCKETS;
+  return (int)((hue + (bucketSize / 2)) / bucketSize) % INDEX_HUE_BUCKETS;
+}
+
+// insert or remove a doc id from a sorted list
+static void insertSorted(vector<uint32_t> &list, uint32_t docID)
+{
+  auto pos = lower_bound(list.begin(), list.end(), docID);
+  if (pos == list.end() || *pos != docID) {
+    list.insert(pos, docID);
+  }
+}
+
+static void eraseSorted(vector<uint32_t> &list, uint32_t docID)
+{
+  auto pos = lower_bound(list.begin(), list.end(), docID);
+  if (pos != list.end() && *pos == docID) {
+    list.erase(pos);
+  }
+}
+
+// find the first position at or after start that isn't less than the doc
+// id, the steps double so nearby ids are found as quickly as a linear walk
+// and distant ones as quickly as a binary search
+static size_t gallop(const vector<uint32_t> &list, size_t start, uint32_t docID)
+{
+  size_t step = 1;
+  size_t low = start;
+  size_t high = start;
+  while (high < list.size() && list[high] < docID) {
+    low = high + 1;
+    high = start + step;
+    step <<= 1;
+  }
+  if (high > list.size()) {
+    high = list.size();
+  }
+  return lower_bound(list.begin() + low, list.begin() + high, docID) - list.begin();
+}
+
+VortexModeIndex::VortexModeIndex() :
+  m_lock(),
+  m_docs(),
+  m_freeDocs(),
+  m_refs(),
+  m_postings(),
+  m_tokens(),
+  m_numDocs(0),
+  m_patternNames()
+{
+  InitializeSRWLock(&m_lock);
+}
+
+VortexModeIndex::~VortexModeIndex()
+{
+}
+
+void VortexModeIndex::setPatternNames(const vector<string> &names)
+{
+  AcquireSRWLockExclusive(&m_lock);
+  m_patternNames = names;
+  for (string &name : m_patternNames) {
+    transform(name.begin(), name.end(), name.begin(), [](char c) {
+      return (c == ' ') ? '_' : (char)tolower((unsigned char)c);
+    });
+  }
+  ReleaseSRWLockExclusive(&m_lock);
+}
+
+void VortexModeIndex::update(Source source, uint32_t index, const VortexModeLibrary::Entry &summary)
+{
+  AcquireSRWLockExclusive(&m_lock);
+  uint32_t docID;
+  auto ref = m_refs.find(refKey(source, index));
+  if (ref != m_refs.end()) {
+    docID = ref->second;
+    if (m_docs[docID].hash == summary.hash) {
+      // the same mode is already indexed here
+      ReleaseSRWLockExclusive(&m_lock);
+      return;
+    }
+    removePostings(docID);
+  } else {
+    if (m_freeDocs.size()) {
+      docID = m_freeDocs.back();
+      m_freeDocs.pop_back();
+    } else {
+      docID = (uint32_t)m_docs.size();
+      m_docs.emplace_back();
+    }
+    m_refs[refKey(source, index)] = docID;
+    m_numDocs++;
+  }
+  Doc &doc = m_docs[docID];
+  doc.source = source;
+  doc.index = index;
+  doc.hash = summary.hash;
+  doc.alive = true;
+  doc.name.assign(summary.name, strnlen(summary.name, sizeof(summary.name)));
+  doc.keys.clear();
+  doc.tokens.clear();
+  doc.keys.push_back(makeKey(KEY_SOURCE, source));
+  doc.keys.push_back(makeKey(KEY_LEDS, summary.numLeds));
+  doc.keys.push_back(makeKey(KEY_COLORS, summary.numColors));
+  for (uint32_t i = 0; i < LIBRARY_MAX_PATTERNS && summary.patternIDs[i] != 0xFF; ++i) {
+    doc.keys.push_back(makeKey(KEY_PATTERN, summary.patternIDs[i]));
+  }
+  // each hue present and the hue that carries the most weight
+  float weights[INDEX_HUE_BUCKETS] = {0};
+  bool present[INDEX_HUE_BUCKETS] = {0};
+  for (uint32_t i = 0; i < summary.numColors && i < LIBRARY_MAX_COLORS; ++i) {
+    float weight = 0;
+    int bucket = hueOf(summary.colors[i], weight);
+    if (bucket < 0) {
+      continue;
+    }
+    weights[bucket] += weight;
+    present[bucket] = true;
+  }
+  int dominant = -1;
+  for (int i = 0; i < INDEX_HUE_BUCKETS; ++i) {
+    if (!present[i]) {
+      continue;
+    }
+    doc.keys.push_back(makeKey(KEY_HUE, i));
+    if (dominant < 0 || weights[i] > weights[dominant]) {
+      dominant = i;
+    }
+  }
+  if (dominant >= 0) {
+    doc.keys.push_back(makeKey(KEY_DOMINANT, dominant));
+  }
+  tokenize(doc.name, doc.tokens);
+  addPostings(docID);
+  ReleaseSRWLockExclusive(&m_lock);
+}
+
+void VortexModeIndex::truncate(Source source, uint32_t count)
+{
+  AcquireSRWLockExclusive(&m_lock);
+  // find every doc being removed first so each list only has to be
+  // filtered once no matter how many docs are removed
+  vector<uint8_t> removed(m_docs.size(), 0);
+  uint32_t numRemoved = 0;
+  for (auto it = m_refs.begin(); it != m_refs.end();) {
+    Doc &doc = m_docs[it->second];
+    if (doc.source != source || doc.index < count) {
+      ++it;
+      continue;
+    }
+    removed[it->second] = 1;
+    doc.alive = false;
+    doc.name.clear();
+    doc.keys.clear();
+    doc.tokens.clear();
+    numRemoved++;
+    it = m_refs.erase(it);
+  }
+  if (numRemoved) {
+    auto isRemoved = [&](uint32_t docID) { return removed[docID] != 0; };
+    for (auto it = m_postings.begin(); it != m_postings.end();) {
+      vector<uint32_t> &list = it->second;
+      list.erase(remove_if(list.begin(), list.end(), isRemoved), list.end());
+      it = list.empty() ? m_postings.erase(it) : next(it);
+    }
+    for (auto it = m_tokens.begin(); it != m_tokens.end();) {
+      vector<uint32_t> &list = it->second;
+      list.erase(remove_if(list.begin(), list.end(), isRemoved), list.end());
+      it = list.empty() ? m_tokens.erase(it) : next(it);
+    }
+    // free the highest ids first so the lowest are reused first
+    for (uint32_t i = (uint32_t)removed.size(); i-- > 0;) {
+      if (removed[i]) {
+        m_freeDocs.push_back(i);
+      }
+    }
+    m_numDocs -= numRemoved;
+  }
+  ReleaseSRWLockExclusive(&m_lock);
+}
+
+bool VortexModeIndex::hashOf(Source source, uint32_t index, uint64_t &outHash) const
+{
+  AcquireSRWLockShared(&m_lock);
+  auto ref = m_refs.find(refKey(source, index));
+  bool found = (ref != m_refs.end());
+  if (found) {
+    outHash = m_docs[ref->second].hash;
+  }
+  ReleaseSRWLockShared(&m_lock);
+  return found;
+}
+
+uint32_t VortexModeIndex::size() const
+{
+  AcquireSRWLockShared(&m_lock);
+  uint32_t numDocs = m_numDocs;
+  ReleaseSRWLockShared(&m_lock);
+  return numDocs;
+}
+
+string VortexModeIndex::nameOf(const Result &result) const
+{
+  string name;
+  AcquireSRWLockShared(&m_lock);
+  auto ref = m_refs.find(refKey(result.source, result.index));
+  if (ref != m_refs.end()) {
+    name = m_docs[ref->second].name;
+  }
+  ReleaseSRWLockShared(&m_lock);
+  return name;
+}
+
+vector<VortexModeIndex::Result> VortexModeIndex::search(const string &query, uint32_t maxResults,
+  uint32_t *outNumMatches) const
+{
+  vector<Result> results;
+  if (outNumMatches) {
+    *outNumMatches = 0;
+  }
+  vector<string> terms;
+  size_t pos = 0;
+  while (pos < query.length()) {
+    size_t end = query.find(' ', pos);
+    if (end == string::npos) {
+      end = query.length();
+    }
+    if (end > pos) {
+      string term = query.substr(pos, end - pos);
+      transform(term.begin(), term.end(), term.begin(), [](char c) { return (char)tolower((unsigned char)c); });
+      terms.push_back(term);
+    }
+    pos = end + 1;
+  }
+  AcquireSRWLockShared(&m_lock);
+  if (!terms.size()) {
+    // an empty query matches everything
+    for (const Doc &doc : m_docs) {
+      if (results.size() >= maxResults) {
+        break;
+      }
+      if (doc.alive) {
+        results.push_back({ doc.source, doc.index });
+      }
+    }
+    if (outNumMatches) {
+      *outNumMatches = m_numDocs;
+    }
+    ReleaseSRWLockShared(&m_lock);
+    return results;
+  }
+  vector<vector<uint32_t>> scratch(terms.size());
+  vector<const vector<uint32_t> *> lists;
+  for (size_t i = 0; i < terms.size(); ++i) {
+    const vector<uint32_t> *list = resolveTerm(terms[i], scratch[i]);
+    if (!list || list->empty()) {
+      // nothing can match every term
+      ReleaseSRWLockShared(&m_lock);
+      return results;
+    }
+    lists.push_back(list);
+  }
+  // start from the shortest list and narrow it down with the others
+  sort(lists.begin(), lists.end(), [](const vector<uint32_t> *a, const vector<uint32_t> *b) {
+    return a->size() < b->size();
+  });
+  vector<uint32_t> matches(*lists[0]);
+  for (size_t i = 1; i < lists.size() && matches.size(); ++i) {
+    const vector<uint32_t> &list = *lists[i];
+    size_t cursor = 0;
+    size_t numKept = 0;
+    for (uint32_t docID : matches) {
+      cursor = gallop(list, cursor, docID);
+      if (cursor == list.size()) {
+        break;
+      }
+      if (list[cursor] == docID) {
+        matches[numKept++] = docID;
+      }
+    }
+    matches.resize(numKept);
+  }
+  if (outNumMatches) {
+    *outNumMatches = (uint32_t)matches.size();
+  }
+  for (uint32_t docID : matches) {
+    if (results.size() >= maxResults) {
+      break;
+    }
+    results.push_back({ m_docs[docID].source, m_docs[docID].index });
+  }
+  ReleaseSRWLockShared(&m_lock);
+  return results;
+}
+
+int VortexModeIndex::hueBucket(uint32_t rgb)
+{
+  float weight = 0;
+  return hueOf(rgb, weight);
+}
+
+const char *VortexModeIndex::hueName(int bucket)
+{
+  if (bucket < 0 || bucket >= INDEX_HUE_BUCKETS) {
+    return "none";
+  }
+  return hueNames[bucket];
+}
+
+void VortexModeIndex::addPostings(uint32_t docID)
+{
+  const Doc &doc = m_docs[docID];
+  for (uint64_t key : doc.keys) {
+    insertSorted(m_postings[key], docID);
+  }
+  for (const string &token : doc.tokens) {
+    insertSorted(m_tokens[token], docID);
+  }
+}
+
+void VortexModeIndex::removePostings(uint32_t docID)
+{
+  const Doc &doc = m_docs[docID];
+  for (uint64_t key : doc.keys) {
+    auto it = m_postings.find(key);
+    if (it == m_postings.end()) {
+      continue;
+    }
+    eraseSorted(it->second, docID);
+    if (it->second.empty()) {
+      m_postings.erase(it);
+    }
+  }
+  for (const string &token : doc.tokens) {
+    auto it = m_tokens.find(token);
+    if (it == m_tokens.end()) {
+      continue;
+    }
+    eraseSorted(it->second, docID);
+    if (it->second.empty()) {
+      m_tokens.erase(it);
+    }
+  }
+}
+
+const vector<uint32_t> *VortexModeIndex::resolveTerm(const string &term, vector<uint32_t> &scratch) const
+{
+  size_t colon = term.find(':');
+  if (colon == string::npos) {
+    // a word of the name, every token that starts with it matches
+    const vector<uint32_t> *first = nullptr;
+    uint32_t numLists = 0;
+    for (auto it = m_tokens.lower_bound(term); it != m_tokens.end(); ++it) {
+      if (it->first.compare(0, term.length(), term) != 0) {
+        break;
+      }
+      if (!numLists++) {
+        first = &it->second;
+        continue;
+      }
+      if (numLists == 2) {
+        scratch = *first;
+      }
+      scratch.insert(scratch.end(), it->second.begin(), it->second.end());
+    }
+    if (numLists < 2) {
+      return first;
+    }
+    sort(scratch.begin(), scratch.end());
+    scratch.erase(unique(scratch.begin(), scratch.end()), scratch.end());
+    return &scratch;
+  }
+  string field = term.substr(0, colon);
+  string value = term.substr(colon + 1);
+  if (value.empty()) {
+    return nullptr;
+  }
+  uint64_t key = 0;
+  if (field == "pattern") {
+    auto name = find(m_patternNames.begin(), m_patternNames.end(), value);
+    if (name != m_patternNames.end()) {
+      // the names start at PATTERN_NONE
+      key = makeKey(KEY_PATTERN, (uint32_t)(name - m_patternNames.begin()) - 1);
+    } else if (isdigit((unsigned char)value[0])) {
+      key = makeKey(KEY_PATTERN, strtoul(value.c_str(), nullptr, 10));
+    } else {
+      return nullptr;
+    }
+  } else if (field == "leds" || field == "colors") {
+    if (!isdigit((unsigned char)value[0])) {
+      return nullptr;
+    }
+    key = makeKey((field == "leds") ? KEY_LEDS : KEY_COLORS, strtoul(value.c_str(), nullptr, 10));
+  } else if (field == "hue" || field == "dominant") {
+    int bucket = 0;
+    while (bucket < INDEX_HUE_BUCKETS && value != hueNames[bucket]) {
+      ++bucket;
+    }
+    if (bucket == INDEX_HUE_BUCKETS) {
+      return nullptr;
+    }
+    key = makeKey((field == "hue") ? KEY_HUE : KEY_DOMINANT, bucket);
+  } else if (field == "in") {
+    int source = 0;
+    while (source < SOURCE_COUNT && value != sourceNames[source]) {
+      ++source;
+    }
+    if (source == SOURCE_COUNT) {
+      return nullptr;
+    }
+    key = makeKey(KEY_SOURCE, source);
+  } else {
+    return nullptr;
+  }
+  auto it = m_postings.find(key);
+  return (it != m_postings.end()) ? &it->second : nullptr;
+}
+
+void VortexModeIndex::tokenize(const string &name, vector<string> &outTokens)
+{
+  string token;
+  for (size_t i = 0; i <= name.length(); ++i) {
+    char c = (i < name.length()) ? name[i] : ' ';
+    if (isalnum((unsigned char)c)) {
+      token += (char)tolower((unsigned char)c);
+      continue;
+    }
+    if (token.length() && find(outTokens.begin(), outTokens.end(), token) == outTokens.end()) {
+      outTokens.push_back(token);
+    }
+    token.clear();
+  }
+}
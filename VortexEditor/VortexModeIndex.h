@@ -0,0 +1,148 @@
+#pragma once
+
+// windows includes
+#include <windows.h>
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+
+#include "VortexModeLibrary.h"
+
+// the number of buckets the hue wheel is split into for searching
+#define INDEX_HUE_BUCKETS 12
+
+// An inverted index over the summaries of modes from every place the editor
+// can find them: the mode list, the open library and the community pages.
+//
+// Every mode gets a document id and each searchable property of the mode
+// (pattern, led count, number of colors, the hues in the colorset, the
+// dominant hue, and the tokens of it's name) maps to a sorted list of the
+// documents that have it. A query is the intersection of the lists for
+// each of it's terms, starting from the shortest, so the cost depends on
+// how many modes match rather than how many are indexed.
+//
+// Queries are a list of terms separated by spaces, all of which must match:
+//
+//   pattern:<name>    uses the pattern (spaces in the name as underscores)
+//   leds:<n>          has exactly n leds
+//   colors:<n>        has exactly n colors
+//   hue:<color>       has a color of that hue (red, orange, yellow, lime,
+//                     green, teal, cyan, azure, blue, purple, magenta, pink)
+//   dominant:<color>  mostly made up of that hue
+//   in:<source>       only modes from the editor, library or community
+//   <word>            the name has a word starting with this
+//
+// The index can be updated one mode at a time and is safe to update and
+// search from different threads.
+class VortexModeIndex
+{
+public:
+  VortexModeIndex();
+  ~VortexModeIndex();
+
+  // where an indexed mode lives
+  enum Source : uint8_t
+  {
+    SOURCE_EDITOR,
+    SOURCE_LIBRARY,
+    SOURCE_COMMUNITY,
+
+    SOURCE_COUNT
+  };
+
+  // a single match, the index is the position of the mode in it's source
+  struct Result
+  {
+    Source source;
+    uint32_t index;
+  };
+
+  // the names of the patterns for resolving pattern: terms, the first name
+  // is PATTERN_NONE and the rest follow in order of pattern id
+  void setPatternNames(const std::vector<std::string> &names);
+
+  // add or replace the mode at an index within a source, the hash of the
+  // summary is used to skip modes that haven't changed
+  void update(Source source, uint32_t index, const VortexModeLibrary::Entry &summary);
+  // remove every mode of a source at or after count
+  void truncate(Source source, uint32_t count);
+  // the hash of an indexed mode, false if there is no mode at that index
+  bool hashOf(Source source, uint32_t index, uint64_t &outHash) const;
+
+  // the number of modes indexed
+  uint32_t size() const;
+  // the name a mode was indexed with
+  std::string nameOf(const Result &result) const;
+
+  // run a query, at most maxResults matches are returned in no particular
+  // order and the total number of matches is optionally provided
+  std::vector<Result> search(const std::string &query, uint32_t maxResults = UINT32_MAX,
+    uint32_t *outNumMatches = nullptr) const;
+
+  // the hue bucket of an 0xRRGGBB color, -1 for greys and blacks
+  static int hueBucket(uint32_t rgb);
+  // the name of a hue bucket
+  static const char *hueName(int bucket);
+
+private:
+  // the kinds of keys, the value of the key is in the low bits
+  enum KeyType : uint8_t
+  {
+    KEY_PATTERN = 1,
+    KEY_LEDS,
+    KEY_COLORS,
+    KEY_HUE,
+    KEY_DOMINANT,
+    KEY_SOURCE,
+  };
+  static uint64_t makeKey(KeyType type, uint32_t value) { return ((uint64_t)type << 32) | value; }
+
+  // an indexed mode
+  struct Doc
+  {
+    Source source;
+    uint32_t index;
+    uint64_t hash;
+    bool alive;
+    std::string name;
+    // everything the document was indexed under so it can be removed
+    std::vector<uint64_t> keys;
+    std::vector<std::string> tokens;
+  };
+
+  // the doc id of a mode in a source
+  static uint64_t refKey(Source source, uint32_t index) { return ((uint64_t)source << 32) | index; }
+
+  // add or remove a doc from the postings of all it's keys
+  void addPostings(uint32_t docID);
+  void removePostings(uint32_t docID);
+
+  // resolve a query term to the sorted list of docs that match it, terms
+  // that match more than one list are merged into the scratch list
+  const std::vector<uint32_t> *resolveTerm(const std::string &term,
+    std::vector<uint32_t> &scratch) const;
+
+  // split a name into lowercase words
+  static void tokenize(const std::string &name, std::vector<std::string> &outTokens);
+
+  // protects everything below
+  mutable SRWLOCK m_lock;
+
+  std::vector<Doc> m_docs;
+  // doc ids that were removed and can be reused
+  std::vector<uint32_t> m_freeDocs;
+  // doc id of each mode by source and index
+  std::unordered_map<uint64_t, uint32_t> m_refs;
+  // the sorted doc ids for each key
+  std::unordered_map<uint64_t, std::vector<uint32_t>> m_postings;
+  // the sorted doc ids for each name token, ordered for prefix lookups
+  std::map<std::string, std::vector<uint32_t>> m_tokens;
+  // number of live docs
+  uint32_t m_numDocs;
+
+  // lowercase pattern names with spaces as underscores
+  std::vector<std::string> m_patternNames;
+};
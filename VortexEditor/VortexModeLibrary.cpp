@@ -0,0 +1,276 @@
+#include "VortexModeLibrary.h"
+
+// VortexEngine includes
+#include "Serial/ByteStream.h"
+#include "Patterns/Patterns.h"
+#include "Colors/Colorset.h"
+#include "VortexLib.h"
+
+// Editor includes
+#include "VortexModeHash.h"
+#include "VortexFile.h"
+
+#include <unordered_map>
+
+// 'VTXL'
+#define LIBRARY_MAGIC   0x4C585456
+#define LIBRARY_VERSION 2
+
+using namespace std;
+
+// write an entire buffer to a file handle
+static bool writeAll(HANDLE hFile, const void *data, uint64_t size)
+{
+  const uint8_t *pos = (const uint8_t *)data;
+  while (size > 0) {
+    DWORD amt = (size > 0x10000000) ? 0x10000000 : (DWORD)size;
+    DWORD written = 0;
+    if (!WriteFile(hFile, pos, amt, &written, NULL) || written != amt) {
+      return false;
+    }
+    pos += amt;
+    size -= amt;
+  }
+  return true;
+}
+
+// whether the mode data stored at an offset of a library is the same as a
+// mode, the file position is left at the end of the file for appending
+static bool storedModeMatches(HANDLE hFile, uint64_t offset, uint32_t size, const ByteStream &mode)
+{
+  vector<uint8_t> stored(size);
+  LARGE_INTEGER pos;
+  pos.QuadPart = (LONGLONG)offset;
+  DWORD bytesRead = 0;
+  bool success = SetFilePointerEx(hFile, pos, NULL, FILE_BEGIN) &&
+    ReadFile(hFile, stored.data(), size, &bytesRead, NULL) && bytesRead == size;
+  LARGE_INTEGER zero = {0};
+  SetFilePointerEx(hFile, zero, NULL, FILE_END);
+  ByteStream storedMode;
+  return success && VortexFile::parse(stored.data(), size, storedMode) &&
+    VortexModeHash::sameMode(storedMode, mode);
+}
+
+VortexModeLibrary::VortexModeLibrary() :
+  m_filename(),
+  m_hFile(INVALID_HANDLE_VALUE),
+  m_hMapping(nullptr),
+  m_pView(nullptr),
+  m_fileSize(0),
+  m_pEntries(nullptr),
+  m_numEntries(0)
+{
+}
+
+VortexModeLibrary::~VortexModeLibrary()
+{
+  close();
+}
+
+bool VortexModeLibrary::open(const string &filename)
+{
+  close();
+  m_hFile = CreateFile(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+    OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (m_hFile == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  LARGE_INTEGER fileSize;
+  if (!GetFileSizeEx(m_hFile, &fileSize) || (uint64_t)fileSize.QuadPart < sizeof(Header)) {
+    close();
+    return false;
+  }
+  m_fileSize = (uint64_t)fileSize.QuadPart;
+  m_hMapping = CreateFileMapping(m_hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (!m_hMapping) {
+    close();
+    return false;
+  }
+  m_pView = (const uint8_t *)MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, 0);
+  if (!m_pView) {
+    close();
+    return false;
+  }
+  const Header *header = (const Header *)m_pView;
+  if (header->magic != LIBRARY_MAGIC || header->version != LIBRARY_VERSION ||
+      header->entrySize != sizeof(Entry)) {
+    close();
+    return false;
+  }
+  // the table must fit entirely within the file
+  uint64_t tocSize = (uint64_t)header->numEntries * sizeof(Entry);
+  if (header->tocOffset < sizeof(Header) || header->tocOffset > m_fileSize ||
+      tocSize > (m_fileSize - header->tocOffset)) {
+    close();
+    return false;
+  }
+  m_pEntries = (const Entry *)(m_pView + header->tocOffset);
+  m_numEntries = header->numEntries;
+  m_filename = filename;
+  return true;
+}
+
+void VortexModeLibrary::close()
+{
+  if (m_pView) {
+    UnmapViewOfFile(m_pView);
+    m_pView = nullptr;
+  }
+  if (m_hMapping) {
+    CloseHandle(m_hMapping);
+    m_hMapping = nullptr;
+  }
+  if (m_hFile != INVALID_HANDLE_VALUE) {
+    CloseHandle(m_hFile);
+    m_hFile = INVALID_HANDLE_VALUE;
+  }
+  m_fileSize = 0;
+  m_pEntries = nullptr;
+  m_numEntries = 0;
+  m_filename.clear();
+}
+
+const VortexModeLibrary::Entry *VortexModeLibrary::entry(uint32_t index) const
+{
+  if (!m_pEntries || index >= m_numEntries) {
+    return nullptr;
+  }
+  return m_pEntries + index;
+}
+
+bool VortexModeLibrary::loadMode(uint32_t index, ByteStream &outStream) const
+{
+  const Entry *ent = entry(index);
+  if (!ent || ent->offset > m_fileSize || ent->size > (m_fileSize - ent->offset)) {
+    return false;
+  }
+  if (!VortexFile::parse(m_pView + ent->offset, ent->size, outStream)) {
+    return false;
+  }
+  // the table and the mode should agree
+  return outStream.CRC() == ent->crc32;
+}
+
+bool VortexModeLibrary::append(const string &filename, vector<Entry> &entries,
+  vector<ByteStream> &modes)
+{
+  if (entries.size() != modes.size()) {
+    return false;
+  }
+  // grab the existing table of contents, the new table is written after
+  // the new modes so the existing one can't be written into
+  vector<Entry> toc;
+  bool reopen = isOpen();
+  string openFilename = m_filename;
+  close();
+  if (GetFileAttributes(filename.c_str()) != INVALID_FILE_ATTRIBUTES) {
+    VortexModeLibrary existing;
+    if (!existing.open(filename)) {
+      // not a library, don't clobber it
+      if (reopen) {
+        open(openFilename);
+      }
+      return false;
+    }
+    toc.assign(existing.m_pEntries, existing.m_pEntries + existing.m_numEntries);
+  }
+  HANDLE hFile = CreateFile(filename.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL,
+    OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (hFile == INVALID_HANDLE_VALUE) {
+    if (reopen) {
+      open(openFilename);
+    }
+    return false;
+  }
+  Header header;
+  memset(&header, 0, sizeof(header));
+  header.magic = LIBRARY_MAGIC;
+  header.version = LIBRARY_VERSION;
+  header.entrySize = sizeof(Entry);
+  bool success = true;
+  LARGE_INTEGER zero = {0};
+  LARGE_INTEGER end = {0};
+  if (!toc.size()) {
+    // a brand new library starts with an empty header, this is also the
+    // case for an existing library that is empty
+    SetFilePointerEx(hFile, zero, NULL, FILE_BEGIN);
+    success = writeAll(hFile, &header, sizeof(header)) && SetEndOfFile(hFile);
+  }
+  success = success && SetFilePointerEx(hFile, zero, &end, FILE_END);
+  uint64_t offset = (uint64_t)end.QuadPart;
+  // the data of every mode already in the library by it's hash
+  unordered_map<uint64_t, size_t> stored;
+  for (size_t i = 0; i < toc.size(); ++i) {
+    stored.emplace(toc[i].hash, i);
+  }
+  for (size_t i = 0; success && i < modes.size(); ++i) {
+    ByteStream &mode = modes[i];
+    Entry &ent = entries[i];
+    ent.hash = VortexModeHash::hashMode(mode);
+    auto existing = stored.find(ent.hash);
+    if (existing != stored.end() && storedModeMatches(hFile, toc[existing->second].offset,
+        toc[existing->second].size, mode)) {
+      // identical mode, share the data that is already stored
+      const Entry &shared = toc[existing->second];
+      ent.offset = shared.offset;
+      ent.size = shared.size;
+      ent.crc32 = shared.crc32;
+      toc.push_back(ent);
+      continue;
+    }
+    ent.offset = offset;
+    ent.crc32 = mode.recalcCRC();
+    ent.size = mode.rawSize();
+    success = writeAll(hFile, mode.rawData(), ent.size);
+    offset += ent.size;
+    stored.emplace(ent.hash, toc.size());
+    toc.push_back(ent);
+  }
+  header.numEntries = (uint32_t)toc.size();
+  header.tocOffset = offset;
+  // the new table must be on disk before the header points at it
+  success = success && writeAll(hFile, toc.data(), toc.size() * sizeof(Entry));
+  success = success && FlushFileBuffers(hFile);
+  success = success && SetFilePointerEx(hFile, zero, NULL, FILE_BEGIN);
+  success = success && writeAll(hFile, &header, sizeof(header));
+  success = success && FlushFileBuffers(hFile);
+  CloseHandle(hFile);
+  if (reopen) {
+    open(openFilename);
+  }
+  return success;
+}
+
+void VortexModeLibrary::summarize(Vortex &vortex, const string &name, Entry &outEntry)
+{
+  memset(&outEntry, 0, sizeof(outEntry));
+  memset(outEntry.patternIDs, (uint8_t)PATTERN_NONE, sizeof(outEntry.patternIDs));
+  strncpy_s(outEntry.name, name.c_str(), _TRUNCATE);
+  outEntry.numLeds = (uint8_t)vortex.numLedsInMode();
+  outEntry.isMulti = vortex.isCurModeMulti();
+  // gather the unique patterns in the mode
+  uint32_t numPats = 0;
+  if (outEntry.isMulti) {
+    outEntry.patternIDs[numPats++] = (uint8_t)vortex.getPatternID(LED_MULTI);
+  }
+  for (LedPos pos = LED_FIRST; pos < outEntry.numLeds && numPats < LIBRARY_MAX_PATTERNS; ++pos) {
+    uint8_t id = (uint8_t)vortex.getPatternID(pos);
+    if (id == (uint8_t)PATTERN_NONE) {
+      continue;
+    }
+    uint32_t i = 0;
+    while (i < numPats && outEntry.patternIDs[i] != id) {
+      ++i;
+    }
+    if (i == numPats) {
+      outEntry.patternIDs[numPats++] = id;
+    }
+  }
+  // and the colorset of the first led, or the multi led pattern
+  Colorset set;
+  vortex.getColorset(outEntry.isMulti ? LED_MULTI : LED_FIRST, set);
+  outEntry.numColors = set.numColors();
+  for (uint32_t i = 0; i < set.numColors() && i < LIBRARY_MAX_COLORS; ++i) {
+    outEntry.colors[i] = set.get(i).raw();
+  }
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+// windows includes
+#include <windows.h>
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+class ByteStream;
+class Vortex;
+
+// the extension of mode libraries
+#define VORTEX_LIBRARY_EXTENSION ".vtxlib"
+
+// the most pattern ids and colors stored in the summary of each mode
+#define LIBRARY_MAX_PATTERNS 8
+#define LIBRARY_MAX_COLORS 8
+// the longest name that can be stored for each mode
+#define LIBRARY_MAX_NAME 48
+
+// A mode library (.vtxlib) packs any number of .vtxmode files into a single
+// file with a table of contents at the end:
+//
+//   [Header] [mode] [mode] ... [mode] [Entry] [Entry] ... [Entry]
+//
+// Each mode is stored byte for byte as it would be in a .vtxmode file and
+// the table of contents holds a fixed size Entry for each mode. The file is
+// memory mapped so opening a library only touches the header and the table
+// regardless of how many modes it contains, and any mode can be looked up
+// by index without reading any of the others.
+//
+// Appending writes the new modes and a new table after the end of the file
+// and only then points the header at the new table, so an interrupted append
+// leaves the library as it was. The old table is left behind as dead space
+// which is dropped whenever the library is re-packed.
+//
+// Modes are content addressed by their hash, when a mode that is already
+// in the library is appended again the new entry shares the existing data
+// instead of storing another copy. The stored data is compared before it's
+// shared so a hash collision can never swap one mode for another.
+class VortexModeLibrary
+{
+public:
+  VortexModeLibrary();
+  ~VortexModeLibrary();
+
+  // the table of contents entry for a single mode
+  struct Entry
+  {
+    // position and size of the mode within the library
+    uint64_t offset;
+    uint32_t size;
+    // the crc of the mode data
+    uint32_t crc32;
+    // the content hash of the mode, identical entries share data
+    uint64_t hash;
+    // summary of the mode for browsing without loading it
+    uint8_t numLeds;
+    uint8_t numColors;
+    uint8_t isMulti;
+    uint8_t reserved;
+    // the unique pattern ids in the mode, PATTERN_NONE marks the end
+    uint8_t patternIDs[LIBRARY_MAX_PATTERNS];
+    // the first few colors of the colorset
+    uint32_t colors[LIBRARY_MAX_COLORS];
+    // the name of the mode
+    char name[LIBRARY_MAX_NAME];
+  };
+
+  // open a library for reading, the file stays mapped until close()
+  bool open(const std::string &filename);
+  void close();
+
+  bool isOpen() const { return m_pView != nullptr; }
+  const std::string &filename() const { return m_filename; }
+
+  // random access to the table of contents
+  uint32_t numEntries() const { return m_numEntries; }
+  const Entry *entry(uint32_t index) const;
+
+  // load a single mode out of the library, the mode is validated the same
+  // way as a .vtxmode file so a damaged library can't corrupt the engine
+  bool loadMode(uint32_t index, ByteStream &outStream) const;
+
+  // append modes to a library, the library is created if it doesn't exist.
+  // The entries provide the summary of each mode and the offset, size, crc
+  // and hash fields are filled out while writing. If the library is open it will
+  // be re-opened afterwards to pick up the new modes
+  bool append(const std::string &filename, std::vector<Entry> &entries,
+    std::vector<ByteStream> &modes);
+
+  // fill out the summary of an entry from the current mode of a vortex
+  static void summarize(Vortex &vortex, const std::string &name, Entry &outEntry);
+
+private:
+  // the header at the front of the library
+  struct Header
+  {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t numEntries;
+    uint32_t entrySize;
+    uint64_t tocOffset;
+    uint64_t reserved;
+  };
+
+  std::string m_filename;
+
+  // the memory mapped view of the file
+  HANDLE m_hFile;
+  HANDLE m_hMapping;
+  const uint8_t *m_pView;
+  uint64_t m_fileSize;
+
+  // the table of contents within the view
+  const Entry *m_pEntries;
+  uint32_t m_numEntries;
+};
@@ -0,0 +1,104 @@
+#include "VortexModeRenderer.h"
+
+// VortexEngine includes
+#include "Serial/ByteStream.h"
+#include "Leds/LedTypes.h"
+#include "VortexLib.h"
+
+#include <fstream>
+
+// the header of a render file
+#define RENDER_FILE_MAGIC 0x444E5256 // VRND
+#define RENDER_FILE_VERSION 1
+
+using namespace std;
+
+VortexModeRenderer::VortexModeRenderer() :
+  m_pool(),
+  m_engines()
+{
+}
+
+VortexModeRenderer::~VortexModeRenderer()
+{
+  cleanup();
+}
+
+bool VortexModeRenderer::init(uint32_t numWorkers)
+{
+  // if no workers could be started the pool renders on this thread
+  m_pool.init(numWorkers);
+  while (m_engines.size() < m_pool.numWorkers() || !m_engines.size()) {
+    m_engines.push_back(make_unique<Vortex>());
+    m_engines.back()->init();
+    // rendering is as fast as the engine can go
+    m_engines.back()->setInstantTimestep(true);
+  }
+  return true;
+}
+
+void VortexModeRenderer::cleanup()
+{
+  m_pool.cleanup();
+  m_engines.clear();
+}
+
+uint32_t VortexModeRenderer::render(const vector<ByteStream> &modes, uint32_t numTicks,
+  vector<Render> &outRenders)
+{
+  outRenders.clear();
+  outRenders.resize(modes.size());
+  if (!m_engines.size() && !init()) {
+    return 0;
+  }
+  vector<uint8_t> rendered(modes.size(), 0);
+  m_pool.parallelFor((uint32_t)modes.size(), [&](uint32_t i, uint32_t worker) {
+    rendered[i] = renderMode(*m_engines[worker], modes[i], numTicks, outRenders[i]);
+  });
+  uint32_t numRendered = 0;
+  for (uint8_t success : rendered) {
+    numRendered += success;
+  }
+  return numRendered;
+}
+
+bool VortexModeRenderer::renderMode(Vortex &vortex, const ByteStream &mode, uint32_t numTicks,
+  Render &outRender)
+{
+  outRender.numLeds = 0;
+  outRender.numTicks = numTicks;
+  outRender.colors.clear();
+  // load the mode on it's own so it starts from the very beginning
+  ByteStream copy = mode;
+  vortex.engine().modes().clearModes();
+  vortex.matchLedCount(copy, true);
+  if (!vortex.addNewMode(copy, false) || !vortex.setCurMode(0, false)) {
+    return false;
+  }
+  uint32_t numLeds = vortex.numLedsInMode();
+  outRender.numLeds = numLeds;
+  outRender.colors.resize((size_t)numLeds * numTicks);
+  for (uint32_t tick = 0; tick < numTicks; ++tick) {
+    vortex.engine().tick();
+    for (uint32_t led = 0; led < numLeds; ++led) {
+      outRender.colors[(size_t)led * numTicks + tick] = vortex.engine().leds().getLed((LedPos)led).raw();
+    }
+  }
+  return true;
+}
+
+bool VortexModeRenderer::write(const string &filename, const vector<Render> &renders)
+{
+  ofstream file(filename, ios::binary | ios::trunc);
+  if (!file) {
+    return false;
+  }
+  uint32_t header[3] = { RENDER_FILE_MAGIC, RENDER_FILE_VERSION, (uint32_t)renders.size() };
+  file.write((const char *)header, sizeof(header));
+  for (const Render &render : renders) {
+    uint32_t sizes[2] = { render.numLeds, render.numTicks };
+    file.write((const char *)sizes, sizeof(sizes));
+    file.write((const char *)render.colors.data(), render.colors.size() * sizeof(uint32_t));
+  }
+  return file.good();
+}
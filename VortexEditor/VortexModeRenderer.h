@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "VortexThreadPool.h"
+
+class ByteStream;
+class Vortex;
+
+// Renders the colors of many modes without any window, for thumbnails and
+// exports.
+//
+// Every mode is simulated from the start for the same number of ticks and
+// the color of every led is kept for every tick. The modes are spread
+// across a pool of workers which each grab the next mode as soon as they
+// finish one, so a few slow modes don't hold up the rest, and each worker
+// renders with an engine of it's own.
+class VortexModeRenderer
+{
+public:
+  VortexModeRenderer();
+  ~VortexModeRenderer();
+
+  // start the workers and an engine for each, by default one per core
+  bool init(uint32_t numWorkers = 0);
+  void cleanup();
+
+  uint32_t numWorkers() const { return m_pool.numWorkers(); }
+
+  // the colors of a single mode
+  struct Render
+  {
+    uint32_t numLeds;
+    uint32_t numTicks;
+    // numTicks colors for each led, one led after another
+    std::vector<uint32_t> colors;
+
+    uint32_t color(uint32_t led, uint32_t tick) const { return colors[(size_t)led * numTicks + tick]; }
+  };
+
+  // render each of the serialized modes for the given number of ticks, a
+  // mode that can't be loaded renders with no leds, returns the number of
+  // modes that rendered
+  uint32_t render(const std::vector<ByteStream> &modes, uint32_t numTicks,
+    std::vector<Render> &outRenders);
+
+  // write the renders to a file, a small header then each mode's led
+  // count, tick count and colors
+  static bool write(const std::string &filename, const std::vector<Render> &renders);
+
+private:
+  // render a single mode with the engine of a worker
+  static bool renderMode(Vortex &vortex, const ByteStream &mode, uint32_t numTicks, Render &outRender);
+
+  VortexThreadPool m_pool;
+  std::vector<std::unique_ptr<Vortex>> m_engines;
+};
@@ -0,0 +1,139 @@
+#include "VortexModeSearch.h"
+#include "VortexEditor.h"
+#include "EditorConfig.h"
+
+#include "resource.h"
+
+#include <stdio.h>
+
+#define SEARCH_QUERY_ID       59101
+#define SEARCH_RESULT_LIST_ID 59102
+
+// the most results listed at once, the count still covers every match
+#define SEARCH_MAX_RESULTS 500
+
+using namespace std;
+
+VortexModeSearch::VortexModeSearch() :
+  m_isOpen(false),
+  m_hIcon(nullptr),
+  m_results(),
+  m_searchWindow(),
+  m_queryTextBox(),
+  m_statusLabel(),
+  m_resultListBox(),
+  m_helpLabel()
+{
+}
+
+VortexModeSearch::~VortexModeSearch()
+{
+  DestroyIcon(m_hIcon);
+}
+
+// initialize the mode search
+bool VortexModeSearch::init(HINSTANCE hInst)
+{
+  // the mode search
+  m_searchWindow.init(hInst, "Vortex Mode Search", BACK_COL, 420, 460, this);
+  m_searchWindow.setVisible(false);
+  m_searchWindow.setCloseCallback(hideGUICallback);
+  m_searchWindow.installLoseFocusCallback(loseFocusCallback);
+
+  m_queryTextBox.init(hInst, m_searchWindow, "", BACK_COL,
+    390, 24, 10, 10, SEARCH_QUERY_ID, queryCallback);
+  m_statusLabel.init(hInst, m_searchWindow, "", BACK_COL,
+    390, 18, 10, 40, 0, nullptr);
+  m_resultListBox.init(hInst, m_searchWindow, "Results", BACK_COL,
+    390, 280, 10, 60, SEARCH_RESULT_LIST_ID, selectCallback);
+  m_helpLabel.init(hInst, m_searchWindow,
+    "pattern:<name> leds:<n> colors:<n> hue:<color> dominant:<color>\r\n"
+    "in:editor|library|community <name words>", BACK_COL,
+    390, 36, 10, 350, 0, nullptr);
+
+  // apply the icon
+  m_hIcon = LoadIcon(hInst, MAKEINTRESOURCE(IDI_ICON1));
+  SendMessage(m_searchWindow.hwnd(), WM_SETICON, ICON_BIG, (LPARAM)m_hIcon);
+
+  return true;
+}
+
+void VortexModeSearch::show()
+{
+  if (m_isOpen) {
+    return;
+  }
+  m_searchWindow.setVisible(true);
+  m_searchWindow.setEnabled(true);
+  m_isOpen = true;
+  SetFocus(m_queryTextBox.hwnd());
+  runQuery();
+}
+
+void VortexModeSearch::hide()
+{
+  if (!m_isOpen) {
+    return;
+  }
+  if (m_searchWindow.isVisible()) {
+    m_searchWindow.setVisible(false);
+  }
+  if (m_searchWindow.isEnabled()) {
+    m_searchWindow.setEnabled(false);
+  }
+  m_isOpen = false;
+}
+
+void VortexModeSearch::loseFocus()
+{
+}
+
+void VortexModeSearch::runQuery()
+{
+  LARGE_INTEGER freq;
+  LARGE_INTEGER startTime;
+  LARGE_INTEGER endTime;
+  QueryPerformanceFrequency(&freq);
+  QueryPerformanceCounter(&startTime);
+  uint32_t numMatches = 0;
+  m_results = g_pEditor->searchModes(m_queryTextBox.getText(), SEARCH_MAX_RESULTS, &numMatches);
+  QueryPerformanceCounter(&endTime);
+  double ms = (double)(endTime.QuadPart - startTime.QuadPart) * 1000.0 / (double)freq.QuadPart;
+  static const char *sourceTags[VortexModeIndex::SOURCE_COUNT] = { "Editor", "Library", "Community" };
+  // the list is filled without redrawing so long result lists stay quick
+  SendMessage(m_resultListBox.hwnd(), WM_SETREDRAW, FALSE, 0);
+  m_resultListBox.clearItems();
+  for (const VortexModeIndex::Result &result : m_results) {
+    m_resultListBox.addItem(string(sourceTags[result.source]) + " " + to_string(result.index) +
+      ": " + g_pEditor->m_modeIndex.nameOf(result));
+  }
+  SendMessage(m_resultListBox.hwnd(), WM_SETREDRAW, TRUE, 0);
+  InvalidateRect(m_resultListBox.hwnd(), NULL, TRUE);
+  char status[128] = {0};
+  snprintf(status, sizeof(status), "%u of %u modes match (%.3f ms)", numMatches,
+    g_pEditor->m_modeIndex.size(), ms);
+  m_statusLabel.setText(status);
+}
+
+void VortexModeSearch::selectResult()
+{
+  int sel = m_resultListBox.getSelection();
+  if (sel < 0 || (uint32_t)sel >= m_results.size()) {
+    return;
+  }
+  const VortexModeIndex::Result &result = m_results[sel];
+  switch (result.source) {
+  case VortexModeIndex::SOURCE_EDITOR:
+    g_pEditor->m_modeListBox.setSelection(result.index);
+    g_pEditor->selectMode(nullptr);
+    break;
+  case VortexModeIndex::SOURCE_LIBRARY:
+    g_pEditor->m_libraryBrowser.showEntry(result.index);
+    break;
+  case VortexModeIndex::SOURCE_COMMUNITY:
+    g_pEditor->m_communityBrowser.showMode(result.index);
+    break;
+  default:
+    break;
+  }
+}
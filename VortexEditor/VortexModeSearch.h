@@ -0,0 +1,69 @@
+#pragma once
+
+// windows includes
+#include <windows.h>
+
+// gui includes
+#include "GUI/VChildwindow.h"
+#include "GUI/VListBox.h"
+#include "GUI/VTextBox.h"
+#include "GUI/VLabel.h"
+
+#include "VortexModeIndex.h"
+
+#include <vector>
+
+class VortexModeSearch
+{
+public:
+  VortexModeSearch();
+  ~VortexModeSearch();
+
+  // initialize the mode search
+  bool init(HINSTANCE hInstance);
+
+  // show/hide the mode search window
+  void show();
+  void hide();
+  void loseFocus();
+
+  bool isOpen() const { return m_isOpen; }
+
+  HWND hwnd() const { return m_searchWindow.hwnd(); }
+
+private:
+  // ==================================
+  //  Mode Search GUI
+  static void hideGUICallback(void *pthis, VWindow *window) {
+    ((VortexModeSearch *)pthis)->hide();
+  }
+  static void loseFocusCallback(void *pthis, VWindow *window) {
+    ((VortexModeSearch *)pthis)->loseFocus();
+  }
+  static void queryCallback(void *pthis, VWindow *window) {
+    ((VortexModeSearch *)pthis)->runQuery();
+  }
+  static void selectCallback(void *pthis, VWindow *window) {
+    ((VortexModeSearch *)pthis)->selectResult();
+  }
+
+  // run the query in the search box and list the results
+  void runQuery();
+  // jump to the selected result wherever it lives
+  void selectResult();
+
+  bool m_isOpen;
+
+  HICON m_hIcon;
+
+  // the results currently listed
+  std::vector<VortexModeIndex::Result> m_results;
+
+  // child window for mode search tool
+  VChildWindow m_searchWindow;
+
+  VTextBox m_queryTextBox;
+  VLabel m_statusLabel;
+  VListBox m_resultListBox;
+  VLabel m_helpLabel;
+};
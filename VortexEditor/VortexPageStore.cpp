@@ -0,0 +1,211 @@
+#include "VortexPageStore.h"
+
+#include <algorithm>
+
+using namespace std;
+
+VortexPageStore::VortexPageStore() :
+  m_fetcher(),
+  m_hwnd(nullptr),
+  m_msg(0),
+  m_workers(),
+  m_lock(),
+  m_wake(),
+  m_pages(),
+  m_queue(),
+  m_fetching(),
+  m_arrived(),
+  m_notifyPending(false),
+  m_numPages(0),
+  m_numFetches(0),
+  m_numDropped(0),
+  m_quit(false)
+{
+  InitializeSRWLock(&m_lock);
+  InitializeConditionVariable(&m_wake);
+}
+
+VortexPageStore::~VortexPageStore()
+{
+  cleanup();
+}
+
+bool VortexPageStore::init(const Fetcher &fetcher, uint32_t numWorkers, HWND hwnd, UINT msg)
+{
+  if (!fetcher || !numWorkers || m_workers.size()) {
+    return false;
+  }
+  m_fetcher = fetcher;
+  m_hwnd = hwnd;
+  m_msg = msg;
+  m_quit = false;
+  for (uint32_t i = 0; i < numWorkers; ++i) {
+    HANDLE hThread = CreateThread(NULL, 0, workerThread, this, 0, NULL);
+    if (!hThread) {
+      cleanup();
+      return false;
+    }
+    m_workers.push_back(hThread);
+  }
+  return true;
+}
+
+void VortexPageStore::cleanup()
+{
+  // pages that are being fetched are finished but nothing new is started
+  AcquireSRWLockExclusive(&m_lock);
+  m_quit = true;
+  m_queue.clear();
+  ReleaseSRWLockExclusive(&m_lock);
+  WakeAllConditionVariable(&m_wake);
+  for (HANDLE hThread : m_workers) {
+    WaitForSingleObject(hThread, INFINITE);
+    CloseHandle(hThread);
+  }
+  m_workers.clear();
+}
+
+VortexPageStore::Page VortexPageStore::get(uint32_t page) const
+{
+  Page result;
+  AcquireSRWLockShared(&m_lock);
+  auto it = m_pages.find(page);
+  if (it != m_pages.end()) {
+    result = it->second;
+  }
+  ReleaseSRWLockShared(&m_lock);
+  return result;
+}
+
+bool VortexPageStore::isPending(uint32_t page) const
+{
+  AcquireSRWLockShared(&m_lock);
+  bool pending = m_fetching.count(page) ||
+    find(m_queue.begin(), m_queue.end(), page) != m_queue.end();
+  ReleaseSRWLockShared(&m_lock);
+  return pending;
+}
+
+void VortexPageStore::prefetch(uint32_t page, uint32_t radius, uint32_t keepRadius)
+{
+  AcquireSRWLockExclusive(&m_lock);
+  if (m_quit) {
+    ReleaseSRWLockExclusive(&m_lock);
+    return;
+  }
+  // the queue is rebuilt around the new page, anything that was queued for
+  // the old page and isn't near the new one is dropped
+  m_queue.clear();
+  for (uint32_t dist = 0; dist <= radius; ++dist) {
+    uint32_t near[2] = { page + dist, page - dist };
+    for (uint32_t i = 0; i < 2; ++i) {
+      uint32_t p = near[i];
+      if ((i && (dist > page || !dist)) || (m_numPages && p >= m_numPages)) {
+        continue;
+      }
+      if (!m_pages.count(p) && !m_fetching.count(p)) {
+        m_queue.push_back(p);
+      }
+    }
+  }
+  // the ui holds it's own reference to any page it's still showing, and
+  // pages that arrive out here after this are dropped on the next move
+  for (auto it = m_pages.begin(); it != m_pages.end();) {
+    uint32_t dist = (it->first > page) ? it->first - page : page - it->first;
+    if (dist > keepRadius) {
+      it = m_pages.erase(it);
+      m_numDropped++;
+    } else {
+      ++it;
+    }
+  }
+  bool queued = !m_queue.empty();
+  ReleaseSRWLockExclusive(&m_lock);
+  if (queued) {
+    WakeAllConditionVariable(&m_wake);
+  }
+}
+
+void VortexPageStore::takeArrived(vector<uint32_t> &outPages)
+{
+  AcquireSRWLockExclusive(&m_lock);
+  outPages.swap(m_arrived);
+  m_arrived.clear();
+  m_notifyPending = false;
+  ReleaseSRWLockExclusive(&m_lock);
+}
+
+uint32_t VortexPageStore::numPages() const
+{
+  AcquireSRWLockShared(&m_lock);
+  uint32_t numPages = m_numPages;
+  ReleaseSRWLockShared(&m_lock);
+  return numPages;
+}
+
+uint32_t VortexPageStore::numStored() const
+{
+  AcquireSRWLockShared(&m_lock);
+  uint32_t numStored = (uint32_t)m_pages.size();
+  ReleaseSRWLockShared(&m_lock);
+  return numStored;
+}
+
+uint32_t VortexPageStore::numFetches() const
+{
+  AcquireSRWLockShared(&m_lock);
+  uint32_t numFetches = m_numFetches;
+  ReleaseSRWLockShared(&m_lock);
+  return numFetches;
+}
+
+uint32_t VortexPageStore::numDropped() const
+{
+  AcquireSRWLockShared(&m_lock);
+  uint32_t numDropped = m_numDropped;
+  ReleaseSRWLockShared(&m_lock);
+  return numDropped;
+}
+
+DWORD __stdcall VortexPageStore::workerThread(void *arg)
+{
+  ((VortexPageStore *)arg)->work();
+  return 0;
+}
+
+void VortexPageStore::work()
+{
+  AcquireSRWLockExclusive(&m_lock);
+  while (true) {
+    while (!m_quit && m_queue.empty()) {
+      SleepConditionVariableSRW(&m_wake, &m_lock, INFINITE, 0);
+    }
+    if (m_quit) {
+      break;
+    }
+    uint32_t page = m_queue.front();
+    m_queue.pop_front();
+    m_fetching.insert(page);
+    m_numFetches++;
+    ReleaseSRWLockExclusive(&m_lock);
+
+    Page result = m_fetcher(page);
+
+    AcquireSRWLockExclusive(&m_lock);
+    m_fetching.erase(page);
+    if (result) {
+      m_pages[page] = result;
+      if (result->numPages()) {
+        m_numPages = result->numPages();
+      }
+    }
+    // failed pages are reported too so the ui can stop waiting on them
+    m_arrived.push_back(page);
+    bool notify = !m_notifyPending && m_hwnd;
+    m_notifyPending = true;
+    if (notify) {
+      PostMessage(m_hwnd, m_msg, 0, 0);
+    }
+  }
+  ReleaseSRWLockExclusive(&m_lock);
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+// windows includes
+#include <windows.h>
+
+#include <stdint.h>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <set>
+#include <vector>
+
+#include "VortexCommunityPage.h"
+
+// The pages of modes fetched from the community server, shared between the
+// ui and the workers that fetch them.
+//
+// A page is converted once and never changed after it's stored, the store only
+// hands out shared pointers to it so the ui can keep drawing from a page
+// without holding the lock while workers add other pages.
+//
+// prefetch() keeps the pages on either side of the current page warm, the
+// workers fetch them in parallel nearest first. Moving to another page
+// replaces whatever is still queued so paging quickly doesn't leave a
+// backlog of pages nobody is looking at anymore, and the pages that are now
+// far from the current page are dropped so the store doesn't grow with every
+// page ever visited. Going back to a dropped page fetches it again, which is
+// a load from the disk cache. Once a batch of pages has arrived a message is
+// posted to the window, the ui then takes the pages that arrived with
+// takeArrived().
+class VortexPageStore
+{
+public:
+  VortexPageStore();
+  ~VortexPageStore();
+
+  typedef std::shared_ptr<const VortexCommunityPage> Page;
+  // fetch and convert a page, runs on the workers so it must be safe to call
+  // from many threads at once. Returns null if the page couldn't be fetched
+  typedef std::function<Page(uint32_t page)> Fetcher;
+
+  bool init(const Fetcher &fetcher, uint32_t numWorkers, HWND hwnd, UINT msg);
+  void cleanup();
+
+  // the page if it has been fetched, this never blocks on a fetch
+  Page get(uint32_t page) const;
+  // whether the page is queued or being fetched
+  bool isPending(uint32_t page) const;
+
+  // fetch the page and the pages up to radius either side of it, and drop
+  // the stored pages that are more than keepRadius away from it
+  void prefetch(uint32_t page, uint32_t radius, uint32_t keepRadius);
+
+  // the pages that arrived since the last call, in the order they arrived
+  void takeArrived(std::vector<uint32_t> &outPages);
+
+  // the number of pages on the server, zero until a page has arrived
+  uint32_t numPages() const;
+  uint32_t numStored() const;
+  uint32_t numFetches() const;
+  uint32_t numDropped() const;
+
+private:
+  static DWORD __stdcall workerThread(void *arg);
+  void work();
+
+  Fetcher m_fetcher;
+  HWND m_hwnd;
+  UINT m_msg;
+  std::vector<HANDLE> m_workers;
+
+  // protects everything below
+  mutable SRWLOCK m_lock;
+  // signaled when pages are queued or the store is closing
+  CONDITION_VARIABLE m_wake;
+
+  std::map<uint32_t, Page> m_pages;
+  // pages waiting for a worker, nearest to the current page first
+  std::deque<uint32_t> m_queue;
+  std::set<uint32_t> m_fetching;
+  std::vector<uint32_t> m_arrived;
+  // whether a message has been posted and not yet answered
+  bool m_notifyPending;
+  uint32_t m_numPages;
+  uint32_t m_numFetches;
+  uint32_t m_numDropped;
+  bool m_quit;
+};
@@ -0,0 +1,522 @@
+// winsock must come before windows.h
+#include <winsock2.h>
+#include <afunix.h>
+
+#include "VortexRPCServer.h"
+
+#pragma comment(lib, "ws2_32.lib")
+
+// requests are read from the client in chunks of this size
+#define RPC_READ_SIZE (64 * 1024)
+// a client that sends a single request larger than this is dropped
+#define RPC_MAX_REQUEST (16 * 1024 * 1024)
+// how often a socket wait wakes up to check if the server is stopping
+#define RPC_POLL_MS 100
+
+// the error codes of json-rpc 2.0
+#define RPC_PARSE_ERROR       -32700
+#define RPC_INVALID_REQUEST   -32600
+#define RPC_METHOD_NOT_FOUND  -32601
+#define RPC_INVALID_PARAMS    -32602
+#define RPC_INTERNAL_ERROR    -32603
+#define RPC_METHOD_FAILED     -32000
+
+// older sdks don't know the reparse tag of unix domain socket files
+#ifndef IO_REPARSE_TAG_AF_UNIX
+#define IO_REPARSE_TAG_AF_UNIX 0x80000023L
+#endif
+
+using namespace std;
+
+// whether the path is a unix domain socket that nothing is listening on,
+// the file left behind by an editor that didn't close properly
+static bool isStaleSocket(const string &path, const sockaddr_un &addr)
+{
+  WIN32_FIND_DATA findData;
+  HANDLE hFind = FindFirstFile(path.c_str(), &findData);
+  if (hFind == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  FindClose(hFind);
+  if (!(findData.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) ||
+      findData.dwReserved0 != IO_REPARSE_TAG_AF_UNIX) {
+    // some other file that isn't ours to remove
+    return false;
+  }
+  SOCKET sock = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (sock == INVALID_SOCKET) {
+    return false;
+  }
+  // another editor is still serving on a socket that accepts connections
+  bool refused = connect(sock, (const sockaddr *)&addr, sizeof(addr)) == SOCKET_ERROR &&
+    WSAGetLastError() == WSAECONNREFUSED;
+  closesocket(sock);
+  return refused;
+}
+
+VortexRPCServer::VortexRPCServer() :
+  m_methods(),
+  m_endpoint(),
+  m_isSocket(false),
+  m_hwnd(nullptr),
+  m_msg(0),
+  m_hThread(nullptr),
+  m_hPipe(nullptr),
+  m_hIOEvent(nullptr),
+  m_listenSock(INVALID_SOCKET),
+  m_clientSock(INVALID_SOCKET),
+  m_ownsSocketFile(false),
+  m_hDoneEvent(nullptr),
+  m_hQuitEvent(nullptr),
+  m_quit(false),
+  m_requests(),
+  m_responses(),
+  m_batchPending(0),
+  m_numCalls(0)
+{
+}
+
+VortexRPCServer::~VortexRPCServer()
+{
+  stop();
+}
+
+void VortexRPCServer::addMethod(const string &name, const Method &method)
+{
+  m_methods[name] = method;
+}
+
+bool VortexRPCServer::start(const string &endpoint, HWND hwnd, UINT msg)
+{
+  if (m_hThread) {
+    return true;
+  }
+  m_endpoint = endpoint;
+  // anything that isn't a pipe name is the path of a unix domain socket
+  m_isSocket = (endpoint.compare(0, 9, "\\\\.\\pipe\\") != 0);
+  m_hwnd = hwnd;
+  m_msg = msg;
+  m_quit = false;
+  m_hDoneEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+  m_hQuitEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+  if (!m_hDoneEvent || !m_hQuitEvent || !listenClient()) {
+    closeListen();
+    return false;
+  }
+  m_hThread = CreateThread(NULL, 0, serverThread, this, 0, NULL);
+  if (!m_hThread) {
+    closeListen();
+    return false;
+  }
+  return true;
+}
+
+void VortexRPCServer::stop()
+{
+  if (m_hThread) {
+    m_quit = true;
+    SetEvent(m_hQuitEvent);
+    WaitForSingleObject(m_hThread, INFINITE);
+    CloseHandle(m_hThread);
+    m_hThread = nullptr;
+  }
+  closeListen();
+  // a batch that was posted but never dispatched is dropped with the client
+  InterlockedExchange(&m_batchPending, 0);
+}
+
+void VortexRPCServer::dispatch()
+{
+  // the flag is taken first in case a method pumps messages, like a message
+  // box would, and this is re-entered before the batch is done
+  if (!InterlockedExchange(&m_batchPending, 0)) {
+    return;
+  }
+  for (const string &line : m_requests) {
+    string response;
+    if (handleRequest(line, response)) {
+      m_responses.push_back(response);
+    }
+  }
+  SetEvent(m_hDoneEvent);
+}
+
+DWORD __stdcall VortexRPCServer::serverThread(void *arg)
+{
+  ((VortexRPCServer *)arg)->serve();
+  return 0;
+}
+
+void VortexRPCServer::serve()
+{
+  vector<char> chunk(RPC_READ_SIZE);
+  string buffer;
+  while (!m_quit && acceptClient()) {
+    buffer.clear();
+    while (!m_quit) {
+      int32_t amount = readClient(chunk.data(), (uint32_t)chunk.size());
+      if (amount <= 0) {
+        break;
+      }
+      buffer.append(chunk.data(), amount);
+      // every complete line that is waiting goes in the same batch
+      m_requests.clear();
+      size_t start = 0;
+      size_t end = 0;
+      while ((end = buffer.find('\n', start)) != string::npos) {
+        m_requests.push_back(buffer.substr(start, end - start));
+        start = end + 1;
+      }
+      buffer.erase(0, start);
+      if (buffer.size() > RPC_MAX_REQUEST) {
+        // the client is told why before it's dropped, the rest of the
+        // request can't be read so there's no id to answer with
+        json response = { { "jsonrpc", "2.0" }, { "id", nullptr },
+          { "error", { { "code", RPC_INVALID_REQUEST }, { "message", "Request too large" } } } };
+        writeClient(response.dump() + "\n");
+        break;
+      }
+      if (!m_requests.size()) {
+        continue;
+      }
+      if (!runBatch()) {
+        break;
+      }
+      string output;
+      for (const string &response : m_responses) {
+        output += response;
+        output += '\n';
+      }
+      if (output.size() && !writeClient(output)) {
+        break;
+      }
+    }
+    closeClient();
+  }
+}
+
+bool VortexRPCServer::runBatch()
+{
+  m_responses.clear();
+  InterlockedExchange(&m_batchPending, 1);
+  if (!PostMessage(m_hwnd, m_msg, 0, 0)) {
+    InterlockedExchange(&m_batchPending, 0);
+    return false;
+  }
+  HANDLE handles[2] = { m_hDoneEvent, m_hQuitEvent };
+  return WaitForMultipleObjects(2, handles, FALSE, INFINITE) == WAIT_OBJECT_0;
+}
+
+bool VortexRPCServer::handleRequest(const string &line, string &outResponse)
+{
+  string text = line;
+  if (text.size() && text.back() == '\r') {
+    text.pop_back();
+  }
+  // blank lines between requests are allowed
+  if (text.find_first_not_of(" \t") == string::npos) {
+    return false;
+  }
+  m_numCalls++;
+  json response = { { "jsonrpc", "2.0" }, { "id", nullptr } };
+  json request = json::parse(text, nullptr, false);
+  bool notify = false;
+  if (request.is_discarded()) {
+    response["error"] = { { "code", RPC_PARSE_ERROR }, { "message", "Parse error" } };
+  } else if (!request.is_object() || !request.contains("method") || !request["method"].is_string()) {
+    if (request.is_object() && request.contains("id")) {
+      response["id"] = request["id"];
+    }
+    response["error"] = { { "code", RPC_INVALID_REQUEST }, { "message", "Invalid request" } };
+  } else {
+    notify = !request.contains("id");
+    if (!notify) {
+      response["id"] = request["id"];
+    }
+    auto method = m_methods.find(request["method"].get<string>());
+    if (method == m_methods.end()) {
+      response["error"] = { { "code", RPC_METHOD_NOT_FOUND }, { "message", "Method not found" } };
+    } else {
+      json params = request.contains("params") ? request["params"] : json::object();
+      json result;
+      try {
+        if (method->second(params, result)) {
+          response["result"] = result;
+        } else {
+          string msg = result.is_string() ? result.get<string>() : "Failed";
+          response["error"] = { { "code", RPC_METHOD_FAILED }, { "message", msg } };
+        }
+      } catch (const json::exception &e) {
+        // params of the wrong type
+        response["error"] = { { "code", RPC_INVALID_PARAMS }, { "message", e.what() } };
+      } catch (const exception &e) {
+        // anything else a method throws fails the request, not the editor
+        response["error"] = { { "code", RPC_INTERNAL_ERROR }, { "message", e.what() } };
+      }
+    }
+  }
+  if (notify) {
+    return false;
+  }
+  outResponse = response.dump(-1, ' ', false, json::error_handler_t::replace);
+  return true;
+}
+
+bool VortexRPCServer::listenClient()
+{
+  if (!m_isSocket) {
+    // only this editor can own the pipe and only local clients can use it
+    m_hPipe = CreateNamedPipe(m_endpoint.c_str(),
+      PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED | FILE_FLAG_FIRST_PIPE_INSTANCE,
+      PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+      1, RPC_READ_SIZE, RPC_READ_SIZE, 0, NULL);
+    if (m_hPipe == INVALID_HANDLE_VALUE) {
+      m_hPipe = nullptr;
+      return false;
+    }
+    m_hIOEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    return m_hIOEvent != nullptr;
+  }
+  sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (m_endpoint.size() >= sizeof(addr.sun_path)) {
+    return false;
+  }
+  memcpy(addr.sun_path, m_endpoint.c_str(), m_endpoint.size());
+  WSADATA wsaData;
+  if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+    return false;
+  }
+  SOCKET sock = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (sock == INVALID_SOCKET) {
+    WSACleanup();
+    return false;
+  }
+  // the socket file is left behind when the editor doesn't close properly,
+  // anything else at the path stays and the bind fails on it
+  if (isStaleSocket(m_endpoint, addr)) {
+    DeleteFile(m_endpoint.c_str());
+  }
+  if (bind(sock, (sockaddr *)&addr, sizeof(addr)) == SOCKET_ERROR) {
+    closesocket(sock);
+    WSACleanup();
+    return false;
+  }
+  m_ownsSocketFile = true;
+  m_listenSock = sock;
+  // clients that connect while another is served wait in the backlog
+  if (listen(sock, SOMAXCONN) == SOCKET_ERROR) {
+    closeListen();
+    return false;
+  }
+  return true;
+}
+
+void VortexRPCServer::closeListen()
+{
+  if (m_hPipe) {
+    CloseHandle(m_hPipe);
+    m_hPipe = nullptr;
+  }
+  if (m_hIOEvent) {
+    CloseHandle(m_hIOEvent);
+    m_hIOEvent = nullptr;
+  }
+  if (m_listenSock != INVALID_SOCKET) {
+    closesocket((SOCKET)m_listenSock);
+    m_listenSock = INVALID_SOCKET;
+    if (m_ownsSocketFile) {
+      DeleteFile(m_endpoint.c_str());
+      m_ownsSocketFile = false;
+    }
+    WSACleanup();
+  }
+  if (m_hDoneEvent) {
+    CloseHandle(m_hDoneEvent);
+    m_hDoneEvent = nullptr;
+  }
+  if (m_hQuitEvent) {
+    CloseHandle(m_hQuitEvent);
+    m_hQuitEvent = nullptr;
+  }
+}
+
+bool VortexRPCServer::acceptClient()
+{
+  if (m_isSocket) {
+    if (!waitSocket(m_listenSock)) {
+      return false;
+    }
+    SOCKET client = accept((SOCKET)m_listenSock, NULL, NULL);
+    if (client == INVALID_SOCKET) {
+      return false;
+    }
+    m_clientSock = client;
+    return true;
+  }
+  OVERLAPPED ov;
+  memset(&ov, 0, sizeof(ov));
+  ov.hEvent = m_hIOEvent;
+  ResetEvent(m_hIOEvent);
+  if (ConnectNamedPipe(m_hPipe, &ov)) {
+    return true;
+  }
+  DWORD err = GetLastError();
+  if (err == ERROR_PIPE_CONNECTED) {
+    return true;
+  }
+  DWORD bytes = 0;
+  return err == ERROR_IO_PENDING && waitPipe(ov, bytes);
+}
+
+int32_t VortexRPCServer::readClient(char *buf, uint32_t size)
+{
+  if (m_isSocket) {
+    if (!waitSocket(m_clientSock)) {
+      return -1;
+    }
+    return recv((SOCKET)m_clientSock, buf, (int)size, 0);
+  }
+  OVERLAPPED ov;
+  memset(&ov, 0, sizeof(ov));
+  ov.hEvent = m_hIOEvent;
+  ResetEvent(m_hIOEvent);
+  DWORD bytes = 0;
+  if (!ReadFile(m_hPipe, buf, size, &bytes, &ov)) {
+    if (GetLastError() != ERROR_IO_PENDING || !waitPipe(ov, bytes)) {
+      // the client closed the pipe or the server is stopping
+      return -1;
+    }
+  }
+  return (int32_t)bytes;
+}
+
+bool VortexRPCServer::writeClient(const string &data)
+{
+  size_t offset = 0;
+  while (offset < data.size()) {
+    uint32_t size = RPC_READ_SIZE;
+    if (data.size() - offset < size) {
+      size = (uint32_t)(data.size() - offset);
+    }
+    DWORD bytes = 0;
+    if (m_isSocket) {
+      int sent = send((SOCKET)m_clientSock, data.c_str() + offset, (int)size, 0);
+      if (sent <= 0) {
+        return false;
+      }
+      bytes = (DWORD)sent;
+    } else {
+      OVERLAPPED ov;
+      memset(&ov, 0, sizeof(ov));
+      ov.hEvent = m_hIOEvent;
+      ResetEvent(m_hIOEvent);
+      if (!WriteFile(m_hPipe, data.c_str() + offset, size, &bytes, &ov)) {
+        if (GetLastError() != ERROR_IO_PENDING || !waitPipe(ov, bytes)) {
+          return false;
+        }
+      }
+    }
+    offset += bytes;
+  }
+  return true;
+}
+
+void VortexRPCServer::closeClient()
+{
+  if (m_isSocket) {
+    if (m_clientSock != INVALID_SOCKET) {
+      closesocket((SOCKET)m_clientSock);
+      m_clientSock = INVALID_SOCKET;
+    }
+    return;
+  }
+  DisconnectNamedPipe(m_hPipe);
+}
+
+bool VortexRPCServer::waitPipe(OVERLAPPED &ov, DWORD &outBytes)
+{
+  HANDLE handles[2] = { ov.hEvent, m_hQuitEvent };
+  if (WaitForMultipleObjects(2, handles, FALSE, INFINITE) != WAIT_OBJECT_0) {
+    // the operation has to finish cancelling before the overlapped is gone
+    CancelIo(m_hPipe);
+    GetOverlappedResult(m_hPipe, &ov, &outBytes, TRUE);
+    return false;
+  }
+  return GetOverlappedResult(m_hPipe, &ov, &outBytes, FALSE) != FALSE;
+}
+
+bool VortexRPCServer::waitSocket(uintptr_t sock)
+{
+  // blocking socket calls can't be interrupted so wait in short steps
+  while (!m_quit) {
+    fd_set fds;
+    FD_ZERO(&fds);
+    FD_SET((SOCKET)sock, &fds);
+    timeval timeout = { 0, RPC_POLL_MS * 1000 };
+    int res = select(0, &fds, NULL, NULL, &timeout);
+    if (res < 0) {
+      return false;
+    }
+    if (res > 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+string VortexRPCServer::encodeBase64(const void *data, size_t size)
+{
+  static const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  const uint8_t *bytes = (const uint8_t *)data;
+  string text;
+  text.reserve(((size + 2) / 3) * 4);
+  for (size_t i = 0; i < size; i += 3) {
+    uint32_t chunk = (uint32_t)bytes[i] << 16;
+    if (i + 1 < size) {
+      chunk |= (uint32_t)bytes[i + 1] << 8;
+    }
+    if (i + 2 < size) {
+      chunk |= bytes[i + 2];
+    }
+    text += table[(chunk >> 18) & 0x3F];
+    text += table[(chunk >> 12) & 0x3F];
+    text += (i + 1 < size) ? table[(chunk >> 6) & 0x3F] : '=';
+    text += (i + 2 < size) ? table[chunk & 0x3F] : '=';
+  }
+  return text;
+}
+
+bool VortexRPCServer::decodeBase64(const string &text, vector<uint8_t> &outData)
+{
+  outData.clear();
+  outData.reserve((text.size() / 4) * 3);
+  uint32_t chunk = 0;
+  uint32_t numBits = 0;
+  for (char c : text) {
+    uint32_t val = 0;
+    if (c >= 'A' && c <= 'Z') {
+      val = c - 'A';
+    } else if (c >= 'a' && c <= 'z') {
+      val = c - 'a' + 26;
+    } else if (c >= '0' && c <= '9') {
+      val = c - '0' + 52;
+    } else if (c == '+') {
+      val = 62;
+    } else if (c == '/') {
+      val = 63;
+    } else if (c == '=') {
+      break;
+    } else {
+      return false;
+    }
+    chunk = (chunk << 6) | val;
+    numBits += 6;
+    if (numBits >= 8) {
+      numBits -= 8;
+      outData.push_back((uint8_t)(chunk >> numBits));
+    }
+  }
+  return true;
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+// windows includes
+#include <windows.h>
+
+#include <stdint.h>
+#include <functional>
+#include <string>
+#include <vector>
+#include <map>
+
+#include "json.hpp"
+
+// the endpoint the editor listens on unless another is given
+#define RPC_DEFAULT_ENDPOINT "\\\\.\\pipe\\VortexEditor"
+
+// A local JSON-RPC 2.0 endpoint so that scripts and tests can drive the
+// editor without clicking through the window.
+//
+// Clients connect to a named pipe, or a unix domain socket when the endpoint
+// is a path on disk, and write one request object per line. A worker thread
+// reads every request that is waiting and hands the whole batch to the ui
+// thread with a single posted message, the methods then run on the ui thread
+// exactly as if the action came from the editor window. Clients can pipeline
+// as many requests as they like without waiting, the responses are written
+// back one per line in the same order. Requests without an id are
+// notifications and get no response.
+//
+// Only one client is served at a time, the next client connects once the
+// current one disconnects.
+class VortexRPCServer
+{
+public:
+  VortexRPCServer();
+  ~VortexRPCServer();
+
+  // a method is given the params of the request and fills out the result,
+  // if it returns false the result is used as the error message instead
+  typedef std::function<bool(const json &params, json &outResult)> Method;
+
+  void addMethod(const std::string &name, const Method &method);
+
+  // start listening on the endpoint, each batch of requests is posted to
+  // the window with the given message so it can call dispatch()
+  bool start(const std::string &endpoint, HWND hwnd, UINT msg);
+  void stop();
+
+  bool isRunning() const { return m_hThread != nullptr; }
+
+  // run the batch of requests that is waiting, on the ui thread
+  void dispatch();
+
+  // the number of requests handled since the server started
+  uint64_t numCalls() const { return m_numCalls; }
+
+  // binary data like modes is passed around as base64
+  static std::string encodeBase64(const void *data, size_t size);
+  static bool decodeBase64(const std::string &text, std::vector<uint8_t> &outData);
+
+private:
+  static DWORD __stdcall serverThread(void *arg);
+  void serve();
+
+  // the client connection is either a pipe or a socket
+  bool listenClient();
+  bool acceptClient();
+  int32_t readClient(char *buf, uint32_t size);
+  bool writeClient(const std::string &data);
+  void closeClient();
+  void closeListen();
+  // wait for an operation on the client, returns false if the server is
+  // stopping while waiting
+  bool waitPipe(OVERLAPPED &ov, DWORD &outBytes);
+  bool waitSocket(uintptr_t sock);
+
+  // hand the requests to the ui thread and wait for the responses, returns
+  // false if the server is stopping
+  bool runBatch();
+
+  // handle a single request line, returns false for a notification
+  bool handleRequest(const std::string &line, std::string &outResponse);
+
+  std::map<std::string, Method> m_methods;
+
+  std::string m_endpoint;
+  bool m_isSocket;
+  HWND m_hwnd;
+  UINT m_msg;
+
+  HANDLE m_hThread;
+  HANDLE m_hPipe;
+  HANDLE m_hIOEvent;
+  uintptr_t m_listenSock;
+  uintptr_t m_clientSock;
+  // whether the socket file on disk was created by this server
+  bool m_ownsSocketFile;
+
+  // signaled by the ui thread once a batch is done and to stop the server
+  HANDLE m_hDoneEvent;
+  HANDLE m_hQuitEvent;
+  volatile bool m_quit;
+
+  // the batch being handed between the threads, only one batch is ever
+  // in flight so the worker owns it until it is posted and the ui thread
+  // owns it until it signals the done event
+  std::vector<std::string> m_requests;
+  std::vector<std::string> m_responses;
+  volatile LONG m_batchPending;
+
+  uint64_t m_numCalls;
+};
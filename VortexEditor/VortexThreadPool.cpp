@@ -0,0 +1,132 @@
+#include "VortexThreadPool.h"
+
+using namespace std;
+
+VortexThreadPool::VortexThreadPool() :
+  m_workers(),
+  m_hDoneEvent(nullptr),
+  m_quit(false),
+  m_pJob(nullptr),
+  m_count(0),
+  m_nextIndex(0),
+  m_numActive(0)
+{
+}
+
+VortexThreadPool::~VortexThreadPool()
+{
+  cleanup();
+}
+
+bool VortexThreadPool::init(uint32_t numWorkers)
+{
+  if (m_workers.size()) {
+    return true;
+  }
+  if (!numWorkers) {
+    SYSTEM_INFO sysInfo;
+    GetSystemInfo(&sysInfo);
+    numWorkers = sysInfo.dwNumberOfProcessors ? sysInfo.dwNumberOfProcessors : 1;
+  }
+  m_quit = false;
+  m_hDoneEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+  if (!m_hDoneEvent) {
+    return false;
+  }
+  // the workers must not move once the threads are running
+  m_workers.resize(numWorkers);
+  uint32_t numStarted = 0;
+  for (; numStarted < numWorkers; ++numStarted) {
+    Worker &worker = m_workers[numStarted];
+    worker.pool = this;
+    worker.index = numStarted;
+    worker.hStartEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+    worker.hThread = worker.hStartEvent ? CreateThread(NULL, 0, workerThread, &worker, 0, NULL) : nullptr;
+    if (!worker.hThread) {
+      if (worker.hStartEvent) {
+        CloseHandle(worker.hStartEvent);
+      }
+      break;
+    }
+  }
+  // every worker in the list is waited on by parallelFor so only keep the
+  // ones that are actually running, shrinking doesn't move them
+  m_workers.resize(numStarted);
+  if (!numStarted) {
+    // parallelFor runs the jobs on the calling thread instead
+    CloseHandle(m_hDoneEvent);
+    m_hDoneEvent = nullptr;
+    return false;
+  }
+  return true;
+}
+
+void VortexThreadPool::cleanup()
+{
+  if (!m_workers.size()) {
+    return;
+  }
+  m_quit = true;
+  for (Worker &worker : m_workers) {
+    SetEvent(worker.hStartEvent);
+  }
+  for (Worker &worker : m_workers) {
+    if (worker.hThread) {
+      WaitForSingleObject(worker.hThread, INFINITE);
+      CloseHandle(worker.hThread);
+    }
+    CloseHandle(worker.hStartEvent);
+  }
+  m_workers.clear();
+  CloseHandle(m_hDoneEvent);
+  m_hDoneEvent = nullptr;
+}
+
+void VortexThreadPool::parallelFor(uint32_t count, const Job &job)
+{
+  if (!count) {
+    return;
+  }
+  // without any workers just run the jobs here
+  if (!m_workers.size()) {
+    for (uint32_t i = 0; i < count; ++i) {
+      job(i, 0);
+    }
+    return;
+  }
+  m_pJob = &job;
+  m_count = count;
+  m_nextIndex = 0;
+  m_numActive = (LONG)m_workers.size();
+  for (Worker &worker : m_workers) {
+    SetEvent(worker.hStartEvent);
+  }
+  WaitForSingleObject(m_hDoneEvent, INFINITE);
+  m_pJob = nullptr;
+}
+
+DWORD __stdcall VortexThreadPool::workerThread(void *arg)
+{
+  Worker *worker = (Worker *)arg;
+  worker->pool->work(worker->index);
+  return 0;
+}
+
+void VortexThreadPool::work(uint32_t worker)
+{
+  while (true) {
+    WaitForSingleObject(m_workers[worker].hStartEvent, INFINITE);
+    if (m_quit) {
+      break;
+    }
+    // each worker pulls the next job until they are all taken
+    LONG index;
+    while ((index = InterlockedIncrement(&m_nextIndex) - 1) < (LONG)m_count) {
+      (*m_pJob)((uint32_t)index, worker);
+    }
+    // the last worker out wakes up the caller
+    if (InterlockedDecrement(&m_numActive) == 0) {
+      SetEvent(m_hDoneEvent);
+    }
+  }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+// windows includes
+#include <windows.h>
+
+#include <stdint.h>
+#include <atomic>
+#include <functional>
+#include <vector>
+
+// A fixed set of worker threads for splitting a batch of independent jobs
+// across every core, parallelFor() blocks until the whole batch is done.
+// Each job is given the index of the worker running it so that callers can
+// keep per-worker state like a scratch engine without any locking
+class VortexThreadPool
+{
+public:
+  VortexThreadPool();
+  ~VortexThreadPool();
+
+  // start the workers, by default one per core
+  bool init(uint32_t numWorkers = 0);
+  void cleanup();
+
+  uint32_t numWorkers() const { return (uint32_t)m_workers.size(); }
+
+  // the job to run, called with the index of the job and the worker
+  typedef std::function<void(uint32_t index, uint32_t worker)> Job;
+
+  // run the job count times spread across the workers
+  void parallelFor(uint32_t count, const Job &job);
+
+private:
+  static DWORD __stdcall workerThread(void *arg);
+  void work(uint32_t worker);
+
+  struct Worker
+  {
+    VortexThreadPool *pool;
+    uint32_t index;
+    HANDLE hThread;
+    // signaled to start the worker on a batch
+    HANDLE hStartEvent;
+  };
+  std::vector<Worker> m_workers;
+
+  // signaled by the last worker to finish a batch
+  HANDLE m_hDoneEvent;
+  // read by the workers when they wake up, outside of any lock
+  std::atomic<bool> m_quit;
+
+  // the current batch
+  const Job *m_pJob;
+  uint32_t m_count;
+  volatile LONG m_nextIndex;
+  volatile LONG m_numActive;
+};
@@ -0,0 +1,179 @@
+#include "VortexTimeline.h"
+#include "VortexModeHash.h"
+
+// VortexEngine includes
+#include "Serial/ByteStream.h"
+#include "Colors/ColorTypes.h"
+#include "VortexLib.h"
+
+#include <algorithm>
+#include <map>
+
+using namespace std;
+
+// the shared timelines by mode, only kept while something holds them
+static map<uint64_t, weak_ptr<const VortexTimeline>> g_timelines;
+static SRWLOCK g_timelineLock = SRWLOCK_INIT;
+
+VortexTimeline::VortexTimeline() :
+  m_runs(),
+  m_length(0),
+  m_loopStart(0),
+  m_loopRun(0),
+  m_isExact(false)
+{
+}
+
+bool VortexTimeline::record(Vortex &vortex, uint32_t led)
+{
+  // the engine belongs to the caller so it gets back the timestep it had
+  bool wasInstant = vortex.isInstantTimestep();
+  vortex.setInstantTimestep(true);
+  vector<uint32_t> colors;
+  colors.reserve(TIMELINE_MIN_TICKS);
+  uint32_t loopStart = 0;
+  uint32_t period = 0;
+  // keep recording until a loop turns up, most patterns loop within a
+  // few hundred ticks but some take a lot longer to come back around
+  for (uint32_t numTicks = TIMELINE_MIN_TICKS; ; numTicks *= 2) {
+    while (colors.size() < numTicks) {
+      vortex.engine().tick();
+      colors.push_back(vortex.engine().leds().getLed((LedPos)led).raw());
+    }
+    m_isExact = findLoop(colors, loopStart, period);
+    if (m_isExact || numTicks >= TIMELINE_MAX_TICKS) {
+      break;
+    }
+  }
+  vortex.setInstantTimestep(wasInstant);
+  if (!m_isExact) {
+    // no loop, just play the whole recording over and over
+    loopStart = 0;
+    period = (uint32_t)colors.size();
+  }
+  m_length = loopStart + period;
+  m_loopStart = loopStart;
+  m_loopRun = 0;
+  m_runs.clear();
+  for (uint32_t i = 0; i < m_length; ++i) {
+    if (!m_runs.size() || m_runs.back().color != colors[i]) {
+      m_runs.push_back({ i, colors[i] });
+    }
+    if (i == m_loopStart) {
+      m_loopRun = (uint32_t)m_runs.size() - 1;
+    }
+  }
+  return m_length > 0;
+}
+
+shared_ptr<const VortexTimeline> VortexTimeline::get(Vortex &vortex, uint32_t tickrate, uint32_t led)
+{
+  ByteStream mode;
+  if (!vortex.getCurMode(mode)) {
+    return nullptr;
+  }
+  // the same mode recorded at another rate or on another led is different
+  uint32_t params[2] = { tickrate, led };
+  uint64_t key = VortexModeHash::hash(params, sizeof(params), VortexModeHash::hashMode(mode));
+  AcquireSRWLockShared(&g_timelineLock);
+  auto it = g_timelines.find(key);
+  shared_ptr<const VortexTimeline> timeline = (it != g_timelines.end()) ? it->second.lock() : nullptr;
+  ReleaseSRWLockShared(&g_timelineLock);
+  if (timeline) {
+    return timeline;
+  }
+  // record outside of the lock, at worst two widgets record the same mode
+  shared_ptr<VortexTimeline> recorded = make_shared<VortexTimeline>();
+  if (!recorded->record(vortex, led)) {
+    return nullptr;
+  }
+  AcquireSRWLockExclusive(&g_timelineLock);
+  // drop the timelines that nothing is showing anymore
+  for (auto entry = g_timelines.begin(); entry != g_timelines.end(); ) {
+    if (entry->second.expired()) {
+      entry = g_timelines.erase(entry);
+    } else {
+      ++entry;
+    }
+  }
+  g_timelines[key] = recorded;
+  ReleaseSRWLockExclusive(&g_timelineLock);
+  return recorded;
+}
+
+uint32_t VortexTimeline::colorAt(uint64_t tick) const
+{
+  if (!m_runs.size()) {
+    return 0;
+  }
+  return m_runs[seek(tick).run].color;
+}
+
+VortexTimeline::Cursor VortexTimeline::seek(uint64_t tick) const
+{
+  Cursor cursor = { 0, 0 };
+  if (!m_runs.size()) {
+    return cursor;
+  }
+  if (tick >= m_length) {
+    tick = m_loopStart + ((tick - m_loopStart) % (m_length - m_loopStart));
+  }
+  // the last run that starts at or before the tick
+  auto it = upper_bound(m_runs.begin(), m_runs.end(), (uint32_t)tick,
+    [](uint32_t t, const Run &run) { return t < run.start; });
+  cursor.tick = (uint32_t)tick;
+  cursor.run = (uint32_t)(it - m_runs.begin()) - 1;
+  return cursor;
+}
+
+uint32_t VortexTimeline::next(Cursor &cursor) const
+{
+  if (!m_runs.size()) {
+    return 0;
+  }
+  if (cursor.tick >= m_length) {
+    cursor.tick = m_loopStart;
+    cursor.run = m_loopRun;
+  }
+  while (cursor.run + 1 < m_runs.size() && m_runs[cursor.run + 1].start <= cursor.tick) {
+    cursor.run++;
+  }
+  cursor.tick++;
+  return m_runs[cursor.run].color;
+}
+
+bool VortexTimeline::findLoop(const vector<uint32_t> &colors, uint32_t &outStart, uint32_t &outPeriod)
+{
+  // skip the first quarter in case the pattern has an intro, the prefix
+  // function of the rest gives the smallest period that fits all of it
+  uint32_t skip = (uint32_t)colors.size() / 4;
+  const uint32_t *tail = colors.data() + skip;
+  uint32_t len = (uint32_t)colors.size() - skip;
+  if (!len) {
+    return false;
+  }
+  vector<uint32_t> prefix(len, 0);
+  for (uint32_t i = 1; i < len; ++i) {
+    uint32_t k = prefix[i - 1];
+    while (k > 0 && tail[i] != tail[k]) {
+      k = prefix[k - 1];
+    }
+    if (tail[i] == tail[k]) {
+      k++;
+    }
+    prefix[i] = k;
+  }
+  uint32_t period = len - prefix[len - 1];
+  // the loop has to be seen at least twice to be believed
+  if (period > len / 2) {
+    return false;
+  }
+  // walk the start of the loop back into the skipped part as far as it goes
+  uint32_t start = skip;
+  while (start > 0 && colors[start - 1] == colors[start - 1 + period]) {
+    start--;
+  }
+  outStart = start;
+  outPeriod = period;
+  return true;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+// windows includes
+#include <windows.h>
+
+#include <stdint.h>
+#include <memory>
+#include <vector>
+
+class Vortex;
+
+// the least and most ticks simulated to find the loop of a pattern
+#define TIMELINE_MIN_TICKS 4096
+#define TIMELINE_MAX_TICKS 32768
+
+// The colors of a single led of a mode simulated once, so that previews can
+// loop the recording instead of ticking an engine forever.
+//
+// The colors are stored run length encoded, one run per change of color,
+// which for most patterns is a few hundred runs. Once recorded the loop of
+// the pattern is found so the timeline is an intro followed by a loop that
+// repeats forever. Patterns without a loop that fits in the recording,
+// like the random patterns, just restart the recording from the top.
+//
+// Every preview of the same mode shares the same timeline through get(),
+// timelines are only kept around while something is still showing them.
+class VortexTimeline
+{
+public:
+  VortexTimeline();
+
+  // position of a playback in the timeline
+  struct Cursor
+  {
+    uint32_t tick;
+    uint32_t run;
+  };
+
+  // simulate the current mode of the engine from it's current state, the
+  // engine runs with an instant timestep while recording to go as fast as
+  // possible and is put back to it's own timestep afterwards
+  bool record(Vortex &vortex, uint32_t led = 0);
+
+  // the shared timeline of the current mode of the engine at the tickrate
+  // it runs at, it is recorded with the engine if nothing else has
+  // recorded the same mode yet
+  static std::shared_ptr<const VortexTimeline> get(Vortex &vortex, uint32_t tickrate, uint32_t led = 0);
+
+  // the color at any tick, after the end it loops forever
+  uint32_t colorAt(uint64_t tick) const;
+  // a cursor at any tick, for playing from the middle of the timeline
+  Cursor seek(uint64_t tick) const;
+  // the color at the cursor then advance the cursor by one tick
+  uint32_t next(Cursor &cursor) const;
+
+  // the ticks before the loop starts, and the length of the loop
+  uint32_t introLength() const { return m_loopStart; }
+  uint32_t loopLength() const { return m_length - m_loopStart; }
+  // whether the loop is the real period of the pattern or just the recording
+  bool isExact() const { return m_isExact; }
+  uint32_t numRuns() const { return (uint32_t)m_runs.size(); }
+
+private:
+  // find the smallest period of the colors that repeats at least twice
+  // and the earliest tick the repeating starts at
+  static bool findLoop(const std::vector<uint32_t> &colors, uint32_t &outStart, uint32_t &outPeriod);
+
+  struct Run
+  {
+    // the tick this color starts at
+    uint32_t start;
+    uint32_t color;
+  };
+  std::vector<Run> m_runs;
+  uint32_t m_length;
+  uint32_t m_loopStart;
+  // the run that is playing when the loop starts over
+  uint32_t m_loopRun;
+  bool m_isExact;
+};
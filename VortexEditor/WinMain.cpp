@@ -1,11 +1,22 @@
 #include <Windows.h>
+#include <string.h>
 
 #include "VortexEditor.h"
+#include "VortexCLI.h"
 
 int __stdcall WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine, int nShowCmd)
 {
+  // command line tasks run without opening the editor
+  int exitCode = 0;
+  if (VortexCLI::run(__argc, __argv, exitCode)) {
+    return exitCode;
+  }
+  // a headless editor is only driven through the automation endpoint:
+  //   VortexEditor.exe --headless [pipe name or socket path]
+  bool headless = (__argc > 1 && strcmp(__argv[1], "--headless") == 0);
+  std::string endpoint = (headless && __argc > 2) ? __argv[2] : RPC_DEFAULT_ENDPOINT;
   VortexEditor editor;
-  editor.init(hInstance);
+  editor.init(hInstance, headless, endpoint);
   editor.run();
   return 0;
 }
\ No newline at end of file
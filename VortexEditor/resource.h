@@ -67,13 +67,21 @@
 #define ID_CHOOSE_DEVICE_CHROMADECK     40071
 #define ID_CHOOSE_DEVICE_SPARK          40072
 #define ID_CHOOSE_DEVICE_DUO            40073
+#define ID_TOOLS_MODE_LIBRARY           40074
+#define ID_FILE_EXPORT_ALL              40075
+#define ID_EDIT_COPY_MODE               40076
+#define ID_EDIT_COPY_ALL_MODES          40077
+#define ID_EDIT_PASTE_MODES             40078
+#define ID_TOOLS_MODE_SEARCH            40079
+#define ID_EDIT_COLORSET_TO_ALL_MODES   40080
+#define ID_EDIT_PATTERN_TO_ALL_MODES    40081
 
 // Next default values for new objects
 // 
 #ifdef APSTUDIO_INVOKED
 #ifndef APSTUDIO_READONLY_SYMBOLS
 #define _APS_NEXT_RESOURCE_VALUE        117
-#define _APS_NEXT_COMMAND_VALUE         40074
+#define _APS_NEXT_COMMAND_VALUE         40082
 #define _APS_NEXT_CONTROL_VALUE         1001
 #define _APS_NEXT_SYMED_VALUE           101
 #endif